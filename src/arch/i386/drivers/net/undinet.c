@@ -532,6 +532,12 @@ int undinet_probe ( struct undi_device *undi ) {
 	DBGC ( undinic, "UNDINIC %p is %s on IRQ %d\n",
 	       undinic, eth_ntoa ( netdev->hw_addr ), undinic->irq );
 
+	/* Interrupts are serviced by undiisr and undinet_poll(), so
+	 * the IRQ may also be used to wake from idle.
+	 */
+	undi->dev.desc.irq = undinic->irq;
+	netdev->features |= NETDEV_F_IRQ;
+
 	/* Get interface information */
 	memset ( &undi_iface, 0, sizeof ( undi_iface ) );
 	if ( ( rc = pxeparent_call ( undinet_entry, PXENV_UNDI_GET_IFACE_INFO,
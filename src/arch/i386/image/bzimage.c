@@ -36,7 +36,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/image.h>
 #include <gpxe/segment.h>
 #include <gpxe/init.h>
-#include <gpxe/cpio.h>
+#include <gpxe/initrd.h>
 #include <gpxe/features.h>
 
 FEATURE ( FEATURE_IMAGE, "bzImage", DHCP_EB_FEATURE_BZIMAGE, 1 );
@@ -333,37 +333,17 @@ static int bzimage_set_cmdline ( struct image *image,
 static size_t bzimage_load_initrd ( struct image *image,
 				    struct image *initrd,
 				    userptr_t address ) {
-	char *filename = initrd->cmdline;
-	struct cpio_header cpio;
-        size_t offset = 0;
+	size_t offset;
 
 	/* Do not include kernel image itself as an initrd */
 	if ( initrd == image )
 		return 0;
 
 	/* Create cpio header before non-prebuilt images */
-	if ( filename && filename[0] ) {
-		size_t name_len = ( strlen ( filename ) + 1 );
-
+	offset = initrd_header ( initrd, address );
+	if ( offset && address ) {
 		DBGC ( image, "bzImage %p inserting initrd %p as %s\n",
-		       image, initrd, filename );
-		memset ( &cpio, '0', sizeof ( cpio ) );
-		memcpy ( cpio.c_magic, CPIO_MAGIC, sizeof ( cpio.c_magic ) );
-		cpio_set_field ( cpio.c_mode, 0100644 );
-		cpio_set_field ( cpio.c_nlink, 1 );
-		cpio_set_field ( cpio.c_filesize, initrd->len );
-		cpio_set_field ( cpio.c_namesize, name_len );
-		if ( address ) {
-			copy_to_user ( address, offset, &cpio,
-				       sizeof ( cpio ) );
-		}
-		offset += sizeof ( cpio );
-		if ( address ) {
-			copy_to_user ( address, offset, filename,
-				       name_len );
-		}
-		offset += name_len;
-		offset = ( ( offset + 0x03 ) & ~0x03 );
+		       image, initrd, initrd->cmdline );
 	}
 
 	/* Copy in initrd image body */
@@ -393,8 +373,24 @@ static int bzimage_load_initrds ( struct image *image,
 	struct image *initrd;
 	size_t total_len = 0;
 	physaddr_t address;
+	userptr_t region;
 	int rc;
 
+	/* Use the initrd region as-is if it already holds exactly the
+	 * initrds we need, and lies within the kernel's range.
+	 */
+	if ( ( initrd_region ( image, &region, &total_len ) == 0 ) &&
+	     ( ( user_to_phys ( region, total_len ) - 1 ) <=
+	       bzimg->mem_limit ) ) {
+		bzimg->ramdisk_image = user_to_phys ( region, 0 );
+		bzimg->ramdisk_size = total_len;
+		DBGC ( image, "bzImage %p using initrd region at [%lx,%lx)\n",
+		       image, user_to_phys ( region, 0 ),
+		       user_to_phys ( region, total_len ) );
+		return 0;
+	}
+	total_len = 0;
+
 	/* Add up length of all initrd images */
 	for_each_image ( initrd )
 		total_len += bzimage_load_initrd ( image, initrd, UNULL );
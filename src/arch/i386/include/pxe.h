@@ -68,6 +68,7 @@ union u_PXENV_ANY {
 	struct s_PXENV_FILE_EXEC		file_exec;
 	struct s_PXENV_FILE_API_CHECK		file_api_check;
 	struct s_PXENV_FILE_EXIT_HOOK		file_exit_hook;
+	struct s_PXENV_FILE_READ_FLAT		file_read_flat;
 };
 
 typedef union u_PXENV_ANY PXENV_ANY_t;
@@ -1800,6 +1800,31 @@ extern PXENV_EXIT_t pxenv_file_exit_hook ( struct s_PXENV_FILE_EXIT_HOOK *file_e
 
 /** @} */ /* pxenv_file_exit_hook */
 
+/** @defgroup pxenv_file_read_flat PXENV_FILE_READ_FLAT
+ *
+ * FILE READ FLAT
+ *
+ * @{
+ */
+
+/** PXE API function code for pxenv_file_read_flat() */
+#define PXENV_FILE_READ_FLAT		0x00e8
+
+/** Parameter block for pxenv_file_read_flat() */
+struct s_PXENV_FILE_READ_FLAT {
+	PXENV_STATUS_t Status;		/**< PXE status code */
+	UINT16_t FileHandle;		/**< File handle */
+	UINT32_t BufferSize;		/**< Data buffer size */
+	ADDR32_t Buffer;		/**< Data buffer physical address */
+} __attribute__ (( packed ));
+
+typedef struct s_PXENV_FILE_READ_FLAT PXENV_FILE_READ_FLAT_t;
+
+extern PXENV_EXIT_t pxenv_file_read_flat ( struct s_PXENV_FILE_READ_FLAT
+					   *file_read_flat );
+
+/** @} */ /* pxenv_file_read_flat */
+
 /** @} */ /* pxe_file_api */
 
 /** @defgroup pxe_loader_api PXE Loader API
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <realmode.h>
+#include <basemem.h>
+#include <gpxe/init.h>
+#include <gpxe/imgcache.h>
+
+/** @file
+ *
+ * BIOS image cache anchor
+ *
+ * The head of the image cache chain is recorded in an anchor
+ * structure within gPXE's hidden base memory.  An instance of gPXE
+ * chainloaded by this one (e.g. undionly.kpxe) will find the anchor
+ * by scanning the base memory above its own, in the same way that
+ * NBPs locate the !PXE structure, and can then use the cached images
+ * held in this instance's hidden external memory.
+ *
+ * The anchor is erased on shutdown, since the memory containing both
+ * the anchor and the cache is then returned to the system.
+ */
+
+/** Image cache anchor signature */
+#define IMGCACHE_ANCHOR_SIGNATURE "gPXEIMGC"
+
+/** Image cache anchor */
+struct gpxe_imgcache_anchor {
+	/** Signature */
+	char signature[8];
+	/** Physical address of first image cache entry */
+	uint32_t head;
+	/** Reserved */
+	uint8_t reserved[3];
+	/** Checksum (makes bytewise sum of anchor zero) */
+	uint8_t checksum;
+} __attribute__ (( packed ));
+
+/** The image cache anchor */
+static struct gpxe_imgcache_anchor __data16 ( imgcache_anchor )
+	__attribute__ (( aligned ( 16 ) ));
+#define imgcache_anchor __use_data16 ( imgcache_anchor )
+
+/**
+ * Calculate image cache anchor checksum
+ *
+ * @v anchor		Image cache anchor
+ * @ret sum		Bytewise sum of anchor
+ */
+static uint8_t
+imgcache_anchor_checksum ( struct gpxe_imgcache_anchor *anchor ) {
+	uint8_t *bytes = ( ( uint8_t * ) anchor );
+	uint8_t sum = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < sizeof ( *anchor ) ; i++ )
+		sum += bytes[i];
+	return sum;
+}
+
+/**
+ * Publish head of image cache chain
+ *
+ * @v head		Physical address of first entry, or zero
+ */
+void imgcache_publish ( physaddr_t head ) {
+
+	memset ( &imgcache_anchor, 0, sizeof ( imgcache_anchor ) );
+	if ( ! head )
+		return;
+	memcpy ( imgcache_anchor.signature, IMGCACHE_ANCHOR_SIGNATURE,
+		 sizeof ( imgcache_anchor.signature ) );
+	imgcache_anchor.head = head;
+	imgcache_anchor.checksum -=
+		imgcache_anchor_checksum ( &imgcache_anchor );
+}
+
+/**
+ * Find image cache anchor left by a previous instance
+ *
+ * @ret head		Physical address of first entry, or zero
+ */
+static physaddr_t bios_find_imgcache ( void ) {
+	struct gpxe_imgcache_anchor anchor;
+	unsigned int segment;
+
+	/* Scan hidden base memory above our own */
+	for ( segment = ( get_fbms() << 6 ) ; segment < 0xa000 ; segment++ ) {
+		copy_from_real ( &anchor, segment, 0, sizeof ( anchor ) );
+		if ( memcmp ( anchor.signature, IMGCACHE_ANCHOR_SIGNATURE,
+			      sizeof ( anchor.signature ) ) != 0 )
+			continue;
+		if ( imgcache_anchor_checksum ( &anchor ) != 0 )
+			continue;
+		if ( ! anchor.head )
+			continue;
+		DBG ( "IMGCACHE found anchor at %04x:0000\n", segment );
+		return anchor.head;
+	}
+	return 0;
+}
+
+/**
+ * Import image cache from previous instance and publish anchor
+ *
+ */
+static void bios_imgcache_startup ( void ) {
+	imgcache_import ( bios_find_imgcache() );
+}
+
+/**
+ * Erase image cache anchor
+ *
+ * @v flags		Shutdown flags
+ */
+static void bios_imgcache_shutdown ( int flags __unused ) {
+	memset ( &imgcache_anchor, 0, sizeof ( imgcache_anchor ) );
+}
+
+/** Image cache anchor startup function */
+struct startup_fn bios_imgcache_startup_fn __startup_fn ( STARTUP_NORMAL ) = {
+	.startup = bios_imgcache_startup,
+	.shutdown = bios_imgcache_shutdown,
+};
@@ -1,8 +1,47 @@
+#include <string.h>
+#include <gpxe/io.h>
 #include <gpxe/nap.h>
 #include <realmode.h>
+#include <biosint.h>
+#include <pic8259.h>
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+/** Length of each napisr entry point */
+#define NAPISR_STUB_LEN 8
+
+/** napisr entry points (one per interrupt line) */
+extern char napisr_stubs[];
+
+/** IRQ chain vectors */
+struct segoff __data16_array ( napisr_next_handlers, [ IRQ_MAX + 1 ] );
+#define napisr_next_handlers __use_data16 ( napisr_next_handlers )
+
+/** Interrupt lines currently hooked (bitmask) */
+uint16_t __data16 ( napisr_active ) = 0;
+#define napisr_active __use_data16 ( napisr_active )
+
+/** Interrupt lines which have triggered (bitmask) */
+volatile uint16_t __data16 ( napisr_triggered ) = 0;
+#define napisr_triggered __use_data16 ( napisr_triggered )
+
+/** Number of users of each hooked interrupt line */
+static unsigned int napisr_users[ IRQ_MAX + 1 ];
+
+/** Interrupt lines which were enabled before being hooked (bitmask) */
+static uint16_t napisr_was_enabled;
+
+/**
+ * Get napisr entry point for interrupt line
+ *
+ * @v irq		Interrupt line
+ * @ret handler		Offset within .text16 to interrupt handler
+ */
+static inline unsigned int napisr_stub ( unsigned int irq ) {
+	return ( ( ( unsigned int ) napisr_stubs ) +
+		 ( irq * NAPISR_STUB_LEN ) );
+}
+
 /**
  * Save power by halting the CPU until the next interrupt
  *
@@ -13,4 +52,86 @@ static void bios_cpu_nap ( void ) {
 					   "cli\n\t" ) : : );
 }
 
+/**
+ * Allow an interrupt line to wake the CPU from a nap
+ *
+ * @v irq		Interrupt line
+ * @ret hooked		Interrupt line was hooked
+ */
+static int bios_nap_irq_hook ( unsigned int irq ) {
+
+	/* IRQ 0 is the timer, which will wake us anyway */
+	if ( ( irq == 0 ) || ( irq > IRQ_MAX ) || ( irq == CHAINED_IRQ ) )
+		return 0;
+
+	if ( napisr_users[irq]++ == 0 ) {
+		DBG ( "NAP hooking IRQ %d\n", irq );
+		if ( irq_enabled ( irq ) )
+			napisr_was_enabled |= ( 1 << irq );
+		napisr_triggered &= ~( 1 << irq );
+		napisr_active |= ( 1 << irq );
+		hook_bios_interrupt ( IRQ_INT ( irq ), napisr_stub ( irq ),
+				      &napisr_next_handlers[irq] );
+		enable_irq ( irq );
+		if ( irq >= IRQ_PIC_CUTOFF )
+			enable_irq ( CHAINED_IRQ );
+	}
+	return 1;
+}
+
+/**
+ * Stop an interrupt line from waking the CPU from a nap
+ *
+ * @v irq		Interrupt line
+ */
+static void bios_nap_irq_unhook ( unsigned int irq ) {
+	int rc;
+
+	if ( --napisr_users[irq] != 0 )
+		return;
+
+	DBG ( "NAP unhooking IRQ %d\n", irq );
+	napisr_active &= ~( 1 << irq );
+	napisr_triggered &= ~( 1 << irq );
+	if ( ! ( napisr_was_enabled & ( 1 << irq ) ) )
+		disable_irq ( irq );
+	napisr_was_enabled &= ~( 1 << irq );
+	if ( ( rc = unhook_bios_interrupt ( IRQ_INT ( irq ),
+					    napisr_stub ( irq ),
+					    &napisr_next_handlers[irq] ) ) != 0 ) {
+		DBG ( "NAP could not unhook IRQ %d: %s\n",
+		      irq, strerror ( rc ) );
+		/* Leave the handler in place; it will now do
+		 * nothing except chain to the previous handler.
+		 */
+	}
+}
+
+/**
+ * Check whether or not an interrupt has occurred
+ *
+ * @v irq		Interrupt line
+ * @ret triggered	Interrupt has occurred since the line was last rearmed
+ */
+static int bios_nap_irq_triggered ( unsigned int irq ) {
+	return ( napisr_triggered & ( 1 << irq ) );
+}
+
+/**
+ * Rearm interrupt line
+ *
+ * @v irq		Interrupt line
+ */
+static void bios_nap_irq_rearm ( unsigned int irq ) {
+
+	if ( napisr_triggered & ( 1 << irq ) ) {
+		napisr_triggered &= ~( 1 << irq );
+		enable_irq ( irq );
+	}
+}
+
 PROVIDE_NAP ( pcbios, cpu_nap, bios_cpu_nap );
+PROVIDE_NAP ( pcbios, nap_irq_hook, bios_nap_irq_hook );
+PROVIDE_NAP ( pcbios, nap_irq_unhook, bios_nap_irq_unhook );
+PROVIDE_NAP ( pcbios, nap_irq_triggered, bios_nap_irq_triggered );
+PROVIDE_NAP ( pcbios, nap_irq_rearm, bios_nap_irq_rearm );
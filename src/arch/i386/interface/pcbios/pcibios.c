@@ -28,6 +28,17 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/**
+ * PCI bus:dev.fn address of the boot device
+ *
+ * This is filled in by the ROM prefix (using the address passed by
+ * the BIOS to the option ROM initialisation entry point), or by the
+ * PXE prefix (using the address reported by the underlying PXE
+ * stack).
+ */
+uint16_t __data16 ( autoboot_busdevfn ) = PCI_BUSDEVFN_NONE;
+#define autoboot_busdevfn __use_data16 ( autoboot_busdevfn )
+
 /**
  * Determine maximum PCI bus number within system
  *
@@ -106,6 +117,15 @@ int pcibios_write ( struct pci_device *pci, uint32_t command, uint32_t value ){
 	return ( ( status >> 8 ) & 0xff );
 }
 
+/**
+ * Get PCI bus:dev.fn address of the boot device
+ *
+ * @ret busdevfn	PCI bus:dev.fn address, or PCI_BUSDEVFN_NONE
+ */
+unsigned int pci_boot_busdevfn ( void ) {
+	return autoboot_busdevfn;
+}
+
 PROVIDE_PCIAPI ( pcbios, pci_max_bus, pcibios_max_bus );
 PROVIDE_PCIAPI_INLINE ( pcbios, pci_read_config_byte );
 PROVIDE_PCIAPI_INLINE ( pcbios, pci_read_config_word );
@@ -106,6 +106,7 @@ union pxenv_call {
 	PXENV_EXIT_t ( * file_exec ) ( struct s_PXENV_FILE_EXEC * );
 	PXENV_EXIT_t ( * file_api_check ) ( struct s_PXENV_FILE_API_CHECK * );
 	PXENV_EXIT_t ( * file_exit_hook ) ( struct s_PXENV_FILE_EXIT_HOOK * );
+	PXENV_EXIT_t ( * file_read_flat ) ( struct s_PXENV_FILE_READ_FLAT * );
 };
 
 /**
@@ -316,6 +317,10 @@ __asmcall void pxe_api_call ( struct i386_all_regs *ix86 ) {
 		pxenv_call.file_exit_hook = pxenv_file_exit_hook;
 		param_len = sizeof ( pxenv_any.file_exit_hook );
 		break;
+	case PXENV_FILE_READ_FLAT:
+		pxenv_call.file_read_flat = pxenv_file_read_flat;
+		param_len = sizeof ( pxenv_any.file_read_flat );
+		break;
 	default:
 		DBG ( "PXENV_UNKNOWN_%hx", opcode );
 		pxenv_call.unknown = pxenv_unknown;
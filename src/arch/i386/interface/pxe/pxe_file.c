@@ -38,6 +38,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 FEATURE ( FEATURE_MISC, "PXEXT", DHCP_EB_FEATURE_PXE_EXT, 2 );
 
+/** Read-ahead window for files read via pxenv_file_read_flat()
+ *
+ * Unread data is held in I/O buffers on the heap, so this must remain
+ * small relative to the heap size.
+ */
+#define PXE_FILE_READAHEAD ( 64 * 1024 )
+
 /**
  * FILE OPEN
  *
@@ -166,6 +173,73 @@ PXENV_EXIT_t pxenv_file_read ( struct s_PXENV_FILE_READ *file_read ) {
 	return PXENV_EXIT_SUCCESS;
 }
 
+/**
+ * FILE READ FLAT
+ *
+ * @v file_read_flat			Pointer to a struct
+ *					s_PXENV_FILE_READ_FLAT
+ * @v s_PXENV_FILE_READ_FLAT::FileHandle File handle
+ * @v s_PXENV_FILE_READ_FLAT::BufferSize Size of data buffer
+ * @v s_PXENV_FILE_READ_FLAT::Buffer	Physical address of data buffer
+ * @ret #PXENV_EXIT_SUCCESS		Data has been read from file
+ * @ret #PXENV_EXIT_FAILURE		Data has not been read from file
+ * @ret s_PXENV_FILE_READ_FLAT::Status	PXE status code
+ * @ret s_PXENV_FILE_READ_FLAT::BufferSize Length of data read
+ *
+ * Unlike pxenv_file_read(), this call accepts a buffer of arbitrary
+ * size anywhere in memory, and does not return until the buffer has
+ * been filled or the end of the file has been reached.  A length
+ * shorter than the buffer size therefore indicates end of file.
+ *
+ * The file's read-ahead window is enlarged on the first call, so that
+ * data continues to arrive in the background between calls.
+ */
+PXENV_EXIT_t pxenv_file_read_flat ( struct s_PXENV_FILE_READ_FLAT
+				    *file_read_flat ) {
+	userptr_t buffer;
+	size_t offset = 0;
+	ssize_t len;
+	int rc;
+
+	DBG ( "PXENV_FILE_READ_FLAT %d to %08x+%x",
+	      file_read_flat->FileHandle, file_read_flat->Buffer,
+	      file_read_flat->BufferSize );
+
+	/* Enable background read-ahead */
+	if ( ( rc = readahead ( file_read_flat->FileHandle,
+				PXE_FILE_READAHEAD ) ) != 0 ) {
+		file_read_flat->Status = PXENV_STATUS ( rc );
+		return PXENV_EXIT_FAILURE;
+	}
+
+	/* Read until buffer is full or file is complete */
+	buffer = phys_to_user ( file_read_flat->Buffer );
+	while ( offset < file_read_flat->BufferSize ) {
+		len = read_user ( file_read_flat->FileHandle, buffer, offset,
+				  ( file_read_flat->BufferSize - offset ) );
+		if ( len == -EWOULDBLOCK )
+			continue;
+		if ( len < 0 ) {
+			/* Report error only if no data was read; the
+			 * error will be returned again by the next call.
+			 */
+			if ( offset )
+				break;
+			file_read_flat->Status = PXENV_STATUS ( len );
+			return PXENV_EXIT_FAILURE;
+		}
+		if ( len == 0 )
+			break;
+		offset += len;
+	}
+
+	DBG ( " read %zx", offset );
+
+	file_read_flat->BufferSize = offset;
+	file_read_flat->Status = PXENV_STATUS_SUCCESS;
+	return PXENV_EXIT_SUCCESS;
+}
+
 /**
  * GET FILE SIZE
  *
@@ -265,7 +339,7 @@ PXENV_EXIT_t pxenv_file_api_check ( struct s_PXENV_FILE_API_CHECK *file_api_chec
 		file_api_check->Size     = sizeof(struct s_PXENV_FILE_API_CHECK);
 		file_api_check->Magic    = 0xe9c17b20;
 		file_api_check->Provider = 0x45585067; /* "gPXE" */
-		file_api_check->APIMask  = 0x0000007f; /* Functions e0-e6 */
+		file_api_check->APIMask  = 0x0000017f; /* Functions e0-e6,e8 */
 		/* Check to see if we have a PXE exit hook */
 		if ( pxe_exit_hook.segment | pxe_exit_hook.offset )
 			/* Function e7, also */
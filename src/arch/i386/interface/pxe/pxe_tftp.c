@@ -27,8 +27,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <assert.h>
 #include <byteswap.h>
 #include <gpxe/uaccess.h>
+#include <gpxe/umalloc.h>
 #include <gpxe/in.h>
 #include <gpxe/tftp.h>
 #include <gpxe/xfer.h>
@@ -36,6 +38,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/process.h>
 #include <pxe.h>
 
+/**
+ * Size of PXE TFTP prefetch ring
+ *
+ * Must be a power of two, and at least as large as the maximum block
+ * size.
+ */
+#define PXE_TFTP_RING_SIZE ( 256 * 1024 )
+
 /** A PXE TFTP connection */
 struct pxe_tftp_connection {
 	/** Data transfer interface */
@@ -54,6 +64,17 @@ struct pxe_tftp_connection {
 	size_t blksize;
 	/** Block index */
 	unsigned int blkidx;
+	/** Prefetch ring buffer
+	 *
+	 * Used only for connections opened via pxenv_tftp_open().
+	 * Data are delivered into the ring ahead of the NBP's calls to
+	 * pxenv_tftp_read(), which are then satisfied from memory.
+	 */
+	userptr_t ring;
+	/** File position of first unread byte within prefetch ring */
+	size_t ring_offset;
+	/** Length of unread data within prefetch ring */
+	size_t ring_fill;
 	/** Overall return status code */
 	int rc;
 };
@@ -74,6 +95,112 @@ static void pxe_tftp_close ( int rc ) {
 	pxe_tftp.rc = rc;
 }
 
+/**
+ * Free PXE TFTP prefetch ring
+ *
+ */
+static void pxe_tftp_free_ring ( void ) {
+	ufree ( pxe_tftp.ring );
+	pxe_tftp.ring = UNULL;
+	pxe_tftp.ring_fill = 0;
+}
+
+/**
+ * Calculate free space within PXE TFTP prefetch ring
+ *
+ * @ret len		Free space
+ */
+static size_t pxe_tftp_ring_space ( void ) {
+	return ( PXE_TFTP_RING_SIZE - pxe_tftp.ring_fill );
+}
+
+/**
+ * Add data to PXE TFTP prefetch ring
+ *
+ * @v data		Data
+ * @v len		Length of data
+ * @ret rc		Return status code
+ *
+ * The data must start at the current file position.  Any portion of
+ * the data which is already present in (or has already been read
+ * from) the ring is ignored.
+ */
+static int pxe_tftp_ring_add ( const void *data, size_t len ) {
+	size_t end = ( pxe_tftp.ring_offset + pxe_tftp.ring_fill );
+	size_t skip;
+	size_t ring_pos;
+	size_t frag_len;
+
+	/* Check for a gap in the received data */
+	if ( pxe_tftp.offset > end ) {
+		DBG ( " prefetch gap at %zx (expected %zx)",
+		      pxe_tftp.offset, end );
+		return -ENOBUFS;
+	}
+
+	/* Skip any duplicate data */
+	skip = ( end - pxe_tftp.offset );
+	if ( skip >= len )
+		return 0;
+	data += skip;
+	len -= skip;
+
+	/* Check for space within the ring */
+	if ( len > pxe_tftp_ring_space() ) {
+		DBG ( " prefetch overrun at %zx (max %zx)", ( end + len ),
+		      ( pxe_tftp.ring_offset + PXE_TFTP_RING_SIZE ) );
+		return -ENOBUFS;
+	}
+
+	/* Copy data into ring, wrapping as necessary */
+	while ( len ) {
+		ring_pos = ( end & ( PXE_TFTP_RING_SIZE - 1 ) );
+		frag_len = ( PXE_TFTP_RING_SIZE - ring_pos );
+		if ( frag_len > len )
+			frag_len = len;
+		copy_to_user ( pxe_tftp.ring, ring_pos, data, frag_len );
+		data += frag_len;
+		len -= frag_len;
+		end += frag_len;
+		pxe_tftp.ring_fill += frag_len;
+	}
+
+	return 0;
+}
+
+/**
+ * Remove data from PXE TFTP prefetch ring
+ *
+ * @v buffer		Buffer
+ * @v len		Length of data to remove
+ */
+static void pxe_tftp_ring_remove ( userptr_t buffer, size_t len ) {
+	size_t offset = 0;
+	size_t ring_pos;
+	size_t frag_len;
+
+	assert ( len <= pxe_tftp.ring_fill );
+
+	while ( len ) {
+		ring_pos = ( pxe_tftp.ring_offset &
+			     ( PXE_TFTP_RING_SIZE - 1 ) );
+		frag_len = ( PXE_TFTP_RING_SIZE - ring_pos );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy_user ( buffer, offset, pxe_tftp.ring, ring_pos,
+			      frag_len );
+		offset += frag_len;
+		len -= frag_len;
+		pxe_tftp.ring_offset += frag_len;
+		pxe_tftp.ring_fill -= frag_len;
+	}
+
+	/* Reopen the window if there is now room for a further block */
+	if ( ( pxe_tftp_ring_space() >= TFTP_LIMIT_BLKSIZE ) &&
+	     ( ( pxe_tftp_ring_space() - offset ) < TFTP_LIMIT_BLKSIZE ) )
+		xfer_window_changed ( &pxe_tftp.xfer );
+}
+
 /**
  * Receive new data
  *
@@ -96,6 +223,8 @@ static int pxe_tftp_xfer_deliver_iob ( struct xfer_interface *xfer __unused,
 	/* Copy data block to buffer */
 	if ( len == 0 ) {
 		/* No data (pure seek); treat as success */
+	} else if ( pxe_tftp.ring ) {
+		rc = pxe_tftp_ring_add ( iobuf->data, len );
 	} else if ( pxe_tftp.offset < pxe_tftp.start ) {
 		DBG ( " buffer underrun at %zx (min %zx)",
 		      pxe_tftp.offset, pxe_tftp.start );
@@ -138,10 +267,31 @@ static void pxe_tftp_xfer_close ( struct xfer_interface *xfer __unused,
 	pxe_tftp_close ( rc );
 }
 
+/**
+ * Check flow control window
+ *
+ * @v xfer		Data transfer interface
+ * @ret len		Length of window
+ */
+static size_t pxe_tftp_xfer_window ( struct xfer_interface *xfer __unused ) {
+
+	/* Limit window to the free space within the prefetch ring,
+	 * if applicable.  The window is closed entirely unless the
+	 * ring has room for a whole block of the largest size that
+	 * the transfer may have negotiated.
+	 */
+	if ( ! pxe_tftp.ring )
+		return ~( ( size_t ) 0 );
+	if ( pxe_tftp_ring_space() < TFTP_LIMIT_BLKSIZE )
+		return 0;
+	return pxe_tftp_ring_space();
+}
+
 static struct xfer_interface_operations pxe_tftp_xfer_ops = {
 	.close		= pxe_tftp_xfer_close,
 	.vredirect	= xfer_vreopen,
-	.window		= unlimited_xfer_window,
+	.window		= pxe_tftp_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= pxe_tftp_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -172,6 +322,7 @@ static int pxe_tftp_open ( uint32_t ipaddress, unsigned int port,
 	int rc;
 
 	/* Reset PXE TFTP connection structure */
+	pxe_tftp_free_ring();
 	memset ( &pxe_tftp, 0, sizeof ( pxe_tftp ) );
 	xfer_init ( &pxe_tftp.xfer, &pxe_tftp_xfer_ops, NULL );
 	pxe_tftp.rc = -EINPROGRESS;
@@ -259,12 +410,32 @@ PXENV_EXIT_t pxenv_tftp_open ( struct s_PXENV_TFTP_OPEN *tftp_open ) {
 		return PXENV_EXIT_FAILURE;
 	}
 
-	/* Wait for OACK to arrive so that we have the block size */
+	/* Allocate prefetch ring */
+	pxe_tftp.ring = umalloc ( PXE_TFTP_RING_SIZE );
+	if ( ! pxe_tftp.ring ) {
+		rc = -ENOMEM;
+		pxe_tftp_close ( rc );
+		tftp_open->Status = PXENV_STATUS ( rc );
+		return PXENV_EXIT_FAILURE;
+	}
+
+	/* Wait for OACK to arrive so that we know the transfer is
+	 * under way
+	 */
 	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
 		( pxe_tftp.max_offset == 0 ) ) {
 		step();
 	}
-	pxe_tftp.blksize = xfer_window ( &pxe_tftp.xfer );
+
+	/* The NBP sees data in blocks of its own requested size,
+	 * reassembled from the prefetch ring, regardless of the block
+	 * size negotiated for the underlying transfer.
+	 */
+	pxe_tftp.blksize = tftp_open->PacketSize;
+	if ( pxe_tftp.blksize < TFTP_DEFAULT_BLKSIZE )
+		pxe_tftp.blksize = TFTP_DEFAULT_BLKSIZE;
+	if ( pxe_tftp.blksize > TFTP_LIMIT_BLKSIZE )
+		pxe_tftp.blksize = TFTP_LIMIT_BLKSIZE;
 	tftp_open->PacketSize = pxe_tftp.blksize;
 	DBG ( " blksize=%d", tftp_open->PacketSize );
 
@@ -297,6 +468,7 @@ PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
 	DBG ( "PXENV_TFTP_CLOSE" );
 
 	pxe_tftp_close ( 0 );
+	pxe_tftp_free_ring();
 	tftp_close->Status = PXENV_STATUS_SUCCESS;
 	return PXENV_EXIT_SUCCESS;
 }
@@ -361,29 +533,51 @@ PXENV_EXIT_t pxenv_tftp_close ( struct s_PXENV_TFTP_CLOSE *tftp_close ) {
  * value before calling this function in protected mode.  You cannot
  * call this function with a 32-bit stack segment.  (See the relevant
  * @ref pxe_x86_pmode16 "implementation note" for more details.)
+ *
+ * The underlying transfer runs ahead of the NBP into a prefetch ring,
+ * and is advanced on each call for as long as the ring has space for
+ * further data.  Blocks are served from the ring, so the NBP need
+ * wait for the network only when the ring has run dry.
  */
 PXENV_EXIT_t pxenv_tftp_read ( struct s_PXENV_TFTP_READ *tftp_read ) {
+	userptr_t buffer;
+	size_t len;
 	int rc;
 
 	DBG ( "PXENV_TFTP_READ to %04x:%04x",
 	      tftp_read->Buffer.segment, tftp_read->Buffer.offset );
 
-	/* Read single block into buffer */
-	pxe_tftp.buffer = real_to_user ( tftp_read->Buffer.segment,
-					 tftp_read->Buffer.offset );
-	pxe_tftp.size = pxe_tftp.blksize;
-	pxe_tftp.start = pxe_tftp.offset;
+	/* Fail if no connection is open */
+	if ( ! pxe_tftp.ring ) {
+		tftp_read->Status = PXENV_STATUS ( -ENOTCONN );
+		return PXENV_EXIT_FAILURE;
+	}
+
+	/* Advance the underlying transfer if there is space to do so */
+	if ( pxe_tftp_ring_space() >= TFTP_LIMIT_BLKSIZE )
+		step();
+
+	/* Wait for a complete block (or EOF) to arrive */
 	while ( ( ( rc = pxe_tftp.rc ) == -EINPROGRESS ) &&
-		( pxe_tftp.offset == pxe_tftp.start ) )
+		( pxe_tftp.ring_fill < pxe_tftp.blksize ) )
 		step();
-	pxe_tftp.buffer = UNULL;
-	tftp_read->BufferSize = ( pxe_tftp.offset - pxe_tftp.start );
-	tftp_read->PacketNumber = ++pxe_tftp.blkidx;
 
 	/* EINPROGRESS is normal if we haven't reached EOF yet */
 	if ( rc == -EINPROGRESS )
 		rc = 0;
 
+	/* Copy single block from prefetch ring into buffer */
+	if ( rc == 0 ) {
+		buffer = real_to_user ( tftp_read->Buffer.segment,
+					tftp_read->Buffer.offset );
+		len = pxe_tftp.ring_fill;
+		if ( len > pxe_tftp.blksize )
+			len = pxe_tftp.blksize;
+		pxe_tftp_ring_remove ( buffer, len );
+		tftp_read->BufferSize = len;
+		tftp_read->PacketNumber = ++pxe_tftp.blkidx;
+	}
+
 	tftp_read->Status = PXENV_STATUS ( rc );
 	return ( rc ? PXENV_EXIT_FAILURE : PXENV_EXIT_SUCCESS );
 }
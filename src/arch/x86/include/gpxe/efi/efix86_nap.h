@@ -15,4 +15,26 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define NAP_PREFIX_efix86 __efix86_
 #endif
 
+/* There is no access to interrupt lines under EFI */
+
+static inline __always_inline int
+NAP_INLINE ( efix86, nap_irq_hook ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( efix86, nap_irq_unhook ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
+static inline __always_inline int
+NAP_INLINE ( efix86, nap_irq_triggered ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( efix86, nap_irq_rearm ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
 #endif /* _GPXE_EFIX86_NAP_H */
@@ -46,3 +46,7 @@ static void efix86_cpu_nap ( void ) {
 }
 
 PROVIDE_NAP ( efix86, cpu_nap, efix86_cpu_nap );
+PROVIDE_NAP_INLINE ( efix86, nap_irq_hook );
+PROVIDE_NAP_INLINE ( efix86, nap_irq_unhook );
+PROVIDE_NAP_INLINE ( efix86, nap_irq_triggered );
+PROVIDE_NAP_INLINE ( efix86, nap_irq_rearm );
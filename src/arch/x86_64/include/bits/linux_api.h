@@ -0,0 +1,26 @@
+#ifndef _BITS_LINUX_API_H
+#define _BITS_LINUX_API_H
+
+/** @file
+ *
+ * Linux system call numbers for x86_64
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#define __NR_read		0
+#define __NR_write		1
+#define __NR_open		2
+#define __NR_close		3
+#define __NR_poll		7
+#define __NR_mmap		9
+#define __NR_munmap		11
+#define __NR_ioctl		16
+#define __NR_mremap		25
+#define __NR_nanosleep		35
+#define __NR_fcntl		72
+#define __NR_clock_gettime	228
+#define __NR_exit_group		231
+
+#endif /* _BITS_LINUX_API_H */
@@ -82,6 +82,9 @@ REQUIRE_OBJECT ( syslog );
 #ifdef CONSOLE_EFI
 REQUIRE_OBJECT ( efi_console );
 #endif
+#ifdef CONSOLE_LINUX
+REQUIRE_OBJECT ( linux_console );
+#endif
 
 /*
  * Drag in all requested network protocols
@@ -128,6 +131,9 @@ REQUIRE_OBJECT ( tftm );
 #ifdef DOWNLOAD_PROTO_SLAM
 REQUIRE_OBJECT ( slam );
 #endif
+#ifdef DOWNLOAD_PROTO_MFEC
+REQUIRE_OBJECT ( mfec );
+#endif
 
 /*
  * Drag in all requested SAN boot protocols
@@ -197,6 +203,17 @@ REQUIRE_OBJECT ( comboot_resolv );
 REQUIRE_OBJECT ( efi_image );
 #endif
 
+/*
+ * Drag in image cache
+ *
+ */
+#ifdef IMAGE_CACHE
+REQUIRE_OBJECT ( imgcache );
+#ifdef UMALLOC_MEMTOP
+REQUIRE_OBJECT ( bios_imgcache );
+#endif
+#endif
+
 /*
  * Drag in all requested commands
  *
@@ -241,6 +258,18 @@ REQUIRE_OBJECT ( pxe_cmd );
 #ifdef IPV6_CMD
 REQUIRE_OBJECT ( ipv6_cmd );
 #endif
+#ifdef BOOTPROF_CMD
+REQUIRE_OBJECT ( bootprof_cmd );
+#endif
+#ifdef IMPAIR_CMD
+REQUIRE_OBJECT ( impair_cmd );
+#endif
+#ifdef PCISTAT_CMD
+REQUIRE_OBJECT ( pcistat_cmd );
+#endif
+#ifdef SCHEDSTAT_CMD
+REQUIRE_OBJECT ( schedstat_cmd );
+#endif
 
 /*
  * Drag in miscellaneous objects
@@ -0,0 +1,19 @@
+#ifndef CONFIG_DEFAULTS_LINUX_H
+#define CONFIG_DEFAULTS_LINUX_H
+
+/** @file
+ *
+ * Configuration defaults for Linux userspace
+ *
+ */
+
+#define UACCESS_LINUX
+#define CONSOLE_LINUX
+#define TIMER_LINUX
+#define NAP_LINUX
+#define UMALLOC_LINUX
+#define SMBIOS_LINUX
+
+#define IMAGE_SCRIPT		/* gPXE script image support */
+
+#endif /* CONFIG_DEFAULTS_LINUX_H */
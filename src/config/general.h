@@ -42,6 +42,36 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define	NET_PROTO_IPV4		/* IPv4 protocol */
 #undef  NET_PROTO_IPV6		/* IPv6 protocol */
 
+/*
+ * Neighbour cache (shared by ARP and NDP)
+ *
+ */
+#define NEIGHBOUR_CACHE_SIZE	32	/* Maximum number of cache entries */
+#define NEIGHBOUR_MAX_PENDING	8	/* Maximum number of packets queued
+					   awaiting address resolution */
+
+/*
+ * Network device idling
+ *
+ * While waiting for network activity, gPXE can halt the CPU until a
+ * network device raises an interrupt, instead of repeatedly polling
+ * every device.  This is used only if every open network device is
+ * able to raise interrupts.
+ *
+ */
+#undef	NET_IRQ_NAP		/* Halt while waiting for network devices */
+
+/*
+ * Boot profiling
+ *
+ * Records timestamped events (DHCP, downloads, image execution etc.)
+ * for display via the "bootprof" command or the "bootprof" setting.
+ * Without this, the tracepoints compile away to nothing and the
+ * profiling code is not linked in.
+ *
+ */
+#undef	BOOTPROF		/* Boot profile tracepoints */
+
 /*
  * PXE support
  *
@@ -60,6 +90,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #undef	DOWNLOAD_PROTO_FTP	/* File Transfer Protocol */
 #undef	DOWNLOAD_PROTO_TFTM	/* Multicast Trivial File Transfer Protocol */
 #undef	DOWNLOAD_PROTO_SLAM	/* Scalable Local Area Multicast */
+#undef	DOWNLOAD_PROTO_MFEC	/* Multicast forward-error-corrected download */
 
 /*
  * SAN boot protocols
@@ -104,6 +135,46 @@ FILE_LICENCE ( GPL2_OR_LATER );
 //#define	IMAGE_COMBOOT		/* SYSLINUX COMBOOT image support */
 //#define	IMAGE_EFI		/* EFI image support */
 
+/*
+ * Image cache
+ *
+ * Downloaded images may be cached in external memory, and reused by
+ * later fetches of the same URI (including fetches made by an
+ * instance of gPXE chainloaded by this one).  Cached images are not
+ * revalidated against the server, so only fetches which explicitly
+ * request it (e.g. "imgfetch --cache") make use of the cache.
+ *
+ */
+#undef	IMAGE_CACHE		/* Image cache */
+#define IMAGE_CACHE_SIZE	( 128 * 1024 * 1024 ) /* Maximum size of
+						       * cached images */
+
+/*
+ * Initrd region
+ *
+ * Initrds are downloaded directly into a single block of external
+ * memory, so that they can be passed to the kernel without copying.
+ * The block is sized from the announced length of each initrd, with
+ * at least this much spare space for further (or growing) initrds,
+ * and is grown as needed.
+ *
+ */
+#define INITRD_REGION_SIZE	( 32 * 1024 * 1024 ) /* Minimum spare space
+							* for initrds */
+
+/*
+ * Device probing
+ *
+ * Lazy probing skips every PCI device other than the boot device (as
+ * identified by the BIOS when initialising the option ROM, or by the
+ * PXE stack which loaded gPXE).  This is effective only when gPXE is
+ * loaded via a prefix which supplies the boot device's bus:dev.fn
+ * address (e.g. a ROM or .pxe prefix); otherwise, all PCI devices
+ * are probed as usual.
+ *
+ */
+#undef	PCI_LAZY_PROBE		/* Probe only the boot network device */
+
 /*
  * Command-line commands to include
  *
@@ -120,8 +191,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define LOGIN_CMD		/* Login command */
 #undef	TIME_CMD		/* Time commands */
 #undef	DIGEST_CMD		/* Image crypto digest commands */
-#define PXE_CMD			/* PXE commands */
+//#define PXE_CMD		/* PXE commands */
 #undef	IPV6_CMD		/* IPv6 commands */
+#undef	BOOTPROF_CMD		/* Boot profile commands (needs BOOTPROF) */
+#undef	IMPAIR_CMD		/* Network impairment commands */
+#undef	PCISTAT_CMD		/* PCI probe statistics command */
+#undef	SCHEDSTAT_CMD		/* Scheduler statistics command */
 
 /*
  * Error message tables to include
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <console.h>
+#include <gpxe/process.h>
+#include <gpxe/keys.h>
+#include <gpxe/timer.h>
+#include <gpxe/bgjob.h>
+
+/** @file
+ *
+ * Background jobs
+ *
+ * A background job is a job (e.g. a downloader) that runs while the
+ * user or script continues to issue further commands.  Any number of
+ * background jobs may run concurrently; they are all driven by the
+ * normal process scheduler whenever anything calls step().
+ *
+ * A completed background job remains in the list of background jobs
+ * until it is reaped by bgjob_wait(), which reports its final status.
+ */
+
+/** List of background jobs */
+static LIST_HEAD ( bgjobs );
+
+/** Most recently allocated job identifier */
+static unsigned int bgjob_last_id;
+
+/**
+ * Handle background job completion
+ *
+ * @v job		Job control interface
+ * @v rc		Final status code
+ */
+static void bgjob_done ( struct job_interface *job, int rc ) {
+	struct bgjob *bgjob = container_of ( job, struct bgjob, job );
+
+	DBGC ( bgjob, "BGJOB %p [%d] complete: %s\n",
+	       bgjob, bgjob->id, strerror ( rc ) );
+
+	/* Record status and detach from job */
+	bgjob->rc = rc;
+	job_nullify ( &bgjob->job );
+	job_unplug ( &bgjob->job );
+
+	/* Notify owner */
+	if ( bgjob->complete )
+		bgjob->complete ( bgjob, rc );
+}
+
+/** Background job control interface operations */
+static struct job_interface_operations bgjob_job_operations = {
+	.done		= bgjob_done,
+	.kill		= ignore_job_kill,
+	.progress	= ignore_job_progress,
+};
+
+/**
+ * Allocate background job
+ *
+ * @v description	Job description
+ * @v priv_size		Size of private data area (bgjob::priv)
+ * @ret bgjob		Background job, or NULL
+ *
+ * The caller should attach the job control interface to the
+ * underlying job (e.g. by passing it to create_downloader()), and
+ * then call register_bgjob().
+ */
+struct bgjob * alloc_bgjob ( const char *description, size_t priv_size ) {
+	struct bgjob *bgjob;
+	size_t description_len = ( strlen ( description ) + 1 /* NUL */ );
+	char *description_copy;
+
+	bgjob = zalloc ( sizeof ( *bgjob ) + priv_size + description_len );
+	if ( ! bgjob )
+		return NULL;
+	ref_init ( &bgjob->refcnt, NULL );
+	job_init ( &bgjob->job, &bgjob_job_operations, &bgjob->refcnt );
+	INIT_LIST_HEAD ( &bgjob->list );
+	bgjob->rc = -EINPROGRESS;
+	bgjob->priv = ( ( ( void * ) bgjob ) + sizeof ( *bgjob ) );
+	description_copy = ( bgjob->priv + priv_size );
+	memcpy ( description_copy, description, description_len );
+	bgjob->description = description_copy;
+	return bgjob;
+}
+
+/**
+ * Register background job
+ *
+ * @v bgjob		Background job
+ *
+ * Assigns a job identifier and adds the job to the list of
+ * background jobs.  The list holds its own reference to the job.
+ */
+void register_bgjob ( struct bgjob *bgjob ) {
+
+	bgjob->id = ++bgjob_last_id;
+	list_add_tail ( &bgjob->list, &bgjobs );
+	bgjob_get ( bgjob );
+	DBGC ( bgjob, "BGJOB %p [%d] started: %s\n",
+	       bgjob, bgjob->id, bgjob->description );
+}
+
+/**
+ * Find background job
+ *
+ * @v id		Job identifier
+ * @ret bgjob		Background job, or NULL
+ */
+struct bgjob * find_bgjob ( unsigned int id ) {
+	struct bgjob *bgjob;
+
+	list_for_each_entry ( bgjob, &bgjobs, list ) {
+		if ( bgjob->id == id )
+			return bgjob;
+	}
+	return NULL;
+}
+
+/**
+ * Check whether or not background job is being waited for
+ *
+ * @v bgjob		Background job
+ * @v wait		Job being waited for, or NULL for all jobs
+ * @ret is_waited	Job is being waited for
+ */
+static inline int bgjob_is_waited ( struct bgjob *bgjob,
+				    struct bgjob *wait ) {
+	return ( ( wait == NULL ) || ( wait == bgjob ) );
+}
+
+/**
+ * Display aggregate progress of background jobs
+ *
+ * @v wait		Job being waited for, or NULL for all jobs
+ */
+static void bgjob_show_progress ( struct bgjob *wait ) {
+	struct job_progress progress;
+	struct bgjob *bgjob;
+	unsigned long completed = 0;
+	unsigned long total = 0;
+	unsigned int running = 0;
+
+	list_for_each_entry ( bgjob, &bgjobs, list ) {
+		if ( ! bgjob_is_waited ( bgjob, wait ) )
+			continue;
+		if ( bgjob->rc != -EINPROGRESS )
+			continue;
+		memset ( &progress, 0, sizeof ( progress ) );
+		job_progress ( &bgjob->job, &progress );
+		completed += progress.completed;
+		total += progress.total;
+		running++;
+	}
+	printf ( "\rWaiting for %d job%s: %ld", running,
+		 ( ( running == 1 ) ? "" : "s" ), ( completed / 1024 ) );
+	if ( total )
+		printf ( "/%ld", ( total / 1024 ) );
+	printf ( " kB " );
+}
+
+/**
+ * Reap completed background jobs
+ *
+ * @v wait		Job being waited for, or NULL for all jobs
+ * @ret rc		Status code of first failed job reaped, if any
+ */
+static int bgjob_reap ( struct bgjob *wait ) {
+	struct bgjob *bgjob;
+	struct bgjob *tmp;
+	int rc = 0;
+
+	list_for_each_entry_safe ( bgjob, tmp, &bgjobs, list ) {
+		if ( ! bgjob_is_waited ( bgjob, wait ) )
+			continue;
+		if ( bgjob->rc == -EINPROGRESS )
+			continue;
+		printf ( "[%d] %s... %s\n", bgjob->id, bgjob->description,
+			 ( bgjob->rc ? strerror ( bgjob->rc ) : "ok" ) );
+		if ( bgjob->rc && ( rc == 0 ) )
+			rc = bgjob->rc;
+		list_del ( &bgjob->list );
+		INIT_LIST_HEAD ( &bgjob->list );
+		bgjob_put ( bgjob );
+	}
+	return rc;
+}
+
+/**
+ * Wait for background jobs to complete
+ *
+ * @v wait		Background job, or NULL to wait for all jobs
+ * @ret rc		Status code of first failed job, if any
+ *
+ * Aggregate progress of all jobs being waited for is displayed on
+ * the console.  Pressing Ctrl-C will cancel all jobs being waited
+ * for.
+ */
+int bgjob_wait ( struct bgjob *wait ) {
+	struct bgjob *bgjob;
+	unsigned long last_progress;
+	int running;
+	int shown = 0;
+
+	last_progress = currticks();
+	while ( 1 ) {
+
+		/* Check for jobs still running */
+		running = 0;
+		list_for_each_entry ( bgjob, &bgjobs, list ) {
+			if ( bgjob_is_waited ( bgjob, wait ) &&
+			     ( bgjob->rc == -EINPROGRESS ) )
+				running = 1;
+		}
+		if ( ! running )
+			break;
+
+		/* Cancel all waited-for jobs on Ctrl-C */
+		if ( iskey() && ( getchar() == CTRL_C ) ) {
+			list_for_each_entry ( bgjob, &bgjobs, list ) {
+				if ( ! ( bgjob_is_waited ( bgjob, wait ) &&
+					 ( bgjob->rc == -EINPROGRESS ) ) )
+					continue;
+				job_kill ( &bgjob->job );
+				if ( bgjob->rc == -EINPROGRESS ) {
+					bgjob_done ( &bgjob->job,
+						     -ECANCELED );
+				}
+			}
+			break;
+		}
+
+		/* Display aggregate progress once per second */
+		if ( ( currticks() - last_progress ) >= TICKS_PER_SEC ) {
+			bgjob_show_progress ( wait );
+			last_progress = currticks();
+			shown = 1;
+		}
+
+		step();
+	}
+	if ( shown )
+		printf ( "\n" );
+
+	/* Report and reap completed jobs */
+	return bgjob_reap ( wait );
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <gpxe/timer.h>
+#include <gpxe/init.h>
+#include <gpxe/settings.h>
+#include <gpxe/vsprintf.h>
+#include <gpxe/bootprof.h>
+
+/** @file
+ *
+ * Boot profiling
+ *
+ * Significant points during the boot process (link up, DHCP state
+ * transitions, connection establishment, download completion, image
+ * execution, etc.) are recorded as timestamped events.  The recorded
+ * profile can be inspected using the "profile" command, and is
+ * exposed via the "boot-profile" setting so that it can be passed on
+ * to the booted operating system (e.g. as part of a kernel command
+ * line).
+ *
+ * The most recent @c BOOTPROF_MAX_EVENTS events are retained, since
+ * the final stages of the boot process tend to be the most
+ * interesting.  Earlier events are overwritten, and counted as
+ * dropped.
+ */
+
+/** Profile settings tag magic */
+#define BOOTPROF_TAG_MAGIC 0x50 /* "Profile" */
+
+/** Profile settings tag for the complete boot profile */
+#define BOOTPROF_TAG_PROFILE ( ( BOOTPROF_TAG_MAGIC << 24 ) | 0x01 )
+
+/** Profile settings tag for the total elapsed time */
+#define BOOTPROF_TAG_TIME ( ( BOOTPROF_TAG_MAGIC << 24 ) | 0x02 )
+
+/** Recorded profile events (a ring buffer) */
+static struct bootprof_event bootprof_events[BOOTPROF_MAX_EVENTS];
+
+/** Timestamp of first profile event (in ticks) */
+static unsigned long bootprof_start;
+
+/** Number of retained profile events */
+unsigned int bootprof_count;
+
+/** Number of earlier profile events overwritten due to lack of space */
+unsigned int bootprof_dropped;
+
+/**
+ * Get retained profile event
+ *
+ * @v index		Index (from zero for the oldest retained event)
+ * @ret prof		Profile event
+ */
+struct bootprof_event * bootprof_event ( unsigned int index ) {
+	return &bootprof_events[ ( bootprof_dropped + index ) %
+				 BOOTPROF_MAX_EVENTS ];
+}
+
+/**
+ * Record profile event
+ *
+ * @v event		Event name
+ * @v name		Name of object to which the event applies, or NULL
+ *
+ * The event name must be a string constant.
+ */
+void bootprof_record ( const char *event, const char *name ) {
+	struct bootprof_event *prof;
+
+	if ( bootprof_count < BOOTPROF_MAX_EVENTS ) {
+		prof = bootprof_event ( bootprof_count++ );
+	} else {
+		prof = bootprof_event ( 0 );
+		bootprof_dropped++;
+	}
+	prof->ticks = currticks();
+	if ( ( bootprof_count == 1 ) && ( ! bootprof_dropped ) )
+		bootprof_start = prof->ticks;
+	prof->event = event;
+	if ( name ) {
+		strncpy ( prof->name, name, ( sizeof ( prof->name ) - 1 ) );
+	} else {
+		prof->name[0] = '\0';
+	}
+	DBG ( "PROFILE %ld %s %s\n", prof->ticks, event, prof->name );
+}
+
+/**
+ * Calculate time of profile event relative to the first event
+ *
+ * @v prof		Profile event
+ * @ret ms		Time in milliseconds
+ */
+unsigned long bootprof_ms ( struct bootprof_event *prof ) {
+	uint64_t elapsed = ( prof->ticks - bootprof_start );
+
+	return ( ( elapsed * 1000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Discard all recorded profile events
+ *
+ */
+void bootprof_clear ( void ) {
+	memset ( bootprof_events, 0, sizeof ( bootprof_events ) );
+	bootprof_start = 0;
+	bootprof_count = 0;
+	bootprof_dropped = 0;
+}
+
+/**
+ * Format boot profile as a string
+ *
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret len		Length of formatted string
+ *
+ * The profile is formatted as a comma-separated list of
+ * "<event>[:<name>]=<ms>" entries.  If any earlier events were
+ * dropped, the list starts with a "dropped=<count>" entry.
+ */
+static size_t bootprof_format ( char *buf, size_t len ) {
+	struct bootprof_event *prof;
+	size_t used = 0;
+	unsigned int i;
+
+	if ( bootprof_dropped ) {
+		used += ssnprintf ( buf, len, "dropped=%d",
+				    bootprof_dropped );
+	}
+	for ( i = 0 ; i < bootprof_count ; i++ ) {
+		prof = bootprof_event ( i );
+		used += ssnprintf ( ( buf + used ), ( len - used ),
+				    "%s%s%s%s=%ld", ( used ? "," : "" ),
+				    prof->event, ( prof->name[0] ? ":" : "" ),
+				    prof->name, bootprof_ms ( prof ) );
+	}
+	return used;
+}
+
+/**
+ * Fetch value of profile setting
+ *
+ * @v settings		Settings block, or NULL to search all blocks
+ * @v setting		Setting to fetch
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @ret len		Length of setting data, or negative error
+ */
+static int bootprof_fetch ( struct settings *settings __unused,
+			   struct setting *setting,
+			   void *data, size_t len ) {
+	uint32_t time;
+	size_t total;
+	char *buf;
+
+	/* Do nothing unless we have recorded at least one event */
+	if ( ! bootprof_count )
+		return -ENOENT;
+
+	switch ( setting->tag ) {
+	case BOOTPROF_TAG_PROFILE:
+		total = bootprof_format ( NULL, 0 );
+		buf = malloc ( total + 1 /* NUL */ );
+		if ( ! buf )
+			return -ENOMEM;
+		bootprof_format ( buf, ( total + 1 ) );
+		if ( len > total )
+			len = total;
+		memcpy ( data, buf, len );
+		free ( buf );
+		return total;
+	case BOOTPROF_TAG_TIME:
+		time = htonl ( bootprof_ms ( bootprof_event ( bootprof_count
+							     - 1 ) ) );
+		if ( len > sizeof ( time ) )
+			len = sizeof ( time );
+		memcpy ( data, &time, len );
+		return sizeof ( time );
+	default:
+		return -ENOENT;
+	}
+}
+
+/** Profile settings operations */
+static struct settings_operations bootprof_settings_operations = {
+	.fetch = bootprof_fetch,
+};
+
+/** Profile settings */
+static struct settings bootprof_settings = {
+	.refcnt = NULL,
+	.name = "profile",
+	.tag_magic = ( BOOTPROF_TAG_MAGIC << 24 ),
+	.siblings = LIST_HEAD_INIT ( bootprof_settings.siblings ),
+	.children = LIST_HEAD_INIT ( bootprof_settings.children ),
+	.op = &bootprof_settings_operations,
+};
+
+/** Boot profile setting */
+struct setting boot_profile_setting __setting = {
+	.name = "boot-profile",
+	.description = "Boot profile",
+	.tag = BOOTPROF_TAG_PROFILE,
+	.type = &setting_type_string,
+};
+
+/** Boot time setting */
+struct setting boot_time_setting __setting = {
+	.name = "boot-time",
+	.description = "Boot time (ms)",
+	.tag = BOOTPROF_TAG_TIME,
+	.type = &setting_type_uint32,
+};
+
+/** Initialise profile settings */
+static void bootprof_init ( void ) {
+	int rc;
+
+	if ( ( rc = register_settings ( &bootprof_settings, NULL ) ) != 0 ) {
+		DBG ( "PROFILE could not register settings: %s\n",
+		      strerror ( rc ) );
+		return;
+	}
+}
+
+/** Profile settings initialiser */
+struct init_fn bootprof_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = bootprof_init,
+};
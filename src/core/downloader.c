@@ -21,13 +21,18 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdlib.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <gpxe/timer.h>
 #include <gpxe/xfer.h>
 #include <gpxe/open.h>
 #include <gpxe/job.h>
 #include <gpxe/uaccess.h>
 #include <gpxe/umalloc.h>
 #include <gpxe/image.h>
+#include <gpxe/initrd.h>
 #include <gpxe/downloader.h>
+#include <gpxe/bootprof.h>
+#include <gpxe/settings.h>
+#include <gpxe/netstats.h>
 
 /** @file
  *
@@ -51,8 +56,13 @@ struct downloader {
 	size_t pos;
 	/** Image registration routine */
 	int ( * register_image ) ( struct image *image );
+	/** Start time (in ticks) */
+	unsigned long start;
 };
 
+/** Download rate of most recent successful download (in kB/s) */
+static unsigned long downloader_rate;
+
 /**
  * Free downloader object
  *
@@ -66,6 +76,25 @@ static void downloader_free ( struct refcnt *refcnt ) {
 	free ( downloader );
 }
 
+/**
+ * Record download rate
+ *
+ * @v downloader	Downloader
+ */
+static void downloader_record_rate ( struct downloader *downloader ) {
+	unsigned long elapsed = ( currticks() - downloader->start );
+	uint64_t rate;
+
+	/* Avoid division by zero for very fast downloads */
+	if ( ! elapsed )
+		elapsed = 1;
+	rate = ( ( ( uint64_t ) downloader->image->len * TICKS_PER_SEC ) /
+		 ( ( uint64_t ) elapsed * 1024 ) );
+	downloader_rate = rate;
+	DBGC ( downloader, "Downloader %p received %zd bytes at %ld kB/s\n",
+	       downloader, downloader->image->len, downloader_rate );
+}
+
 /**
  * Terminate download
  *
@@ -78,6 +107,11 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
 	job_nullify ( &downloader->job );
 	xfer_nullify ( &downloader->xfer );
 
+	if ( rc == 0 ) {
+		bootprof_trace ( "download-done", downloader->image->name );
+		downloader_record_rate ( downloader );
+	}
+
 	/* Free resources and close interfaces */
 	xfer_close ( &downloader->xfer, rc );
 	job_done ( &downloader->job, rc );
@@ -93,6 +127,7 @@ static void downloader_finished ( struct downloader *downloader, int rc ) {
 static int downloader_ensure_size ( struct downloader *downloader,
 				    size_t len ) {
 	userptr_t new_buffer;
+	int rc;
 
 	/* If buffer is already large enough, do nothing */
 	if ( len <= downloader->image->len )
@@ -101,6 +136,13 @@ static int downloader_ensure_size ( struct downloader *downloader,
 	DBGC ( downloader, "Downloader %p extending to %zd bytes\n",
 	       downloader, len );
 
+	/* Download initrds directly into the initrd region, if possible */
+	if ( downloader->image->flags & IMAGE_INITRD ) {
+		rc = initrd_resize ( downloader->image, len );
+		if ( rc != -ENOTTY )
+			return rc;
+	}
+
 	/* Extend buffer */
 	new_buffer = urealloc ( downloader->image->data, len );
 	if ( ! new_buffer ) {
@@ -228,6 +270,7 @@ static struct xfer_interface_operations downloader_xfer_operations = {
 	.close		= downloader_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= downloader_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -271,7 +314,9 @@ int create_downloader ( struct job_interface *job, struct image *image,
 		    &downloader->refcnt );
 	downloader->image = image_get ( image );
 	downloader->register_image = register_image;
+	downloader->start = currticks();
 	va_start ( args, type );
+	bootprof_trace ( "download", image->name );
 
 	/* Instantiate child objects and attach to our interfaces */
 	if ( ( rc = xfer_vopen ( &downloader->xfer, type, args ) ) != 0 )
@@ -289,3 +334,35 @@ int create_downloader ( struct job_interface *job, struct image *image,
 	va_end ( args );
 	return rc;
 }
+
+/****************************************************************************
+ *
+ * Statistics
+ *
+ */
+
+/** Download rate setting */
+struct setting download_rate_setting __setting = {
+	.name = "download-rate",
+	.description = "Download rate (kB/s)",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Get download rate of most recent successful download
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Download rate (in kB/s)
+ */
+static unsigned long downloader_rate_value ( struct net_device *netdev
+					     __unused ) {
+	return downloader_rate;
+}
+
+/** Downloader statistics */
+struct net_statistic downloader_statistics[] __net_statistic = {
+	{
+		.setting = &download_rate_setting,
+		.value = downloader_rate_value,
+	},
+};
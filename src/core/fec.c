@@ -0,0 +1,510 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <gpxe/umalloc.h>
+#include <gpxe/fec.h>
+
+/** @file
+ *
+ * Forward error correction
+ *
+ * This is a systematic Reed-Solomon erasure code over GF(2^8), using
+ * a Cauchy generator matrix.  Data is divided into groups of @c k
+ * source blocks, and each group is extended with @c r repair blocks.
+ * Repair block @c j is the sum over all source blocks @c i of
+ *
+ *     S_i / ( j XOR ( r + i ) )
+ *
+ * Since every square submatrix of a Cauchy matrix is nonsingular, a
+ * group can be reconstructed from any @c k of its @c k+r blocks.
+ *
+ * The decoder does not buffer the data itself.  Each source block is
+ * passed to the recipient as soon as it arrives, and its contribution
+ * is added into a per-group accumulator for each repair block index.
+ * When a repair block arrives, it is added into its accumulator to
+ * leave a remainder involving only the missing source blocks, which
+ * are reconstructed (and passed to the recipient) as soon as enough
+ * remainders are available.  The decoder therefore needs @c r/k
+ * times the size of the data, rather than a complete second copy.
+ */
+
+/** GF(2^8) generator polynomial (x^8 + x^4 + x^3 + x^2 + 1) */
+#define FEC_GF_POLY 0x11d
+
+/** Per-group decoder state */
+struct fec_group {
+	/** Bitmap of source blocks received (or reconstructed) */
+	uint32_t received;
+	/** Bitmap of repair blocks received */
+	uint32_t repaired;
+	/** Number of source blocks still missing */
+	uint8_t missing;
+	/** Number of repair blocks received */
+	uint8_t stored;
+} __attribute__ (( packed ));
+
+/** GF(2^8) exponent table (doubled to avoid a modulo operation) */
+static uint8_t fec_exp[510];
+
+/** GF(2^8) logarithm table */
+static uint8_t fec_log[256];
+
+/**
+ * Initialise GF(2^8) tables
+ *
+ */
+static void fec_init_tables ( void ) {
+	unsigned int x = 1;
+	unsigned int i;
+
+	if ( fec_exp[0] )
+		return;
+	for ( i = 0 ; i < 255 ; i++ ) {
+		fec_exp[i] = fec_exp[ i + 255 ] = x;
+		fec_log[x] = i;
+		x <<= 1;
+		if ( x & 0x100 )
+			x ^= FEC_GF_POLY;
+	}
+}
+
+/**
+ * Multiply in GF(2^8)
+ *
+ * @v a			Multiplicand
+ * @v b			Multiplier
+ * @ret product		Product
+ */
+static inline uint8_t fec_mul ( uint8_t a, uint8_t b ) {
+	if ( ! ( a && b ) )
+		return 0;
+	return fec_exp[ fec_log[a] + fec_log[b] ];
+}
+
+/**
+ * Invert in GF(2^8)
+ *
+ * @v a			Value (must be nonzero)
+ * @ret inverse		Multiplicative inverse
+ */
+static inline uint8_t fec_inv ( uint8_t a ) {
+	assert ( a != 0 );
+	return fec_exp[ 255 - fec_log[a] ];
+}
+
+/**
+ * Add multiple of one block to another
+ *
+ * @v dst		Destination block
+ * @v src		Source block
+ * @v c			Multiplier
+ * @v len		Block length
+ */
+static void fec_muladd ( uint8_t *dst, const uint8_t *src, uint8_t c,
+			 size_t len ) {
+	unsigned int log_c;
+
+	if ( ! c )
+		return;
+	log_c = fec_log[c];
+	while ( len-- ) {
+		if ( *src )
+			*dst ^= fec_exp[ fec_log[*src] + log_c ];
+		dst++;
+		src++;
+	}
+}
+
+/**
+ * Scale block
+ *
+ * @v buf		Block
+ * @v c			Multiplier (must be nonzero)
+ * @v len		Block length
+ */
+static void fec_scale ( uint8_t *buf, uint8_t c, size_t len ) {
+	unsigned int log_c = fec_log[c];
+
+	while ( len-- ) {
+		if ( *buf )
+			*buf = fec_exp[ fec_log[*buf] + log_c ];
+		buf++;
+	}
+}
+
+/**
+ * Get encoding coefficient
+ *
+ * @v r			Number of repair blocks per group
+ * @v repair		Repair block index
+ * @v source		Source block index
+ * @ret c		Coefficient of source block within repair block
+ */
+uint8_t fec_coefficient ( unsigned int r, unsigned int repair,
+			  unsigned int source ) {
+	fec_init_tables();
+	return fec_inv ( repair ^ ( r + source ) );
+}
+
+/**
+ * Construct repair block
+ *
+ * @v k			Number of source blocks per group
+ * @v r			Number of repair blocks per group
+ * @v repair		Repair block index
+ * @v sources		Source blocks (contiguous)
+ * @v blksize		Block size
+ * @v out		Repair block to fill in
+ */
+void fec_encode ( unsigned int k, unsigned int r, unsigned int repair,
+		  const void *sources, size_t blksize, void *out ) {
+	const uint8_t *src = sources;
+	unsigned int i;
+
+	memset ( out, 0, blksize );
+	for ( i = 0 ; i < k ; i++ ) {
+		fec_muladd ( out, src, fec_coefficient ( r, repair, i ),
+			     blksize );
+		src += blksize;
+	}
+}
+
+/**
+ * Get offset of accumulator within accumulator buffer
+ *
+ * @v fec		FEC decoder
+ * @v group		Group index
+ * @v repair		Repair block index
+ * @ret offset		Offset within accumulator buffer
+ */
+static inline size_t fec_offset ( struct fec_decoder *fec,
+				  unsigned long group, unsigned int repair ) {
+	return ( ( ( group * fec->acc_count ) + repair ) * fec->blksize );
+}
+
+/**
+ * Reconstruct missing source blocks within a group
+ *
+ * @v fec		FEC decoder
+ * @v group		Group index
+ * @v state		Group state
+ * @ret rc		Return status code
+ *
+ * Each received repair block's accumulator must hold its remainder
+ * after removing the contributions of all received source blocks.
+ */
+static int fec_decode ( struct fec_decoder *fec, unsigned long group,
+			struct fec_group *state ) {
+	unsigned int slots[FEC_MAX_K];
+	unsigned int rows[FEC_MAX_K];
+	uint8_t *matrix = fec->matrix;
+	size_t blksize = fec->blksize;
+	unsigned int m = 0;
+	unsigned int n = 0;
+	unsigned int a;
+	unsigned int b;
+	unsigned int i;
+	unsigned int p;
+	uint8_t c;
+	int rc;
+
+	/* Identify missing source blocks and received repair blocks */
+	for ( i = 0 ; i < fec->k ; i++ ) {
+		if ( ! ( state->received & ( 1UL << i ) ) )
+			slots[m++] = i;
+	}
+	for ( i = 0 ; i < fec->acc_count ; i++ ) {
+		if ( state->repaired & ( 1UL << i ) )
+			rows[n++] = i;
+	}
+	assert ( m == state->missing );
+	assert ( n == m );
+
+	/* Construct the matrix relating the remainders to the missing
+	 * source blocks.
+	 */
+	for ( a = 0 ; a < m ; a++ ) {
+		for ( b = 0 ; b < m ; b++ ) {
+			matrix[ ( a * m ) + b ] =
+				fec_coefficient ( fec->r, rows[a], slots[b] );
+		}
+	}
+
+	/* Solve by Gauss-Jordan elimination, applying each row
+	 * operation to the corresponding remainder.
+	 */
+	for ( a = 0 ; a < m ; a++ ) {
+
+		/* Find pivot row and swap into place */
+		for ( p = a ; p < m ; p++ ) {
+			if ( matrix[ ( p * m ) + a ] )
+				break;
+		}
+		assert ( p < m );
+		if ( p != a ) {
+			for ( b = 0 ; b < m ; b++ ) {
+				c = matrix[ ( a * m ) + b ];
+				matrix[ ( a * m ) + b ] = matrix[ ( p * m ) + b ];
+				matrix[ ( p * m ) + b ] = c;
+			}
+			i = rows[a];
+			rows[a] = rows[p];
+			rows[p] = i;
+		}
+
+		/* Normalise pivot row */
+		c = fec_inv ( matrix[ ( a * m ) + a ] );
+		fec_scale ( &matrix[ a * m ], c, m );
+		copy_from_user ( fec->acc, fec->accumulators,
+				 fec_offset ( fec, group, rows[a] ), blksize );
+		fec_scale ( fec->acc, c, blksize );
+		copy_to_user ( fec->accumulators,
+			       fec_offset ( fec, group, rows[a] ),
+			       fec->acc, blksize );
+
+		/* Eliminate column from all other rows */
+		for ( b = 0 ; b < m ; b++ ) {
+			c = matrix[ ( b * m ) + a ];
+			if ( ( b == a ) || ( ! c ) )
+				continue;
+			fec_muladd ( &matrix[ b * m ], &matrix[ a * m ], c, m );
+			copy_from_user ( fec->tmp, fec->accumulators,
+					 fec_offset ( fec, group, rows[b] ),
+					 blksize );
+			fec_muladd ( fec->tmp, fec->acc, c, blksize );
+			copy_to_user ( fec->accumulators,
+				       fec_offset ( fec, group, rows[b] ),
+				       fec->tmp, blksize );
+		}
+	}
+
+	/* Mark group as complete */
+	state->received = 0xffffffffUL;
+	state->missing = 0;
+	DBGC2 ( fec, "FEC %p reconstructed %d blocks in group %ld\n",
+		fec, m, group );
+
+	/* Pass reconstructed blocks to recipient */
+	for ( a = 0 ; a < m ; a++ ) {
+		copy_from_user ( fec->acc, fec->accumulators,
+				 fec_offset ( fec, group, rows[a] ), blksize );
+		if ( ( rc = fec->deliver ( fec, group, slots[a],
+					   fec->acc ) ) != 0 )
+			return rc;
+	}
+
+	return 0;
+}
+
+/**
+ * Initialise FEC decoder
+ *
+ * @v fec		FEC decoder
+ * @v len		Total data length
+ * @v blksize		Block size
+ * @v k			Number of source blocks per group
+ * @v r			Number of repair blocks per group
+ * @v deliver		Method for passing source blocks to recipient
+ * @ret rc		Return status code
+ *
+ * Only the first @c k repair blocks of each group are used, since no
+ * more than @c k can ever be needed.
+ */
+int fec_decoder_init ( struct fec_decoder *fec, size_t len, size_t blksize,
+		       unsigned int k, unsigned int r,
+		       int ( * deliver ) ( struct fec_decoder *fec,
+					   unsigned long group,
+					   unsigned int index,
+					   const void *data ) ) {
+	struct fec_group state;
+	unsigned long num_blocks;
+	unsigned long group;
+	unsigned int present;
+	unsigned int i;
+	size_t acc_len;
+
+	/* Sanity checks */
+	memset ( fec, 0, sizeof ( *fec ) );
+	if ( ( blksize == 0 ) || ( k == 0 ) || ( k > FEC_MAX_K ) ||
+	     ( ( k + r ) > FEC_MAX_BLOCKS ) ) {
+		DBGC ( fec, "FEC %p invalid parameters blksize=%zd k=%d "
+		       "r=%d\n", fec, blksize, k, r );
+		return -EINVAL;
+	}
+	fec_init_tables();
+	fec->blksize = blksize;
+	fec->k = k;
+	fec->r = r;
+	fec->acc_count = ( ( r < k ) ? r : k );
+	fec->deliver = deliver;
+	num_blocks = ( ( len + blksize - 1 ) / blksize );
+	fec->num_groups = ( ( num_blocks + k - 1 ) / k );
+	fec->remaining = fec->num_groups;
+
+	/* Allocate buffers */
+	acc_len = ( fec->num_groups * fec->acc_count * blksize );
+	fec->acc = malloc ( blksize );
+	fec->tmp = malloc ( blksize );
+	fec->matrix = malloc ( k * k );
+	fec->accumulators = umalloc ( acc_len );
+	fec->groups = umalloc ( fec->num_groups * sizeof ( state ) );
+	if ( ! ( fec->acc && fec->tmp && fec->matrix &&
+		 ( fec->accumulators || ( ! acc_len ) ) && fec->groups ) ) {
+		fec_decoder_free ( fec );
+		return -ENOMEM;
+	}
+	memset_user ( fec->accumulators, 0, 0, acc_len );
+
+	/* Initialise group state.  Source blocks beyond the end of
+	 * the data are implicitly zero, and so count as received.
+	 */
+	for ( group = 0 ; group < fec->num_groups ; group++ ) {
+		present = ( num_blocks - ( group * k ) );
+		if ( present > k )
+			present = k;
+		memset ( &state, 0, sizeof ( state ) );
+		for ( i = present ; i < k ; i++ )
+			state.received |= ( 1UL << i );
+		state.missing = present;
+		copy_to_user ( fec->groups, ( group * sizeof ( state ) ),
+			       &state, sizeof ( state ) );
+	}
+
+	DBGC ( fec, "FEC %p decoding %zd bytes as %ld groups of %d+%d "
+	       "%zd-byte blocks\n", fec, len, fec->num_groups, k, r, blksize );
+	return 0;
+}
+
+/**
+ * Add block into accumulator
+ *
+ * @v fec		FEC decoder
+ * @v group		Group index
+ * @v repair		Repair block index
+ * @v data		Block data (of length @c blksize)
+ * @v c			Multiplier
+ */
+static void fec_accumulate ( struct fec_decoder *fec, unsigned long group,
+			     unsigned int repair, const void *data,
+			     uint8_t c ) {
+	size_t offset = fec_offset ( fec, group, repair );
+
+	copy_from_user ( fec->tmp, fec->accumulators, offset, fec->blksize );
+	fec_muladd ( fec->tmp, data, c, fec->blksize );
+	copy_to_user ( fec->accumulators, offset, fec->tmp, fec->blksize );
+}
+
+/**
+ * Receive block
+ *
+ * @v fec		FEC decoder
+ * @v group		Group index
+ * @v index		Block index within group (source blocks first)
+ * @v data		Block data (of length @c blksize)
+ * @ret rc		Return status code
+ *
+ * Blocks which are not needed (e.g. duplicates, or any block for a
+ * group that is already complete) are silently ignored.  Source
+ * blocks, whether received or reconstructed, are passed to the
+ * recipient via the decoder's delivery method.
+ */
+int fec_decoder_rx ( struct fec_decoder *fec, unsigned long group,
+		     unsigned int index, const void *data ) {
+	struct fec_group state;
+	size_t state_offset = ( group * sizeof ( state ) );
+	unsigned int repair;
+	unsigned int i;
+	int rc;
+
+	/* Sanity check */
+	if ( ( group >= fec->num_groups ) || ( index >= ( fec->k + fec->r ) ))
+		return -EINVAL;
+
+	/* Ignore blocks for completed groups */
+	copy_from_user ( &state, fec->groups, state_offset, sizeof ( state ) );
+	if ( ! state.missing )
+		return 0;
+
+	if ( index < fec->k ) {
+
+		/* Source block: ignore if already present */
+		if ( state.received & ( 1UL << index ) )
+			return 0;
+
+		/* Pass to recipient */
+		if ( ( rc = fec->deliver ( fec, group, index, data ) ) != 0 )
+			return rc;
+		state.received |= ( 1UL << index );
+		state.missing--;
+
+		/* Remove contribution from every accumulator, unless
+		 * the group is now complete.
+		 */
+		if ( state.missing ) {
+			for ( i = 0 ; i < fec->acc_count ; i++ ) {
+				fec_accumulate ( fec, group, i, data,
+						 fec_coefficient ( fec->r, i,
+								   index ) );
+			}
+		}
+
+	} else {
+
+		/* Repair block: ignore if unused or already received */
+		repair = ( index - fec->k );
+		if ( ( repair >= fec->acc_count ) ||
+		     ( state.repaired & ( 1UL << repair ) ) )
+			return 0;
+
+		/* Add into accumulator to leave the remainder */
+		fec_accumulate ( fec, group, repair, data, 1 );
+		state.repaired |= ( 1UL << repair );
+		state.stored++;
+	}
+
+	/* Reconstruct group if possible */
+	rc = 0;
+	if ( state.missing && ( state.stored == state.missing ) )
+		rc = fec_decode ( fec, group, &state );
+	if ( ! state.missing )
+		fec->remaining--;
+
+	copy_to_user ( fec->groups, state_offset, &state, sizeof ( state ) );
+	return rc;
+}
+
+/**
+ * Free FEC decoder
+ *
+ * @v fec		FEC decoder
+ */
+void fec_decoder_free ( struct fec_decoder *fec ) {
+	free ( fec->acc );
+	free ( fec->tmp );
+	free ( fec->matrix );
+	ufree ( fec->accumulators );
+	ufree ( fec->groups );
+	memset ( fec, 0, sizeof ( *fec ) );
+}
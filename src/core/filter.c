@@ -52,6 +52,12 @@ size_t filter_window ( struct xfer_interface *xfer ) {
 	return xfer_window ( other );
 }
 
+void filter_window_changed ( struct xfer_interface *xfer ) {
+	struct xfer_interface *other = filter_other_half ( xfer );
+
+	xfer_window_changed ( other );
+}
+
 struct io_buffer * filter_alloc_iob ( struct xfer_interface *xfer,
 				      size_t len ) {
 	struct xfer_interface *other = filter_other_half ( xfer );
@@ -37,6 +37,7 @@ static struct xfer_interface_operations hw_xfer_operations = {
 	.close		= hw_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
@@ -28,7 +28,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/list.h>
 #include <gpxe/umalloc.h>
 #include <gpxe/uri.h>
+#include <gpxe/crypto.h>
 #include <gpxe/image.h>
+#include <gpxe/initrd.h>
+#include <gpxe/bootprof.h>
 
 /** @file
  *
@@ -49,7 +52,11 @@ static void free_image ( struct refcnt *refcnt ) {
 
 	free ( image->cmdline );
 	uri_put ( image->uri );
-	ufree ( image->data );
+	if ( image->flags & IMAGE_INITRD_PLACED ) {
+		initrd_release ( image );
+	} else {
+		ufree ( image->data );
+	}
 	image_put ( image->replacement );
 	free ( image );
 	DBGC ( image, "IMAGE %p freed\n", image );
@@ -185,6 +192,7 @@ static int image_load_type ( struct image *image, struct image_type *type ) {
 
 	/* Flag as loaded */
 	image->flags |= IMAGE_LOADED;
+	bootprof_trace ( "image-load", image->name );
 	return 0;
 }
 
@@ -263,6 +271,7 @@ int image_exec ( struct image *image ) {
 	image_get ( image );
 
 	/* Try executing the image */
+	bootprof_trace ( "image-exec", image->name );
 	if ( ( rc = image->type->exec ( image ) ) != 0 ) {
 		DBGC ( image, "IMAGE %p could not execute: %s\n",
 		       image, strerror ( rc ) );
@@ -327,3 +336,29 @@ int register_and_autoexec_image ( struct image *image ) {
 
 	return 0;
 }
+
+/**
+ * Calculate digest of image data
+ *
+ * @v image		Image
+ * @v digest		Digest algorithm
+ * @v out		Buffer for digest output
+ */
+void image_digest ( struct image *image, struct digest_algorithm *digest,
+		    void *out ) {
+	uint8_t ctx[digest->ctxsize];
+	uint8_t buf[128];
+	size_t offset = 0;
+	size_t frag_len;
+
+	digest_init ( digest, ctx );
+	while ( offset < image->len ) {
+		frag_len = ( image->len - offset );
+		if ( frag_len > sizeof ( buf ) )
+			frag_len = sizeof ( buf );
+		copy_from_user ( buf, image->data, offset, frag_len );
+		digest_update ( digest, ctx, buf, frag_len );
+		offset += frag_len;
+	}
+	digest_final ( digest, ctx, out );
+}
@@ -0,0 +1,466 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <gpxe/list.h>
+#include <gpxe/uaccess.h>
+#include <gpxe/umalloc.h>
+#include <gpxe/sha1.h>
+#include <gpxe/uri.h>
+#include <gpxe/image.h>
+#include <gpxe/initrd.h>
+#include <gpxe/imgcache.h>
+#include <config/general.h>
+
+/** @file
+ *
+ * Image cache
+ *
+ * Successfully downloaded images are retained in external memory,
+ * keyed by URI and identified by length and SHA-1 digest.  A later
+ * fetch of the same URI is satisfied from the cache, provided that
+ * the cached copy still matches its digest.
+ *
+ * Cached entries are never revalidated against the server, so the
+ * cache is used only for images explicitly marked as cacheable
+ * (e.g. via "imgfetch --cache").  It is intended for images which do
+ * not change during a boot attempt, such as those re-fetched by a
+ * retry loop within a script or by a chainloaded instance of gPXE.
+ *
+ * Each cache entry has a self-describing header in external memory,
+ * pointing to the image data, and the entries form a chain linked by
+ * physical address.  An owned entry normally shares the data buffer
+ * of the image that it was created from, holding a reference to the
+ * image.  The head of the chain may be published by the platform
+ * (e.g. in hidden base memory), so that an instance of gPXE
+ * chainloaded by this one can import the chain and make use of its
+ * entries.  Imported entries are
+ * never modified or freed, since they belong to the previous
+ * instance.
+ */
+
+/** Image cache entry header magic signature ("gIMC") */
+#define IMGCACHE_MAGIC 0x434d4967
+
+/** Maximum length of a URI used as an image cache key */
+#define IMGCACHE_MAX_URI_LEN 256
+
+/** An image cache entry header
+ *
+ * This structure is located at the start of each cache entry in
+ * external memory, and is followed by the URI.
+ */
+struct imgcache_header {
+	/** Magic signature */
+	uint32_t magic;
+	/** Physical address of this header */
+	uint32_t address;
+	/** Physical address of next entry, or zero */
+	uint32_t next;
+	/** Length of image data */
+	uint32_t len;
+	/** Physical address of image data */
+	uint32_t data;
+	/** Length of URI (including terminating NUL) */
+	uint16_t uri_len;
+	/** SHA-1 digest of image data */
+	uint8_t digest[SHA1_DIGEST_SIZE];
+	/** Reserved */
+	uint8_t reserved;
+	/** Checksum (makes bytewise sum of header zero) */
+	uint8_t checksum;
+} __attribute__ (( packed ));
+
+/** An image cache entry owned by this instance */
+struct imgcache_entry {
+	/** List of owned entries (most recent first) */
+	struct list_head list;
+	/** Entry header block in external memory */
+	userptr_t block;
+	/** Image whose data buffer is shared, or NULL */
+	struct image *image;
+	/** Private copy of image data, if not shared */
+	userptr_t data;
+	/** Length of image data */
+	size_t len;
+};
+
+/** Image cache entries owned by this instance */
+static LIST_HEAD ( imgcache_entries );
+
+/** Total length of image data owned by this instance */
+static size_t imgcache_len;
+
+/** First entry inherited from a previous instance, or zero */
+static physaddr_t imgcache_foreign;
+
+/**
+ * Calculate image cache entry header checksum
+ *
+ * @v hdr		Entry header
+ * @ret sum		Bytewise sum of header
+ */
+static uint8_t imgcache_checksum ( struct imgcache_header *hdr ) {
+	uint8_t *bytes = ( ( uint8_t * ) hdr );
+	uint8_t sum = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < sizeof ( *hdr ) ; i++ )
+		sum += bytes[i];
+	return sum;
+}
+
+/**
+ * Read image cache entry header
+ *
+ * @v address		Physical address of entry
+ * @v hdr		Entry header to fill in
+ * @ret rc		Return status code
+ */
+static int imgcache_read ( physaddr_t address, struct imgcache_header *hdr ) {
+
+	copy_from_user ( hdr, phys_to_user ( address ), 0, sizeof ( *hdr ) );
+	if ( ( hdr->magic != IMGCACHE_MAGIC ) ||
+	     ( hdr->address != address ) ||
+	     ( imgcache_checksum ( hdr ) != 0 ) ) {
+		DBG ( "IMGCACHE invalid entry at %08lx\n", address );
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/**
+ * Write image cache entry header
+ *
+ * @v hdr		Entry header
+ */
+static void imgcache_write ( struct imgcache_header *hdr ) {
+
+	hdr->checksum = 0;
+	hdr->checksum -= imgcache_checksum ( hdr );
+	copy_to_user ( phys_to_user ( hdr->address ), 0, hdr,
+		       sizeof ( *hdr ) );
+}
+
+/**
+ * Get physical address of first entry within image cache
+ *
+ * @ret address		Physical address, or zero
+ */
+static physaddr_t imgcache_head ( void ) {
+	struct imgcache_entry *entry;
+
+	if ( list_empty ( &imgcache_entries ) )
+		return imgcache_foreign;
+	entry = list_entry ( imgcache_entries.next, struct imgcache_entry,
+			     list );
+	return user_to_phys ( entry->block, 0 );
+}
+
+/**
+ * Rebuild image cache chain
+ *
+ * Rewrites the chain pointers of all owned entries to reflect the
+ * list of owned entries, and publishes the new head of the chain.
+ */
+static void imgcache_relink ( void ) {
+	struct imgcache_entry *entry;
+	struct imgcache_entry *next;
+	struct imgcache_header hdr;
+
+	list_for_each_entry ( entry, &imgcache_entries, list ) {
+		copy_from_user ( &hdr, entry->block, 0, sizeof ( hdr ) );
+		if ( entry->list.next == &imgcache_entries ) {
+			hdr.next = imgcache_foreign;
+		} else {
+			next = list_entry ( entry->list.next,
+					    struct imgcache_entry, list );
+			hdr.next = user_to_phys ( next->block, 0 );
+		}
+		imgcache_write ( &hdr );
+	}
+	imgcache_publish ( imgcache_head() );
+}
+
+/**
+ * Remove owned entry from image cache
+ *
+ * @v entry		Image cache entry
+ */
+static void imgcache_remove ( struct imgcache_entry *entry ) {
+
+	DBG ( "IMGCACHE evicting entry at %08lx\n",
+	      user_to_phys ( entry->block, 0 ) );
+	list_del ( &entry->list );
+	imgcache_len -= entry->len;
+	memset_user ( entry->block, 0, 0, sizeof ( struct imgcache_header ) );
+	ufree ( entry->block );
+	ufree ( entry->data );
+	if ( entry->image )
+		image_put ( entry->image );
+	free ( entry );
+}
+
+/**
+ * Construct image cache key
+ *
+ * @v uri		URI
+ * @v buf		Buffer
+ * @v len		Length of buffer
+ * @ret key_len		Length of key (including NUL), or zero
+ *
+ * Any password is omitted from the key.
+ */
+static size_t imgcache_key ( struct uri *uri, char *buf, size_t len ) {
+	size_t key_len;
+
+	key_len = ( unparse_uri ( buf, len, uri,
+				  ( URI_ALL & ~URI_PASSWORD_BIT ) ) + 1 );
+	return ( ( key_len <= len ) ? key_len : 0 );
+}
+
+/**
+ * Find entry within image cache
+ *
+ * @v key		Key
+ * @v key_len		Length of key (including NUL)
+ * @v hdr		Entry header to fill in
+ * @ret rc		Return status code
+ *
+ * The most recently added entry for a given key is returned.  The
+ * walk stops at the first invalid entry.
+ */
+static int imgcache_find ( const char *key, size_t key_len,
+			   struct imgcache_header *hdr ) {
+	char uri[IMGCACHE_MAX_URI_LEN];
+	physaddr_t address;
+
+	for ( address = imgcache_head() ; address ; address = hdr->next ) {
+		if ( imgcache_read ( address, hdr ) != 0 )
+			break;
+		if ( hdr->uri_len != key_len )
+			continue;
+		copy_from_user ( uri, phys_to_user ( address ),
+				 sizeof ( *hdr ), key_len );
+		if ( memcmp ( uri, key, key_len ) == 0 )
+			return 0;
+	}
+	return -ENOENT;
+}
+
+/**
+ * Fetch image from image cache
+ *
+ * @v image		Image
+ * @v uri		Image URI
+ * @ret rc		Return status code
+ *
+ * On success, the image's data buffer is allocated and filled in.
+ * The image is not registered.
+ */
+int imgcache_fetch ( struct image *image, struct uri *uri ) {
+	char key[IMGCACHE_MAX_URI_LEN];
+	struct imgcache_header hdr;
+	uint8_t digest[SHA1_DIGEST_SIZE];
+	size_t key_len;
+	int rc;
+
+	/* Find cache entry */
+	if ( ! ( key_len = imgcache_key ( uri, key, sizeof ( key ) ) ) )
+		return -ENOENT;
+	if ( ( rc = imgcache_find ( key, key_len, &hdr ) ) != 0 )
+		return rc;
+
+	/* Allocate image data buffer */
+	if ( ( ! ( image->flags & IMAGE_INITRD ) ) ||
+	     ( ( rc = initrd_resize ( image, hdr.len ) ) != 0 ) ) {
+		image->data = umalloc ( hdr.len );
+		if ( ! image->data )
+			return -ENOMEM;
+		image->len = hdr.len;
+	}
+
+	/* Copy data, and verify digest of the copy */
+	memcpy_user ( image->data, 0, phys_to_user ( hdr.data ), 0, hdr.len );
+	image_digest ( image, &sha1_algorithm, digest );
+	if ( memcmp ( digest, hdr.digest, sizeof ( digest ) ) != 0 ) {
+		DBGC ( image, "IMGCACHE %p entry at %08x for %s is corrupt\n",
+		       image, hdr.address, key );
+		if ( image->flags & IMAGE_INITRD_PLACED ) {
+			initrd_release ( image );
+		} else {
+			ufree ( image->data );
+			image->data = UNULL;
+		}
+		image->len = 0;
+		return -EIO;
+	}
+
+	DBGC ( image, "IMGCACHE %p fetched %s from entry at %08x\n",
+	       image, key, hdr.address );
+	return 0;
+}
+
+/**
+ * Add image to image cache
+ *
+ * @v image		Image
+ * @v uri		Image URI
+ *
+ * Failure to add an image to the cache is not an error.  Older owned
+ * entries will be evicted as necessary to keep the total size of the
+ * cache within @c IMAGE_CACHE_SIZE.
+ *
+ * The entry shares the image's data buffer.  An image placed within
+ * the initrd region is copied instead, since the region must remain
+ * free to be laid out afresh for the next boot attempt.
+ */
+void imgcache_add ( struct image *image, struct uri *uri ) {
+	char key[IMGCACHE_MAX_URI_LEN];
+	struct imgcache_header hdr;
+	struct imgcache_entry *entry;
+	struct imgcache_entry *tmp;
+	uint8_t digest[SHA1_DIGEST_SIZE];
+	physaddr_t address;
+	size_t key_len;
+
+	/* Construct key and digest */
+	if ( ! ( key_len = imgcache_key ( uri, key, sizeof ( key ) ) ) )
+		return;
+	if ( image->len > IMAGE_CACHE_SIZE )
+		return;
+	image_digest ( image, &sha1_algorithm, digest );
+
+	/* Do nothing if an identical entry already exists */
+	if ( ( imgcache_find ( key, key_len, &hdr ) == 0 ) &&
+	     ( hdr.len == image->len ) &&
+	     ( memcmp ( hdr.digest, digest, sizeof ( digest ) ) == 0 ) )
+		return;
+
+	/* Remove any stale owned entry for this key */
+	list_for_each_entry_safe ( entry, tmp, &imgcache_entries, list ) {
+		address = user_to_phys ( entry->block, 0 );
+		if ( ( imgcache_read ( address, &hdr ) == 0 ) &&
+		     ( hdr.uri_len == key_len ) ) {
+			char uri_key[key_len];
+
+			copy_from_user ( uri_key, entry->block, sizeof ( hdr ),
+					 key_len );
+			if ( memcmp ( uri_key, key, key_len ) == 0 )
+				imgcache_remove ( entry );
+		}
+	}
+
+	/* Evict oldest owned entries to make space */
+	while ( ( imgcache_len + image->len ) > IMAGE_CACHE_SIZE ) {
+		entry = list_entry ( imgcache_entries.prev,
+				     struct imgcache_entry, list );
+		imgcache_remove ( entry );
+	}
+
+	/* Relink surviving entries, so that the chain never refers to
+	 * an evicted block even if the new entry cannot be allocated.
+	 */
+	imgcache_relink();
+
+	/* Allocate entry */
+	entry = zalloc ( sizeof ( *entry ) );
+	if ( ! entry )
+		goto err_alloc_entry;
+	entry->block = umalloc ( sizeof ( hdr ) + key_len );
+	if ( ! entry->block )
+		goto err_alloc_block;
+	if ( image->flags & IMAGE_INITRD_PLACED ) {
+		entry->data = umalloc ( image->len );
+		if ( ! entry->data ) {
+			DBGC ( image, "IMGCACHE %p could not allocate %zd "
+			       "bytes\n", image, image->len );
+			goto err_alloc_data;
+		}
+		memcpy_user ( entry->data, 0, image->data, 0, image->len );
+	} else {
+		entry->image = image_get ( image );
+		entry->data = UNULL;
+	}
+	entry->len = image->len;
+
+	/* Populate entry */
+	memset ( &hdr, 0, sizeof ( hdr ) );
+	hdr.magic = IMGCACHE_MAGIC;
+	hdr.address = user_to_phys ( entry->block, 0 );
+	hdr.len = image->len;
+	hdr.data = user_to_phys ( ( entry->image ? image->data : entry->data ),
+				  0 );
+	hdr.uri_len = key_len;
+	memcpy ( hdr.digest, digest, sizeof ( hdr.digest ) );
+	copy_to_user ( entry->block, sizeof ( hdr ), key, key_len );
+	imgcache_write ( &hdr );
+
+	/* Add to head of chain */
+	list_add ( &entry->list, &imgcache_entries );
+	imgcache_len += entry->len;
+	imgcache_relink();
+
+	DBGC ( image, "IMGCACHE %p cached %s at [%08x,%08zx)%s\n", image,
+	       key, hdr.data, ( hdr.data + image->len ),
+	       ( entry->image ? " (shared)" : "" ) );
+	return;
+
+ err_alloc_data:
+	ufree ( entry->block );
+ err_alloc_block:
+	free ( entry );
+ err_alloc_entry:
+	return;
+}
+
+/**
+ * Import image cache from a previous instance
+ *
+ * @v head		Physical address of first entry, or zero
+ *
+ * The chain is imported only once, and only if valid.  The head of
+ * the combined chain is (re)published in any case.
+ */
+void imgcache_import ( physaddr_t head ) {
+	struct imgcache_header hdr;
+
+	if ( head && ( ! imgcache_foreign ) &&
+	     ( imgcache_read ( head, &hdr ) == 0 ) ) {
+		DBG ( "IMGCACHE importing entries from %08lx\n", head );
+		imgcache_foreign = head;
+	}
+	imgcache_relink();
+}
+
+/**
+ * Publish head of image cache chain
+ *
+ * @v head		Physical address of first entry, or zero
+ *
+ * This is a no-op unless the platform provides a way to pass the
+ * image cache on to a chainloaded instance.
+ */
+__weak void imgcache_publish ( physaddr_t head __unused ) {
+	/* Nothing to do */
+}
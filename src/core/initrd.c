@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <gpxe/list.h>
+#include <gpxe/umalloc.h>
+#include <gpxe/cpio.h>
+#include <gpxe/image.h>
+#include <gpxe/initrd.h>
+#include <config/general.h>
+
+/** @file
+ *
+ * Initial ramdisk region
+ *
+ * Images fetched as initrds are downloaded directly into a single
+ * contiguous block of external memory, each preceded by space for
+ * its cpio header.  If the region still matches the set of
+ * registered images when the kernel is booted, the region can be
+ * handed to the kernel as-is, without copying.
+ *
+ * The region is reserved when the first initrd is placed, sized
+ * from the length announced for that initrd plus some spare space,
+ * and is grown (and possibly moved) when an image no longer fits.
+ * Initrds may be placed while earlier initrds are still being
+ * downloaded, since their lengths are normally announced before the
+ * download starts.  Only the last image within the region may grow;
+ * an earlier image which outgrows its announced length is moved out
+ * into a buffer of its own.
+ */
+
+/** Start of initrd region */
+static userptr_t initrd_data = UNULL;
+
+/** Reserved length of initrd region */
+static size_t initrd_len = 0;
+
+/** Images within the initrd region, in order of placement */
+static LIST_HEAD ( initrd_images );
+
+/**
+ * Round up to a 4-byte boundary
+ *
+ * @v len		Length
+ * @ret len		Rounded length
+ */
+static inline size_t initrd_align ( size_t len ) {
+	return ( ( len + 0x03 ) & ~0x03 );
+}
+
+/**
+ * Construct cpio header for an initrd
+ *
+ * @v image		Initrd image
+ * @v address		Address at which to write header, or UNULL
+ * @ret len		Length of header, rounded up to 4 bytes
+ *
+ * A cpio header is created only for images with a non-empty command
+ * line, which is used as the filename within the archive.
+ */
+size_t initrd_header ( struct image *image, userptr_t address ) {
+	const char *filename = image->cmdline;
+	struct cpio_header cpio;
+	size_t name_len;
+	size_t len;
+
+	/* Prebuilt archives need no header */
+	if ( ! ( filename && filename[0] ) )
+		return 0;
+
+	name_len = ( strlen ( filename ) + 1 );
+	len = initrd_align ( sizeof ( cpio ) + name_len );
+	if ( address ) {
+		memset ( &cpio, '0', sizeof ( cpio ) );
+		memcpy ( cpio.c_magic, CPIO_MAGIC, sizeof ( cpio.c_magic ) );
+		cpio_set_field ( cpio.c_mode, 0100644 );
+		cpio_set_field ( cpio.c_nlink, 1 );
+		cpio_set_field ( cpio.c_filesize, image->len );
+		cpio_set_field ( cpio.c_namesize, name_len );
+		copy_to_user ( address, 0, &cpio, sizeof ( cpio ) );
+		copy_to_user ( address, sizeof ( cpio ), filename, name_len );
+		memset_user ( address, ( sizeof ( cpio ) + name_len ), 0,
+			      ( len - sizeof ( cpio ) - name_len ) );
+	}
+	return len;
+}
+
+/**
+ * Get last image within initrd region
+ *
+ * @ret image		Last image, or NULL
+ */
+static struct image * initrd_tail ( void ) {
+	if ( list_empty ( &initrd_images ) )
+		return NULL;
+	return list_entry ( initrd_images.prev, struct image, initrd_list );
+}
+
+/**
+ * Free initrd region
+ *
+ */
+static void initrd_free_region ( void ) {
+	ufree ( initrd_data );
+	initrd_data = UNULL;
+	initrd_len = 0;
+}
+
+/**
+ * Ensure that initrd region is large enough
+ *
+ * @v len		Required length
+ * @ret rc		Return status code
+ *
+ * Spare space of at least INITRD_REGION_SIZE (or a quarter of the
+ * required length, if larger) is reserved where possible, so that
+ * images which grow gradually do not require the region to be moved
+ * on every extension.  Growing the region may move it, in which case
+ * every placed image is rebased.
+ */
+static int initrd_reserve ( size_t len ) {
+	struct image *image;
+	userptr_t new_data;
+	size_t new_len;
+	size_t spare;
+
+	/* Do nothing if region is already large enough */
+	if ( len <= initrd_len )
+		return 0;
+
+	/* Grow region, with spare space if possible */
+	spare = ( len / 4 );
+	if ( spare < INITRD_REGION_SIZE )
+		spare = INITRD_REGION_SIZE;
+	new_len = ( len + spare );
+	if ( new_len < len )
+		new_len = len;
+	new_data = urealloc ( initrd_data, new_len );
+	if ( ! new_data ) {
+		new_len = len;
+		new_data = urealloc ( initrd_data, new_len );
+		if ( ! new_data ) {
+			DBG ( "INITRD could not reserve %zd bytes\n", len );
+			return -ENOBUFS;
+		}
+	}
+	DBG ( "INITRD region reserved at [%lx,%lx)\n",
+	      user_to_phys ( new_data, 0 ), user_to_phys ( new_data, new_len ) );
+	initrd_data = new_data;
+	initrd_len = new_len;
+
+	/* Rebase placed images */
+	list_for_each_entry ( image, &initrd_images, initrd_list ) {
+		image->data = userptr_add ( initrd_data,
+					    ( image->initrd_offset +
+					      image->initrd_hdr_len ) );
+	}
+
+	return 0;
+}
+
+/**
+ * Move initrd image out of initrd region
+ *
+ * @v image		Initrd image
+ * @ret rc		Return status code
+ *
+ * The image data are copied into a buffer of their own, which the
+ * caller may then extend as usual.
+ */
+static int initrd_evict ( struct image *image ) {
+	userptr_t data = UNULL;
+
+	if ( image->len ) {
+		data = umalloc ( image->len );
+		if ( ! data )
+			return -ENOBUFS;
+		memcpy_user ( data, 0, image->data, 0, image->len );
+	}
+	initrd_release ( image );
+	image->data = data;
+
+	DBGC ( image, "INITRD %p moved out of region\n", image );
+	return 0;
+}
+
+/**
+ * Extend initrd image within initrd region
+ *
+ * @v image		Initrd image
+ * @v len		Required length
+ * @ret rc		Return status code
+ *
+ * An image not yet within the region will be placed at the end of
+ * the region if possible.  Returns -ENOTTY if the image cannot be
+ * placed (or can no longer remain within the region), in which case
+ * the caller should extend a separate buffer instead.
+ */
+int initrd_resize ( struct image *image, size_t len ) {
+	struct image *tail = initrd_tail();
+	size_t offset;
+	size_t hdr_len;
+	int rc;
+
+	/* Extend in place if this is the last image in the region */
+	if ( image->flags & IMAGE_INITRD_PLACED ) {
+		if ( ( image == tail ) &&
+		     ( initrd_reserve ( image->initrd_offset +
+					image->initrd_hdr_len +
+					initrd_align ( len ) ) == 0 ) ) {
+			image->len = len;
+			return 0;
+		}
+		DBGC ( image, "INITRD %p cannot extend to %zd bytes within "
+		       "region\n", image, len );
+		if ( ( rc = initrd_evict ( image ) ) != 0 )
+			return rc;
+		return -ENOTTY;
+	}
+
+	/* Cannot place an image which already has its own buffer */
+	if ( image->data )
+		return -ENOTTY;
+
+	/* Append to end of region, growing the region if necessary */
+	offset = ( tail ? ( tail->initrd_offset + tail->initrd_hdr_len +
+			    initrd_align ( tail->len ) ) : 0 );
+	hdr_len = initrd_header ( image, UNULL );
+	if ( initrd_reserve ( offset + hdr_len + initrd_align ( len ) ) != 0 ){
+		DBGC ( image, "INITRD %p does not fit within region\n",
+		       image );
+		return -ENOTTY;
+	}
+	image->initrd_offset = offset;
+	image->initrd_hdr_len = hdr_len;
+	image->flags |= IMAGE_INITRD_PLACED;
+	list_add_tail ( &image->initrd_list, &initrd_images );
+	image->data = userptr_add ( initrd_data, ( offset + hdr_len ) );
+	image->len = len;
+
+	DBGC ( image, "INITRD %p placed at [%lx,%lx)\n", image,
+	       user_to_phys ( initrd_data, offset ),
+	       user_to_phys ( initrd_data, ( offset + hdr_len + len ) ) );
+	return 0;
+}
+
+/**
+ * Release initrd image from initrd region
+ *
+ * @v image		Initrd image
+ *
+ * New images are always placed after the last image remaining within
+ * the region, so the space occupied by a released image becomes
+ * reusable only once every image placed after it has also been
+ * released.  The region itself is freed once empty.
+ */
+void initrd_release ( struct image *image ) {
+
+	assert ( image->flags & IMAGE_INITRD_PLACED );
+
+	list_del ( &image->initrd_list );
+	image->flags &= ~IMAGE_INITRD_PLACED;
+	image->data = UNULL;
+
+	if ( list_empty ( &initrd_images ) )
+		initrd_free_region();
+}
+
+/**
+ * Get assembled initrd region
+ *
+ * @v exclude		Image to exclude (i.e. the kernel), or NULL
+ * @v data		Start of region to fill in
+ * @v len		Length of region to fill in
+ * @ret rc		Return status code
+ *
+ * The region is usable only if it contains exactly the registered
+ * images (other than @c exclude), in registration order, each with
+ * an unchanged cpio header length.  The cpio headers and inter-image
+ * padding are written out before returning.
+ */
+int initrd_region ( struct image *exclude, userptr_t *data, size_t *len ) {
+	struct image *image;
+	struct image *placed;
+	size_t offset = 0;
+	size_t end;
+
+	/* Walk registered images and region in parallel */
+	placed = list_entry ( &initrd_images, struct image, initrd_list );
+	for_each_image ( image ) {
+		if ( image == exclude )
+			continue;
+		placed = list_entry ( placed->initrd_list.next, struct image,
+				      initrd_list );
+		if ( ( &placed->initrd_list == &initrd_images ) ||
+		     ( placed != image ) ||
+		     ( image->initrd_offset != offset ) ||
+		     ( image->initrd_hdr_len != initrd_header ( image, UNULL ))){
+			DBGC ( image, "INITRD %p does not match region\n",
+			       image );
+			return -ENOENT;
+		}
+		end = ( offset + image->initrd_hdr_len + image->len );
+		offset = initrd_align ( end );
+	}
+	if ( ( placed->initrd_list.next != &initrd_images ) || ( ! offset ) )
+		return -ENOENT;
+
+	/* Fill in cpio headers and padding */
+	list_for_each_entry ( image, &initrd_images, initrd_list ) {
+		initrd_header ( image, userptr_add ( initrd_data,
+						     image->initrd_offset ) );
+		end = ( image->initrd_offset + image->initrd_hdr_len +
+			image->len );
+		memset_user ( initrd_data, end, 0,
+			      ( initrd_align ( end ) - end ) );
+	}
+
+	*data = initrd_data;
+	*len = offset;
+	return 0;
+}
@@ -58,6 +58,8 @@ struct io_buffer * alloc_iob ( size_t len ) {
 	iobuf = ( struct io_buffer * ) ( data + len );
 	iobuf->head = iobuf->data = iobuf->tail = data;
 	iobuf->end = iobuf;
+	iobuf->flags = 0;
+	iobuf->flow = 0;
 	return iobuf;
 }
 
@@ -1,3 +1,7 @@
 #include <gpxe/nap.h>
 
 PROVIDE_NAP_INLINE ( null, cpu_nap );
+PROVIDE_NAP_INLINE ( null, nap_irq_hook );
+PROVIDE_NAP_INLINE ( null, nap_irq_unhook );
+PROVIDE_NAP_INLINE ( null, nap_irq_triggered );
+PROVIDE_NAP_INLINE ( null, nap_irq_rearm );
@@ -57,6 +57,10 @@ struct posix_file {
 	size_t filesize;
 	/** Received data queue */
 	struct list_head data;
+	/** Length of data in received data queue */
+	size_t queued;
+	/** Read-ahead window */
+	size_t window;
 };
 
 /** List of open files */
@@ -128,6 +132,7 @@ posix_file_xfer_deliver_iob ( struct xfer_interface *xfer,
 		file->filesize = file->pos;
 
 	if ( iob_len ( iobuf ) ) {
+		file->queued += iob_len ( iobuf );
 		list_add_tail ( &iobuf->list, &file->data );
 	} else {
 		free_iob ( iobuf );
@@ -136,11 +141,30 @@ posix_file_xfer_deliver_iob ( struct xfer_interface *xfer,
 	return 0;
 }
 
+/**
+ * Check flow control window
+ *
+ * @v xfer		POSIX file data transfer interface
+ * @ret len		Length of window
+ *
+ * The window shrinks as received data accumulates unread, so that a
+ * fast producer cannot exhaust the heap.
+ */
+static size_t posix_file_xfer_window ( struct xfer_interface *xfer ) {
+	struct posix_file *file =
+		container_of ( xfer, struct posix_file, xfer );
+
+	if ( file->queued >= file->window )
+		return 0;
+	return ( file->window - file->queued );
+}
+
 /** POSIX file data transfer interface operations */
 static struct xfer_interface_operations posix_file_xfer_operations = {
 	.close		= posix_file_xfer_close,
 	.vredirect	= xfer_vreopen,
-	.window		= unlimited_xfer_window,
+	.window		= posix_file_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= posix_file_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -200,6 +224,7 @@ int open ( const char *uri_string ) {
 		return -ENOMEM;
 	ref_init ( &file->refcnt, posix_file_free );
 	file->fd = fd;
+	file->window = POSIX_WINDOW_SIZE;
 	file->rc = -EINPROGRESS;
 	xfer_init ( &file->xfer, &posix_file_xfer_operations,
 		    &file->refcnt );
@@ -237,12 +262,22 @@ int open ( const char *uri_string ) {
  * @v readfds		File descriptors to check
  * @v wait		Wait until data is ready
  * @ret nready		Number of ready file descriptors
+ *
+ * On return, @c readfds contains only those file descriptors that are
+ * ready, i.e. that have data available or have changed status.  If
+ * @c wait is set, the network will be stepped until at least one file
+ * descriptor is ready; otherwise @c readfds is left unchanged when
+ * none are ready.
  */
 int select ( fd_set *readfds, int wait ) {
 	struct posix_file *file;
+	fd_set ready;
+	int nready;
 	int fd;
 
 	do {
+		FD_ZERO ( &ready );
+		nready = 0;
 		for ( fd = POSIX_FD_MIN ; fd <= POSIX_FD_MAX ; fd++ ) {
 			if ( ! FD_ISSET ( fd, readfds ) )
 				continue;
@@ -253,9 +288,12 @@ int select ( fd_set *readfds, int wait ) {
 			     ( file->rc == -EINPROGRESS ) )
 				continue;
 			/* Data is available or status has changed */
-			FD_ZERO ( readfds );
-			FD_SET ( fd, readfds );
-			return 1;
+			FD_SET ( fd, &ready );
+			nready++;
+		}
+		if ( nready ) {
+			*readfds = ready;
+			return nready;
 		}
 		step();
 	} while ( wait );
@@ -271,13 +309,16 @@ int select ( fd_set *readfds, int wait ) {
  * @v len		Maximum length to read
  * @ret len		Actual length read, or negative error number
  *
- * This call is non-blocking; if no data is available to read then
- * -EWOULDBLOCK will be returned.
+ * All queued data that fits within the buffer is returned by a single
+ * call.  This call is non-blocking; if no data is available to read
+ * then -EWOULDBLOCK will be returned.
  */
 ssize_t read_user ( int fd, userptr_t buffer, off_t offset, size_t max_len ) {
 	struct posix_file *file;
 	struct io_buffer *iobuf;
-	size_t len;
+	struct io_buffer *tmp;
+	size_t frag_len;
+	size_t len = 0;
 
 	/* Identify file */
 	file = posix_fd_to_file ( fd );
@@ -288,19 +329,32 @@ ssize_t read_user ( int fd, userptr_t buffer, off_t offset, size_t max_len ) {
 	if ( list_empty ( &file->data ) )
 		step();
 
-	/* Dequeue at most one received I/O buffer into user buffer */
-	list_for_each_entry ( iobuf, &file->data, list ) {
-		len = iob_len ( iobuf );
-		if ( len > max_len )
-			len = max_len;
-		copy_to_user ( buffer, offset, iobuf->data, len );
-		iob_pull ( iobuf, len );
+	/* Dequeue as many received I/O buffers as will fit */
+	list_for_each_entry_safe ( iobuf, tmp, &file->data, list ) {
+		if ( ! max_len )
+			break;
+		frag_len = iob_len ( iobuf );
+		if ( frag_len > max_len )
+			frag_len = max_len;
+		copy_to_user ( buffer, ( offset + len ), iobuf->data,
+			       frag_len );
+		iob_pull ( iobuf, frag_len );
 		if ( ! iob_len ( iobuf ) ) {
 			list_del ( &iobuf->list );
 			free_iob ( iobuf );
 		}
+		len += frag_len;
+		max_len -= frag_len;
+	}
+	if ( len ) {
 		file->pos += len;
-		assert ( len != 0 );
+		file->queued -= len;
+		/* Reopen the window once it has half drained, so that
+		 * the data source can resume without waiting to probe.
+		 */
+		if ( ( ( file->queued + len ) > ( file->window / 2 ) ) &&
+		     ( file->queued <= ( file->window / 2 ) ) )
+			xfer_window_changed ( &file->xfer );
 		return len;
 	}
 
@@ -331,6 +385,32 @@ ssize_t fsize ( int fd ) {
 	return file->filesize;
 }
 
+/**
+ * Set read-ahead window
+ *
+ * @v fd		File descriptor
+ * @v len		Maximum length of unread data to accept
+ * @ret rc		Return status code
+ *
+ * The window may not be reduced below the default window size.  Data
+ * within the window continues to be received in the background
+ * (i.e. whenever the process scheduler runs) without waiting for a
+ * call to read_user().
+ */
+int readahead ( int fd, size_t len ) {
+	struct posix_file *file;
+
+	/* Identify file */
+	file = posix_fd_to_file ( fd );
+	if ( ! file )
+		return -EBADF;
+
+	if ( len < POSIX_WINDOW_SIZE )
+		len = POSIX_WINDOW_SIZE;
+	file->window = len;
+	return 0;
+}
+
 /**
  * Close file
  *
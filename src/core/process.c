@@ -31,7 +31,13 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 
 /** Process run queue */
-static LIST_HEAD ( run_queue );
+LIST_HEAD ( run_queue );
+
+/** Sleeping processes */
+LIST_HEAD ( sleep_queue );
+
+/** Scheduler statistics */
+struct scheduler_stats scheduler_stats;
 
 /**
  * Add process to process list
@@ -45,6 +51,7 @@ void process_add ( struct process *process ) {
 	if ( list_empty ( &process->list ) ) {
 		DBGC ( process, "PROCESS %p starting\n", process );
 		ref_get ( process->refcnt );
+		process->credit = 0;
 		list_add_tail ( &process->list, &run_queue );
 	} else {
 		DBGC ( process, "PROCESS %p already started\n", process );
@@ -57,38 +64,110 @@ void process_add ( struct process *process ) {
  * @v process		Process
  *
  * It is safe to call process_del() multiple times; further calls will
- * have no effect.
+ * have no effect.  A sleeping process may be removed.
  */
 void process_del ( struct process *process ) {
 	if ( ! list_empty ( &process->list ) ) {
 		DBGC ( process, "PROCESS %p stopping\n", process );
 		list_del ( &process->list );
 		INIT_LIST_HEAD ( &process->list );
+		process->state &= ~PROCESS_ASLEEP;
 		ref_put ( process->refcnt );
 	} else {
 		DBGC ( process, "PROCESS %p already stopped\n", process );
 	}
 }
 
+/**
+ * End process' current turn
+ *
+ * @v process		Process
+ *
+ * Moves the process to the end of the run queue, forfeiting any
+ * remaining steps in its current turn.  A process should call this
+ * when it has found nothing to do, so that a high-priority process
+ * does not monopolise the CPU while idle.
+ */
+void process_yield ( struct process *process ) {
+	if ( ( ! list_empty ( &process->list ) ) &&
+	     ( ! process_is_asleep ( process ) ) ) {
+		list_del ( &process->list );
+		list_add_tail ( &process->list, &run_queue );
+		process->credit = 0;
+		scheduler_stats.yields++;
+	}
+}
+
+/**
+ * Put process to sleep
+ *
+ * @v process		Process
+ *
+ * The process will not be stepped again until process_wake() is
+ * called.  Sleeping has no effect on a process which is not running.
+ */
+void process_sleep ( struct process *process ) {
+	if ( ( ! list_empty ( &process->list ) ) &&
+	     ( ! process_is_asleep ( process ) ) ) {
+		DBGC2 ( process, "PROCESS %p sleeping\n", process );
+		list_del ( &process->list );
+		list_add_tail ( &process->list, &sleep_queue );
+		process->state |= PROCESS_ASLEEP;
+		process->credit = 0;
+		scheduler_stats.sleeps++;
+	}
+}
+
+/**
+ * Wake sleeping process
+ *
+ * @v process		Process
+ *
+ * It is safe to call process_wake() on a process which is not
+ * asleep; the call will have no effect.
+ */
+void process_wake ( struct process *process ) {
+	if ( process_is_asleep ( process ) ) {
+		DBGC2 ( process, "PROCESS %p waking\n", process );
+		list_del ( &process->list );
+		list_add_tail ( &process->list, &run_queue );
+		process->state &= ~PROCESS_ASLEEP;
+		scheduler_stats.wakes++;
+	}
+}
+
 /**
  * Single-step a single process
  *
- * This executes a single step of the first process in the run queue,
- * and moves the process to the end of the run queue.
+ * This executes a single step of the first process in the run queue.
+ * A process of priority @c n is allowed 2^n consecutive steps before
+ * being moved to the end of the run queue, so that (for example) the
+ * network stack is polled more often than housekeeping processes.
  */
 void step ( void ) {
 	struct process *process;
+	unsigned long idle;
 
 	list_for_each_entry ( process, &run_queue, list ) {
-		list_del ( &process->list );
-		list_add_tail ( &process->list, &run_queue );
+		if ( ! process->credit )
+			process->credit = ( 1 << process->priority );
+		if ( --process->credit == 0 ) {
+			list_del ( &process->list );
+			list_add_tail ( &process->list, &run_queue );
+		}
+		process->steps++;
+		scheduler_stats.steps[process->priority]++;
 		ref_get ( process->refcnt ); /* Inhibit destruction mid-step */
 		DBGC2 ( process, "PROCESS %p executing\n", process );
+		idle = ( scheduler_stats.yields + scheduler_stats.sleeps );
 		process->step ( process );
+		if ( ( scheduler_stats.yields + scheduler_stats.sleeps ) == idle )
+			scheduler_stats.busy++;
 		DBGC2 ( process, "PROCESS %p finished executing\n", process );
 		ref_put ( process->refcnt ); /* Allow destruction */
-		break;
+		return;
 	}
+	scheduler_stats.idle++;
 }
 
 /**
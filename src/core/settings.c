@@ -53,6 +53,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 struct generic_setting {
 	/** List of generic settings */
 	struct list_head list;
+	/** Next generic setting in tag hash chain */
+	struct generic_setting *tag_next;
+	/** Next generic setting in name hash chain */
+	struct generic_setting *name_next;
 	/** Setting */
 	struct setting setting;
 	/** Size of setting name */
@@ -82,25 +86,139 @@ static inline void * generic_setting_data ( struct generic_setting *generic ) {
 		 generic->name_len );
 }
 
+/**
+ * Calculate hash of setting name
+ *
+ * @v name		Setting name
+ * @ret hash		Hash value
+ */
+static unsigned int setting_name_hash ( const char *name ) {
+	unsigned int hash = 0;
+
+	while ( *name )
+		hash = ( ( hash * 31 ) + *(name++) );
+	return hash;
+}
+
+/**
+ * Get tag hash chain for generic setting
+ *
+ * @v generics		Generic settings block
+ * @v tag		Setting tag
+ * @ret chain		Hash chain
+ */
+static inline struct generic_setting **
+generic_setting_tag_chain ( struct generic_settings *generics,
+			    unsigned int tag ) {
+	return &generics->tags[ ( tag ^ ( tag >> 8 ) ) &
+				( GENERIC_SETTINGS_HASH_SIZE - 1 ) ];
+}
+
+/**
+ * Get name hash chain for generic setting
+ *
+ * @v generics		Generic settings block
+ * @v name		Setting name
+ * @ret chain		Hash chain
+ */
+static inline struct generic_setting **
+generic_setting_name_chain ( struct generic_settings *generics,
+			     const char *name ) {
+	return &generics->names[ setting_name_hash ( name ) &
+				 ( GENERIC_SETTINGS_HASH_SIZE - 1 ) ];
+}
+
 /**
  * Find generic setting
  *
  * @v generics		Generic settings block
  * @v setting		Setting to find
  * @ret generic		Generic setting, or NULL
+ *
+ * This matches settings in the same way as setting_cmp(): by tag if
+ * both settings have the same non-zero tag, otherwise by name.
  */
 static struct generic_setting *
 find_generic_setting ( struct generic_settings *generics,
 		       struct setting *setting ) {
 	struct generic_setting *generic;
 
-	list_for_each_entry ( generic, &generics->list, list ) {
-		if ( setting_cmp ( &generic->setting, setting ) == 0 )
-			return generic;
+	/* Look up by tag, if applicable */
+	if ( setting->tag ) {
+		for ( generic = *generic_setting_tag_chain ( generics,
+							     setting->tag ) ;
+		      generic ; generic = generic->tag_next ) {
+			if ( generic->setting.tag == setting->tag )
+				return generic;
+		}
+	}
+
+	/* Look up by name, if applicable */
+	if ( setting->name && setting->name[0] ) {
+		for ( generic = *generic_setting_name_chain ( generics,
+							      setting->name );
+		      generic ; generic = generic->name_next ) {
+			if ( strcmp ( generic->setting.name,
+				      setting->name ) == 0 )
+				return generic;
+		}
 	}
+
 	return NULL;
 }
 
+/**
+ * Add generic setting to generic settings block
+ *
+ * @v generics		Generic settings block
+ * @v generic		Generic setting
+ */
+static void add_generic_setting ( struct generic_settings *generics,
+				  struct generic_setting *generic ) {
+	struct generic_setting **chain;
+
+	list_add ( &generic->list, &generics->list );
+	if ( generic->setting.tag ) {
+		chain = generic_setting_tag_chain ( generics,
+						    generic->setting.tag );
+		generic->tag_next = *chain;
+		*chain = generic;
+	}
+	if ( generic->setting.name[0] ) {
+		chain = generic_setting_name_chain ( generics,
+						     generic->setting.name );
+		generic->name_next = *chain;
+		*chain = generic;
+	}
+}
+
+/**
+ * Remove generic setting from generic settings block
+ *
+ * @v generics		Generic settings block
+ * @v generic		Generic setting
+ */
+static void del_generic_setting ( struct generic_settings *generics,
+				  struct generic_setting *generic ) {
+	struct generic_setting **chain;
+
+	list_del ( &generic->list );
+	if ( generic->setting.tag ) {
+		chain = generic_setting_tag_chain ( generics,
+						    generic->setting.tag );
+		while ( *chain != generic )
+			chain = &(*chain)->tag_next;
+		*chain = generic->tag_next;
+	}
+	if ( generic->setting.name[0] ) {
+		chain = generic_setting_name_chain ( generics,
+						     generic->setting.name );
+		while ( *chain != generic )
+			chain = &(*chain)->name_next;
+		*chain = generic->name_next;
+	}
+}
+
 /**
  * Store value of generic setting
  *
@@ -142,13 +260,13 @@ int generic_settings_store ( struct settings *settings,
 
 	/* Delete existing generic setting, if any */
 	if ( old ) {
-		list_del ( &old->list );
+		del_generic_setting ( generics, old );
 		free ( old );
 	}
 
-	/* Add new setting to list, if any */
+	/* Add new setting, if any */
 	if ( new )
-		list_add ( &new->list, &generics->list );
+		add_generic_setting ( generics, new );
 
 	return 0;
 }
@@ -193,7 +311,7 @@ void generic_settings_clear ( struct settings *settings ) {
 	struct generic_setting *tmp;
 
 	list_for_each_entry_safe ( generic, tmp, &generics->list, list ) {
-		list_del ( &generic->list );
+		del_generic_setting ( generics, generic );
 		free ( generic );
 	}
 	assert ( list_empty ( &generics->list ) );
@@ -206,6 +324,120 @@ struct settings_operations generic_settings_operations = {
 	.clear = generic_settings_clear,
 };
 
+/******************************************************************************
+ *
+ * Setting lookup cache
+ *
+ ******************************************************************************
+ */
+
+/** Number of entries in setting lookup cache
+ *
+ * Must be a power of two.
+ */
+#define SETTINGS_CACHE_SIZE 16
+
+/** Maximum length of a setting name held in the setting lookup cache */
+#define SETTINGS_CACHE_NAME_LEN 24
+
+/**
+ * A setting lookup cache entry
+ *
+ * Records which settings block (if any) provided a setting when it
+ * was last fetched starting from a given settings block.  The cache
+ * records only where the setting was found, not its value, so that
+ * settings blocks which generate their values on demand remain
+ * accurate.
+ */
+struct settings_cache_entry {
+	/** Generation for which this entry is valid */
+	unsigned int generation;
+	/** Settings block from which the search started */
+	struct settings *settings;
+	/** Setting tag */
+	unsigned int tag;
+	/** Setting name */
+	char name[SETTINGS_CACHE_NAME_LEN];
+	/** Settings block providing the setting, or NULL if not found */
+	struct settings *origin;
+};
+
+/** Setting lookup cache */
+static struct settings_cache_entry settings_cache[SETTINGS_CACHE_SIZE];
+
+/** Current setting lookup cache generation
+ *
+ * Any change to the settings tree or to the contents of any settings
+ * block increments the generation, which invalidates every cache
+ * entry at once.
+ */
+static unsigned int settings_cache_generation = 1;
+
+/**
+ * Invalidate setting lookup cache
+ *
+ */
+static void settings_cache_invalidate ( void ) {
+
+	/* Skip zero, which marks entries that have never been used */
+	if ( ++settings_cache_generation == 0 )
+		settings_cache_generation = 1;
+}
+
+/**
+ * Find setting lookup cache entry
+ *
+ * @v settings		Settings block from which the search starts
+ * @v setting		Setting to fetch
+ * @v hit		Cache entry is valid for this lookup
+ * @ret entry		Cache entry, or NULL if lookup cannot be cached
+ */
+static struct settings_cache_entry *
+settings_cache_entry ( struct settings *settings, struct setting *setting,
+		       int *hit ) {
+	struct settings_cache_entry *entry;
+	const char *name = ( setting->name ? setting->name : "" );
+	unsigned int hash;
+
+	/* Do not attempt to cache lookups with overlength names */
+	*hit = 0;
+	if ( strlen ( name ) >= sizeof ( entry->name ) )
+		return NULL;
+
+	/* Identify cache entry */
+	hash = ( ( ( ( intptr_t ) settings ) >> 4 ) ^ setting->tag ^
+		 setting_name_hash ( name ) );
+	entry = &settings_cache[ hash & ( SETTINGS_CACHE_SIZE - 1 ) ];
+
+	/* Check for a hit */
+	*hit = ( ( entry->generation == settings_cache_generation ) &&
+		 ( entry->settings == settings ) &&
+		 ( entry->tag == setting->tag ) &&
+		 ( strcmp ( entry->name, name ) == 0 ) );
+	return entry;
+}
+
+/**
+ * Record result of setting lookup
+ *
+ * @v entry		Cache entry
+ * @v settings		Settings block from which the search started
+ * @v setting		Setting fetched
+ * @v origin		Settings block providing the setting, or NULL
+ */
+static void settings_cache_record ( struct settings_cache_entry *entry,
+				    struct settings *settings,
+				    struct setting *setting,
+				    struct settings *origin ) {
+	const char *name = ( setting->name ? setting->name : "" );
+
+	entry->generation = settings_cache_generation;
+	entry->settings = settings;
+	entry->tag = setting->tag;
+	strcpy ( entry->name, name );
+	entry->origin = origin;
+}
+
 /******************************************************************************
  *
  * Registered settings blocks
@@ -412,6 +644,7 @@ static void reprioritise_settings ( struct settings *settings ) {
 			break;
 	}
 	list_add_tail ( &settings->siblings, &tmp->siblings );
+	settings_cache_invalidate();
 
 	/* Recurse up the tree */
 	reprioritise_settings ( parent );
@@ -441,6 +674,7 @@ int register_settings ( struct settings *settings, struct settings *parent ) {
 	ref_get ( parent->refcnt );
 	settings->parent = parent;
 	list_add_tail ( &settings->siblings, &parent->children );
+	settings_cache_invalidate();
 	DBGC ( settings, "Settings %p (\"%s\") registered\n",
 	       settings, settings_name ( settings ) );
 
@@ -475,6 +709,7 @@ void unregister_settings ( struct settings *settings ) {
 	settings->parent = NULL;
 	list_del ( &settings->siblings );
 	ref_put ( settings->refcnt );
+	settings_cache_invalidate();
 
 	/* Apply potentially-updated settings */
 	apply_settings();
@@ -509,8 +744,9 @@ int store_setting ( struct settings *settings, struct setting *setting,
 		return -ENOTSUP;
 
 	/* Store setting */
-	if ( ( rc = settings->op->store ( settings, setting,
-					  data, len ) ) != 0 )
+	rc = settings->op->store ( settings, setting, data, len );
+	settings_cache_invalidate();
+	if ( rc != 0 )
 		return rc;
 
 	/* Reprioritise settings if necessary */
@@ -531,6 +767,44 @@ int store_setting ( struct settings *settings, struct setting *setting,
 	return 0;
 }
 
+/**
+ * Fetch value of setting, recording the providing settings block
+ *
+ * @v settings		Settings block
+ * @v setting		Setting to fetch
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @v origin		Settings block providing the setting to fill in
+ * @ret len		Length of setting data, or negative error
+ */
+static int fetch_setting_origin ( struct settings *settings,
+				  struct setting *setting,
+				  void *data, size_t len,
+				  struct settings **origin ) {
+	struct settings *child;
+	int ret;
+
+	/* Sanity check */
+	if ( ! settings->op->fetch )
+		return -ENOTSUP;
+
+	/* Try this block first */
+	if ( ( ret = settings->op->fetch ( settings, setting,
+					   data, len ) ) >= 0 ) {
+		*origin = settings;
+		return ret;
+	}
+
+	/* Recurse into each child block in turn */
+	list_for_each_entry ( child, &settings->children, siblings ) {
+		if ( ( ret = fetch_setting_origin ( child, setting, data, len,
+						    origin ) ) >= 0 )
+			return ret;
+	}
+
+	return -ENOENT;
+}
+
 /**
  * Fetch value of setting
  *
@@ -542,10 +816,16 @@ int store_setting ( struct settings *settings, struct setting *setting,
  *
  * The actual length of the setting will be returned even if
  * the buffer was too small.
+ *
+ * The settings block that provided the setting is remembered in the
+ * setting lookup cache, so that repeated fetches (e.g. during setting
+ * expansion) need not search the settings tree again.
  */
 int fetch_setting ( struct settings *settings, struct setting *setting,
 		    void *data, size_t len ) {
-	struct settings *child;
+	struct settings_cache_entry *entry;
+	struct settings *origin = NULL;
+	int hit;
 	int ret;
 
 	/* Avoid returning uninitialised data on error */
@@ -555,23 +835,25 @@ int fetch_setting ( struct settings *settings, struct setting *setting,
 	if ( ! settings )
 		settings = &settings_root;
 
-	/* Sanity check */
-	if ( ! settings->op->fetch )
-		return -ENOTSUP;
-
-	/* Try this block first */
-	if ( ( ret = settings->op->fetch ( settings, setting,
-					   data, len ) ) >= 0 )
-		return ret;
-
-	/* Recurse into each child block in turn */
-	list_for_each_entry ( child, &settings->children, siblings ) {
-		if ( ( ret = fetch_setting ( child, setting,
-					     data, len ) ) >= 0 )
+	/* Use cached result, if available */
+	entry = settings_cache_entry ( settings, setting, &hit );
+	if ( hit ) {
+		if ( ! entry->origin )
+			return -ENOENT;
+		if ( ( ret = entry->origin->op->fetch ( entry->origin, setting,
+							data, len ) ) >= 0 )
 			return ret;
+		memset ( data, 0, len );
 	}
 
-	return -ENOENT;
+	/* Search settings tree */
+	ret = fetch_setting_origin ( settings, setting, data, len, &origin );
+
+	/* Record result in cache */
+	if ( entry && ( ( ret >= 0 ) || ( ret == -ENOENT ) ) )
+		settings_cache_record ( entry, settings, setting, origin );
+
+	return ret;
 }
 
 /**
@@ -802,6 +1084,7 @@ int fetch_uuid_setting ( struct settings *settings, struct setting *setting,
 void clear_settings ( struct settings *settings ) {
 	if ( settings->op->clear )
 		settings->op->clear ( settings );
+	settings_cache_invalidate();
 }
 
 /**
@@ -114,6 +114,19 @@ size_t xfer_window ( struct xfer_interface *xfer ) {
 	return len;
 }
 
+/**
+ * Report change in flow control window
+ *
+ * @v xfer		Data transfer interface
+ */
+void xfer_window_changed ( struct xfer_interface *xfer ) {
+	struct xfer_interface *dest = xfer_get_dest ( xfer );
+
+	dest->op->window_changed ( dest );
+
+	xfer_put ( dest );
+}
+
 /**
  * Allocate I/O buffer
  *
@@ -325,6 +338,15 @@ size_t no_xfer_window ( struct xfer_interface *xfer __unused ) {
 	return 0;
 }
 
+/**
+ * Ignore change in flow control window
+ *
+ * @v xfer		Data transfer interface
+ */
+void ignore_xfer_window_changed ( struct xfer_interface *xfer __unused ) {
+	/* Nothing to do */
+}
+
 /**
  * Allocate I/O buffer
  *
@@ -402,6 +424,7 @@ struct xfer_interface_operations null_xfer_ops = {
 	.close		= ignore_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
@@ -23,6 +23,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <byteswap.h>
 #include <gpxe/crypto.h>
 #include <gpxe/cbc.h>
+#include <gpxe/gcm.h>
 #include <gpxe/aes.h>
 #include "crypto/axtls/crypto.h"
 
@@ -156,3 +157,7 @@ struct cipher_algorithm aes_algorithm = {
 /* AES with cipher-block chaining */
 CBC_CIPHER ( aes_cbc, aes_cbc_algorithm,
 	     aes_algorithm, struct aes_context, AES_BLOCKSIZE );
+
+/* AES in Galois/Counter Mode */
+GCM_CIPHER ( aes_gcm, aes_gcm_algorithm,
+	     aes_algorithm, struct aes_context );
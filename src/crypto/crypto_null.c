@@ -63,12 +63,12 @@ static void cipher_null_setiv ( void *ctx __unused,
 
 static void cipher_null_encrypt ( void *ctx __unused, const void *src,
 				  void *dst, size_t len ) {
-	memcpy ( dst, src, len );
+	memmove ( dst, src, len );
 }
 
 static void cipher_null_decrypt ( void *ctx __unused, const void *src,
 				  void *dst, size_t len ) {
-	memcpy ( dst, src, len );
+	memmove ( dst, src, len );
 }
 
 struct cipher_algorithm cipher_null = {
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <byteswap.h>
+#include <gpxe/crypto.h>
+#include <gpxe/gcm.h>
+
+/** @file
+ *
+ * Galois/Counter Mode
+ *
+ * This implements GCM as defined in NIST SP 800-38D, using Shoup's
+ * 4-bit table method for the GHASH multiplication.
+ *
+ * Additional authenticated data must be supplied in a single call,
+ * before any data is encrypted or decrypted.  Data may be supplied
+ * in several calls, but all calls except the last must be a multiple
+ * of the GCM block size.
+ */
+
+/** Reduction constants for the 4-bit GHASH multiplication */
+static const uint16_t gcm_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+};
+
+/**
+ * Multiply accumulated hash value by the hash subkey H
+ *
+ * @v gcm_ctx		GCM context
+ */
+static void gcm_multiply ( struct gcm_context *gcm_ctx ) {
+	const uint8_t *x = gcm_ctx->hash;
+	uint64_t *out = ( ( uint64_t * ) gcm_ctx->hash );
+	uint64_t zh;
+	uint64_t zl;
+	unsigned int rem;
+	unsigned int lo;
+	unsigned int hi;
+	int i;
+
+	lo = ( x[15] & 0x0f );
+	zh = gcm_ctx->hh[lo];
+	zl = gcm_ctx->hl[lo];
+
+	for ( i = 15 ; i >= 0 ; i-- ) {
+		lo = ( x[i] & 0x0f );
+		hi = ( x[i] >> 4 );
+
+		if ( i != 15 ) {
+			rem = ( zl & 0x0f );
+			zl = ( ( zh << 60 ) | ( zl >> 4 ) );
+			zh = ( zh >> 4 );
+			zh ^= ( ( ( uint64_t ) gcm_last4[rem] ) << 48 );
+			zh ^= gcm_ctx->hh[lo];
+			zl ^= gcm_ctx->hl[lo];
+		}
+
+		rem = ( zl & 0x0f );
+		zl = ( ( zh << 60 ) | ( zl >> 4 ) );
+		zh = ( zh >> 4 );
+		zh ^= ( ( ( uint64_t ) gcm_last4[rem] ) << 48 );
+		zh ^= gcm_ctx->hh[hi];
+		zl ^= gcm_ctx->hl[hi];
+	}
+
+	out[0] = cpu_to_be64 ( zh );
+	out[1] = cpu_to_be64 ( zl );
+}
+
+/**
+ * Update GHASH with data
+ *
+ * @v gcm_ctx		GCM context
+ * @v data		Data
+ * @v len		Length of data
+ *
+ * Any trailing partial block is zero-padded.
+ */
+static void gcm_ghash ( struct gcm_context *gcm_ctx, const void *data,
+			size_t len ) {
+	const uint8_t *bytes = data;
+	size_t frag_len;
+	unsigned int i;
+
+	while ( len ) {
+		frag_len = len;
+		if ( frag_len > GCM_BLOCKSIZE )
+			frag_len = GCM_BLOCKSIZE;
+		for ( i = 0 ; i < frag_len ; i++ )
+			gcm_ctx->hash[i] ^= bytes[i];
+		gcm_multiply ( gcm_ctx );
+		bytes += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Set key
+ *
+ * @v ctx		Context
+ * @v key		Key
+ * @v keylen		Key length
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @ret rc		Return status code
+ */
+int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm_ctx ) {
+	uint64_t h[2];
+	uint64_t vh;
+	uint64_t vl;
+	uint64_t reduce;
+	unsigned int i;
+	unsigned int j;
+	int rc;
+
+	assert ( raw_cipher->blocksize == GCM_BLOCKSIZE );
+
+	/* Set underlying cipher key */
+	if ( ( rc = cipher_setkey ( raw_cipher, ctx, key, keylen ) ) != 0 )
+		return rc;
+
+	/* Calculate hash subkey H = E(K,0) */
+	memset ( h, 0, sizeof ( h ) );
+	cipher_encrypt ( raw_cipher, ctx, h, h, sizeof ( h ) );
+	vh = be64_to_cpu ( h[0] );
+	vl = be64_to_cpu ( h[1] );
+
+	/* Construct table of multiples of H */
+	memset ( gcm_ctx->hh, 0, sizeof ( gcm_ctx->hh ) );
+	memset ( gcm_ctx->hl, 0, sizeof ( gcm_ctx->hl ) );
+	gcm_ctx->hh[8] = vh;
+	gcm_ctx->hl[8] = vl;
+	for ( i = 4 ; i > 0 ; i >>= 1 ) {
+		reduce = ( ( vl & 1 ) ? 0xe1000000UL : 0 );
+		vl = ( ( vh << 63 ) | ( vl >> 1 ) );
+		vh = ( ( vh >> 1 ) ^ ( reduce << 32 ) );
+		gcm_ctx->hh[i] = vh;
+		gcm_ctx->hl[i] = vl;
+	}
+	for ( i = 2 ; i <= 8 ; i <<= 1 ) {
+		for ( j = 1 ; j < i ; j++ ) {
+			gcm_ctx->hh[ i + j ] = ( gcm_ctx->hh[i] ^
+						 gcm_ctx->hh[j] );
+			gcm_ctx->hl[ i + j ] = ( gcm_ctx->hl[i] ^
+						 gcm_ctx->hl[j] );
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Set initialisation vector
+ *
+ * @v ctx		Context
+ * @v iv		Initialisation vector (of length GCM_IV_LEN)
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ *
+ * This also resets the authentication state, ready for a new
+ * message.
+ */
+void gcm_setiv ( void *ctx, const void *iv,
+		 struct cipher_algorithm *raw_cipher,
+		 struct gcm_context *gcm_ctx ) {
+
+	/* Construct initial counter block J0 = IV || 0^31 || 1 */
+	memcpy ( gcm_ctx->ctr, iv, GCM_IV_LEN );
+	memset ( ( gcm_ctx->ctr + GCM_IV_LEN ), 0,
+		 ( GCM_BLOCKSIZE - GCM_IV_LEN ) );
+	gcm_ctx->ctr[ GCM_BLOCKSIZE - 1 ] = 1;
+	cipher_encrypt ( raw_cipher, ctx, gcm_ctx->ctr, gcm_ctx->ekj0,
+			 GCM_BLOCKSIZE );
+
+	/* Reset authentication state */
+	memset ( gcm_ctx->hash, 0, sizeof ( gcm_ctx->hash ) );
+	gcm_ctx->aad_len = 0;
+	gcm_ctx->len = 0;
+}
+
+/**
+ * Apply counter-mode keystream
+ *
+ * @v ctx		Context
+ * @v src		Input data
+ * @v dst		Output data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ * @v encrypt		Data is being encrypted
+ */
+static void gcm_crypt ( void *ctx, const void *src, void *dst, size_t len,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx, int encrypt ) {
+	const uint8_t *in = src;
+	uint8_t *out = dst;
+	uint8_t keystream[GCM_BLOCKSIZE];
+	uint32_t *ctr32 = ( ( uint32_t * ) ( gcm_ctx->ctr + GCM_IV_LEN ) );
+	size_t frag_len;
+	unsigned int i;
+
+	/* Treat data with no destination as additional authenticated
+	 * data.
+	 */
+	if ( ! dst ) {
+		assert ( gcm_ctx->len == 0 );
+		gcm_ghash ( gcm_ctx, src, len );
+		gcm_ctx->aad_len += len;
+		return;
+	}
+
+	gcm_ctx->len += len;
+	while ( len ) {
+		frag_len = len;
+		if ( frag_len > GCM_BLOCKSIZE )
+			frag_len = GCM_BLOCKSIZE;
+
+		/* Generate keystream block */
+		*ctr32 = cpu_to_be32 ( be32_to_cpu ( *ctr32 ) + 1 );
+		cipher_encrypt ( raw_cipher, ctx, gcm_ctx->ctr, keystream,
+				 GCM_BLOCKSIZE );
+
+		/* Authenticate ciphertext (before overwriting it, if
+		 * decrypting in place).
+		 */
+		if ( ! encrypt )
+			gcm_ghash ( gcm_ctx, in, frag_len );
+		for ( i = 0 ; i < frag_len ; i++ )
+			out[i] = ( in[i] ^ keystream[i] );
+		if ( encrypt )
+			gcm_ghash ( gcm_ctx, out, frag_len );
+
+		in += frag_len;
+		out += frag_len;
+		len -= frag_len;
+	}
+}
+
+/**
+ * Encrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to encrypt
+ * @v dst		Buffer for encrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_encrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+	gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 1 );
+}
+
+/**
+ * Decrypt data
+ *
+ * @v ctx		Context
+ * @v src		Data to decrypt
+ * @v dst		Buffer for decrypted data, or NULL for additional data
+ * @v len		Length of data
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_decrypt ( void *ctx, const void *src, void *dst, size_t len,
+		   struct cipher_algorithm *raw_cipher,
+		   struct gcm_context *gcm_ctx ) {
+	gcm_crypt ( ctx, src, dst, len, raw_cipher, gcm_ctx, 0 );
+}
+
+/**
+ * Generate authentication tag
+ *
+ * @v ctx		Context
+ * @v auth		Buffer for authentication tag
+ * @v raw_cipher	Underlying cipher algorithm
+ * @v gcm_ctx		GCM context
+ */
+void gcm_auth ( void *ctx __unused, void *auth,
+		struct cipher_algorithm *raw_cipher __unused,
+		struct gcm_context *gcm_ctx ) {
+	uint64_t lengths[2];
+	uint8_t *tag = auth;
+	unsigned int i;
+
+	/* Hash the bit lengths of the additional data and ciphertext */
+	lengths[0] = cpu_to_be64 ( gcm_ctx->aad_len * 8 );
+	lengths[1] = cpu_to_be64 ( gcm_ctx->len * 8 );
+	gcm_ghash ( gcm_ctx, lengths, sizeof ( lengths ) );
+
+	/* Tag is the final hash value encrypted with J0 */
+	for ( i = 0 ; i < GCM_AUTHSIZE ; i++ )
+		tag[i] = ( gcm_ctx->hash[i] ^ gcm_ctx->ekj0[i] );
+}
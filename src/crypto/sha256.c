@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/** @file
+ *
+ * SHA-256 algorithm
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <byteswap.h>
+#include <gpxe/rotate.h>
+#include <gpxe/crypto.h>
+#include <gpxe/sha256.h>
+
+/** SHA-256 initial hash values */
+static const uint32_t sha256_init_hash[8] = {
+	0x6a09e667UL, 0xbb67ae85UL, 0x3c6ef372UL, 0xa54ff53aUL,
+	0x510e527fUL, 0x9b05688cUL, 0x1f83d9abUL, 0x5be0cd19UL,
+};
+
+/** SHA-256 round constants */
+static const uint32_t sha256_k[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+	0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+	0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+	0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+	0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+	0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+	0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+	0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+	0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL,
+};
+
+/**
+ * Initialise SHA-256 digest
+ *
+ * @v ctx		SHA-256 context
+ */
+static void sha256_init ( void *ctx ) {
+	struct sha256_context *context = ctx;
+
+	memcpy ( context->hash, sha256_init_hash, sizeof ( context->hash ) );
+	context->len = 0;
+}
+
+/**
+ * Digest a single 64-byte block
+ *
+ * @v context		SHA-256 context
+ * @v block		Data block
+ */
+static void sha256_digest_block ( struct sha256_context *context,
+				  const uint8_t *block ) {
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t s0, s1, maj, ch, t1, t2;
+	unsigned int i;
+
+	/* Prepare message schedule */
+	for ( i = 0 ; i < 16 ; i++ )
+		w[i] = be32_to_cpu ( ( ( const uint32_t * ) block )[i] );
+	for ( ; i < 64 ; i++ ) {
+		s0 = ( ror32 ( w[ i - 15 ], 7 ) ^ ror32 ( w[ i - 15 ], 18 ) ^
+		       ( w[ i - 15 ] >> 3 ) );
+		s1 = ( ror32 ( w[ i - 2 ], 17 ) ^ ror32 ( w[ i - 2 ], 19 ) ^
+		       ( w[ i - 2 ] >> 10 ) );
+		w[i] = ( w[ i - 16 ] + s0 + w[ i - 7 ] + s1 );
+	}
+
+	/* Compression loop */
+	a = context->hash[0];
+	b = context->hash[1];
+	c = context->hash[2];
+	d = context->hash[3];
+	e = context->hash[4];
+	f = context->hash[5];
+	g = context->hash[6];
+	h = context->hash[7];
+	for ( i = 0 ; i < 64 ; i++ ) {
+		s0 = ( ror32 ( a, 2 ) ^ ror32 ( a, 13 ) ^ ror32 ( a, 22 ) );
+		maj = ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+		t2 = ( s0 + maj );
+		s1 = ( ror32 ( e, 6 ) ^ ror32 ( e, 11 ) ^ ror32 ( e, 25 ) );
+		ch = ( ( e & f ) ^ ( ( ~e ) & g ) );
+		t1 = ( h + s1 + ch + sha256_k[i] + w[i] );
+		h = g;
+		g = f;
+		f = e;
+		e = ( d + t1 );
+		d = c;
+		c = b;
+		b = a;
+		a = ( t1 + t2 );
+	}
+	context->hash[0] += a;
+	context->hash[1] += b;
+	context->hash[2] += c;
+	context->hash[3] += d;
+	context->hash[4] += e;
+	context->hash[5] += f;
+	context->hash[6] += g;
+	context->hash[7] += h;
+}
+
+/**
+ * Update SHA-256 digest with new data
+ *
+ * @v ctx		SHA-256 context
+ * @v data		Data to digest
+ * @v len		Length of data
+ */
+static void sha256_update ( void *ctx, const void *data, size_t len ) {
+	struct sha256_context *context = ctx;
+	size_t offset = ( context->len % SHA256_BLOCK_SIZE );
+	size_t frag_len;
+
+	context->len += len;
+
+	/* Complete any partial block */
+	if ( offset ) {
+		frag_len = ( SHA256_BLOCK_SIZE - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		memcpy ( ( context->block + offset ), data, frag_len );
+		data += frag_len;
+		len -= frag_len;
+		if ( ( offset + frag_len ) < SHA256_BLOCK_SIZE )
+			return;
+		sha256_digest_block ( context, context->block );
+	}
+
+	/* Digest whole blocks directly from the source buffer */
+	while ( len >= SHA256_BLOCK_SIZE ) {
+		sha256_digest_block ( context, data );
+		data += SHA256_BLOCK_SIZE;
+		len -= SHA256_BLOCK_SIZE;
+	}
+
+	/* Retain any trailing partial block */
+	memcpy ( context->block, data, len );
+}
+
+/**
+ * Finalise SHA-256 digest
+ *
+ * @v ctx		SHA-256 context
+ * @v out		Output buffer
+ */
+static void sha256_final ( void *ctx, void *out ) {
+	struct sha256_context *context = ctx;
+	static const uint8_t pad[SHA256_BLOCK_SIZE] = { 0x80 };
+	uint64_t len_bits = cpu_to_be64 ( context->len * 8 );
+	size_t offset = ( context->len % SHA256_BLOCK_SIZE );
+	size_t pad_len;
+	uint32_t *hash = out;
+	unsigned int i;
+
+	/* Pad to 56 bytes modulo the block size, then append length */
+	pad_len = ( ( offset < 56 ) ? ( 56 - offset ) : ( 120 - offset ) );
+	sha256_update ( context, pad, pad_len );
+	sha256_update ( context, &len_bits, sizeof ( len_bits ) );
+
+	/* Copy out hash value */
+	for ( i = 0 ; i < 8 ; i++ )
+		hash[i] = cpu_to_be32 ( context->hash[i] );
+}
+
+/** SHA-256 algorithm */
+struct digest_algorithm sha256_algorithm = {
+	.name		= "sha256",
+	.ctxsize	= SHA256_CTX_SIZE,
+	.blocksize	= SHA256_BLOCK_SIZE,
+	.digestsize	= SHA256_DIGEST_SIZE,
+	.init		= sha256_init,
+	.update		= sha256_update,
+	.final		= sha256_final,
+};
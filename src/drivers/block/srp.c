@@ -425,6 +425,7 @@ static struct xfer_interface_operations srp_xfer_operations = {
 	.close		= srp_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= srp_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
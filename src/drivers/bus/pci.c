@@ -28,7 +28,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <errno.h>
 #include <gpxe/tables.h>
 #include <gpxe/device.h>
+#include <gpxe/timer.h>
 #include <gpxe/pci.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -36,8 +38,30 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+#ifdef PCI_LAZY_PROBE
+#define PCI_LAZY 1
+#else
+#define PCI_LAZY 0
+#endif
+
+/** PCI bus scan statistics */
+struct pci_bus_stats pci_bus_stats;
+
 static void pcibus_remove ( struct root_device *rootdev );
 
+/**
+ * Get PCI bus:dev.fn address of the boot device
+ *
+ * @ret busdevfn	PCI bus:dev.fn address, or PCI_BUSDEVFN_NONE
+ *
+ * Platforms which know the device from which they were loaded
+ * (e.g. via the PnP option ROM initialisation call) will override
+ * this function.
+ */
+__weak unsigned int pci_boot_busdevfn ( void ) {
+	return PCI_BUSDEVFN_NONE;
+}
+
 /**
  * Read PCI BAR
  *
@@ -165,6 +189,39 @@ void adjust_pci_device ( struct pci_device *pci ) {
 	}
 }
 
+/**
+ * Attempt to probe a PCI device using a specified driver
+ *
+ * @v pci		PCI device
+ * @v driver		PCI driver
+ * @v id		Matching entry in driver's ID table
+ * @ret rc		Return status code
+ */
+static int pci_probe_driver ( struct pci_device *pci,
+			      struct pci_driver *driver,
+			      struct pci_device_id *id ) {
+	unsigned long start;
+	unsigned long elapsed;
+	int rc;
+
+	pci->driver = driver;
+	pci->driver_name = id->name;
+	DBG ( "...using driver %s\n", pci->driver_name );
+	start = currticks();
+	rc = driver->probe ( pci, id );
+	elapsed = ( currticks() - start );
+	driver->stats.name = id->name;
+	driver->stats.probes++;
+	driver->stats.ticks += elapsed;
+	if ( rc != 0 ) {
+		driver->stats.failures++;
+		DBG ( "......probe failed after %ld ticks\n", elapsed );
+		return rc;
+	}
+	DBG ( "......probed in %ld ticks\n", elapsed );
+	return 0;
+}
+
 /**
  * Probe a PCI device
  *
@@ -178,7 +235,6 @@ static int pci_probe ( struct pci_device *pci ) {
 	struct pci_driver *driver;
 	struct pci_device_id *id;
 	unsigned int i;
-	int rc;
 
 	DBG ( "Adding PCI device %02x:%02x.%x (%04x:%04x mem %lx io %lx "
 	      "irq %d)\n", pci->bus, PCI_SLOT ( pci->devfn ),
@@ -194,17 +250,10 @@ static int pci_probe ( struct pci_device *pci ) {
 			if ( ( id->device != PCI_ANY_ID ) &&
 			     ( id->device != pci->device ) )
 				continue;
-			pci->driver = driver;
-			pci->driver_name = id->name;
-			DBG ( "...using driver %s\n", pci->driver_name );
-			if ( ( rc = driver->probe ( pci, id ) ) != 0 ) {
-				DBG ( "......probe failed\n" );
-				continue;
-			}
-			return 0;
+			if ( pci_probe_driver ( pci, driver, id ) == 0 )
+				return 0;
 		}
 	}
-
 	DBG ( "...no driver found\n" );
 	return -ENOTTY;
 }
@@ -235,6 +284,8 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 	unsigned int devfn;
 	uint8_t hdrtype = 0;
 	uint32_t tmp;
+	unsigned int boot_busdevfn = pci_boot_busdevfn();
+	unsigned long start = currticks();
 	int rc;
 
 	max_bus = pci_max_bus();
@@ -275,6 +326,23 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 			pci_read_config_byte ( pci, PCI_INTERRUPT_LINE,
 					       &pci->irq );
 			pci_read_bases ( pci );
+			pci_bus_stats.functions++;
+
+			/* In lazy mode, probe only the boot device (if
+			 * known).  Link state cannot be used to choose a
+			 * device, since it is generally unknown until
+			 * the device has been opened.
+			 */
+			if ( PCI_LAZY &&
+			     ( boot_busdevfn != PCI_BUSDEVFN_NONE ) &&
+			     ( boot_busdevfn != PCI_BUSDEVFN ( bus, devfn ) ) ) {
+				DBG ( "Skipping PCI device %02x:%02x.%x "
+				      "(%04x:%04x)\n", bus, PCI_SLOT ( devfn ),
+				      PCI_FUNC ( devfn ), pci->vendor,
+				      pci->device );
+				pci_bus_stats.skipped++;
+				continue;
+			}
 
 			/* Add to device hierarchy */
 			snprintf ( pci->dev.name, sizeof ( pci->dev.name ),
@@ -303,6 +371,7 @@ static int pcibus_probe ( struct root_device *rootdev ) {
 	}
 
 	free ( pci );
+	pci_bus_stats.ticks = ( currticks() - start );
 	return 0;
 
  err:
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <gpxe/device.h>
+#include <gpxe/list.h>
+#include <gpxe/iobuf.h>
+#include <gpxe/netdevice.h>
+#include <gpxe/ethernet.h>
+#include <gpxe/if_ether.h>
+#include <linux_api.h>
+
+/** @file
+ *
+ * Linux TAP network device driver
+ *
+ * Each "--tap=<ifname>" option on the command line attaches a
+ * network device to the named host TAP interface.  The host end of
+ * the interface must be configured (e.g. with "ip tuntap add" and
+ * "ip link set up") by the user.
+ */
+
+/** TAP clone device */
+#define TAP_CLONE_DEV "/dev/net/tun"
+
+/** Command-line option prefix */
+#define TAP_OPTION "--tap="
+
+/** Maximum frame length */
+#define TAP_MTU ( ETH_FRAME_LEN + 4 /* possible VLAN tag */ )
+
+/** Number of frames to receive per poll */
+#define TAP_RX_QUOTA 16
+
+/** A TAP network device */
+struct tap_nic {
+	/** Generic device */
+	struct device dev;
+	/** Network device */
+	struct net_device *netdev;
+	/** Host interface name */
+	char ifname[16];
+	/** File descriptor */
+	int fd;
+};
+
+/** List of TAP devices */
+static struct tap_nic *tap_nics[4];
+
+/** Number of TAP devices */
+static unsigned int tap_count;
+
+/**
+ * Open network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int tap_open ( struct net_device *netdev ) {
+	struct tap_nic *tap = netdev->priv;
+	struct linux_ifreq ifr;
+	long ret;
+
+	/* Open clone device */
+	ret = linux_open ( TAP_CLONE_DEV, ( LINUX_O_RDWR | LINUX_O_NONBLOCK ) );
+	if ( ret < 0 ) {
+		DBGC ( tap, "TAP %p could not open %s: error %ld\n",
+		       tap, TAP_CLONE_DEV, -ret );
+		return -ENODEV;
+	}
+	tap->fd = ret;
+
+	/* Attach to host interface */
+	memset ( &ifr, 0, sizeof ( ifr ) );
+	strncpy ( ifr.ifr_name, tap->ifname, ( sizeof ( ifr.ifr_name ) - 1 ) );
+	ifr.ifr_flags = ( LINUX_IFF_TAP | LINUX_IFF_NO_PI );
+	if ( ( ret = linux_ioctl ( tap->fd, LINUX_TUNSETIFF, &ifr ) ) != 0 ) {
+		DBGC ( tap, "TAP %p could not attach to %s: error %ld\n",
+		       tap, tap->ifname, -ret );
+		linux_close ( tap->fd );
+		tap->fd = -1;
+		return -ENODEV;
+	}
+
+	DBGC ( tap, "TAP %p attached to %s\n", tap, tap->ifname );
+	return 0;
+}
+
+/**
+ * Close network device
+ *
+ * @v netdev		Network device
+ */
+static void tap_close ( struct net_device *netdev ) {
+	struct tap_nic *tap = netdev->priv;
+
+	if ( tap->fd >= 0 ) {
+		linux_close ( tap->fd );
+		tap->fd = -1;
+	}
+}
+
+/**
+ * Transmit packet
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int tap_transmit ( struct net_device *netdev,
+			  struct io_buffer *iobuf ) {
+	struct tap_nic *tap = netdev->priv;
+	long ret;
+
+	/* Writes to a TAP device are atomic and never block, so the
+	 * buffer can be completed immediately.
+	 */
+	ret = linux_write ( tap->fd, iobuf->data, iob_len ( iobuf ) );
+	if ( ret < 0 ) {
+		DBGC ( tap, "TAP %p could not transmit: error %ld\n",
+		       tap, -ret );
+		netdev_tx_complete_err ( netdev, iobuf, -EIO );
+		return 0;
+	}
+	netdev_tx_complete ( netdev, iobuf );
+	return 0;
+}
+
+/**
+ * Poll for completed and received packets
+ *
+ * @v netdev		Network device
+ */
+static void tap_poll ( struct net_device *netdev ) {
+	struct tap_nic *tap = netdev->priv;
+	struct io_buffer *iobuf;
+	unsigned int quota = TAP_RX_QUOTA;
+	long ret;
+
+	while ( quota-- ) {
+		iobuf = alloc_iob ( TAP_MTU );
+		if ( ! iobuf ) {
+			netdev_rx_err ( netdev, NULL, -ENOMEM );
+			return;
+		}
+		ret = linux_read ( tap->fd, iobuf->data, TAP_MTU );
+		if ( ret <= 0 ) {
+			free_iob ( iobuf );
+			if ( ( ret < 0 ) && ( ret != -LINUX_EAGAIN ) ) {
+				DBGC ( tap, "TAP %p could not receive: "
+				       "error %ld\n", tap, -ret );
+				netdev_rx_err ( netdev, NULL, -EIO );
+			}
+			return;
+		}
+		iob_put ( iobuf, ret );
+		netdev_rx ( netdev, iobuf );
+	}
+}
+
+/**
+ * Enable or disable interrupts
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void tap_irq ( struct net_device *netdev __unused,
+		      int enable __unused ) {
+	/* Nothing to do */
+}
+
+/** TAP network device operations */
+static struct net_device_operations tap_operations = {
+	.open		= tap_open,
+	.close		= tap_close,
+	.transmit	= tap_transmit,
+	.poll		= tap_poll,
+	.irq		= tap_irq,
+};
+
+/**
+ * Create TAP network device
+ *
+ * @v rootdev		TAP bus root device
+ * @v ifname		Host interface name
+ * @ret rc		Return status code
+ */
+static int tap_create ( struct root_device *rootdev, const char *ifname ) {
+	struct net_device *netdev;
+	struct tap_nic *tap;
+	int rc;
+
+	/* Allocate and initialise structure */
+	netdev = alloc_etherdev ( sizeof ( *tap ) );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	netdev_init ( netdev, &tap_operations );
+	tap = netdev->priv;
+	tap->netdev = netdev;
+	tap->fd = -1;
+	strncpy ( tap->ifname, ifname, ( sizeof ( tap->ifname ) - 1 ) );
+
+	/* Add to device hierarchy */
+	snprintf ( tap->dev.name, sizeof ( tap->dev.name ), "tap-%s",
+		   tap->ifname );
+	tap->dev.desc.bus_type = BUS_TYPE_TAP;
+	tap->dev.parent = &rootdev->dev;
+	list_add ( &tap->dev.siblings, &rootdev->dev.children );
+	INIT_LIST_HEAD ( &tap->dev.children );
+	netdev->dev = &tap->dev;
+
+	/* Use a locally-administered MAC address */
+	netdev->hw_addr[0] = 0x02;
+	netdev->hw_addr[1] = 'g';
+	netdev->hw_addr[2] = 'P';
+	netdev->hw_addr[3] = 'X';
+	netdev->hw_addr[4] = 'E';
+	netdev->hw_addr[5] = tap_count;
+
+	/* The host end of a TAP interface has no link state to report */
+	netdev_link_up ( netdev );
+
+	/* Register network device */
+	if ( ( rc = register_netdev ( netdev ) ) != 0 )
+		goto err_register;
+
+	tap_nics[tap_count++] = tap;
+	return 0;
+
+	unregister_netdev ( netdev );
+ err_register:
+	list_del ( &tap->dev.siblings );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Probe TAP root bus
+ *
+ * @v rootdev		TAP bus root device
+ * @ret rc		Return status code
+ */
+static int tapbus_probe ( struct root_device *rootdev ) {
+	const char *arg;
+	int i;
+	int rc;
+
+	for ( i = 1 ; i < linux_argc ; i++ ) {
+		arg = linux_argv[i];
+		if ( strncmp ( arg, TAP_OPTION, strlen ( TAP_OPTION ) ) != 0 )
+			continue;
+		if ( tap_count >= ( sizeof ( tap_nics ) /
+				    sizeof ( tap_nics[0] ) ) ) {
+			printf ( "Too many TAP devices\n" );
+			break;
+		}
+		if ( ( rc = tap_create ( rootdev,
+					 ( arg + strlen ( TAP_OPTION ) ) ) ) ){
+			printf ( "Could not create TAP device %s: %s\n",
+				 arg, strerror ( rc ) );
+		}
+	}
+	return 0;
+}
+
+/**
+ * Remove TAP root bus
+ *
+ * @v rootdev		TAP bus root device
+ */
+static void tapbus_remove ( struct root_device *rootdev __unused ) {
+	struct tap_nic *tap;
+	struct net_device *netdev;
+
+	while ( tap_count ) {
+		tap = tap_nics[--tap_count];
+		netdev = tap->netdev;
+		unregister_netdev ( netdev );
+		list_del ( &tap->dev.siblings );
+		netdev_nullify ( netdev );
+		netdev_put ( netdev );
+	}
+}
+
+/** TAP bus root device driver */
+static struct root_driver tap_root_driver = {
+	.probe = tapbus_probe,
+	.remove = tapbus_remove,
+};
+
+/** TAP bus root device */
+struct root_device tap_root_device __root_device = {
+	.dev = { .name = "TAP" },
+	.driver = &tap_root_driver,
+};
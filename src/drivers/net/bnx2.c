@@ -2604,18 +2604,27 @@ bnx2_irq(struct nic *nic __unused, irq_action_t action __unused)
 	}
 }
 
+static int
+bnx2_link(struct nic *nic __unused)
+{
+	struct bnx2 *bp = &bnx2;
+
+	return bp->link_up;
+}
+
 static struct nic_operations bnx2_operations = {
 	.connect	= dummy_connect,
 	.poll		= bnx2_poll,
 	.transmit	= bnx2_transmit,
 	.irq		= bnx2_irq,
+	.link		= bnx2_link,
 };
 
 static int
 bnx2_probe(struct nic *nic, struct pci_device *pdev)
 {
 	struct bnx2 *bp = &bnx2;
-	int i, rc;
+	int rc;
 
 	if (pdev == 0)
 		return 0;
@@ -2655,23 +2664,12 @@ bnx2_probe(struct nic *nic, struct pci_device *pdev)
 		return 0;
 	}
 
+	/* Do not wait for the link to come up; link state is reported
+	 * via bnx2_link() once autonegotiation completes.
+	 */
 	bnx2_poll_link(bp);
-	for(i = 0; !bp->link_up && (i < VALID_LINK_TIMEOUT*100); i++) {
-		mdelay(1);
-		bnx2_poll_link(bp);
-	}
-#if 1
-	if (!bp->link_up){
-		printf("Valid link not established\n");
-		goto err_out_disable;
-	}
-#endif
-	
-	return 1;
 
-err_out_disable:
-	bnx2_disable(nic);
-	return 0;
+	return 1;
 }
 
 static struct pci_device_id bnx2_nics[] = {
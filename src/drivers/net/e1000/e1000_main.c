@@ -32,6 +32,10 @@
 FILE_LICENCE ( GPL2_ONLY );
 
 #include "e1000.h"
+#include <stddef.h>
+#include <gpxe/ip.h>
+#include <gpxe/tcp.h>
+#include <gpxe/tcpip.h>
 
 /**
  * e1000_irq_disable - Disable interrupt generation
@@ -208,9 +212,13 @@ static void e1000_process_tx_packets ( struct net_device *netdev )
 	uint32_t tx_status;
 	struct e1000_tx_desc *tx_curr_desc;
 
-	/* Check status of transmitted packets
+	/* Check status of transmitted packets.  The head and tail
+	   indices coincide when the ring is completely full, so use
+	   the fill counter to decide when to stop.
 	 */
-	while ( ( i = adapter->tx_head ) != adapter->tx_tail ) {
+	while ( adapter->tx_fill_ctr ) {
+
+		i = adapter->tx_head;
 
 		tx_curr_desc = ( void * )  ( adapter->tx_base ) +
 					   ( i * sizeof ( *adapter->tx_base ) );
@@ -224,8 +232,11 @@ static void e1000_process_tx_packets ( struct net_device *netdev )
 		DBG ( "Sent packet. tx_head: %d tx_tail: %d tx_status: %#08x\n",
 		      adapter->tx_head, adapter->tx_tail, tx_status );
 
-		if ( tx_status & ( E1000_TXD_STAT_EC | E1000_TXD_STAT_LC |
-				   E1000_TXD_STAT_TU ) ) {
+		if ( ! adapter->tx_iobuf[i] ) {
+			/* Offload context descriptor; nothing to complete */
+		} else if ( tx_status & ( E1000_TXD_STAT_EC |
+					  E1000_TXD_STAT_LC |
+					  E1000_TXD_STAT_TU ) ) {
 			netdev_tx_complete_err ( netdev, adapter->tx_iobuf[i], -EINVAL );
 			DBG ( "Error transmitting packet, tx_status: %#08x\n",
 			      tx_status );
@@ -238,6 +249,7 @@ static void e1000_process_tx_packets ( struct net_device *netdev )
 		/* Decrement count of used descriptors, clear this descriptor
 		 */
 		adapter->tx_fill_ctr--;
+		adapter->tx_iobuf[i] = NULL;
 		memset ( tx_curr_desc, 0, sizeof ( *tx_curr_desc ) );
 
 		adapter->tx_head = ( adapter->tx_head + 1 ) % NUM_TX_DESC;
@@ -420,6 +432,10 @@ static void e1000_configure_rx ( struct e1000_adapter *adapter )
 	/* Enable Receives */
 	rctl |=  E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SZ_2048 |
 		 E1000_RCTL_MPE;
+
+	/* Enable TCP/UDP receive checksum verification */
+	if ( adapter->netdev->features & NETDEV_F_RX_CSUM )
+		E1000_WRITE_REG ( hw, E1000_RXCSUM, E1000_RXCSUM_TUOFL );
 	E1000_WRITE_REG ( hw, E1000_RCTL, rctl );
 	E1000_WRITE_FLUSH ( hw );
 
@@ -477,6 +493,14 @@ static void e1000_process_rx_packets ( struct net_device *netdev )
 			DBG ( "e1000_poll: Corrupted packet received!"
 			      " rx_err: %#08x\n", rx_err );
 		} else {
+			/* Trust the hardware's TCP/UDP checksum verdict */
+			if ( ( netdev->features & NETDEV_F_RX_CSUM ) &&
+			     ! ( rx_status & E1000_RXD_STAT_IXSM ) &&
+			     ( rx_status & ( E1000_RXD_STAT_TCPCS |
+					     E1000_RXD_STAT_UDPCS ) ) &&
+			     ! ( rx_err & E1000_RXD_ERR_TCPE ) ) {
+				adapter->rx_iobuf[i]->flags |= IOB_CSUM_VALID;
+			}
 			/* Add this packet to the receive queue. */
 			netdev_rx ( netdev, adapter->rx_iobuf[i] );
 		}
@@ -574,6 +598,82 @@ static void e1000_close ( struct net_device *netdev )
 	e1000_free_rx_resources ( adapter );
 }
 
+/**
+ * e1000_tx_context - Queue an offload context descriptor
+ *
+ * @v adapter	e1000 private structure
+ * @v iobuf	I/O buffer marked with IOB_CSUM_PARTIAL
+ * @v popts	Packet options for the data descriptor to fill in
+ *
+ * @ret cmd	Additional command bits for the data descriptor
+ *
+ * The context descriptor occupies a ring slot of its own, with no
+ * associated I/O buffer.
+ **/
+static uint32_t e1000_tx_context ( struct e1000_adapter *adapter,
+				   struct io_buffer *iobuf, uint32_t *popts )
+{
+	struct e1000_context_desc *ctx_desc;
+	size_t css = ( iobuf->csum_start - ( iobuf->data - iobuf->head ) );
+	size_t ipcss = ETH_HLEN;
+	size_t hdr_len;
+	struct iphdr *iphdr;
+	struct tcp_header *tcphdr;
+	uint16_t neg_len;
+	uint32_t cmd = 0;
+
+	ctx_desc = ( void * ) ( adapter->tx_base ) +
+		   ( adapter->tx_tail * sizeof ( *adapter->tx_base ) );
+	memset ( ctx_desc, 0, sizeof ( *ctx_desc ) );
+
+	/* Checksum from csum_start to the end of the packet */
+	ctx_desc->upper_setup.tcp_fields.tucss = css;
+	ctx_desc->upper_setup.tcp_fields.tucso = ( css + iobuf->csum_offset );
+	ctx_desc->upper_setup.tcp_fields.tucse = 0;
+	*popts = E1000_TXD_POPTS_TXSM;
+
+	if ( iobuf->flags & IOB_TSO ) {
+		iphdr = ( iobuf->data + ipcss );
+		tcphdr = ( iobuf->data + css );
+		hdr_len = ( css + ( ( tcphdr->hlen & TCP_MASK_HLEN ) / 4 ) );
+
+		/* The hardware fills in each segment's IP length and
+		   checksum, and expects a TCP pseudo-header checksum
+		   that excludes the length.
+		 */
+		iphdr->len = 0;
+		iphdr->chksum = 0;
+		neg_len = ~htons ( iob_len ( iobuf ) - css );
+		tcphdr->csum = ~tcpip_continue_chksum ( ~tcphdr->csum,
+							&neg_len,
+							sizeof ( neg_len ) );
+
+		ctx_desc->lower_setup.ip_fields.ipcss = ipcss;
+		ctx_desc->lower_setup.ip_fields.ipcso =
+			( ipcss + offsetof ( struct iphdr, chksum ) );
+		ctx_desc->lower_setup.ip_fields.ipcse = ( css - 1 );
+		ctx_desc->tcp_seg_setup.fields.hdr_len = hdr_len;
+		ctx_desc->tcp_seg_setup.fields.mss = iobuf->mss;
+		ctx_desc->cmd_and_length =
+			( E1000_TXD_CMD_TSE | E1000_TXD_CMD_IP |
+			  E1000_TXD_CMD_TCP | ( iob_len ( iobuf ) - hdr_len ) );
+		*popts |= E1000_TXD_POPTS_IXSM;
+		cmd = E1000_TXD_CMD_TSE;
+	}
+	ctx_desc->cmd_and_length |= ( E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_C |
+				      E1000_TXD_CMD_RS );
+
+	DBG ( "TX context css: %zd cso: %zd mss: %d\n", css,
+	      ( css + iobuf->csum_offset ),
+	      ( ( iobuf->flags & IOB_TSO ) ? iobuf->mss : 0 ) );
+
+	adapter->tx_iobuf[adapter->tx_tail] = NULL;
+	adapter->tx_tail = ( adapter->tx_tail + 1 ) % NUM_TX_DESC;
+	adapter->tx_fill_ctr++;
+
+	return cmd;
+}
+
 /**
  * e1000_transmit - Transmit a packet
  *
@@ -586,16 +686,30 @@ static int e1000_transmit ( struct net_device *netdev, struct io_buffer *iobuf )
 {
 	struct e1000_adapter *adapter = netdev_priv( netdev );
 	struct e1000_hw *hw = &adapter->hw;
-	uint32_t tx_curr = adapter->tx_tail;
+	uint32_t tx_curr;
 	struct e1000_tx_desc *tx_curr_desc;
+	unsigned int needed;
+	uint32_t cmd;
+	uint32_t popts = 0;
 
 	DBG ("e1000_transmit\n");
 
-	if ( adapter->tx_fill_ctr == NUM_TX_DESC ) {
+	/* Offloaded packets need an extra context descriptor */
+	needed = ( ( iobuf->flags & IOB_CSUM_PARTIAL ) ? 2 : 1 );
+	if ( ( NUM_TX_DESC - adapter->tx_fill_ctr ) < needed ) {
 		DBG ("TX overflow\n");
 		return -ENOBUFS;
 	}
 
+	if ( iobuf->flags & IOB_CSUM_PARTIAL ) {
+		cmd = ( E1000_TXD_CMD_DEXT | E1000_TXD_DTYP_D |
+			E1000_TXD_CMD_RS |
+			e1000_tx_context ( adapter, iobuf, &popts ) );
+	} else {
+		cmd = E1000_TXD_CMD_RPS;
+	}
+	tx_curr = adapter->tx_tail;
+
 	/* Save pointer to iobuf we have been given to transmit,
 	   netdev_tx_complete() will need it later
 	 */
@@ -613,9 +727,9 @@ static int e1000_transmit ( struct net_device *netdev, struct io_buffer *iobuf )
 	tx_curr_desc->buffer_addr =
 		virt_to_bus ( iobuf->data );
 	tx_curr_desc->lower.data =
-		E1000_TXD_CMD_RPS  | E1000_TXD_CMD_EOP |
+		cmd | E1000_TXD_CMD_EOP |
 		E1000_TXD_CMD_IFCS | iob_len ( iobuf );
-	tx_curr_desc->upper.data = 0;
+	tx_curr_desc->upper.data = ( popts << E1000_TXD_POPTS_SHIFT );
 
 	DBG ( "TX fill: %d tx_curr: %d addr: %#08lx len: %zd\n", adapter->tx_fill_ctr,
 	      tx_curr, virt_to_bus ( iobuf->data ), iob_len ( iobuf ) );
@@ -778,6 +892,18 @@ int e1000_probe ( struct pci_device *pdev,
 
 	DBG ( "adapter->hw.mac.type: %#08x\n", adapter->hw.mac.type );
 
+	/* Checksum offload appeared with the 82543, segmentation
+	 * offload with the 82544 (but is broken on the 82547)
+	 */
+	if ( adapter->hw.mac.type >= e1000_82543 )
+		netdev->features |= ( NETDEV_F_RX_CSUM | NETDEV_F_TX_CSUM );
+	if ( ( adapter->hw.mac.type >= e1000_82544 ) &&
+	     ( adapter->hw.mac.type != e1000_82547 ) )
+		netdev->features |= NETDEV_F_TSO;
+
+	/* Interrupts are acknowledged by e1000_poll() */
+	netdev->features |= NETDEV_F_IRQ;
+
 	/* before reading the EEPROM, reset the controller to
 	 * put the device in a known good starting state
 	 */
@@ -114,6 +114,9 @@ struct vf_data_storage {
 /* this is the size past which hardware will drop packets when setting LPE=0 */
 #define MAXIMUM_ETHERNET_VLAN_SIZE 1522
 
+/* largest MTU supported (jumbo frames) */
+#define IGB_MAX_MTU 9000
+
 /* Supported Rx Buffer Sizes */
 #define IGB_RXBUFFER_128   128    /* Used for packet split */
 #define IGB_RXBUFFER_256   256    /* Used for packet split */
@@ -258,7 +261,60 @@ struct igb_ring {
 #define E1000_RX_DESC(R, i)		E1000_GET_DESC(R, i, e1000_rx_desc)
 
 #define MAX_MSIX_COUNT 10
-/* board specific private data structure */
+
+#define NUM_TX_DESC	8
+#define NUM_RX_DESC	8
+
+/* Number of TX/RX queue pairs, with received flows spread across the
+ * RX queues by receive-side scaling (RSS).
+ *
+ * Every RX queue keeps NUM_RX_DESC buffers of rx_buffer_len bytes
+ * posted, so the RX rings take IGB_NUM_QUEUES * NUM_RX_DESC *
+ * rx_buffer_len bytes of heap: 16kB with a single queue at the
+ * standard MTU, but 64kB of the 128kB heap with four queues.  A
+ * single queue is therefore the default; build with e.g.
+ * EXTRA_CFLAGS=-DIGB_NUM_QUEUES=4 to trade heap space for RSS.
+ * Fewer queues are used when a larger MTU would take the RX rings
+ * beyond NETDEV_RX_BUFFER_SPACE. */
+#ifndef IGB_NUM_QUEUES
+#define IGB_NUM_QUEUES	1
+#endif
+#if ( IGB_NUM_QUEUES < 1 ) || ( IGB_NUM_QUEUES > NETDEV_MAX_QUEUES )
+#error "IGB_NUM_QUEUES must be between 1 and NETDEV_MAX_QUEUES"
+#endif
+
+/* Largest receive buffer for which a single queue's RX ring fits
+ * within NETDEV_RX_BUFFER_SPACE */
+#define IGB_MAX_RXBUFFER	( NETDEV_RX_BUFFER_SPACE / NUM_RX_DESC )
+
+/* Number of RSS redirection table entries */
+#define IGB_RETA_SIZE	128
+
+/* Number of 32-bit words in the RSS hash key */
+#define IGB_RSSRK_SIZE	10
+
+/* Iterate over the queue pairs in use.  The comparison against
+ * IGB_NUM_QUEUES is redundant, but tells the compiler that q stays
+ * within the queue array. */
+#define for_each_igb_queue( adapter, q )				\
+	for ( (q) = 0 ; ( ( (q) < (adapter)->num_queues ) &&		\
+			  ( (q) < IGB_NUM_QUEUES ) ) ; (q)++ )
+
+/* TX/RX descriptor ring pair */
+struct igb_queue {
+	struct io_buffer *tx_iobuf[NUM_TX_DESC];
+	struct io_buffer *rx_iobuf[NUM_RX_DESC];
+
+	struct e1000_tx_desc *tx_base;
+	struct e1000_rx_desc *rx_base;
+
+	uint32_t tx_head;
+	uint32_t tx_tail;
+	uint32_t tx_fill_ctr;
+
+	uint32_t rx_curr;
+};
+
 
 /* board specific private data structure */
 struct igb_adapter {
@@ -285,23 +341,17 @@ struct igb_adapter {
 	unsigned int flags;
 	unsigned int flags2;
 
-#define NUM_TX_DESC	8
-#define NUM_RX_DESC	8
-
-	struct io_buffer *tx_iobuf[NUM_TX_DESC];
-	struct io_buffer *rx_iobuf[NUM_RX_DESC];
-
-	struct e1000_tx_desc *tx_base;
-	struct e1000_rx_desc *rx_base;
+	struct igb_queue queue[IGB_NUM_QUEUES];
 
 	uint32_t tx_ring_size;
 	uint32_t rx_ring_size;
 
-	uint32_t tx_head;
-	uint32_t tx_tail;
-	uint32_t tx_fill_ctr;
+	/* length of receive buffers, chosen when the device is opened */
+	uint32_t rx_buffer_len;
 
-	uint32_t rx_curr;
+	/* number of TX/RX queue pairs in use, chosen along with
+	 * rx_buffer_len */
+	unsigned int num_queues;
 
 	uint32_t ioaddr;
 	uint32_t irqno;
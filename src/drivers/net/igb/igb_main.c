@@ -215,6 +215,8 @@ int igb_sw_init(struct igb_adapter *adapter)
 
 /* TX support routines */
 
+static void igb_free_tx_resources ( struct igb_adapter *adapter );
+
 /**
  * igb_setup_tx_resources - allocate Tx resources (Descriptors)
  *
@@ -224,6 +226,9 @@ int igb_sw_init(struct igb_adapter *adapter)
  **/
 static int igb_setup_tx_resources ( struct igb_adapter *adapter )
 {
+	struct igb_queue *queue;
+	unsigned int q;
+
 	DBG ( "igb_setup_tx_resources\n" );
 
 	/* Allocate transmit descriptor ring memory.
@@ -236,16 +241,23 @@ static int igb_setup_tx_resources ( struct igb_adapter *adapter )
 	   cross 64K bytes.
 	 */
 
-	adapter->tx_base =
-		malloc_dma ( adapter->tx_ring_size, adapter->tx_ring_size );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
 
-	if ( ! adapter->tx_base ) {
-		return -ENOMEM;
-	}
+		queue->tx_base =
+			malloc_dma ( adapter->tx_ring_size,
+				     adapter->tx_ring_size );
+
+		if ( ! queue->tx_base ) {
+			igb_free_tx_resources ( adapter );
+			return -ENOMEM;
+		}
 
-	memset ( adapter->tx_base, 0, adapter->tx_ring_size );
+		memset ( queue->tx_base, 0, adapter->tx_ring_size );
 
-	DBG ( "adapter->tx_base = %#08lx\n", virt_to_bus ( adapter->tx_base ) );
+		DBG ( "queue[%d].tx_base = %#08lx\n", q,
+		      virt_to_bus ( queue->tx_base ) );
+	}
 
 	return 0;
 }
@@ -254,23 +266,24 @@ static int igb_setup_tx_resources ( struct igb_adapter *adapter )
  * igb_process_tx_packets - process transmitted packets
  *
  * @v netdev	network interface device structure
+ * @v queue	TX/RX queue pair
  **/
-static void igb_process_tx_packets ( struct net_device *netdev )
+static void igb_process_tx_packets ( struct net_device *netdev,
+				     struct igb_queue *queue )
 {
-	struct igb_adapter *adapter = netdev_priv ( netdev );
 	uint32_t i;
 	uint32_t tx_status;
 	struct e1000_tx_desc *tx_curr_desc;
 
 	/* Check status of transmitted packets
 	 */
-	DBG ( "process_tx_packets: tx_head = %d, tx_tail = %d\n", adapter->tx_head,
-	      adapter->tx_tail );
+	DBG ( "process_tx_packets: tx_head = %d, tx_tail = %d\n", queue->tx_head,
+	      queue->tx_tail );
 
-	while ( ( i = adapter->tx_head ) != adapter->tx_tail ) {
+	while ( ( i = queue->tx_head ) != queue->tx_tail ) {
 
-		tx_curr_desc = ( void * )  ( adapter->tx_base ) +
-					   ( i * sizeof ( *adapter->tx_base ) );
+		tx_curr_desc = ( void * )  ( queue->tx_base ) +
+					   ( i * sizeof ( *queue->tx_base ) );
 
 		tx_status = tx_curr_desc->upper.data;
 
@@ -282,33 +295,40 @@ static void igb_process_tx_packets ( struct net_device *netdev )
 			break;
 
 		DBG ( "Sent packet. tx_head: %d tx_tail: %d tx_status: %#08x\n",
-		      adapter->tx_head, adapter->tx_tail, tx_status );
+		      queue->tx_head, queue->tx_tail, tx_status );
 
 		if ( tx_status & ( E1000_TXD_STAT_EC | E1000_TXD_STAT_LC |
 				   E1000_TXD_STAT_TU ) ) {
-			netdev_tx_complete_err ( netdev, adapter->tx_iobuf[i], -EINVAL );
+			netdev_tx_complete_err ( netdev, queue->tx_iobuf[i], -EINVAL );
 			DBG ( "Error transmitting packet, tx_status: %#08x\n",
 			      tx_status );
 		} else {
-			netdev_tx_complete ( netdev, adapter->tx_iobuf[i] );
+			netdev_tx_complete ( netdev, queue->tx_iobuf[i] );
 			DBG ( "Success transmitting packet, tx_status: %#08x\n",
 			      tx_status );
 		}
 
 		/* Decrement count of used descriptors, clear this descriptor
 		 */
-		adapter->tx_fill_ctr--;
+		queue->tx_fill_ctr--;
 		memset ( tx_curr_desc, 0, sizeof ( *tx_curr_desc ) );
 
-		adapter->tx_head = ( adapter->tx_head + 1 ) % NUM_TX_DESC;
+		queue->tx_head = ( queue->tx_head + 1 ) % NUM_TX_DESC;
 	}
 }
 
 static void igb_free_tx_resources ( struct igb_adapter *adapter )
 {
+	struct igb_queue *queue;
+	unsigned int q;
+
 	DBG ( "igb_free_tx_resources\n" );
 
-	free_dma ( adapter->tx_base, adapter->tx_ring_size );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
+		free_dma ( queue->tx_base, adapter->tx_ring_size );
+		queue->tx_base = NULL;
+	}
 }
 
 /**
@@ -320,6 +340,8 @@ static void igb_free_tx_resources ( struct igb_adapter *adapter )
 static void igb_configure_tx ( struct igb_adapter *adapter )
 {
 	struct e1000_hw *hw = &adapter->hw;
+	struct igb_queue *queue;
+	unsigned int q;
 	u32 tctl, txdctl;
 
 	DBG ( "igb_configure_tx\n" );
@@ -330,24 +352,31 @@ static void igb_configure_tx ( struct igb_adapter *adapter )
 	E1000_WRITE_FLUSH(hw);
 	mdelay(10);
 
-	E1000_WRITE_REG ( hw, E1000_TDBAH(0), 0 );
-	E1000_WRITE_REG ( hw, E1000_TDBAL(0), virt_to_bus ( adapter->tx_base ) );
-	E1000_WRITE_REG ( hw, E1000_TDLEN(0), adapter->tx_ring_size );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
+
+		E1000_WRITE_REG ( hw, E1000_TDBAH(q), 0 );
+		E1000_WRITE_REG ( hw, E1000_TDBAL(q),
+				  virt_to_bus ( queue->tx_base ) );
+		E1000_WRITE_REG ( hw, E1000_TDLEN(q), adapter->tx_ring_size );
 
-	DBG ( "E1000_TDBAL(0): %#08x\n",  E1000_READ_REG ( hw, E1000_TDBAL(0) ) );
-	DBG ( "E1000_TDLEN(0): %d\n",	  E1000_READ_REG ( hw, E1000_TDLEN(0) ) );
+		DBG ( "E1000_TDBAL(%d): %#08x\n", q,
+		      E1000_READ_REG ( hw, E1000_TDBAL(q) ) );
+		DBG ( "E1000_TDLEN(%d): %d\n", q,
+		      E1000_READ_REG ( hw, E1000_TDLEN(q) ) );
 
-	/* Setup the HW Tx Head and Tail descriptor pointers */
-	E1000_WRITE_REG ( hw, E1000_TDH(0), 0 );
-	E1000_WRITE_REG ( hw, E1000_TDT(0), 0 );
+		/* Setup the HW Tx Head and Tail descriptor pointers */
+		E1000_WRITE_REG ( hw, E1000_TDH(q), 0 );
+		E1000_WRITE_REG ( hw, E1000_TDT(q), 0 );
 
-	adapter->tx_head = 0;
-	adapter->tx_tail = 0;
-	adapter->tx_fill_ctr = 0;
+		queue->tx_head = 0;
+		queue->tx_tail = 0;
+		queue->tx_fill_ctr = 0;
 
-	txdctl = E1000_READ_REG ( hw, E1000_TXDCTL(0) );
-	txdctl |= E1000_TXDCTL_QUEUE_ENABLE;
-	E1000_WRITE_REG ( hw, E1000_TXDCTL(0), txdctl );
+		txdctl = E1000_READ_REG ( hw, E1000_TXDCTL(q) );
+		txdctl |= E1000_TXDCTL_QUEUE_ENABLE;
+		E1000_WRITE_REG ( hw, E1000_TXDCTL(q), txdctl );
+	}
 
 	/* Setup Transmit Descriptor Settings for eop descriptor */
 	adapter->txd_cmd = E1000_TXD_CMD_EOP | E1000_TXD_CMD_IFCS;
@@ -372,14 +401,22 @@ static void igb_configure_tx ( struct igb_adapter *adapter )
 
 static void igb_free_rx_resources ( struct igb_adapter *adapter )
 {
+	struct igb_queue *queue;
+	unsigned int q;
 	int i;
 
 	DBG ( "igb_free_rx_resources\n" );
 
-	free_dma ( adapter->rx_base, adapter->rx_ring_size );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
 
-	for ( i = 0; i < NUM_RX_DESC; i++ ) {
-		free_iob ( adapter->rx_iobuf[i] );
+		free_dma ( queue->rx_base, adapter->rx_ring_size );
+		queue->rx_base = NULL;
+
+		for ( i = 0; i < NUM_RX_DESC; i++ ) {
+			free_iob ( queue->rx_iobuf[i] );
+			queue->rx_iobuf[i] = NULL;
+		}
 	}
 }
 
@@ -387,13 +424,15 @@ static void igb_free_rx_resources ( struct igb_adapter *adapter )
  * igb_refill_rx_ring - allocate Rx io_buffers
  *
  * @v adapter	e1000 private structure
+ * @v q		Queue index
  *
  * @ret rc	 Returns 0 on success, negative on failure
  **/
-static int igb_refill_rx_ring ( struct igb_adapter *adapter )
+static int igb_refill_rx_ring ( struct igb_adapter *adapter, unsigned int q )
 {
 	int i, rx_curr;
 	int rc = 0;
+	struct igb_queue *queue = &adapter->queue[q];
 	struct e1000_rx_desc *rx_curr_desc;
 	struct e1000_hw *hw = &adapter->hw;
 	struct io_buffer *iob;
@@ -401,19 +440,19 @@ static int igb_refill_rx_ring ( struct igb_adapter *adapter )
 	DBGP ("igb_refill_rx_ring\n");
 
 	for ( i = 0; i < NUM_RX_DESC; i++ ) {
-		rx_curr = ( ( adapter->rx_curr + i ) % NUM_RX_DESC );
-		rx_curr_desc = adapter->rx_base + rx_curr;
+		rx_curr = ( ( queue->rx_curr + i ) % NUM_RX_DESC );
+		rx_curr_desc = queue->rx_base + rx_curr;
 
 		if ( rx_curr_desc->status & E1000_RXD_STAT_DD )
 			continue;
 
-		if ( adapter->rx_iobuf[rx_curr] != NULL )
+		if ( queue->rx_iobuf[rx_curr] != NULL )
 			continue;
 
-		DBG2 ( "Refilling rx desc %d\n", rx_curr );
+		DBG2 ( "Refilling rx desc %d on queue %d\n", rx_curr, q );
 
-		iob = alloc_iob ( MAXIMUM_ETHERNET_VLAN_SIZE );
-		adapter->rx_iobuf[rx_curr] = iob;
+		iob = alloc_iob ( adapter->rx_buffer_len );
+		queue->rx_iobuf[rx_curr] = iob;
 
 		if ( ! iob ) {
 			DBG ( "alloc_iob failed\n" );
@@ -422,7 +461,7 @@ static int igb_refill_rx_ring ( struct igb_adapter *adapter )
 		} else {
 			rx_curr_desc->buffer_addr = virt_to_bus ( iob->data );
 
-			E1000_WRITE_REG ( hw, E1000_RDT(0), rx_curr );
+			E1000_WRITE_REG ( hw, E1000_RDT(q), rx_curr );
 		}
 	}
 	return rc;
@@ -437,6 +476,8 @@ static int igb_refill_rx_ring ( struct igb_adapter *adapter )
  **/
 static int igb_setup_rx_resources ( struct igb_adapter *adapter )
 {
+	struct igb_queue *queue;
+	unsigned int q;
 	int i, rc = 0;
 
 	DBGP ( "igb_setup_rx_resources\n" );
@@ -445,27 +486,78 @@ static int igb_setup_rx_resources ( struct igb_adapter *adapter )
 	   It must not cross a 64K boundary because of hardware errata
 	 */
 
-	adapter->rx_base =
-		malloc_dma ( adapter->rx_ring_size, adapter->rx_ring_size );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
 
-	if ( ! adapter->rx_base ) {
-		return -ENOMEM;
-	}
-	memset ( adapter->rx_base, 0, adapter->rx_ring_size );
+		queue->rx_base =
+			malloc_dma ( adapter->rx_ring_size,
+				     adapter->rx_ring_size );
 
-	for ( i = 0; i < NUM_RX_DESC; i++ ) {
-		/* let igb_refill_rx_ring() io_buffer allocations */
-		adapter->rx_iobuf[i] = NULL;
+		if ( ! queue->rx_base ) {
+			igb_free_rx_resources ( adapter );
+			return -ENOMEM;
+		}
+		memset ( queue->rx_base, 0, adapter->rx_ring_size );
+
+		queue->rx_curr = 0;
+		for ( i = 0; i < NUM_RX_DESC; i++ ) {
+			/* let igb_refill_rx_ring() io_buffer allocations */
+			queue->rx_iobuf[i] = NULL;
+		}
 	}
 
 	/* allocate io_buffers */
-	rc = igb_refill_rx_ring ( adapter );
-	if ( rc < 0 )
-		igb_free_rx_resources ( adapter );
+	for_each_igb_queue ( adapter, q ) {
+		rc = igb_refill_rx_ring ( adapter, q );
+		if ( rc < 0 ) {
+			igb_free_rx_resources ( adapter );
+			break;
+		}
+	}
 
 	return rc;
 }
 
+/**
+ * igb_configure_rss - Spread received flows across the Rx queues
+ * @adapter: board private structure
+ *
+ * Packets are assigned to a queue according to a hash of their
+ * addresses and ports, so that each flow is always received on the
+ * same queue.
+ **/
+static void igb_configure_rss ( struct igb_adapter *adapter )
+{
+	struct e1000_hw *hw = &adapter->hw;
+	uint32_t reta = 0;
+	uint32_t mrqc;
+	unsigned int shift;
+	int i;
+
+	/* Fill the redirection table, four entries per register.
+	 * The 82575 holds the queue index in the upper bits of each
+	 * entry.
+	 */
+	shift = ( ( hw->mac.type == e1000_82575 ) ? 6 : 0 );
+	for ( i = 0; i < IGB_RETA_SIZE; i++ ) {
+		reta >>= 8;
+		reta |= ( ( ( i % adapter->num_queues ) << shift ) << 24 );
+		if ( ( i & 3 ) == 3 )
+			E1000_WRITE_REG ( hw, E1000_RETA ( i >> 2 ), reta );
+	}
+
+	/* Use a random hash key */
+	for ( i = 0; i < IGB_RSSRK_SIZE; i++ )
+		E1000_WRITE_REG ( hw, E1000_RSSRK ( i ), random() );
+
+	mrqc = E1000_MRQC_ENABLE_RSS_4Q;
+	mrqc |= ( E1000_MRQC_RSS_FIELD_IPV4 |
+		  E1000_MRQC_RSS_FIELD_IPV4_TCP |
+		  E1000_MRQC_RSS_FIELD_IPV6 |
+		  E1000_MRQC_RSS_FIELD_IPV6_TCP );
+	E1000_WRITE_REG ( hw, E1000_MRQC, mrqc );
+}
+
 /**
  * igb_configure_rx - Configure 8254x Receive Unit after Reset
  * @adapter: board private structure
@@ -475,6 +567,8 @@ static int igb_setup_rx_resources ( struct igb_adapter *adapter )
 static void igb_configure_rx ( struct igb_adapter *adapter )
 {
 	struct e1000_hw *hw = &adapter->hw;
+	struct igb_queue *queue;
+	unsigned int q;
 	uint32_t rctl, rxdctl, rxcsum, mrqc;
 
 	DBGP ( "igb_configure_rx\n" );
@@ -485,42 +579,60 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
 	E1000_WRITE_FLUSH(hw);
 	mdelay(10);
 
-	adapter->rx_curr = 0;
-
-	/* Setup the HW Rx Head and Tail Descriptor Pointers and
-	 * the Base and Length of the Rx Descriptor Ring */
-
-	E1000_WRITE_REG ( hw, E1000_RDBAL(0), virt_to_bus ( adapter->rx_base ) );
-	E1000_WRITE_REG ( hw, E1000_RDBAH(0), 0 );
-	E1000_WRITE_REG ( hw, E1000_RDLEN(0), adapter->rx_ring_size );
-
-	E1000_WRITE_REG ( hw, E1000_RDH(0), 0 );
-	E1000_WRITE_REG ( hw, E1000_RDT(0), 0 );
+	for_each_igb_queue ( adapter, q ) {
+		queue = &adapter->queue[q];
+
+		queue->rx_curr = 0;
+
+		/* Setup the HW Rx Head and Tail Descriptor Pointers and
+		 * the Base and Length of the Rx Descriptor Ring */
+
+		E1000_WRITE_REG ( hw, E1000_RDBAL(q),
+				  virt_to_bus ( queue->rx_base ) );
+		E1000_WRITE_REG ( hw, E1000_RDBAH(q), 0 );
+		E1000_WRITE_REG ( hw, E1000_RDLEN(q), adapter->rx_ring_size );
+
+		E1000_WRITE_REG ( hw, E1000_RDH(q), 0 );
+		E1000_WRITE_REG ( hw, E1000_RDT(q), 0 );
+
+		/* Set the receive buffer size, in 1kB units */
+		E1000_WRITE_REG ( hw, E1000_SRRCTL(q),
+				  ( ( adapter->rx_buffer_len >>
+				      E1000_SRRCTL_BSIZEPKT_SHIFT ) |
+				    E1000_SRRCTL_DESCTYPE_LEGACY ) );
+
+		DBG ( "E1000_RDBAL(%d): %#08x\n", q,
+		      E1000_READ_REG ( hw, E1000_RDBAL(q) ) );
+		DBG ( "E1000_RDLEN(%d): %d\n", q,
+		      E1000_READ_REG ( hw, E1000_RDLEN(q) ) );
+
+		rxdctl = E1000_READ_REG ( hw, E1000_RXDCTL(q) );
+		rxdctl |= E1000_RXDCTL_QUEUE_ENABLE;
+		rxdctl &= 0xFFF00000;
+		rxdctl |= IGB_RX_PTHRESH;
+		rxdctl |= IGB_RX_HTHRESH << 8;
+		rxdctl |= IGB_RX_WTHRESH << 16;
+		E1000_WRITE_REG ( hw, E1000_RXDCTL(q), rxdctl );
+		E1000_WRITE_FLUSH ( hw );
+	}
 
-	DBG ( "E1000_RDBAL(0): %#08x\n",  E1000_READ_REG ( hw, E1000_RDBAL(0) ) );
-	DBG ( "E1000_RDLEN(0): %d\n",	  E1000_READ_REG ( hw, E1000_RDLEN(0) ) );
 	DBG ( "E1000_RCTL:  %#08x\n",	  E1000_READ_REG ( hw, E1000_RCTL ) );
 
-	rxdctl = E1000_READ_REG ( hw, E1000_RXDCTL(0) );
-	rxdctl |= E1000_RXDCTL_QUEUE_ENABLE;
-	rxdctl &= 0xFFF00000;
-	rxdctl |= IGB_RX_PTHRESH;
-	rxdctl |= IGB_RX_HTHRESH << 8;
-	rxdctl |= IGB_RX_WTHRESH << 16;
-	E1000_WRITE_REG ( hw, E1000_RXDCTL(0), rxdctl );
-	E1000_WRITE_FLUSH ( hw );
-
 	rxcsum = E1000_READ_REG(hw, E1000_RXCSUM);
 	rxcsum &= ~( E1000_RXCSUM_TUOFL | E1000_RXCSUM_IPPCSE );
 	E1000_WRITE_REG ( hw, E1000_RXCSUM, 0 );
 
-	/* The initial value for MRQC disables multiple receive
-	 * queues, however this setting is not recommended.
-	 * - Intel® 82576 Gigabit Ethernet Controller Datasheet r2.41
-	 *   Section 8.10.9 Multiple Queues Command Register - MRQC
-	 */
-	mrqc = E1000_MRQC_ENABLE_VMDQ;
-	E1000_WRITE_REG ( hw, E1000_MRQC, mrqc );
+	if ( adapter->num_queues > 1 ) {
+		igb_configure_rss ( adapter );
+	} else {
+		/* The initial value for MRQC disables multiple receive
+		 * queues, however this setting is not recommended.
+		 * - Intel® 82576 Gigabit Ethernet Controller Datasheet r2.41
+		 *   Section 8.10.9 Multiple Queues Command Register - MRQC
+		 */
+		mrqc = E1000_MRQC_ENABLE_VMDQ;
+		E1000_WRITE_REG ( hw, E1000_MRQC, mrqc );
+	}
 
 	/* Turn off loopback modes */
 	rctl &= ~(E1000_RCTL_LBM_TCVR | E1000_RCTL_LBM_MAC);
@@ -536,6 +648,7 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
 
 	/* enable LPE to prevent packets larger than max_frame_size */
 	rctl |= E1000_RCTL_LPE;
+	E1000_WRITE_REG ( hw, E1000_RLPML, adapter->max_frame_size );
 
 	/* enable stripping of CRC. */
 	rctl |= E1000_RCTL_SECRC;
@@ -556,11 +669,16 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
 	 * I have omitted that step.
 	 * - Simon Horman, May 2009
 	 */
-	E1000_WRITE_REG ( hw, E1000_RDT(0), NUM_RX_DESC - 1 );
-
-	DBG ( "RDBAH: %#08x\n",	 E1000_READ_REG ( hw, E1000_RDBAH(0) ) );
-	DBG ( "RDBAL: %#08x\n",	 E1000_READ_REG ( hw, E1000_RDBAL(0) ) );
-	DBG ( "RDLEN: %d\n",	 E1000_READ_REG ( hw, E1000_RDLEN(0) ) );
+	for_each_igb_queue ( adapter, q ) {
+		E1000_WRITE_REG ( hw, E1000_RDT(q), NUM_RX_DESC - 1 );
+
+		DBG ( "RDBAH(%d): %#08x\n", q,
+		      E1000_READ_REG ( hw, E1000_RDBAH(q) ) );
+		DBG ( "RDBAL(%d): %#08x\n", q,
+		      E1000_READ_REG ( hw, E1000_RDBAL(q) ) );
+		DBG ( "RDLEN(%d): %d\n", q,
+		      E1000_READ_REG ( hw, E1000_RDLEN(q) ) );
+	}
 	DBG ( "RCTL:  %#08x\n",	 E1000_READ_REG ( hw, E1000_RCTL ) );
 }
 
@@ -568,10 +686,13 @@ static void igb_configure_rx ( struct igb_adapter *adapter )
  * igb_process_rx_packets - process received packets
  *
  * @v netdev	network interface device structure
+ * @v q		Queue index
  **/
-static void igb_process_rx_packets ( struct net_device *netdev )
+static void igb_process_rx_packets ( struct net_device *netdev,
+				     unsigned int q )
 {
 	struct igb_adapter *adapter = netdev_priv ( netdev );
+	struct igb_queue *queue = &adapter->queue[q];
 	uint32_t i;
 	uint32_t rx_status;
 	uint32_t rx_len;
@@ -584,10 +705,10 @@ static void igb_process_rx_packets ( struct net_device *netdev )
 	 */
 	while ( 1 ) {
 
-		i = adapter->rx_curr;
+		i = queue->rx_curr;
 
-		rx_curr_desc = ( void * )  ( adapter->rx_base ) +
-				  ( i * sizeof ( *adapter->rx_base ) );
+		rx_curr_desc = ( void * )  ( queue->rx_base ) +
+				  ( i * sizeof ( *queue->rx_base ) );
 		rx_status = rx_curr_desc->status;
 
 		DBG2 ( "Before DD Check RX_status: %#08x\n", rx_status );
@@ -595,35 +716,68 @@ static void igb_process_rx_packets ( struct net_device *netdev )
 		if ( ! ( rx_status & E1000_RXD_STAT_DD ) )
 			break;
 
-		if ( adapter->rx_iobuf[i] == NULL )
+		if ( queue->rx_iobuf[i] == NULL )
 			break;
 
 		DBG ( "E1000_RCTL = %#08x\n", E1000_READ_REG ( &adapter->hw, E1000_RCTL ) );
 
 		rx_len = rx_curr_desc->length;
 
-		DBG ( "Received packet, rx_curr: %d  rx_status: %#08x  rx_len: %d\n",
-		      i, rx_status, rx_len );
+		DBG ( "Received packet, queue: %d rx_curr: %d  rx_status: %#08x  "
+		      "rx_len: %d\n", q, i, rx_status, rx_len );
 
 		rx_err = rx_curr_desc->errors;
 
-		iob_put ( adapter->rx_iobuf[i], rx_len );
+		iob_put ( queue->rx_iobuf[i], rx_len );
 
 		if ( rx_err & E1000_RXD_ERR_FRAME_ERR_MASK ) {
 
-			netdev_rx_err ( netdev, adapter->rx_iobuf[i], -EINVAL );
+			netdev_rx_err ( netdev, queue->rx_iobuf[i], -EINVAL );
 			DBG ( "igb_process_rx_packets: Corrupted packet received!"
 			      " rx_err: %#08x\n", rx_err );
 		} else	{
 			/* Add this packet to the receive queue. */
-			netdev_rx ( netdev, adapter->rx_iobuf[i] );
+			netdev_queue_rx ( netdev, q, queue->rx_iobuf[i] );
 		}
-		adapter->rx_iobuf[i] = NULL;
+		queue->rx_iobuf[i] = NULL;
 
 		memset ( rx_curr_desc, 0, sizeof ( *rx_curr_desc ) );
 
-		adapter->rx_curr = ( adapter->rx_curr + 1 ) % NUM_RX_DESC;
+		queue->rx_curr = ( queue->rx_curr + 1 ) % NUM_RX_DESC;
+	}
+}
+
+/**
+ * igb_size_rx_buffers - Size Rx buffers and choose the number of queues
+ *
+ * @v adapter	e1000 private structure
+ *
+ * Receive buffers are sized according to the current MTU, rounded up
+ * to the 1kB granularity of SRRCTL.  Fewer queues are used if the Rx
+ * rings for all IGB_NUM_QUEUES queues would not fit within
+ * NETDEV_RX_BUFFER_SPACE.
+ **/
+static void igb_size_rx_buffers ( struct igb_adapter *adapter )
+{
+	struct net_device *netdev = adapter->netdev;
+
+	adapter->max_frame_size = ( netdev_max_rx_len ( netdev ) +
+				    VLAN_TAG_SIZE + ETH_FCS_LEN );
+	adapter->rx_buffer_len = ( ( adapter->max_frame_size +
+				     IGB_RXBUFFER_1024 - 1 ) &
+				   ~( IGB_RXBUFFER_1024 - 1 ) );
+	assert ( adapter->rx_buffer_len <= IGB_MAX_RXBUFFER );
+
+	adapter->num_queues = IGB_NUM_QUEUES;
+	while ( ( adapter->num_queues > 1 ) &&
+		( ( adapter->num_queues * adapter->rx_buffer_len ) >
+		  IGB_MAX_RXBUFFER ) ) {
+		adapter->num_queues--;
 	}
+	netdev->num_queues = adapter->num_queues;
+
+	DBG ( "RX buffer length %d, %d queues\n",
+	      adapter->rx_buffer_len, adapter->num_queues );
 }
 
 /** Functions that implement the gPXE driver API **/
@@ -671,23 +825,25 @@ static int igb_transmit ( struct net_device *netdev, struct io_buffer *iobuf )
 {
 	struct igb_adapter *adapter = netdev_priv( netdev );
 	struct e1000_hw *hw = &adapter->hw;
-	uint32_t tx_curr = adapter->tx_tail;
+	unsigned int q = netdev_queue_tx ( netdev, iobuf );
+	struct igb_queue *queue = &adapter->queue[q];
+	uint32_t tx_curr = queue->tx_tail;
 	struct e1000_tx_desc *tx_curr_desc;
 
 	DBGP ("igb_transmit\n");
 
-	if ( adapter->tx_fill_ctr == NUM_TX_DESC ) {
-		DBG ("TX overflow\n");
+	if ( queue->tx_fill_ctr == NUM_TX_DESC ) {
+		DBG ("TX overflow on queue %d\n", q);
 		return -ENOBUFS;
 	}
 
 	/* Save pointer to iobuf we have been given to transmit,
 	   netdev_tx_complete() will need it later
 	 */
-	adapter->tx_iobuf[tx_curr] = iobuf;
+	queue->tx_iobuf[tx_curr] = iobuf;
 
-	tx_curr_desc = ( void * ) ( adapter->tx_base ) +
-		       ( tx_curr * sizeof ( *adapter->tx_base ) );
+	tx_curr_desc = ( void * ) ( queue->tx_base ) +
+		       ( tx_curr * sizeof ( *queue->tx_base ) );
 
 	DBG ( "tx_curr_desc = %#08lx\n", virt_to_bus ( tx_curr_desc ) );
 	DBG ( "tx_curr_desc + 16 = %#08lx\n", virt_to_bus ( tx_curr_desc ) + 16 );
@@ -699,16 +855,17 @@ static int igb_transmit ( struct net_device *netdev, struct io_buffer *iobuf )
 	tx_curr_desc->upper.data = 0;
 	tx_curr_desc->lower.data = adapter->txd_cmd | iob_len ( iobuf );
 
-	DBG ( "TX fill: %d tx_curr: %d addr: %#08lx len: %zd\n", adapter->tx_fill_ctr,
-	      tx_curr, virt_to_bus ( iobuf->data ), iob_len ( iobuf ) );
+	DBG ( "TX queue: %d fill: %d tx_curr: %d addr: %#08lx len: %zd\n", q,
+	      queue->tx_fill_ctr, tx_curr, virt_to_bus ( iobuf->data ),
+	      iob_len ( iobuf ) );
 
 	/* Point to next free descriptor */
-	adapter->tx_tail = ( adapter->tx_tail + 1 ) % NUM_TX_DESC;
-	adapter->tx_fill_ctr++;
+	queue->tx_tail = ( queue->tx_tail + 1 ) % NUM_TX_DESC;
+	queue->tx_fill_ctr++;
 
 	/* Write new tail to NIC, making packet available for transmit
 	 */
-	E1000_WRITE_REG ( hw, E1000_TDT(0), adapter->tx_tail );
+	E1000_WRITE_REG ( hw, E1000_TDT(q), queue->tx_tail );
 	E1000_WRITE_FLUSH(hw);
 
 	return 0;
@@ -723,6 +880,7 @@ static void igb_poll ( struct net_device *netdev )
 {
 	struct igb_adapter *adapter = netdev_priv( netdev );
 	struct e1000_hw *hw = &adapter->hw;
+	unsigned int q;
 
 	uint32_t icr;
 
@@ -735,11 +893,13 @@ static void igb_poll ( struct net_device *netdev )
 
 	DBG ( "igb_poll: intr_status = %#08x\n", icr );
 
-	igb_process_tx_packets ( netdev );
+	for_each_igb_queue ( adapter, q ) {
+		igb_process_tx_packets ( netdev, &adapter->queue[q] );
 
-	igb_process_rx_packets ( netdev );
+		igb_process_rx_packets ( netdev, q );
 
-	igb_refill_rx_ring(adapter);
+		igb_refill_rx_ring ( adapter, q );
+	}
 }
 
 /**
@@ -820,8 +980,18 @@ int igb_probe ( struct pci_device *pdev,
 	adapter->min_frame_size	   = ETH_ZLEN + ETH_FCS_LEN;
 	adapter->max_hw_frame_size = ETH_FRAME_LEN + ETH_FCS_LEN;
 
-	adapter->tx_ring_size = sizeof ( *adapter->tx_base ) * NUM_TX_DESC;
-	adapter->rx_ring_size = sizeof ( *adapter->rx_base ) * NUM_RX_DESC;
+	/* Limit frames to what a single queue's Rx ring can hold */
+	adapter->num_queues = IGB_NUM_QUEUES;
+	netdev->num_queues = IGB_NUM_QUEUES;
+	netdev->max_pkt_len = ( ETH_HLEN + IGB_MAX_MTU );
+	if ( netdev->max_pkt_len >
+	     ( IGB_MAX_RXBUFFER - VLAN_TAG_SIZE - ETH_FCS_LEN ) ) {
+		netdev->max_pkt_len =
+			( IGB_MAX_RXBUFFER - VLAN_TAG_SIZE - ETH_FCS_LEN );
+	}
+
+	adapter->tx_ring_size = sizeof ( *adapter->queue[0].tx_base ) * NUM_TX_DESC;
+	adapter->rx_ring_size = sizeof ( *adapter->queue[0].rx_base ) * NUM_RX_DESC;
 
 	/* Fix up PCI device */
 	adjust_pci_device ( pdev );
@@ -971,6 +1141,8 @@ static int igb_open ( struct net_device *netdev )
 
 	DBGP ( "igb_open\n" );
 
+	igb_size_rx_buffers ( adapter );
+
 	/* allocate transmit descriptors */
 	err = igb_setup_tx_resources ( adapter );
 	if ( err ) {
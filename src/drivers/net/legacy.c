@@ -38,6 +38,19 @@ static int legacy_transmit ( struct net_device *netdev, struct io_buffer *iobuf
 	return 0;
 }
 
+static void legacy_link ( struct net_device *netdev ) {
+	struct nic *nic = netdev->priv;
+
+	/* Legacy devices that don't report link state are assumed to
+	 * always have link.
+	 */
+	if ( ( ! nic->nic_op->link ) || nic->nic_op->link ( nic ) ) {
+		netdev_link_up ( netdev );
+	} else {
+		netdev_link_down ( netdev );
+	}
+}
+
 static void legacy_poll ( struct net_device *netdev ) {
 	struct nic *nic = netdev->priv;
 	struct io_buffer *iobuf;
@@ -54,6 +67,8 @@ static void legacy_poll ( struct net_device *netdev ) {
 	} else {
 		free_iob ( iobuf );
 	}
+
+	legacy_link ( netdev );
 }
 
 static int legacy_open ( struct net_device *netdev __unused ) {
@@ -114,8 +129,8 @@ int legacy_probe ( void *hwdev,
 	 */
 	dev->desc.irq = nic.irqno;
 
-	/* Mark as link up; legacy devices don't handle link state */
-	netdev_link_up ( netdev );
+	/* Record initial link state */
+	legacy_link ( netdev );
 
 	if ( ( rc = register_netdev ( netdev ) ) != 0 )
 		goto err_register;
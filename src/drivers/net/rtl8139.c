@@ -527,6 +527,9 @@ static int rtl_probe ( struct pci_device *pci,
 	rtl_init_eeprom ( netdev );
 	nvs_read ( &rtl->eeprom.nvs, EE_MAC, netdev->hw_addr, ETH_ALEN );
 
+	/* Interrupts are acknowledged by rtl_poll() */
+	netdev->features |= NETDEV_F_IRQ;
+
 	/* Mark as link up; we don't yet handle link state */
 	netdev_link_up ( netdev );
 	
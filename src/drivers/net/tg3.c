@@ -3249,12 +3249,22 @@ static void tg3_irq(struct nic *nic __unused, irq_action_t action __unused)
   }
 }
 
+/**************************************************************************
+LINK - Report link state
+***************************************************************************/
+static int tg3_link(struct nic *nic __unused)
+{
+	struct tg3 *tp = &tg3;
+
+	return tp->carrier_ok;
+}
+
 static struct nic_operations tg3_operations = {
 	.connect	= dummy_connect,
 	.poll		= tg3_poll,
 	.transmit	= tg3_transmit,
 	.irq		= tg3_irq,
-
+	.link		= tg3_link,
 };
 
 /**************************************************************************
@@ -3265,7 +3275,7 @@ static int tg3_probe ( struct nic *nic, struct pci_device *pdev ) {
 
 	struct tg3 *tp = &tg3;
 	unsigned long tg3reg_base, tg3reg_len;
-	int i, err, pm_cap;
+	int err, pm_cap;
 
 	memset(tp, 0, sizeof(*tp));
 
@@ -3363,16 +3373,10 @@ static int tg3_probe ( struct nic *nic, struct pci_device *pdev ) {
 	} 
 	tp->tg3_flags |= TG3_FLAG_INIT_COMPLETE;
 
-	/* Wait for a reasonable time for the link to come up */
+	/* Do not wait for the link to come up; link state is reported
+	 * via tg3_link() once autonegotiation completes.
+	 */
 	tg3_poll_link(tp);
-	for(i = 0; !tp->carrier_ok && (i < VALID_LINK_TIMEOUT*100); i++) {
-		mdelay(1);
-		tg3_poll_link(tp);
-	}
-	if (!tp->carrier_ok){
-		printf("Valid link not established\n");
-		goto err_out_disable;
-	}
 
 	nic->nic_op	= &tg3_operations;
 	return 1;
@@ -22,6 +22,7 @@
 
 FILE_LICENCE ( GPL2_OR_LATER );
 
+#include <string.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <gpxe/list.h>
@@ -30,6 +31,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/pci.h>
 #include <gpxe/if_ether.h>
 #include <gpxe/ethernet.h>
+#include <gpxe/tcpip.h>
+#include <gpxe/tcp.h>
 #include <gpxe/virtio-ring.h>
 #include <gpxe/virtio-pci.h>
 #include "virtio-net.h"
@@ -59,6 +62,12 @@ FILE_LICENCE ( GPL2_OR_LATER );
  * than space, it is heavy-weight and allocated like traditional descriptor
  * rings in the open() function of the driver and not in probe().
  *
+ * Each packet is preceded by a virtio net header describing checksum and
+ * segmentation offload.  Received packets carry their header in the iobuf
+ * headroom; transmitted packets borrow the headroom in front of the link-layer
+ * header when it is large enough, falling back to a shared zeroed header and
+ * software checksumming otherwise.
+ *
  * There is no true interrupt enable/disable.  Virtqueues have callback
  * enable/disable flags but these are only hints.  The hypervisor may still
  * raise an interrupt.  Nevertheless, this driver disables callbacks in the
@@ -80,8 +89,11 @@ enum {
 	/** Max number of pending rx packets */
 	NUM_RX_BUF = 8,
 
-	/** Max Ethernet frame length, including FCS and VLAN tag */
-	RX_BUF_SIZE = 1522,
+	/** Allowance for FCS and VLAN tag in received frames */
+	RX_BUF_SLACK = 8,
+
+	/** Largest MTU we are prepared to use (jumbo frames) */
+	VIRTNET_MAX_MTU = 9000,
 };
 
 struct virtnet_nic {
@@ -97,33 +109,41 @@ struct virtnet_nic {
 	/** Pending rx packet count */
 	unsigned int rx_num_iobufs;
 
-	/** Virtio net packet header, we only need one */
+	/** Maximum pending rx packet count, fixed when the device is opened */
+	unsigned int rx_max_iobufs;
+
+	/** Length of rx buffers, fixed when the device is opened */
+	size_t rx_buf_len;
+
+	/** Zeroed virtio net packet header for packets without offload */
 	struct virtio_net_hdr empty_header;
 };
 
+/** Offload features we are prepared to negotiate */
+#define VIRTNET_OFFLOAD_FEATURES ( ( 1 << VIRTIO_NET_F_CSUM ) |		\
+				   ( 1 << VIRTIO_NET_F_GUEST_CSUM ) |	\
+				   ( 1 << VIRTIO_NET_F_HOST_TSO4 ) )
+
 /** Add an iobuf to a virtqueue
  *
  * @v netdev		Network device
  * @v vq_idx		Virtqueue index (RX_INDEX or TX_INDEX)
  * @v iobuf		I/O buffer
+ * @v hdr		Virtio net header to accompany the packet
  *
  * The virtqueue is kicked after the iobuf has been added.
  */
 static void virtnet_enqueue_iob ( struct net_device *netdev,
-				  int vq_idx, struct io_buffer *iobuf ) {
+				  int vq_idx, struct io_buffer *iobuf,
+				  struct virtio_net_hdr *hdr ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 	struct vring_virtqueue *vq = &virtnet->virtqueue[vq_idx];
 	unsigned int out = ( vq_idx == TX_INDEX ) ? 2 : 0;
 	unsigned int in = ( vq_idx == TX_INDEX ) ? 0 : 2;
 	struct vring_list list[] = {
 		{
-			/* Share a single zeroed virtio net header between all
-			 * rx and tx packets.  This works because this driver
-			 * does not use any advanced features so none of the
-			 * header fields get used.
-			 */
-			.addr = ( char* ) &virtnet->empty_header,
-			.length = sizeof ( virtnet->empty_header ),
+			.addr = ( char* ) hdr,
+			.length = sizeof ( *hdr ),
 		},
 		{
 			.addr = ( char* ) iobuf->data,
@@ -145,21 +165,25 @@ static void virtnet_enqueue_iob ( struct net_device *netdev,
 static void virtnet_refill_rx_virtqueue ( struct net_device *netdev ) {
 	struct virtnet_nic *virtnet = netdev->priv;
 
-	while ( virtnet->rx_num_iobufs < NUM_RX_BUF ) {
+	while ( virtnet->rx_num_iobufs < virtnet->rx_max_iobufs ) {
 		struct io_buffer *iobuf;
 
 		/* Try to allocate a buffer, stop for now if out of memory */
-		iobuf = alloc_iob ( RX_BUF_SIZE );
+		iobuf = alloc_iob ( sizeof ( struct virtio_net_hdr ) +
+				    virtnet->rx_buf_len );
 		if ( ! iobuf )
 			break;
 
 		/* Keep track of iobuf so close() can free it */
 		list_add ( &iobuf->list, &virtnet->rx_iobufs );
 
-		/* Mark packet length until we know the actual size */
-		iob_put ( iobuf, RX_BUF_SIZE );
+		/* Leave room for the per-packet header, and mark packet
+		 * length until we know the actual size
+		 */
+		iob_reserve ( iobuf, sizeof ( struct virtio_net_hdr ) );
+		iob_put ( iobuf, virtnet->rx_buf_len );
 
-		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf );
+		virtnet_enqueue_iob ( netdev, RX_INDEX, iobuf, iobuf->head );
 		virtnet->rx_num_iobufs++;
 	}
 }
@@ -195,9 +219,20 @@ static int virtnet_open ( struct net_device *netdev ) {
 		}
 	}
 
-	/* Initialize rx packets */
+	/* Initialize rx packets, sized according to the current MTU.
+	 * Keep fewer of them pending if they are too large for all
+	 * NUM_RX_BUF to fit within the receive buffer space.
+	 */
 	INIT_LIST_HEAD ( &virtnet->rx_iobufs );
 	virtnet->rx_num_iobufs = 0;
+	virtnet->rx_buf_len = ( netdev_max_rx_len ( netdev ) + RX_BUF_SLACK );
+	virtnet->rx_max_iobufs = ( NETDEV_RX_BUFFER_SPACE /
+				   ( sizeof ( struct virtio_net_hdr ) +
+				     virtnet->rx_buf_len ) );
+	if ( virtnet->rx_max_iobufs > NUM_RX_BUF )
+		virtnet->rx_max_iobufs = NUM_RX_BUF;
+	DBGC ( virtnet, "VIRTIO-NET %p using %d rx buffers of %zd bytes\n",
+	       virtnet, virtnet->rx_max_iobufs, virtnet->rx_buf_len );
 	virtnet_refill_rx_virtqueue ( netdev );
 
 	/* Disable interrupts before starting */
@@ -205,7 +240,8 @@ static int virtnet_open ( struct net_device *netdev ) {
 
 	/* Driver is ready */
 	features = vp_get_features ( ioaddr );
-	vp_set_features ( ioaddr, features & ( 1 << VIRTIO_NET_F_MAC ) );
+	vp_set_features ( ioaddr, features & ( ( 1 << VIRTIO_NET_F_MAC ) |
+					       VIRTNET_OFFLOAD_FEATURES ) );
 	vp_set_status ( ioaddr, VIRTIO_CONFIG_S_DRIVER | VIRTIO_CONFIG_S_DRIVER_OK );
 	return 0;
 }
@@ -241,7 +277,39 @@ static void virtnet_close ( struct net_device *netdev ) {
  */
 static int virtnet_transmit ( struct net_device *netdev,
 			      struct io_buffer *iobuf ) {
-	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf );
+	struct virtnet_nic *virtnet = netdev->priv;
+	struct virtio_net_hdr *hdr = &virtnet->empty_header;
+	size_t offset = ( iobuf->data - iobuf->head );
+	struct tcp_header *tcphdr;
+
+	if ( iobuf->flags & IOB_CSUM_PARTIAL ) {
+		if ( iob_headroom ( iobuf ) < sizeof ( *hdr ) ) {
+			/* No room for a header; finish checksum here */
+			if ( iobuf->flags & IOB_TSO ) {
+				DBGC ( virtnet, "VIRTIO-NET %p no headroom "
+				       "for TSO iobuf %p\n", virtnet, iobuf );
+				return -ENOBUFS;
+			}
+			tcpip_complete_chksum ( iobuf );
+		} else {
+			/* Place header in front of the link-layer header */
+			hdr = ( iobuf->data - sizeof ( *hdr ) );
+			memset ( hdr, 0, sizeof ( *hdr ) );
+			hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+			hdr->csum_start = ( iobuf->csum_start - offset );
+			hdr->csum_offset = iobuf->csum_offset;
+			if ( iobuf->flags & IOB_TSO ) {
+				tcphdr = ( iobuf->head + iobuf->csum_start );
+				hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+				hdr->gso_size = iobuf->mss;
+				hdr->hdr_len = ( hdr->csum_start +
+						 ( ( tcphdr->hlen &
+						     TCP_MASK_HLEN ) / 4 ) );
+			}
+		}
+	}
+
+	virtnet_enqueue_iob ( netdev, TX_INDEX, iobuf, hdr );
 	return 0;
 }
 
@@ -274,18 +342,34 @@ static void virtnet_process_rx_packets ( struct net_device *netdev ) {
 	while ( vring_more_used ( rx_vq ) ) {
 		unsigned int len;
 		struct io_buffer *iobuf = vring_get_buf ( rx_vq, &len );
+		struct virtio_net_hdr *hdr = iobuf->head;
 
 		/* Release ownership of iobuf */
 		list_del ( &iobuf->list );
 		virtnet->rx_num_iobufs--;
 
 		/* Update iobuf length */
-		iob_unput ( iobuf, RX_BUF_SIZE );
+		iob_unput ( iobuf, virtnet->rx_buf_len );
 		iob_put ( iobuf, len - sizeof ( struct virtio_net_hdr ) );
 
 		DBGC ( virtnet, "VIRTIO-NET %p rx complete iobuf %p len %zd\n",
 		       virtnet, iobuf, iob_len ( iobuf ) );
 
+		/* Packets from local peers may arrive with an incomplete
+		 * checksum; complete it here so the stack need not care.
+		 */
+		if ( hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM ) {
+			iobuf->csum_start = ( ( iobuf->data - iobuf->head ) +
+					      hdr->csum_start );
+			iobuf->csum_offset = hdr->csum_offset;
+			iobuf->flags = IOB_CSUM_PARTIAL;
+			tcpip_complete_chksum ( iobuf );
+		}
+		if ( hdr->flags & ( VIRTIO_NET_HDR_F_NEEDS_CSUM |
+				    VIRTIO_NET_HDR_F_DATA_VALID ) ) {
+			iobuf->flags |= IOB_CSUM_VALID;
+		}
+
 		/* Pass completed packet to the network stack */
 		netdev_rx ( netdev, iobuf );
 	}
@@ -378,6 +462,23 @@ static int virtnet_probe ( struct pci_device *pci,
 		       eth_ntoa ( netdev->hw_addr ) );
 	}
 
+	/* Advertise whichever offloads the host can provide */
+	if ( features & ( 1 << VIRTIO_NET_F_GUEST_CSUM ) )
+		netdev->features |= NETDEV_F_RX_CSUM;
+	if ( features & ( 1 << VIRTIO_NET_F_CSUM ) ) {
+		netdev->features |= NETDEV_F_TX_CSUM;
+		if ( features & ( 1 << VIRTIO_NET_F_HOST_TSO4 ) )
+			netdev->features |= NETDEV_F_TSO;
+	}
+
+	/* The host imposes no frame size limit of its own */
+	netdev->max_pkt_len = ( ETH_HLEN + VIRTNET_MAX_MTU );
+
+	/* Interrupts are acknowledged by virtnet_poll() */
+	netdev->features |= NETDEV_F_IRQ;
+	DBGC ( virtnet, "VIRTIO-NET %p features %#x\n",
+	       virtnet, netdev->features );
+
 	/* Mark link as up, control virtqueue is not used */
 	netdev_link_up ( netdev );
 
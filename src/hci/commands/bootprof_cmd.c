@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <gpxe/command.h>
+#include <gpxe/bootprof.h>
+
+/** @file
+ *
+ * Boot profile commands
+ *
+ */
+
+/**
+ * "profile" command syntax message
+ *
+ * @v argv		Argument list
+ */
+static void bootprof_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s [-c|--clear]\n"
+		 "\n"
+		 "Displays (or clears) the boot profile\n",
+		 argv[0] );
+}
+
+/**
+ * Display boot profile
+ *
+ */
+static void bootprof_show ( void ) {
+	struct bootprof_event *prof;
+	unsigned long ms;
+	unsigned long prev_ms = 0;
+	unsigned int i;
+
+	if ( bootprof_dropped )
+		printf ( "(%d earlier events not retained)\n",
+			 bootprof_dropped );
+	for ( i = 0 ; i < bootprof_count ; i++ ) {
+		prof = bootprof_event ( i );
+		ms = bootprof_ms ( prof );
+		if ( ! i )
+			prev_ms = ms;
+		printf ( "%8ldms (+%ldms) %s %s\n", ms, ( ms - prev_ms ),
+			 prof->event, prof->name );
+		prev_ms = ms;
+	}
+}
+
+/**
+ * The "profile" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int bootprof_exec ( int argc, char **argv ) {
+	static struct option longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ "clear", 0, NULL, 'c' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int clear = 0;
+	int c;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "hc", longopts, NULL ) ) >= 0 ){
+		switch ( c ) {
+		case 'c':
+			clear = 1;
+			break;
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			bootprof_syntax ( argv );
+			return 1;
+		}
+	}
+
+	if ( optind != argc ) {
+		bootprof_syntax ( argv );
+		return 1;
+	}
+
+	if ( clear ) {
+		bootprof_clear();
+	} else {
+		bootprof_show();
+	}
+	return 0;
+}
+
+/** Boot profile commands */
+struct command bootprof_command __command = {
+	.name = "profile",
+	.exec = bootprof_exec,
+};
@@ -51,12 +51,7 @@ static int digest_exec ( int argc, char **argv,
 			 struct digest_algorithm *digest ) {
 	const char *image_name;
 	struct image *image;
-	uint8_t digest_ctx[digest->ctxsize];
 	uint8_t digest_out[digest->digestsize];
-	uint8_t buf[128];
-	size_t offset;
-	size_t len;
-	size_t frag_len;
 	int i;
 	unsigned j;
 
@@ -76,21 +71,9 @@ static int digest_exec ( int argc, char **argv,
 			printf ( "No such image: %s\n", image_name );
 			continue;
 		}
-		offset = 0;
-		len = image->len;
 
 		/* calculate digest */
-		digest_init ( digest, digest_ctx );
-		while ( len ) {
-			frag_len = len;
-			if ( frag_len > sizeof ( buf ) )
-				frag_len = sizeof ( buf );
-			copy_from_user ( buf, image->data, offset, frag_len );
-			digest_update ( digest, digest_ctx, buf, frag_len );
-			len -= frag_len;
-			offset += frag_len;
-		}
-		digest_final ( digest, digest_ctx, digest_out );
+		image_digest ( image, digest, digest_out );
 
 		for ( j = 0 ; j < sizeof ( digest_out ) ; j++ )
 			printf ( "%02x", digest_out[j] );
@@ -158,9 +158,50 @@ static int ifstat_payload ( struct net_device *netdev ) {
 	return 0;
 }
 
+static int ifstat_verbose_payload ( struct net_device *netdev ) {
+	ifstat_verbose ( netdev );
+	return 0;
+}
+
+static void ifstat_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s [-v|--verbose] [<interface>] [<interface>...]\n"
+		 "\n"
+		 "Display status of the specified network interfaces\n",
+		 argv[0] );
+}
+
 static int ifstat_exec ( int argc, char **argv ) {
-	return ifcommon_exec ( argc, argv,
-			       ifstat_payload, "Display status of" );
+	static struct option ifstat_longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ "verbose", 0, NULL, 'v' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int ( * payload ) ( struct net_device * ) = ifstat_payload;
+	int c;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "hv", ifstat_longopts,
+				    NULL ) ) >= 0 ) {
+		switch ( c ) {
+		case 'v':
+			payload = ifstat_verbose_payload;
+			break;
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			ifstat_syntax ( argv );
+			return 1;
+		}
+	}
+
+	if ( optind == argc ) {
+		return ifcommon_do_all ( payload );
+	} else {
+		return ifcommon_do_list ( payload, &argv[optind],
+					  ( argc - optind ) );
+	}
 }
 
 /** Interface management commands */
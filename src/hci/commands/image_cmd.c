@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <getopt.h>
 #include <gpxe/image.h>
 #include <gpxe/command.h>
+#include <gpxe/bgjob.h>
 #include <usr/imgmgmt.h>
 
 /** @file
@@ -38,6 +39,7 @@ enum image_action {
 	IMG_FETCH = 0,
 	IMG_LOAD,
 	IMG_EXEC,
+	IMG_INITRD,
 };
 
 /**
@@ -84,10 +86,12 @@ static void imgfetch_core_syntax ( char **argv, enum image_action action ) {
 		[IMG_FETCH]	= "Fetch",
 		[IMG_LOAD]	= "Fetch and load",
 		[IMG_EXEC]	= "Fetch and execute",
+		[IMG_INITRD]	= "Fetch initrd",
 	};
 
 	printf ( "Usage:\n"
-		 "  %s [-n|--name <name>] filename [arguments...]\n"
+		 "  %s [-n|--name <name>] [-b|--background] [-c|--cache] "
+		 "filename [arguments...]\n"
 		 "\n"
 		 "%s executable/loadable image\n",
 		 argv[0], actions[action] );
@@ -108,23 +112,36 @@ static int imgfetch_core_exec ( struct image_type *image_type,
 	static struct option longopts[] = {
 		{ "help", 0, NULL, 'h' },
 		{ "name", required_argument, NULL, 'n' },
+		{ "background", 0, NULL, 'b' },
+		{ "cache", 0, NULL, 'c' },
 		{ NULL, 0, NULL, 0 },
 	};
 	struct image *image;
+	struct bgjob *bgjob;
 	const char *name = NULL;
 	char *filename;
 	int ( * image_register ) ( struct image *image );
+	int background = 0;
+	int cache = 0;
 	int c;
 	int rc;
 
 	/* Parse options */
-	while ( ( c = getopt_long ( argc, argv, "hn:",
+	while ( ( c = getopt_long ( argc, argv, "hn:bc",
 				    longopts, NULL ) ) >= 0 ) {
 		switch ( c ) {
 		case 'n':
 			/* Set image name */
 			name = optarg;
 			break;
+		case 'b':
+			/* Fetch in background */
+			background = 1;
+			break;
+		case 'c':
+			/* Use image cache */
+			cache = 1;
+			break;
 		case 'h':
 			/* Display help text */
 		default:
@@ -134,6 +151,17 @@ static int imgfetch_core_exec ( struct image_type *image_type,
 		}
 	}
 
+	/* An image cannot safely be loaded or executed from within
+	 * the completion of a background download; the image must
+	 * instead be waited for and then loaded or executed.
+	 */
+	if ( background && ( ( action == IMG_LOAD ) ||
+			     ( action == IMG_EXEC ) ) ) {
+		printf ( "%s cannot be used with --background; use imgfetch "
+			 "--background and imgwait instead\n", argv[0] );
+		return -ENOTSUP;
+	}
+
 	/* Need at least a filename remaining after the options */
 	if ( optind == argc ) {
 		imgfetch_core_syntax ( argv, action );
@@ -159,6 +187,10 @@ static int imgfetch_core_exec ( struct image_type *image_type,
 	/* Set image type (if specified) */
 	image->type = image_type;
 
+	/* Allow use of image cache (if specified) */
+	if ( cache )
+		image->flags |= IMAGE_CACHEABLE;
+
 	/* Fill in command line */
 	if ( ( rc = imgfill_cmdline ( image, ( argc - optind ),
 				      &argv[optind] ) ) != 0 )
@@ -175,10 +207,28 @@ static int imgfetch_core_exec ( struct image_type *image_type,
 	case IMG_EXEC:
 		image_register = register_and_autoexec_image;
 		break;
+	case IMG_INITRD:
+		image->flags |= IMAGE_INITRD;
+		image_register = register_image;
+		break;
 	default:
 		assert ( 0 );
 		return -EINVAL;
 	}
+	if ( background ) {
+		if ( ( rc = imgfetch_background ( image, filename,
+						  image_register,
+						  &bgjob ) ) != 0 ) {
+			printf ( "Could not fetch %s: %s\n",
+				 filename, strerror ( rc ) );
+			image_put ( image );
+			return rc;
+		}
+		if ( bgjob )
+			printf ( "[%d] %s\n", bgjob->id, bgjob->description );
+		image_put ( image );
+		return 0;
+	}
 	if ( ( rc = imgfetch ( image, filename, image_register ) ) != 0 ) {
 		printf ( "Could not fetch %s: %s\n",
 			 filename, strerror ( rc ) );
@@ -207,6 +257,23 @@ static int imgfetch_exec ( int argc, char **argv ) {
 	return 0;
 }
 
+/**
+ * The "initrd" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int initrd_exec ( int argc, char **argv ) {
+	int rc;
+
+	if ( ( rc = imgfetch_core_exec ( NULL, IMG_INITRD,
+					 argc, argv ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
 /**
  * The "kernel" command
  *
@@ -492,6 +559,71 @@ static int imgstat_exec ( int argc, char **argv ) {
 	return 0;
 }
 
+/**
+ * "imgwait" command syntax message
+ *
+ * @v argv		Argument list
+ */
+static void imgwait_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s [<job>]\n"
+		 "\n"
+		 "Wait for one or all background image fetches\n",
+		 argv[0] );
+}
+
+/**
+ * The "imgwait" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int imgwait_exec ( int argc, char **argv ) {
+	static struct option longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	struct bgjob *bgjob = NULL;
+	unsigned int id;
+	char *endp;
+	int c;
+	int rc;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "h", longopts, NULL ) ) >= 0 ){
+		switch ( c ) {
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			imgwait_syntax ( argv );
+			return 1;
+		}
+	}
+
+	/* Need zero or one arguments */
+	if ( optind < ( argc - 1 ) ) {
+		imgwait_syntax ( argv );
+		return 1;
+	}
+
+	/* Identify job, if specified */
+	if ( optind != argc ) {
+		id = strtoul ( argv[optind], &endp, 0 );
+		if ( *endp || ! ( bgjob = find_bgjob ( id ) ) ) {
+			printf ( "No such job: %s\n", argv[optind] );
+			return 1;
+		}
+	}
+
+	/* Wait for job(s) */
+	if ( ( rc = bgjob_wait ( bgjob ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
 /**
  * "imgstat" command syntax message
  *
@@ -571,7 +703,7 @@ struct command image_commands[] __command = {
 	},
 	{
 		.name = "initrd",
-		.exec = imgfetch_exec, /* synonym for "imgfetch" */
+		.exec = initrd_exec,
 	},
 	{
 		.name = "kernel",
@@ -601,6 +733,10 @@ struct command image_commands[] __command = {
 		.name = "imgstat",
 		.exec = imgstat_exec,
 	},
+	{
+		.name = "imgwait",
+		.exec = imgwait_exec,
+	},
 	{
 		.name = "imgfree",
 		.exec = imgfree_exec,
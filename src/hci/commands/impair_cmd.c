@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <gpxe/netdevice.h>
+#include <gpxe/command.h>
+#include <gpxe/impairnet.h>
+
+/** @file
+ *
+ * Network impairment commands
+ *
+ */
+
+/**
+ * "impair" command syntax message
+ *
+ * @v argv		Argument list
+ */
+static void impair_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s [-s|--seed <seed>] [<interface> [<profile>]]\n"
+		 "\n"
+		 "Impairs (or stops impairing) a network interface\n",
+		 argv[0] );
+}
+
+/**
+ * Display impairment queue statistics
+ *
+ * @v direction		Direction name
+ * @v queue		Impairment queue
+ */
+static void impair_show_queue ( const char *direction,
+				struct impair_queue *queue ) {
+	struct impair_statistics *stats = &queue->stats;
+
+	printf ( "  [%s:%d lost:%d over:%d dup:%d reord:%d held:%d]\n",
+		 direction, stats->delivered, stats->lost, stats->overflowed,
+		 stats->duplicated, stats->reordered, queue->count );
+}
+
+/**
+ * Display network impairment profiles and impaired devices
+ *
+ */
+static void impair_show ( void ) {
+	struct impairment *impairment;
+	struct net_device *netdev;
+	struct impairnet *impairnet;
+
+	for_each_table_entry ( impairment, IMPAIRMENTS ) {
+		printf ( "%s: loss %d/1000 dup %d/1000 reorder %d/1000 "
+			 "delay %d+%dms", impairment->name, impairment->loss,
+			 impairment->duplicate, impairment->reorder,
+			 impairment->delay, impairment->jitter );
+		if ( impairment->rate )
+			printf ( " rate %ldkB/s", ( impairment->rate / 1024 ) );
+		printf ( "\n" );
+	}
+	for_each_netdev ( netdev ) {
+		impairnet = find_impairnet ( netdev );
+		if ( ! impairnet )
+			continue;
+		printf ( "%s: impaired as \"%s\"\n", netdev->name,
+			 impairnet->tx.impairment->name );
+		impair_show_queue ( "TX", &impairnet->tx );
+		impair_show_queue ( "RX", &impairnet->rx );
+	}
+}
+
+/**
+ * The "impair" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int impair_exec ( int argc, char **argv ) {
+	static struct option longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ "seed", required_argument, NULL, 's' },
+		{ NULL, 0, NULL, 0 },
+	};
+	struct net_device *netdev;
+	struct impairment *impairment;
+	unsigned long seed = 0;
+	char *end;
+	int c;
+	int rc;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "hs:", longopts, NULL ) ) >= 0 ){
+		switch ( c ) {
+		case 's':
+			seed = strtoul ( optarg, &end, 0 );
+			if ( *end ) {
+				printf ( "Invalid seed \"%s\"\n", optarg );
+				return 1;
+			}
+			break;
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			impair_syntax ( argv );
+			return 1;
+		}
+	}
+
+	/* Display profiles and impaired devices if no interface given */
+	if ( optind == argc ) {
+		impair_show();
+		return 0;
+	}
+	if ( ( argc - optind ) > 2 ) {
+		impair_syntax ( argv );
+		return 1;
+	}
+
+	/* Identify network device */
+	netdev = find_netdev ( argv[optind] );
+	if ( ! netdev ) {
+		printf ( "No such interface: %s\n", argv[optind] );
+		return 1;
+	}
+
+	/* Stop impairing device if no profile given */
+	if ( ( optind + 1 ) == argc ) {
+		unimpair_netdev ( netdev );
+		return 0;
+	}
+
+	/* Impair device */
+	impairment = find_impairment ( argv[ optind + 1 ] );
+	if ( ! impairment ) {
+		printf ( "No such impairment profile: %s\n",
+			 argv[ optind + 1 ] );
+		return 1;
+	}
+	if ( ( rc = impair_netdev ( netdev, impairment, seed ) ) != 0 ) {
+		printf ( "Could not impair %s: %s\n",
+			 netdev->name, strerror ( rc ) );
+		return 1;
+	}
+
+	return 0;
+}
+
+/** Network impairment commands */
+struct command impair_command __command = {
+	.name = "impair",
+	.exec = impair_exec,
+};
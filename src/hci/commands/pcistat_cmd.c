@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <gpxe/command.h>
+#include <gpxe/timer.h>
+#include <gpxe/pci.h>
+
+/** @file
+ *
+ * PCI probe statistics command
+ *
+ */
+
+/**
+ * Convert ticks to milliseconds
+ *
+ * @v ticks		Ticks
+ * @ret ms		Milliseconds
+ */
+static unsigned long pcistat_ms ( unsigned long ticks ) {
+	return ( ( ( uint64_t ) ticks * 1000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * "pcistat" command syntax message
+ *
+ * @v argv		Argument list
+ */
+static void pcistat_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s\n"
+		 "\n"
+		 "Displays the time spent probing PCI devices\n",
+		 argv[0] );
+}
+
+/**
+ * Display PCI probe statistics
+ *
+ */
+static void pcistat_show ( void ) {
+	struct pci_driver *driver;
+	struct pci_driver_stats *stats;
+	unsigned int probed = 0;
+
+	for_each_table_entry ( driver, PCI_DRIVERS ) {
+		stats = &driver->stats;
+		if ( ! stats->probes )
+			continue;
+		printf ( "%s: %d probes, %d failed, %ldms\n", stats->name,
+			 stats->probes, stats->failures,
+			 pcistat_ms ( stats->ticks ) );
+		probed += stats->probes;
+	}
+	printf ( "Scanned %d PCI functions (%d probes, %d skipped) in "
+		 "%ldms\n", pci_bus_stats.functions, probed,
+		 pci_bus_stats.skipped, pcistat_ms ( pci_bus_stats.ticks ) );
+}
+
+/**
+ * The "pcistat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int pcistat_exec ( int argc, char **argv ) {
+	static struct option longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int c;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "h", longopts, NULL ) ) >= 0 ){
+		switch ( c ) {
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			pcistat_syntax ( argv );
+			return 1;
+		}
+	}
+
+	if ( optind != argc ) {
+		pcistat_syntax ( argv );
+		return 1;
+	}
+
+	pcistat_show();
+	return 0;
+}
+
+/** PCI probe statistics commands */
+struct command pcistat_command __command = {
+	.name = "pcistat",
+	.exec = pcistat_exec,
+};
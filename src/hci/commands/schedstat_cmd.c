@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdio.h>
+#include <getopt.h>
+#include <gpxe/command.h>
+#include <gpxe/process.h>
+
+/** @file
+ *
+ * Scheduler statistics command
+ *
+ */
+
+/**
+ * "schedstat" command syntax message
+ *
+ * @v argv		Argument list
+ */
+static void schedstat_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s\n"
+		 "\n"
+		 "Displays process scheduling statistics\n",
+		 argv[0] );
+}
+
+/**
+ * Display process
+ *
+ * @v process		Process
+ */
+static void schedstat_process ( struct process *process ) {
+	if ( process->name ) {
+		printf ( "%s", process->name );
+	} else {
+		printf ( "%p", process );
+	}
+	printf ( ": priority %d, %s, %ld steps\n", process->priority,
+		 ( process_is_asleep ( process ) ? "asleep" : "runnable" ),
+		 process->steps );
+}
+
+/**
+ * Display scheduler statistics
+ *
+ */
+static void schedstat_show ( void ) {
+	struct process *process;
+	unsigned int priority;
+
+	list_for_each_entry ( process, &run_queue, list )
+		schedstat_process ( process );
+	list_for_each_entry ( process, &sleep_queue, list )
+		schedstat_process ( process );
+	for ( priority = 0 ; priority <= PROCESS_PRIO_MAX ; priority++ ) {
+		printf ( "Priority %d: %ld steps\n", priority,
+			 scheduler_stats.steps[priority] );
+	}
+	printf ( "%ld busy, %ld idle, %ld yields, %ld sleeps, %ld wakes\n",
+		 scheduler_stats.busy, scheduler_stats.idle,
+		 scheduler_stats.yields, scheduler_stats.sleeps,
+		 scheduler_stats.wakes );
+}
+
+/**
+ * The "schedstat" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int schedstat_exec ( int argc, char **argv ) {
+	static struct option longopts[] = {
+		{ "help", 0, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int c;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "h", longopts, NULL ) ) >= 0 ){
+		switch ( c ) {
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			schedstat_syntax ( argv );
+			return 1;
+		}
+	}
+
+	if ( optind != argc ) {
+		schedstat_syntax ( argv );
+		return 1;
+	}
+
+	schedstat_show();
+	return 0;
+}
+
+/** Scheduler statistics commands */
+struct command schedstat_command __command = {
+	.name = "schedstat",
+	.exec = schedstat_exec,
+};
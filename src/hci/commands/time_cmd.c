@@ -26,9 +26,13 @@
 #include <gpxe/command.h>
 #include <gpxe/nap.h>
 #include <gpxe/timer.h>
+#include <gpxe/netdevice.h>
 
 static int time_exec ( int argc, char **argv ) {
 	unsigned long start;
+	unsigned long elapsed;
+	unsigned long idle;
+	unsigned long busy;
 	int rc, secs;
 
 	if ( argc == 1 ||
@@ -44,10 +48,17 @@ static int time_exec ( int argc, char **argv ) {
 	}
 
 	start = currticks();
+	idle = net_idle_stats.ticks;
 	rc = execv ( argv[1], argv + 1 );
-	secs = (currticks() - start) / ticks_per_sec();
+	elapsed = ( currticks() - start );
+	idle = ( net_idle_stats.ticks - idle );
+	secs = elapsed / ticks_per_sec();
 
-	printf ( "%s: %ds\n", argv[0], secs );
+	/* Report proportion of time for which the CPU was not halted
+	 * awaiting network activity.
+	 */
+	busy = ( elapsed ? ( ( ( elapsed - idle ) * 100 ) / elapsed ) : 100 );
+	printf ( "%s: %ds (CPU %ld%%)\n", argv[0], secs, busy );
 
 	return rc;
 }
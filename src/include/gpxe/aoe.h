@@ -130,6 +130,8 @@ struct aoe_session {
 	unsigned int status;
 	/** Byte offset within command's data buffer */
 	unsigned int command_offset;
+	/** Maximum number of sectors per AoE ATA command */
+	unsigned int max_count;
 	/** Return status code for command */
 	int rc;
 
@@ -140,7 +142,13 @@ struct aoe_session {
 #define AOE_STATUS_ERR_MASK	0x0f /**< Error portion of status code */ 
 #define AOE_STATUS_PENDING	0x80 /**< Command pending */
 
-/** Maximum number of sectors per packet */
+/** Number of sectors per packet used before target discovery
+ *
+ * This is the largest number of sectors which fit within a packet at
+ * the standard Ethernet MTU.  Once the target has responded to the
+ * config query, the number of sectors per packet is derived from the
+ * network device's MTU and the target's advertised sector count.
+ */
 #define AOE_MAX_COUNT 2
 
 extern void aoe_detach ( struct ata_device *ata );
@@ -10,9 +10,8 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <gpxe/tables.h>
-
-struct net_device;
-struct net_protocol;
+#include <gpxe/netdevice.h>
+#include <gpxe/neighbour.h>
 
 /** A network-layer protocol that relies upon ARP */
 struct arp_net_protocol {
@@ -36,11 +35,24 @@ struct arp_net_protocol {
 #define __arp_net_protocol __table_entry ( ARP_NET_PROTOCOLS, 01 )
 
 extern struct net_protocol arp_protocol;
+extern struct neighbour_discovery arp_discovery;
+
+/**
+ * Transmit packet, determining link-layer address via ARP
+ *
+ * @v iobuf		I/O buffer
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v net_source	Source network-layer address
+ * @ret rc		Return status code
+ */
+static inline int arp_tx ( struct io_buffer *iobuf, struct net_device *netdev,
+			   struct net_protocol *net_protocol,
+			   const void *net_dest, const void *net_source ) {
 
-extern int arp_resolve ( struct net_device *netdev,
-			 struct net_protocol *net_protocol,
-			 const void *dest_net_addr,
-			 const void *source_net_addr,
-			 void *dest_ll_addr );
+	return neighbour_tx ( iobuf, netdev, net_protocol, net_dest,
+			      &arp_discovery, net_source );
+}
 
 #endif /* _GPXE_ARP_H */
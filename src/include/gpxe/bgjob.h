@@ -0,0 +1,68 @@
+#ifndef _GPXE_BGJOB_H
+#define _GPXE_BGJOB_H
+
+/** @file
+ *
+ * Background jobs
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <gpxe/list.h>
+#include <gpxe/refcnt.h>
+#include <gpxe/job.h>
+
+/** A background job */
+struct bgjob {
+	/** Reference count */
+	struct refcnt refcnt;
+	/** List of background jobs */
+	struct list_head list;
+	/** Job control interface */
+	struct job_interface job;
+	/** Job identifier */
+	unsigned int id;
+	/** Job description */
+	const char *description;
+	/** Final status code, or -EINPROGRESS */
+	int rc;
+	/** Job completion handler, or NULL
+	 *
+	 * @v bgjob		Background job
+	 * @v rc		Final status code
+	 */
+	void ( * complete ) ( struct bgjob *bgjob, int rc );
+	/** Private data */
+	void *priv;
+};
+
+extern struct bgjob * alloc_bgjob ( const char *description,
+				    size_t priv_size );
+extern void register_bgjob ( struct bgjob *bgjob );
+extern struct bgjob * find_bgjob ( unsigned int id );
+extern int bgjob_wait ( struct bgjob *bgjob );
+
+/**
+ * Get reference to background job
+ *
+ * @v bgjob		Background job
+ * @ret bgjob		Background job
+ */
+static inline __attribute__ (( always_inline )) struct bgjob *
+bgjob_get ( struct bgjob *bgjob ) {
+	ref_get ( &bgjob->refcnt );
+	return bgjob;
+}
+
+/**
+ * Drop reference to background job
+ *
+ * @v bgjob		Background job
+ */
+static inline __attribute__ (( always_inline )) void
+bgjob_put ( struct bgjob *bgjob ) {
+	ref_put ( &bgjob->refcnt );
+}
+
+#endif /* _GPXE_BGJOB_H */
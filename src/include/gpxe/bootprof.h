@@ -0,0 +1,50 @@
+#ifndef _GPXE_BOOTPROF_H
+#define _GPXE_BOOTPROF_H
+
+/** @file
+ *
+ * Boot profiling
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <config/general.h>
+
+/** Maximum number of recorded profile events */
+#define BOOTPROF_MAX_EVENTS 64
+
+/** A boot profile event */
+struct bootprof_event {
+	/** Timestamp (in ticks) */
+	unsigned long ticks;
+	/** Event name */
+	const char *event;
+	/** Name of object to which the event applies (may be empty) */
+	char name[24];
+};
+
+extern unsigned int bootprof_count;
+extern unsigned int bootprof_dropped;
+
+extern struct bootprof_event * bootprof_event ( unsigned int index );
+extern void bootprof_record ( const char *event, const char *name );
+extern unsigned long bootprof_ms ( struct bootprof_event *event );
+extern void bootprof_clear ( void );
+
+/**
+ * Record profile event, if boot profiling is enabled
+ *
+ * @v event		Event name
+ * @v name		Name of object to which the event applies, or NULL
+ *
+ * The event name must be a string constant.
+ */
+static inline __attribute__ (( always_inline )) void
+bootprof_trace ( const char *event __unused, const char *name __unused ) {
+#ifdef BOOTPROF
+	bootprof_record ( event, name );
+#endif
+}
+
+#endif /* _GPXE_BOOTPROF_H */
@@ -52,6 +52,12 @@ struct cipher_algorithm {
 	size_t ctxsize;
 	/** Block size */
 	size_t blocksize;
+	/** Authentication tag size
+	 *
+	 * This is zero for ciphers which do not provide
+	 * authenticated encryption.
+	 */
+	size_t authsize;
 	/** Set key
 	 *
 	 * @v ctx		Context
@@ -74,6 +80,10 @@ struct cipher_algorithm {
 	 * @v len		Length of data
 	 *
 	 * @v len is guaranteed to be a multiple of @c blocksize.
+	 *
+	 * For authenticating ciphers, a NULL @c dst indicates that
+	 * @c src is additional data to be authenticated but not
+	 * encrypted.
 	 */
 	void ( * encrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
@@ -88,6 +98,14 @@ struct cipher_algorithm {
 	 */
 	void ( * decrypt ) ( void *ctx, const void *src, void *dst,
 			     size_t len );
+	/** Generate authentication tag
+	 *
+	 * @v ctx		Context
+	 * @v auth		Buffer for authentication tag
+	 *
+	 * This method is required only for authenticating ciphers.
+	 */
+	void ( * auth ) ( void *ctx, void *auth );
 };
 
 /** A public key algorithm */
@@ -143,10 +161,19 @@ static inline void cipher_decrypt ( struct cipher_algorithm *cipher,
 	cipher_decrypt ( (cipher), (ctx), (src), (dst), (len) );	\
 	} while ( 0 )
 
+static inline void cipher_auth ( struct cipher_algorithm *cipher,
+				 void *ctx, void *auth ) {
+	cipher->auth ( ctx, auth );
+}
+
 static inline int is_stream_cipher ( struct cipher_algorithm *cipher ) {
 	return ( cipher->blocksize == 1 );
 }
 
+static inline int is_auth_cipher ( struct cipher_algorithm *cipher ) {
+	return ( cipher->authsize != 0 );
+}
+
 extern struct digest_algorithm digest_null;
 extern struct cipher_algorithm cipher_null;
 extern struct pubkey_algorithm pubkey_null;
@@ -52,6 +52,9 @@ struct device_description {
 /** ISA bus type */
 #define BUS_TYPE_ISA 5
 
+/** TAP bus type */
+#define BUS_TYPE_TAP 6
+
 /** A hardware device */
 struct device {
 	/** Name */
@@ -82,6 +82,9 @@ struct dhcp_packet;
 /** Root path */
 #define DHCP_ROOT_PATH 17
 
+/** Interface MTU */
+#define DHCP_MTU 26
+
 /** Vendor encapsulated options */
 #define DHCP_VENDOR_ENCAP 43
 
@@ -343,6 +346,13 @@ struct dhcp_netdev_desc {
  */
 #define DHCP_EB_USE_CACHED DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb2 )
 
+/** DHCP early-commit policy
+ *
+ * Controls when DHCP discovery stops collecting offers and proceeds
+ * to DHCPREQUEST.  Takes one of the DHCP_COMMIT_XXX values.
+ */
+#define DHCP_EB_COMMIT DHCP_ENCAP_OPT ( DHCP_EB_ENCAP, 0xb3 )
+
 /** BIOS drive number
  *
  * This is the drive number for a drive emulated via INT 13.  0x80 is
@@ -600,6 +610,24 @@ struct dhcphdr {
 /** Maximum time that we will wait for ProxyDHCP responses */
 #define PROXYDHCP_MAX_TIMEOUT ( 2 * TICKS_PER_SEC )
 
+/** Commit to an offer once both IP and PXE settings are available
+ *
+ * This is the default policy.  An offer that is itself PXE-complete
+ * is committed to immediately; otherwise we wait for ProxyDHCP
+ * offers for up to PROXYDHCP_MAX_TIMEOUT.
+ */
+#define DHCP_COMMIT_PXE 0
+
+/** Commit to the first IP offer without waiting for ProxyDHCP */
+#define DHCP_COMMIT_FIRST 1
+
+/** Always collect offers for the full ProxyDHCP window
+ *
+ * This allows a higher-priority offer to win even when a
+ * PXE-complete offer arrives first.
+ */
+#define DHCP_COMMIT_WAIT 2
+
 /** Maximum time that we will wait for Boot Server responses */
 #define PXEBS_MAX_TIMEOUT ( 3 * TICKS_PER_SEC )
 
@@ -11,6 +11,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
 
+/** Maximum number of top-level options recorded in a DHCP option index */
+#define DHCP_OPTION_INDEX_MAX 32
+
+/** DHCP option index is stale and must be rebuilt before use */
+#define DHCP_OPTION_INDEX_STALE -1
+
+/** DHCP options block holds too many options to index */
+#define DHCP_OPTION_INDEX_FULL -2
+
 /** A DHCP options block */
 struct dhcp_options {
 	/** Option block raw data */
@@ -19,6 +28,18 @@ struct dhcp_options {
 	size_t len;
 	/** Option block maximum length */
 	size_t max_len;
+	/** Number of indexed top-level options
+	 *
+	 * This is DHCP_OPTION_INDEX_STALE if the options have been
+	 * modified since the index was built, or
+	 * DHCP_OPTION_INDEX_FULL if there are too many options to
+	 * index.
+	 */
+	int index_len;
+	/** Tags of indexed top-level options */
+	uint8_t index_tag[DHCP_OPTION_INDEX_MAX];
+	/** Offsets of indexed top-level options */
+	uint16_t index_offset[DHCP_OPTION_INDEX_MAX];
 };
 
 extern int dhcpopt_store ( struct dhcp_options *options, unsigned int tag,
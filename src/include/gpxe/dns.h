@@ -19,6 +19,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define DNS_TYPE_A		1
 #define DNS_TYPE_CNAME		5
+#define DNS_TYPE_SOA		6
 #define DNS_TYPE_AAAA		28
 #define DNS_TYPE_ANY		255
 
@@ -43,6 +44,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define	DNS_PORT		53
 #define	DNS_MAX_RETRIES		3
 #define	DNS_MAX_CNAME_RECURSION	0x30
+#define	DNS_MAX_SERVERS		4	/**< Max servers queried in parallel */
+#define	DNS_CACHE_SIZE		16	/**< Max cached answers */
+#define	DNS_CACHE_MAX_TTL	86400	/**< Max cache lifetime (seconds) */
 
 /*
  * DNS protocol structures
@@ -89,11 +93,17 @@ struct dns_rr_info_cname {
 	char cname[0];
 } __attribute__ (( packed ));
 
+struct dns_rr_info_soa {
+	struct dns_rr_info_common common;
+	char mname[0];
+} __attribute__ (( packed ));
+
 union dns_rr_info {
 	struct dns_rr_info_common common;
 	struct dns_rr_info_a a;
 	struct dns_rr_info_aaaa aaaa;
 	struct dns_rr_info_cname cname;
+	struct dns_rr_info_soa soa;
 };
 
 #endif /* _GPXE_DNS_H */
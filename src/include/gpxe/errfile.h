@@ -55,6 +55,11 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_bitmap		       ( ERRFILE_CORE | 0x000f0000 )
 #define ERRFILE_base64		       ( ERRFILE_CORE | 0x00100000 )
 #define ERRFILE_base16		       ( ERRFILE_CORE | 0x00110000 )
+#define ERRFILE_initrd		       ( ERRFILE_CORE | 0x00120000 )
+#define ERRFILE_imgcache	       ( ERRFILE_CORE | 0x00130000 )
+#define ERRFILE_fec		       ( ERRFILE_CORE | 0x00140000 )
+#define ERRFILE_bootprof	       ( ERRFILE_CORE | 0x00150000 )
+#define ERRFILE_bgjob		       ( ERRFILE_CORE | 0x00160000 )
 
 #define ERRFILE_eisa		     ( ERRFILE_DRIVER | 0x00000000 )
 #define ERRFILE_isa		     ( ERRFILE_DRIVER | 0x00010000 )
@@ -135,6 +140,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_ata		     ( ERRFILE_DRIVER | 0x00740000 )
 #define ERRFILE_srp		     ( ERRFILE_DRIVER | 0x00750000 )
 #define ERRFILE_qib7322		     ( ERRFILE_DRIVER | 0x00760000 )
+#define ERRFILE_tap		     ( ERRFILE_DRIVER | 0x00770000 )
 
 #define ERRFILE_aoe			( ERRFILE_NET | 0x00000000 )
 #define ERRFILE_arp			( ERRFILE_NET | 0x00010000 )
@@ -180,6 +186,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_wpa_ccmp		( ERRFILE_NET | 0x00290000 )
 #define ERRFILE_eth_slow		( ERRFILE_NET | 0x002a0000 )
 #define ERRFILE_dhcp6			( ERRFILE_NET | 0x002b0000 )
+#define ERRFILE_neighbour		( ERRFILE_NET | 0x002c0000 )
+#define ERRFILE_mfec			( ERRFILE_NET | 0x002d0000 )
+#define ERRFILE_impairnet		( ERRFILE_NET | 0x002e0000 )
 
 #define ERRFILE_image		      ( ERRFILE_IMAGE | 0x00000000 )
 #define ERRFILE_elf		      ( ERRFILE_IMAGE | 0x00010000 )
@@ -215,6 +224,9 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #define ERRFILE_ib_srpboot	      ( ERRFILE_OTHER | 0x00180000 )
 #define ERRFILE_iwmgmt		      ( ERRFILE_OTHER | 0x00190000 )
 #define ERRFILE_ip6mgmt		      ( ERRFILE_OTHER | 0x001a0000 )
+#define ERRFILE_pxe_file	      ( ERRFILE_OTHER | 0x001b0000 )
+#define ERRFILE_netbench	      ( ERRFILE_OTHER | 0x001c0000 )
+#define ERRFILE_linux_smbios	      ( ERRFILE_OTHER | 0x001d0000 )
 
 /** @} */
 
@@ -0,0 +1,75 @@
+#ifndef _GPXE_FEC_H
+#define _GPXE_FEC_H
+
+/** @file
+ *
+ * Forward error correction
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <gpxe/uaccess.h>
+
+/** Maximum number of source blocks per group */
+#define FEC_MAX_K 32
+
+/** Maximum number of (source plus repair) blocks per group */
+#define FEC_MAX_BLOCKS 256
+
+/** A forward error correction decoder */
+struct fec_decoder {
+	/** Repair block accumulators
+	 *
+	 * There are @c acc_count accumulators for each group.
+	 */
+	userptr_t accumulators;
+	/** Group state array */
+	userptr_t groups;
+	/** Block size */
+	size_t blksize;
+	/** Number of source blocks per group */
+	unsigned int k;
+	/** Number of repair blocks per group */
+	unsigned int r;
+	/** Number of repair blocks per group used for decoding */
+	unsigned int acc_count;
+	/** Number of groups */
+	unsigned long num_groups;
+	/** Number of incomplete groups */
+	unsigned long remaining;
+	/** Accumulator block */
+	uint8_t *acc;
+	/** Temporary block */
+	uint8_t *tmp;
+	/** Decoding matrix */
+	uint8_t *matrix;
+	/**
+	 * Pass source block to recipient
+	 *
+	 * @v fec		FEC decoder
+	 * @v group		Group index
+	 * @v index		Source block index within group
+	 * @v data		Block data (of length @c blksize)
+	 * @ret rc		Return status code
+	 */
+	int ( * deliver ) ( struct fec_decoder *fec, unsigned long group,
+			    unsigned int index, const void *data );
+};
+
+extern uint8_t fec_coefficient ( unsigned int r, unsigned int repair,
+				 unsigned int source );
+extern void fec_encode ( unsigned int k, unsigned int r, unsigned int repair,
+			 const void *sources, size_t blksize, void *out );
+extern int fec_decoder_init ( struct fec_decoder *fec, size_t len,
+			      size_t blksize, unsigned int k, unsigned int r,
+			      int ( * deliver ) ( struct fec_decoder *fec,
+						  unsigned long group,
+						  unsigned int index,
+						  const void *data ) );
+extern int fec_decoder_rx ( struct fec_decoder *fec, unsigned long group,
+			    unsigned int index, const void *data );
+extern void fec_decoder_free ( struct fec_decoder *fec );
+
+#endif /* _GPXE_FEC_H */
@@ -0,0 +1,114 @@
+#ifndef _GPXE_GCM_H
+#define _GPXE_GCM_H
+
+/** @file
+ *
+ * Galois/Counter Mode
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <gpxe/crypto.h>
+
+/** GCM block size */
+#define GCM_BLOCKSIZE 16
+
+/** GCM initialisation vector length
+ *
+ * Only the recommended 96-bit IV length is supported.
+ */
+#define GCM_IV_LEN 12
+
+/** GCM authentication tag length */
+#define GCM_AUTHSIZE 16
+
+/** GCM context */
+struct gcm_context {
+	/** Multiples of the hash subkey H (high halves) */
+	uint64_t hh[16];
+	/** Multiples of the hash subkey H (low halves) */
+	uint64_t hl[16];
+	/** Accumulated GHASH value */
+	uint8_t hash[GCM_BLOCKSIZE];
+	/** Counter block */
+	uint8_t ctr[GCM_BLOCKSIZE];
+	/** Encrypted initial counter block */
+	uint8_t ekj0[GCM_BLOCKSIZE];
+	/** Length of additional authenticated data */
+	uint64_t aad_len;
+	/** Length of encrypted data */
+	uint64_t len;
+};
+
+extern int gcm_setkey ( void *ctx, const void *key, size_t keylen,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_setiv ( void *ctx, const void *iv,
+			struct cipher_algorithm *raw_cipher,
+			struct gcm_context *gcm_ctx );
+extern void gcm_encrypt ( void *ctx, const void *src, void *dst, size_t len,
+			  struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_decrypt ( void *ctx, const void *src, void *dst, size_t len,
+			  struct cipher_algorithm *raw_cipher,
+			  struct gcm_context *gcm_ctx );
+extern void gcm_auth ( void *ctx, void *auth,
+		       struct cipher_algorithm *raw_cipher,
+		       struct gcm_context *gcm_ctx );
+
+/**
+ * Create a Galois/Counter Mode of behaviour of an existing cipher
+ *
+ * @v _gcm_name		Name for the new GCM cipher
+ * @v _gcm_cipher	New cipher algorithm
+ * @v _raw_cipher	Underlying cipher algorithm
+ * @v _raw_context	Context structure for the underlying cipher
+ */
+#define GCM_CIPHER( _gcm_name, _gcm_cipher, _raw_cipher, _raw_context )	\
+struct _gcm_name ## _context {						\
+	_raw_context raw_ctx;						\
+	struct gcm_context gcm_ctx;					\
+};									\
+static int _gcm_name ## _setkey ( void *ctx, const void *key,		\
+				  size_t keylen ) {			\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	return gcm_setkey ( &_gcm_name ## _ctx->raw_ctx, key, keylen,	\
+			    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );\
+}									\
+static void _gcm_name ## _setiv ( void *ctx, const void *iv ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_setiv ( &_gcm_name ## _ctx->raw_ctx, iv,			\
+		    &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _encrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_encrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _decrypt ( void *ctx, const void *src,		\
+				    void *dst, size_t len ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_decrypt ( &_gcm_name ## _ctx->raw_ctx, src, dst, len,	\
+		      &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );	\
+}									\
+static void _gcm_name ## _auth ( void *ctx, void *auth ) {		\
+	struct _gcm_name ## _context * _gcm_name ## _ctx = ctx;		\
+	gcm_auth ( &_gcm_name ## _ctx->raw_ctx, auth,			\
+		   &_raw_cipher, &_gcm_name ## _ctx->gcm_ctx );		\
+}									\
+struct cipher_algorithm _gcm_cipher = {					\
+	.name		= #_gcm_name,					\
+	.ctxsize	= sizeof ( struct _gcm_name ## _context ),	\
+	.blocksize	= 1,						\
+	.authsize	= GCM_AUTHSIZE,					\
+	.setkey		= _gcm_name ## _setkey,				\
+	.setiv		= _gcm_name ## _setiv,				\
+	.encrypt	= _gcm_name ## _encrypt,			\
+	.decrypt	= _gcm_name ## _decrypt,			\
+	.auth		= _gcm_name ## _auth,				\
+};
+
+#endif /* _GPXE_GCM_H */
@@ -17,6 +17,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 struct uri;
 struct image_type;
+struct digest_algorithm;
 
 /** An executable or loadable image */
 struct image {
@@ -63,11 +64,27 @@ struct image {
 	 * be freed before it can be executed.
 	 */
 	struct image *replacement;
+
+	/** List of images within the initrd region */
+	struct list_head initrd_list;
+	/** Offset of initrd region entry (including any cpio header) */
+	size_t initrd_offset;
+	/** Length of cpio header at start of initrd region entry */
+	size_t initrd_hdr_len;
 };
 
 /** Image is loaded */
 #define IMAGE_LOADED 0x0001
 
+/** Image is an initrd, to be downloaded into the initrd region */
+#define IMAGE_INITRD 0x0002
+
+/** Image data lies within the initrd region */
+#define IMAGE_INITRD_PLACED 0x0004
+
+/** Image may be satisfied from, and added to, the image cache */
+#define IMAGE_CACHEABLE 0x0008
+
 /** An executable or loadable image type */
 struct image_type {
 	/** Name of this image type */
@@ -158,6 +175,8 @@ extern int image_autoload ( struct image *image );
 extern int image_exec ( struct image *image );
 extern int register_and_autoload_image ( struct image *image );
 extern int register_and_autoexec_image ( struct image *image );
+extern void image_digest ( struct image *image,
+			  struct digest_algorithm *digest, void *out );
 
 /**
  * Increment reference count on an image
@@ -0,0 +1,22 @@
+#ifndef _GPXE_IMGCACHE_H
+#define _GPXE_IMGCACHE_H
+
+/** @file
+ *
+ * Image cache
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+struct image;
+struct uri;
+
+extern int imgcache_fetch ( struct image *image, struct uri *uri );
+extern void imgcache_add ( struct image *image, struct uri *uri );
+extern void imgcache_import ( physaddr_t head );
+extern void imgcache_publish ( physaddr_t head );
+
+#endif /* _GPXE_IMGCACHE_H */
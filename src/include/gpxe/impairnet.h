@@ -0,0 +1,148 @@
+#ifndef _GPXE_IMPAIRNET_H
+#define _GPXE_IMPAIRNET_H
+
+/** @file
+ *
+ * Impaired network devices
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <gpxe/list.h>
+#include <gpxe/tables.h>
+#include <gpxe/netdevice.h>
+
+struct io_buffer;
+
+/** A network impairment profile
+ *
+ * Probabilities are expressed in parts per thousand, and times in
+ * milliseconds.
+ */
+struct impairment {
+	/** Name */
+	const char *name;
+	/** Probability of losing a frame */
+	unsigned int loss;
+	/** Probability of duplicating a frame */
+	unsigned int duplicate;
+	/** Probability of holding a frame back behind its successors */
+	unsigned int reorder;
+	/** Fixed one-way delay */
+	unsigned int delay;
+	/** Maximum additional random delay */
+	unsigned int jitter;
+	/** Link rate (in bytes per second), or zero for unlimited */
+	unsigned long rate;
+};
+
+/** Network impairment profile table */
+#define IMPAIRMENTS __table ( struct impairment, "impairments" )
+
+/** Declare a network impairment profile */
+#define __impairment __table_entry ( IMPAIRMENTS, 01 )
+
+/** Additional delay applied to a reordered frame, in milliseconds */
+#define IMPAIR_REORDER_DELAY 10
+
+/** Maximum number of frames held by an impairment queue */
+#define IMPAIR_MAX_FRAMES 128
+
+/** Impairment queue statistics */
+struct impair_statistics {
+	/** Number of frames delivered */
+	unsigned int delivered;
+	/** Number of frames lost */
+	unsigned int lost;
+	/** Number of frames dropped due to a full queue */
+	unsigned int overflowed;
+	/** Number of frames duplicated */
+	unsigned int duplicated;
+	/** Number of frames reordered */
+	unsigned int reordered;
+};
+
+struct impair_queue;
+
+/** Impairment queue operations */
+struct impair_queue_operations {
+	/**
+	 * Deliver frame
+	 *
+	 * @v queue		Impairment queue
+	 * @v iobuf		I/O buffer
+	 *
+	 * This method takes ownership of the I/O buffer.
+	 */
+	void ( * deliver ) ( struct impair_queue *queue,
+			     struct io_buffer *iobuf );
+	/**
+	 * Discard frame
+	 *
+	 * @v queue		Impairment queue
+	 * @v iobuf		I/O buffer
+	 * @v rc		Reason for discard, or zero if the frame was lost
+	 *
+	 * This method takes ownership of the I/O buffer.
+	 */
+	void ( * discard ) ( struct impair_queue *queue,
+			     struct io_buffer *iobuf, int rc );
+};
+
+/** An impairment queue
+ *
+ * An impairment queue applies an impairment profile to a stream of
+ * frames travelling in one direction.  All random decisions are
+ * drawn from a pseudo-random sequence private to the queue, so that
+ * a given seed reproduces the same pattern of impairments.
+ */
+struct impair_queue {
+	/** Impairment profile */
+	struct impairment *impairment;
+	/** Queue operations */
+	struct impair_queue_operations *op;
+	/** Frames awaiting delivery, in order of delivery time */
+	struct list_head frames;
+	/** Number of frames awaiting delivery */
+	unsigned int count;
+	/** Pseudo-random number generator state */
+	uint32_t random;
+	/** Time at which link becomes idle, in microseconds */
+	uint64_t idle;
+	/** Delivery time of most recently queued in-order frame */
+	uint64_t last;
+	/** Statistics */
+	struct impair_statistics stats;
+};
+
+/** An impaired network device */
+struct impairnet {
+	/** List of impaired network devices */
+	struct list_head list;
+	/** Network device */
+	struct net_device *netdev;
+	/** Underlying network device operations */
+	struct net_device_operations *op;
+	/** Transmit impairment queue */
+	struct impair_queue tx;
+	/** Receive impairment queue */
+	struct impair_queue rx;
+};
+
+extern struct impairment * find_impairment ( const char *name );
+extern void impair_init ( struct impair_queue *queue,
+			  struct impairment *impairment,
+			  struct impair_queue_operations *op,
+			  unsigned long seed );
+extern void impair_enqueue ( struct impair_queue *queue,
+			     struct io_buffer *iobuf );
+extern void impair_poll ( struct impair_queue *queue );
+extern void impair_flush ( struct impair_queue *queue, int rc );
+extern struct impairnet * find_impairnet ( struct net_device *netdev );
+extern int impair_netdev ( struct net_device *netdev,
+			   struct impairment *impairment, unsigned long seed );
+extern void unimpair_netdev ( struct net_device *netdev );
+
+#endif /* _GPXE_IMPAIRNET_H */
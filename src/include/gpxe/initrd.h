@@ -0,0 +1,23 @@
+#ifndef _GPXE_INITRD_H
+#define _GPXE_INITRD_H
+
+/** @file
+ *
+ * Initial ramdisk region
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <gpxe/uaccess.h>
+
+struct image;
+
+extern size_t initrd_header ( struct image *image, userptr_t address );
+extern int initrd_resize ( struct image *image, size_t len );
+extern void initrd_release ( struct image *image );
+extern int initrd_region ( struct image *exclude, userptr_t *data,
+			   size_t *len );
+
+#endif /* _GPXE_INITRD_H */
@@ -57,8 +57,42 @@ struct io_buffer {
 	void *tail;
 	/** End of the buffer */
         void *end;
+
+	/** Offload flags
+	 *
+	 * This is the bitwise-OR of zero or more IOB_XXX constants.
+	 */
+	unsigned int flags;
+	/** Start of checksummed data, as an offset from @c head */
+	uint16_t csum_start;
+	/** Offset of checksum field from start of checksummed data */
+	uint16_t csum_offset;
+	/** Maximum segment payload length (for IOB_TSO) */
+	uint16_t mss;
+	/** Flow hash
+	 *
+	 * This is set by the transport layer for transmitted packets,
+	 * and is used to select a hardware queue on multi-queue
+	 * devices.  Packets which do not belong to any flow have a
+	 * flow hash of zero.
+	 */
+	uint16_t flow;
 };
 
+/** Transport-layer checksum has been verified by the hardware */
+#define IOB_CSUM_VALID 0x0001
+
+/** Transport-layer checksum is incomplete
+ *
+ * The checksum field contains the (uncomplemented) pseudo-header
+ * checksum, and the data from @c csum_start onwards has not yet been
+ * summed.
+ */
+#define IOB_CSUM_PARTIAL 0x0002
+
+/** Packet is a TCP segment requiring segmentation offload */
+#define IOB_TSO 0x0004
+
 /**
  * Reserve space at start of I/O buffer
  *
@@ -199,6 +233,7 @@ static inline void iob_populate ( struct io_buffer *iobuf,
 	iobuf->head = iobuf->data = data;
 	iobuf->tail = ( data + len );
 	iobuf->end = ( data + max_len );
+	iobuf->flags = 0;
 }
 
 /**
@@ -13,6 +13,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/in.h>
 #include <gpxe/list.h>
 #include <gpxe/retry.h>
+#include <gpxe/timer.h>
 
 struct io_buffer;
 struct net_device;
@@ -32,8 +33,11 @@ struct net_protocol;
 #define IP_TOS		0
 #define IP_TTL		64
 
-#define IP_FRAG_IOB_SIZE	1500
-#define IP_FRAG_TIMEOUT		50
+/* IP fragment reassembly */
+#define IP_FRAG_TIMEOUT		( 15 * TICKS_PER_SEC )
+#define IP_FRAG_MAX_BUFFERS	8	/**< Max datagrams being reassembled */
+#define IP_FRAG_MAX_MEM		( 32 * 1024 )  /**< Max fragment buffer memory */
+#define IP_FRAG_HASH_SIZE	16	/**< Hash buckets (power of two) */
 
 /** An IPv4 packet header */
 struct iphdr {
@@ -74,20 +78,49 @@ struct ipv4_miniroute {
 	struct in_addr gateway;
 };
 
-/* Fragment reassembly buffer */
-struct frag_buffer {
-	/* Identification number */
-	uint16_t ident;
-	/* Source network address */
+/** A hole within a partially reassembled IPv4 datagram
+ *
+ * Holes are tracked as described in RFC 815.
+ */
+struct ipv4_frag_hole {
+	/** List of holes */
+	struct list_head list;
+	/** Offset of first missing byte */
+	size_t first;
+	/** Offset of last missing byte, or @c IP_FRAG_INFINITY */
+	size_t last;
+};
+
+/** Last byte of a hole extending to the (as yet unknown) datagram end */
+#define IP_FRAG_INFINITY ( ~( ( size_t ) 0 ) )
+
+/** An IPv4 fragment reassembly buffer */
+struct ipv4_frag_buffer {
+	/** List of reassembly buffers within the same hash bucket */
+	struct list_head hash;
+	/** List of all reassembly buffers, most recently created first */
+	struct list_head list;
+
+	/** Source network address */
 	struct in_addr src;
-	/* Destination network address */
+	/** Destination network address */
 	struct in_addr dest;
-	/* Reassembled I/O buffer */
-	struct io_buffer *frag_iob;
-	/* Reassembly timer */
-	struct retry_timer frag_timer;
-	/* List of fragment reassembly buffers */
-	struct list_head list;
+	/** Identification number */
+	uint16_t ident;
+	/** Transport-layer protocol */
+	uint8_t protocol;
+
+	/** Received fragments (each including its IPv4 header) */
+	struct list_head fragments;
+	/** Holes yet to be filled */
+	struct list_head holes;
+	/** Total size of fragment I/O buffers held */
+	size_t mem;
+	/** Datagram payload length (valid once final fragment is seen) */
+	size_t len;
+
+	/** Reassembly timer */
+	struct retry_timer timer;
 };
 
 extern struct list_head ipv4_miniroutes;
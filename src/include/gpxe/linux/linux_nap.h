@@ -0,0 +1,40 @@
+#ifndef _GPXE_LINUX_NAP_H
+#define _GPXE_LINUX_NAP_H
+
+/** @file
+ *
+ * gPXE CPU sleeping API for Linux userspace
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#ifdef NAP_LINUX
+#define NAP_PREFIX_linux
+#else
+#define NAP_PREFIX_linux __linux_
+#endif
+
+/* There is no access to interrupt lines under Linux userspace */
+
+static inline __always_inline int
+NAP_INLINE ( linux, nap_irq_hook ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( linux, nap_irq_unhook ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
+static inline __always_inline int
+NAP_INLINE ( linux, nap_irq_triggered ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( linux, nap_irq_rearm ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
+#endif /* _GPXE_LINUX_NAP_H */
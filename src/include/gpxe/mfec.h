@@ -0,0 +1,47 @@
+#ifndef _GPXE_MFEC_H
+#define _GPXE_MFEC_H
+
+/** @file
+ *
+ * Multicast forward-error-corrected download protocol
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+/** Default MFEC multicast port */
+#define MFEC_DEFAULT_PORT 10010
+
+/** MFEC packet magic ("MFEC") */
+#define MFEC_MAGIC 0x4d464543UL
+
+/** An MFEC packet header
+ *
+ * All fields are in network byte order.  The header is followed by
+ * exactly @c blksize bytes of payload; the final source block of a
+ * file is padded with zeroes.
+ */
+struct mfec_header {
+	/** Magic signature */
+	uint32_t magic;
+	/** Session identifier */
+	uint32_t session;
+	/** Total file length */
+	uint32_t len;
+	/** Block size */
+	uint16_t blksize;
+	/** Number of source blocks per group */
+	uint8_t k;
+	/** Number of repair blocks per group */
+	uint8_t r;
+	/** Group index */
+	uint32_t group;
+	/** Block index within group (source blocks first) */
+	uint8_t index;
+	/** Reserved */
+	uint8_t reserved[3];
+} __attribute__ (( packed ));
+
+#endif /* _GPXE_MFEC_H */
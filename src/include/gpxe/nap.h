@@ -43,6 +43,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 /* Include all architecture-independent I/O API headers */
 #include <gpxe/null_nap.h>
+#include <gpxe/linux/linux_nap.h>
 
 /* Include all architecture-dependent I/O API headers */
 #include <bits/nap.h>
@@ -53,4 +54,42 @@ FILE_LICENCE ( GPL2_OR_LATER );
  */
 void cpu_nap ( void );
 
+/**
+ * Allow an interrupt line to wake the CPU from a nap
+ *
+ * @v irq		Interrupt line
+ * @ret hooked		Interrupt line was hooked
+ *
+ * Once hooked, an interrupt on the line will terminate cpu_nap().
+ * The line is then masked until nap_irq_rearm() is called, so the
+ * device raising the interrupt need not be serviced from within the
+ * interrupt handler.
+ */
+int nap_irq_hook ( unsigned int irq );
+
+/**
+ * Stop an interrupt line from waking the CPU from a nap
+ *
+ * @v irq		Interrupt line
+ */
+void nap_irq_unhook ( unsigned int irq );
+
+/**
+ * Check whether or not an interrupt has occurred
+ *
+ * @v irq		Interrupt line
+ * @ret triggered	Interrupt has occurred since the line was last rearmed
+ */
+int nap_irq_triggered ( unsigned int irq );
+
+/**
+ * Rearm interrupt line
+ *
+ * @v irq		Interrupt line
+ *
+ * The caller must have serviced all devices attached to the
+ * interrupt line since the interrupt occurred.
+ */
+void nap_irq_rearm ( unsigned int irq );
+
 #endif /* _GPXE_NAP_H */
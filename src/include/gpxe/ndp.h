@@ -7,6 +7,7 @@
 #include <gpxe/ip6.h>
 #include <gpxe/in.h>
 #include <gpxe/netdevice.h>
+#include <gpxe/neighbour.h>
 #include <gpxe/iobuf.h>
 #include <gpxe/tcpip.h>
 
@@ -106,8 +107,24 @@ struct prefix_option
 #define RADVERT_MANAGED		( 1 << 7 )
 #define RADVERT_OTHERCONF	( 1 << 6 )
 
-int ndp_resolve ( struct net_device *netdev, struct in6_addr *src,
-		  struct in6_addr *dest, void *dest_ll_addr );
+extern struct neighbour_discovery ndp_discovery;
+
+/**
+ * Transmit packet, determining link-layer address via NDP
+ *
+ * @v iobuf		I/O buffer
+ * @v netdev		Network device
+ * @v net_dest		Destination IPv6 address
+ * @v net_source	Source IPv6 address
+ * @ret rc		Return status code
+ */
+static inline int ndp_tx ( struct io_buffer *iobuf, struct net_device *netdev,
+			   const struct in6_addr *net_dest,
+			   const struct in6_addr *net_source ) {
+
+	return neighbour_tx ( iobuf, netdev, &ipv6_protocol, net_dest,
+			      &ndp_discovery, net_source );
+}
 
 int ndp_send_rsolicit ( struct net_device *netdev,
 			struct job_interface *job,
@@ -118,7 +135,7 @@ int ndp_process_radvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src
 			  struct icmp6_net_protocol *net_protocol );
 
 int ndp_process_nadvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
-			  struct sockaddr_tcpip *st_dest,
+			  struct sockaddr_tcpip *st_dest, struct net_device *netdev,
 			  struct icmp6_net_protocol *net_protocol );
 
 int ndp_process_nsolicit ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
@@ -0,0 +1,88 @@
+#ifndef _GPXE_NEIGHBOUR_H
+#define _GPXE_NEIGHBOUR_H
+
+/** @file
+ *
+ * Neighbour discovery
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <gpxe/list.h>
+#include <gpxe/retry.h>
+#include <gpxe/netdevice.h>
+
+/** A neighbour discovery protocol */
+struct neighbour_discovery {
+	/** Name */
+	const char *name;
+	/**
+	 * Transmit neighbour discovery request
+	 *
+	 * @v netdev		Network device
+	 * @v net_protocol	Network-layer protocol
+	 * @v net_dest		Destination network-layer address
+	 * @v net_source	Source network-layer address
+	 * @ret rc		Return status code
+	 */
+	int ( * tx_request ) ( struct net_device *netdev,
+			       struct net_protocol *net_protocol,
+			       const void *net_dest, const void *net_source );
+};
+
+/** A neighbour cache entry */
+struct neighbour {
+	/** List of entries within the same hash bucket */
+	struct list_head hash;
+	/** List of all entries, most recently used first */
+	struct list_head lru;
+
+	/** Network device */
+	struct net_device *netdev;
+	/** Network-layer protocol */
+	struct net_protocol *net_protocol;
+	/** Network-layer destination address */
+	uint8_t net_dest[MAX_NET_ADDR_LEN];
+	/** Link-layer destination address */
+	uint8_t ll_dest[MAX_LL_ADDR_LEN];
+
+	/** Neighbour discovery protocol (if discovery is ongoing) */
+	struct neighbour_discovery *discovery;
+	/** Network-layer source address (if discovery is ongoing) */
+	uint8_t net_source[MAX_NET_ADDR_LEN];
+	/** Retransmission timer */
+	struct retry_timer timer;
+
+	/** Packets awaiting neighbour discovery */
+	struct list_head tx_queue;
+	/** Number of packets awaiting neighbour discovery */
+	unsigned int tx_queue_len;
+};
+
+/**
+ * Test if neighbour cache entry has a valid link-layer address
+ *
+ * @v neighbour		Neighbour cache entry
+ * @ret has_ll_dest	Neighbour cache entry has a valid link-layer address
+ */
+static inline __attribute__ (( always_inline )) int
+neighbour_has_ll_dest ( struct neighbour *neighbour ) {
+	return ( ! neighbour->discovery );
+}
+
+extern int neighbour_tx ( struct io_buffer *iobuf, struct net_device *netdev,
+			  struct net_protocol *net_protocol,
+			  const void *net_dest,
+			  struct neighbour_discovery *discovery,
+			  const void *net_source );
+extern int neighbour_update ( struct net_device *netdev,
+			      struct net_protocol *net_protocol,
+			      const void *net_dest, const void *ll_dest );
+extern int neighbour_define ( struct net_device *netdev,
+			      struct net_protocol *net_protocol,
+			      const void *net_dest, const void *ll_dest );
+extern void neighbour_flush ( struct net_device *netdev );
+
+#endif /* _GPXE_NEIGHBOUR_H */
@@ -43,7 +43,7 @@ struct device;
 #define MAX_LL_HEADER_LEN 32
 
 /** Maximum length of a network-layer address */
-#define MAX_NET_ADDR_LEN 4
+#define MAX_NET_ADDR_LEN 16
 
 /**
  * A network-layer protocol
@@ -239,16 +239,56 @@ struct net_device_error {
 /** Maximum number of unique errors that we will keep track of */
 #define NETDEV_MAX_UNIQUE_ERRORS 4
 
+/** Number of network device queue occupancy histogram buckets */
+#define NETDEV_OCCUPANCY_BUCKETS 8
+
 /** Network device statistics */
 struct net_device_stats {
 	/** Count of successful completions */
 	unsigned int good;
 	/** Count of error completions */
 	unsigned int bad;
+	/** Total length of successful completions */
+	unsigned long bytes;
+	/** Number of packets currently queued */
+	unsigned int queued;
+	/** Maximum number of packets queued */
+	unsigned int max_queued;
+	/** Queue occupancy histogram
+	 *
+	 * Bucket @c n counts packets which were enqueued when the
+	 * queue depth (including the packet itself) was in the range
+	 * [2^n,2^(n+1)).  The final bucket also counts all greater
+	 * depths.
+	 */
+	unsigned int occupancy[NETDEV_OCCUPANCY_BUCKETS];
 	/** Error breakdowns */
 	struct net_device_error errors[NETDEV_MAX_UNIQUE_ERRORS];
 };
 
+/** Minimum MTU permitted by IPv4 */
+#define NETDEV_MIN_MTU 68
+
+/** Maximum number of hardware queues per network device */
+#define NETDEV_MAX_QUEUES 4
+
+/** Heap space available for a network device's receive buffers
+ *
+ * Drivers which size their receive buffers according to the MTU
+ * should post fewer buffers, or use fewer hardware queues, when the
+ * buffers would otherwise not fit within this space, and should limit
+ * @c max_pkt_len so that the smallest such configuration still fits.
+ */
+#define NETDEV_RX_BUFFER_SPACE ( 64 * 1024 )
+
+/** Network device hardware queue statistics */
+struct net_device_queue {
+	/** Number of packets submitted to this queue for transmission */
+	unsigned int tx;
+	/** Number of packets received from this queue */
+	unsigned int rx;
+};
+
 /**
  * A network device
  *
@@ -305,11 +345,54 @@ struct net_device {
 	 * indicates the error preventing link-up.
 	 */
 	int link_rc;
+	/** Time at which device was last opened (in ticks) */
+	unsigned long open_time;
+	/** Time taken to achieve link-up after opening (in ticks)
+	 *
+	 * This is valid only if the NETDEV_LINK_TIMED state bit is set.
+	 */
+	unsigned long link_time;
+	/** Time at which device was last polled (in ticks) */
+	unsigned long poll_time;
+	/** Interrupt line used to wake from idle
+	 *
+	 * This is valid only if the NETDEV_IRQ_IDLE state bit is set.
+	 */
+	unsigned int idle_irq;
+	/** Number of packets held outside the TX and RX queues
+	 *
+	 * A layer interposed between the network stack and the
+	 * driver (such as an impairment queue) may hold packets for
+	 * later release.  The device is treated as having work
+	 * pending while any packets are held.
+	 */
+	unsigned int held;
 	/** Maximum packet length
 	 *
-	 * This length includes any link-layer headers.
+	 * This length includes any link-layer headers, and is the
+	 * largest packet that the hardware is able to handle.
 	 */
 	size_t max_pkt_len;
+	/** Maximum transmission unit
+	 *
+	 * This is the largest network-layer packet that may be sent
+	 * or received, excluding any link-layer headers.  It may be
+	 * changed via the "mtu" setting (e.g. by DHCP), up to the
+	 * limit imposed by @c max_pkt_len.
+	 */
+	size_t mtu;
+	/** MTU to be used when the device is next opened, or zero
+	 *
+	 * An increase in MTU cannot take effect while the device is
+	 * open, since the driver's receive buffers may be too small.
+	 */
+	size_t pending_mtu;
+	/** Offload capabilities
+	 *
+	 * This is the bitwise-OR of zero or more NETDEV_F_XXX
+	 * constants, and is set by the driver before registration.
+	 */
+	unsigned int features;
 	/** TX packet queue */
 	struct list_head tx_queue;
 	/** RX packet queue */
@@ -318,9 +401,24 @@ struct net_device {
 	struct net_device_stats tx_stats;
 	/** RX statistics */
 	struct net_device_stats rx_stats;
+	/** Number of hardware queues
+	 *
+	 * This is set by the driver before registration, and may not
+	 * exceed NETDEV_MAX_QUEUES.  The driver's open() method may
+	 * reduce it, e.g. to save memory when the MTU requires larger
+	 * receive buffers.  Drivers for devices with more
+	 * than one hardware queue should use netdev_queue_tx() to
+	 * select the queue for each transmitted packet, and
+	 * netdev_queue_rx() to hand over received packets.
+	 */
+	unsigned int num_queues;
+	/** Hardware queue statistics */
+	struct net_device_queue queues[NETDEV_MAX_QUEUES];
 
 	/** Configuration settings applicable to this device */
 	struct generic_settings settings;
+	/** Statistics settings for this device */
+	struct settings stats_settings;
 
 	/** Driver private data */
 	void *priv;
@@ -332,6 +430,62 @@ struct net_device {
 /** Network device interrupts are enabled */
 #define NETDEV_IRQ_ENABLED 0x0002
 
+/** Network device has recorded the time taken to achieve link-up */
+#define NETDEV_LINK_TIMED 0x0004
+
+/** Network device is polled only when its interrupt line is raised
+ *
+ * While this state bit is set, the device's interrupts are enabled
+ * and are used to wake the CPU from a nap.
+ */
+#define NETDEV_IRQ_IDLE 0x0008
+
+/** Network device verifies received TCP/UDP checksums
+ *
+ * Received packets whose checksums have been verified will be marked
+ * with IOB_CSUM_VALID.
+ */
+#define NETDEV_F_RX_CSUM 0x0001
+
+/** Network device can insert transmitted TCP/UDP checksums
+ *
+ * Packets marked with IOB_CSUM_PARTIAL will have the pseudo-header
+ * checksum in the checksum field; the device must sum the data from
+ * csum_start to the end of the packet and store the result at
+ * csum_start + csum_offset.
+ */
+#define NETDEV_F_TX_CSUM 0x0002
+
+/** Network device can segment TCP over IPv4
+ *
+ * Packets marked with IOB_TSO may be larger than the link MTU, and
+ * must be split by the device into segments carrying at most @c mss
+ * bytes of TCP payload.  Requires NETDEV_F_TX_CSUM.
+ */
+#define NETDEV_F_TSO 0x0004
+
+/** Network device can wake the CPU via an interrupt
+ *
+ * While interrupts are enabled via the irq() method, the device will
+ * raise its interrupt line (as recorded in the underlying hardware
+ * device's description) whenever there is work for poll() to do, and
+ * poll() will acknowledge the interrupt.  The interrupt need not be
+ * serviced by anything other than poll().
+ */
+#define NETDEV_F_IRQ 0x0008
+
+/** Network idle statistics */
+struct net_idle_stats {
+	/** Number of times the CPU was halted awaiting network activity */
+	unsigned long naps;
+	/** Time spent halted awaiting network activity (in ticks) */
+	unsigned long ticks;
+	/** Number of polls of interrupt-driven devices */
+	unsigned long polls;
+	/** Number of polls of interrupt-driven devices skipped as idle */
+	unsigned long skipped;
+};
+
 /** Link-layer protocol table */
 #define LL_PROTOCOLS __table ( struct ll_protocol, "ll_protocols" )
 
@@ -345,8 +499,10 @@ struct net_device {
 #define __net_protocol __table_entry ( NET_PROTOCOLS, 01 )
 
 extern struct list_head net_devices;
+extern struct net_idle_stats net_idle_stats;
 extern struct net_device_operations null_netdev_operations;
 extern struct settings_operations netdev_settings_operations;
+extern struct settings_operations netdev_stats_operations;
 
 /**
  * Initialise a network device
@@ -381,6 +537,20 @@ static inline const char * netdev_addr ( struct net_device *netdev ) {
 	return netdev->ll_protocol->ntoa ( netdev->ll_addr );
 }
 
+/**
+ * Get length of receive buffers required by network device
+ *
+ * @v netdev		Network device
+ * @ret len		Maximum received packet length
+ *
+ * This includes the link-layer header, and is the length that
+ * drivers should use when allocating receive buffers at the time the
+ * device is opened.
+ */
+static inline size_t netdev_max_rx_len ( struct net_device *netdev ) {
+	return ( netdev->mtu + netdev->ll_protocol->ll_header_len );
+}
+
 /** Iterate over all network devices */
 #define for_each_netdev( netdev ) \
 	list_for_each_entry ( (netdev), &net_devices, list )
@@ -449,16 +619,8 @@ netdev_settings_init ( struct net_device *netdev ) {
 	generic_settings_init ( &netdev->settings,
 				&netdev->refcnt, netdev->name );
 	netdev->settings.settings.op = &netdev_settings_operations;
-}
-
-/**
- * Mark network device as having link up
- *
- * @v netdev		Network device
- */
-static inline __attribute__ (( always_inline )) void
-netdev_link_up ( struct net_device *netdev ) {
-	netdev->link_rc = 0;
+	settings_init ( &netdev->stats_settings, &netdev_stats_operations,
+			&netdev->refcnt, "stats", 0 );
 }
 
 /**
@@ -505,6 +667,11 @@ netdev_irq_enabled ( struct net_device *netdev ) {
 	return ( netdev->state & NETDEV_IRQ_ENABLED );
 }
 
+extern void netdev_link_up ( struct net_device *netdev );
+extern unsigned int netdev_queue_tx ( struct net_device *netdev,
+				      struct io_buffer *iobuf );
+extern void netdev_queue_rx ( struct net_device *netdev, unsigned int queue,
+			      struct io_buffer *iobuf );
 extern void netdev_link_down ( struct net_device *netdev );
 extern int netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf );
 extern void netdev_tx_complete_err ( struct net_device *netdev,
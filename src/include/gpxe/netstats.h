@@ -0,0 +1,43 @@
+#ifndef _GPXE_NETSTATS_H
+#define _GPXE_NETSTATS_H
+
+/** @file
+ *
+ * Network statistics
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <gpxe/tables.h>
+
+struct net_device;
+struct setting;
+
+/** A network statistic
+ *
+ * Network statistics are exposed as read-only settings within each
+ * network device's "stats" settings block (e.g. "net0.stats/rx-bytes"),
+ * and are displayed by "ifstat -v".  Statistics maintained by
+ * protocols rather than by network devices (e.g. TCP retransmission
+ * counts) ignore the network device, and so appear identically for
+ * every device.
+ */
+struct net_statistic {
+	/** Setting */
+	struct setting *setting;
+	/** Fetch current value
+	 *
+	 * @v netdev		Network device
+	 * @ret value		Current value
+	 */
+	unsigned long ( * value ) ( struct net_device *netdev );
+};
+
+/** Network statistic table */
+#define NET_STATISTICS __table ( struct net_statistic, "net_statistics" )
+
+/** Declare a network statistic */
+#define __net_statistic __table_entry ( NET_STATISTICS, 01 )
+
+#endif /* _GPXE_NETSTATS_H */
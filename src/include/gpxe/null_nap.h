@@ -20,4 +20,24 @@ NAP_INLINE ( null, cpu_nap ) ( void ) {
 	/* Do nothing */
 }
 
+static inline __always_inline int
+NAP_INLINE ( null, nap_irq_hook ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( null, nap_irq_unhook ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
+static inline __always_inline int
+NAP_INLINE ( null, nap_irq_triggered ) ( unsigned int irq __unused ) {
+	return 0;
+}
+
+static inline __always_inline void
+NAP_INLINE ( null, nap_irq_rearm ) ( unsigned int irq __unused ) {
+	/* Do nothing */
+}
+
 #endif /* _GPXE_NULL_NAP_H */
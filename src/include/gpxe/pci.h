@@ -318,12 +318,26 @@ struct pci_device {
 	const char *driver_name;
 };
 
+/** PCI driver probe statistics */
+struct pci_driver_stats {
+	/** Name of most recently probed device ID */
+	const char *name;
+	/** Number of devices for which probe() has been called */
+	unsigned int probes;
+	/** Number of failed calls to probe() */
+	unsigned int failures;
+	/** Total time spent within probe(), in ticks */
+	unsigned long ticks;
+};
+
 /** A PCI driver */
 struct pci_driver {
 	/** PCI ID table */
 	struct pci_device_id *ids;
 	/** Number of entries in PCI ID table */
 	unsigned int id_count;
+	/** Probe statistics */
+	struct pci_driver_stats stats;
 	/**
 	 * Probe device
 	 *
@@ -347,6 +361,19 @@ struct pci_driver {
 /** Declare a PCI driver */
 #define __pci_driver __table_entry ( PCI_DRIVERS, 01 )
 
+/** PCI bus scan statistics */
+struct pci_bus_stats {
+	/** Number of PCI functions found */
+	unsigned int functions;
+	/** Number of PCI functions not probed due to lazy probing */
+	unsigned int skipped;
+	/** Total time spent scanning and probing, in ticks */
+	unsigned long ticks;
+};
+
+/** Unknown PCI bus:dev.fn address */
+#define PCI_BUSDEVFN_NONE 0xffff
+
 #define PCI_DEVFN( slot, func )		( ( (slot) << 3 ) | (func) )
 #define PCI_SLOT( devfn )		( ( (devfn) >> 3 ) & 0x1f )
 #define PCI_FUNC( devfn )		( (devfn) & 0x07 )
@@ -374,11 +401,14 @@ struct pci_driver {
 #define PCI_ROM( _vendor, _device, _name, _description, _data ) \
 	PCI_ID( _vendor, _device, _name, _description, _data )
 
+extern struct pci_bus_stats pci_bus_stats;
+
 extern void adjust_pci_device ( struct pci_device *pci );
 extern unsigned long pci_bar_start ( struct pci_device *pci,
 				     unsigned int reg );
 extern int pci_find_capability ( struct pci_device *pci, int capability );
 extern unsigned long pci_bar_size ( struct pci_device *pci, unsigned int reg );
+extern unsigned int pci_boot_busdevfn ( void );
 
 /**
  * Set PCI driver-private data
@@ -18,6 +18,14 @@ FILE_LICENCE ( GPL2_OR_LATER );
 /** Maximum file descriptor that will ever be allocated */
 #define POSIX_FD_MAX ( 31 )
 
+/** Default flow control window for each open file
+ *
+ * Received data beyond this amount that has not yet been read will
+ * cause the file to advertise a closed window, so that flow-controlled
+ * protocols (e.g. TCP) stop sending until the reader catches up.
+ */
+#define POSIX_WINDOW_SIZE ( 32 * 1024 )
+
 /** File descriptor set as used for select() */
 typedef uint32_t fd_set;
 
@@ -26,6 +34,7 @@ extern ssize_t read_user ( int fd, userptr_t buffer,
 			   off_t offset, size_t len );
 extern int select ( fd_set *readfds, int wait );
 extern ssize_t fsize ( int fd );
+extern int readahead ( int fd, size_t len );
 extern int close ( int fd );
 
 /**
@@ -31,10 +31,72 @@ struct process {
 	 * object, this field may be NULL.
 	 */
 	struct refcnt *refcnt;
+	/** Scheduling priority
+	 *
+	 * This is a PROCESS_PRIO_XXX constant.  A process with
+	 * priority @c n may execute up to 2^n consecutive steps each
+	 * time it reaches the head of the run queue.
+	 */
+	unsigned int priority;
+	/** Process state
+	 *
+	 * This is the bitwise-OR of zero or more PROCESS_XXX
+	 * constants.
+	 */
+	unsigned int state;
+	/** Steps remaining in the current turn */
+	unsigned int credit;
+	/** Name (for scheduler tracing), or NULL */
+	const char *name;
+	/** Number of steps executed */
+	unsigned long steps;
+};
+
+/** Normal priority, for housekeeping (e.g. timers) */
+#define PROCESS_PRIO_NORMAL 0
+
+/** Priority for processes driving active data transfers */
+#define PROCESS_PRIO_TRANSFER 1
+
+/** Priority for processes handling received network packets */
+#define PROCESS_PRIO_NETWORK 2
+
+/** Highest process priority */
+#define PROCESS_PRIO_MAX PROCESS_PRIO_NETWORK
+
+/** Process is asleep, awaiting process_wake() */
+#define PROCESS_ASLEEP 0x0001
+
+/** Scheduler statistics */
+struct scheduler_stats {
+	/** Number of steps executed by processes of each priority */
+	unsigned long steps[ PROCESS_PRIO_MAX + 1 ];
+	/** Number of calls to step() which found no runnable process */
+	unsigned long idle;
+	/** Number of turns ended early via process_yield() */
+	unsigned long yields;
+	/** Number of times a process went to sleep */
+	unsigned long sleeps;
+	/** Number of times a sleeping process was woken */
+	unsigned long wakes;
+	/** Number of steps which ended without a yield or sleep
+	 *
+	 * A step which neither yields nor sleeps is assumed to have
+	 * made progress.  This is used to determine whether or not
+	 * the whole system is idle.
+	 */
+	unsigned long busy;
 };
 
+extern struct list_head run_queue;
+extern struct list_head sleep_queue;
+extern struct scheduler_stats scheduler_stats;
+
 extern void process_add ( struct process *process );
 extern void process_del ( struct process *process );
+extern void process_yield ( struct process *process );
+extern void process_sleep ( struct process *process );
+extern void process_wake ( struct process *process );
 extern void step ( void );
 
 /**
@@ -50,6 +112,11 @@ process_init_stopped ( struct process *process,
 	INIT_LIST_HEAD ( &process->list );
 	process->step = step;
 	process->refcnt = refcnt;
+	process->priority = PROCESS_PRIO_NORMAL;
+	process->state = 0;
+	process->credit = 0;
+	process->name = NULL;
+	process->steps = 0;
 }
 
 /**
@@ -66,6 +133,17 @@ process_init ( struct process *process,
 	process_add ( process );
 }
 
+/**
+ * Check whether or not process is asleep
+ *
+ * @v process		Process
+ * @ret asleep		Process is asleep
+ */
+static inline __attribute__ (( always_inline )) int
+process_is_asleep ( struct process *process ) {
+	return ( process->state & PROCESS_ASLEEP );
+}
+
 /** Permanent process table */
 #define PERMANENT_PROCESSES __table ( struct process, "processes" )
 
@@ -10,6 +10,7 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <stdint.h>
+#include <string.h>
 #include <gpxe/tables.h>
 #include <gpxe/list.h>
 #include <gpxe/refcnt.h>
@@ -158,15 +159,30 @@ struct settings_applicator {
 /** Declare a settings applicator */
 #define __settings_applicator __table_entry ( SETTINGS_APPLICATORS, 01 )
 
+struct generic_setting;
+
+/** Number of hash chains in a generic settings block
+ *
+ * Must be a power of two.
+ */
+#define GENERIC_SETTINGS_HASH_SIZE 8
+
 /**
  * A generic settings block
  *
+ * Each generic setting is hashed by tag (if it has a tag) and by name
+ * (if it has a name), so that lookups by either key do not need to
+ * scan the whole block.
  */
 struct generic_settings {
 	/** Settings block */
 	struct settings settings;
 	/** List of generic settings */
 	struct list_head list;
+	/** Hash chains of generic settings with tags */
+	struct generic_setting *tags[GENERIC_SETTINGS_HASH_SIZE];
+	/** Hash chains of generic settings with names */
+	struct generic_setting *names[GENERIC_SETTINGS_HASH_SIZE];
 };
 
 extern struct settings_operations generic_settings_operations;
@@ -288,6 +304,8 @@ static inline void generic_settings_init ( struct generic_settings *generics,
 	settings_init ( &generics->settings, &generic_settings_operations,
 			refcnt, name, 0 );
 	INIT_LIST_HEAD ( &generics->list );
+	memset ( generics->tags, 0, sizeof ( generics->tags ) );
+	memset ( generics->names, 0, sizeof ( generics->names ) );
 }
 
 /**
@@ -0,0 +1,36 @@
+#ifndef _GPXE_SHA256_H
+#define _GPXE_SHA256_H
+
+/** @file
+ *
+ * SHA-256 algorithm
+ *
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+
+struct digest_algorithm;
+
+/** SHA-256 block size */
+#define SHA256_BLOCK_SIZE 64
+
+/** SHA-256 digest size */
+#define SHA256_DIGEST_SIZE 32
+
+/** SHA-256 context */
+struct sha256_context {
+	/** Intermediate hash value */
+	uint32_t hash[8];
+	/** Partial data block */
+	uint8_t block[SHA256_BLOCK_SIZE];
+	/** Total number of bytes digested */
+	uint64_t len;
+};
+
+#define SHA256_CTX_SIZE sizeof ( struct sha256_context )
+
+extern struct digest_algorithm sha256_algorithm;
+
+#endif /* _GPXE_SHA256_H */
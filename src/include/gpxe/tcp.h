@@ -290,23 +290,49 @@ struct tcp_options {
 #define TCP_MAX_WINDOW_SIZE	8192
 
 /**
- * Path MTU
+ * Minimum number of maximum-sized segments in the advertised window
  *
- * We really ought to implement Path MTU discovery.  Until we do,
- * anything with a path MTU greater than this may fail.
+ * When the MSS is large (e.g. when using jumbo frames), the window
+ * is increased beyond TCP_MAX_WINDOW_SIZE so that it can hold at
+ * least this many segments.
  */
-#define TCP_PATH_MTU 1460
+#define TCP_MIN_WINDOW_SEGMENTS 2
 
 /**
- * Advertised TCP MSS
+ * Largest window that can be advertised
  *
- * We currently hardcode this to a reasonable value and hope that the
- * sender uses path MTU discovery.  The alternative is breaking the
- * abstraction layer so that we can find out the MTU from the IP layer
- * (which would have to find out from the net device layer).
+ * We do not use window scaling, so the window must fit in the 16-bit
+ * window field.  Keep payloads dword-aligned as above.
+ */
+#define TCP_WINDOW_LIMIT ( 65536 - 4 )
+
+/**
+ * Maximum length of a segmentation offload packet
+ *
+ * When the transmitting network device supports TCP segmentation
+ * offload, we may hand it a single packet containing up to this much
+ * payload.  This must leave room for the TCP and IPv4 headers within
+ * the 16-bit IPv4 total length field.
+ */
+#define TCP_TSO_MAX_LEN ( 44 * TCP_MSS )
+
+/**
+ * Default TCP MSS
+ *
+ * The MSS is normally derived from the MTU of the network device
+ * used to reach the peer, and reduced to the MSS advertised by the
+ * peer.  This value is used only if the network device cannot be
+ * determined.  We do not implement path MTU discovery, so anything
+ * with a path MTU smaller than the local MTU may fail.
  */
 #define TCP_MSS 1460
 
+/** Length of IPv4 and TCP headers (excluding options) */
+#define TCP_MSS_IPV4_OVERHEAD 40
+
+/** Length of IPv6 and TCP headers (excluding options) */
+#define TCP_MSS_IPV6_OVERHEAD 60
+
 /** TCP maximum segment lifetime
  *
  * Currently set to 2 minutes, as per RFC 793.
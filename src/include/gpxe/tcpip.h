@@ -98,6 +98,17 @@ struct tcpip_net_protocol {
 		       struct sockaddr_tcpip *st_dest,
 		       struct net_device *netdev,
 		       uint16_t *trans_csum );
+	/**
+	 * Identify transmitting network device
+	 *
+	 * @v st_dest		Destination address
+	 * @ret netdev		Network device, or NULL
+	 *
+	 * This method is optional.  It is used by transport-layer
+	 * protocols to discover the offload capabilities of the
+	 * device that will be used to reach @c st_dest.
+	 */
+	struct net_device * ( * netdev ) ( struct sockaddr_tcpip *st_dest );
 };
 
 /** TCP/IP transport-layer protocol table */
@@ -113,6 +124,23 @@ struct tcpip_net_protocol {
 /** Declare a TCP/IP network-layer protocol */
 #define __tcpip_net_protocol __table_entry ( TCPIP_NET_PROTOCOLS, 01 )
 
+/**
+ * Calculate flow hash
+ *
+ * @v src		Source port (in network byte order)
+ * @v dest		Destination port (in network byte order)
+ * @ret flow		Flow hash
+ *
+ * Connections to the same server differ only in their local port, so
+ * the port pair is sufficient to spread concurrent transfers across
+ * hardware queues.
+ */
+static inline uint16_t tcpip_flow ( uint16_t src, uint16_t dest ) {
+	uint32_t ports = ( ( ( uint32_t ) src << 16 ) | dest );
+
+	return ( ( ports * 0x9e3779b1UL ) >> 16 );
+}
+
 extern int tcpip_rx ( struct io_buffer *iobuf, uint8_t tcpip_proto,
 		      struct sockaddr_tcpip *st_src,
 		      struct sockaddr_tcpip *st_dest, uint16_t pshdr_csum );
@@ -121,6 +149,10 @@ extern int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip,
 		      struct sockaddr_tcpip *st_dest,
 		      struct net_device *netdev,
 		      uint16_t *trans_csum );
+extern struct net_device * tcpip_netdev ( struct sockaddr_tcpip *st_dest );
+extern void tcpip_tx_csum ( struct io_buffer *iobuf, struct net_device *netdev,
+			    uint16_t *trans_csum, uint16_t pshdr_csum );
+extern void tcpip_complete_chksum ( struct io_buffer *iobuf );
 extern uint16_t tcpip_continue_chksum ( uint16_t partial,
 					const void *data, size_t len );
 extern uint16_t tcpip_chksum ( const void *data, size_t len );
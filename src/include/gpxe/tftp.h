@@ -13,7 +13,15 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 #define TFTP_PORT	       69 /**< Default TFTP server port */
 #define	TFTP_DEFAULT_BLKSIZE  512 /**< Default TFTP data block size */
-#define	TFTP_MAX_BLKSIZE     1432
+#define	TFTP_MAX_BLKSIZE     1432 /**< Data block size for a 1500-byte MTU */
+#define	TFTP_LIMIT_BLKSIZE  65464 /**< Largest data block size (RFC 2348) */
+
+/** Allowance for headers when calculating blocksize from the MTU
+ *
+ * This is chosen so that a standard 1500-byte MTU gives a blocksize
+ * of TFTP_MAX_BLKSIZE.
+ */
+#define TFTP_MTU_OVERHEAD ( 1500 - TFTP_MAX_BLKSIZE )
 
 #define TFTP_RRQ		1 /**< Read request opcode */
 #define TFTP_WRQ		2 /**< Write request opcode */
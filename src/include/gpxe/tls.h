@@ -16,6 +16,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/crypto.h>
 #include <gpxe/md5.h>
 #include <gpxe/sha1.h>
+#include <gpxe/sha256.h>
 #include <gpxe/x509.h>
 
 /** A TLS header */
@@ -34,12 +35,27 @@ struct tls_header {
 	uint16_t length;
 } __attribute__ (( packed ));
 
+/** TLS authentication header
+ *
+ * This is the sequence number and record header over which a record
+ * MAC (or AEAD authentication tag) is calculated.
+ */
+struct tls_auth_header {
+	/** Sequence number */
+	uint64_t seq;
+	/** Record header */
+	struct tls_header header;
+} __attribute__ (( packed ));
+
 /** TLS version 1.0 */
 #define TLS_VERSION_TLS_1_0 0x0301
 
 /** TLS version 1.1 */
 #define TLS_VERSION_TLS_1_1 0x0302
 
+/** TLS version 1.2 */
+#define TLS_VERSION_TLS_1_2 0x0303
+
 /** Change cipher content type */
 #define TLS_TYPE_CHANGE_CIPHER 20
 
@@ -73,6 +89,44 @@ struct tls_header {
 #define TLS_RSA_WITH_NULL_SHA 0x0002
 #define TLS_RSA_WITH_AES_128_CBC_SHA 0x002f
 #define TLS_RSA_WITH_AES_256_CBC_SHA 0x0035
+#define TLS_RSA_WITH_AES_128_CBC_SHA256 0x003c
+#define TLS_RSA_WITH_AES_256_CBC_SHA256 0x003d
+#define TLS_RSA_WITH_AES_128_GCM_SHA256 0x009c
+
+/** Maximum length of a TLS plaintext record fragment */
+#define TLS_MAX_FRAGMENT_LEN 16384
+
+/** Maximum length of a received TLS ciphertext record */
+#define TLS_RX_MAX_LEN ( TLS_MAX_FRAGMENT_LEN + 2048 )
+
+/** Length of the explicit nonce within an AEAD-ciphered record */
+#define TLS_AEAD_EXPLICIT_IV_LEN 8
+
+/** Maximum length of the implicit (fixed) part of an AEAD nonce */
+#define TLS_AEAD_FIXED_IV_LEN 4
+
+/** Maximum TX record headroom
+ *
+ * This is the record header plus the largest explicit IV or nonce
+ * that we may need to prepend to the record content.
+ */
+#define TLS_TX_HEADROOM ( sizeof ( struct tls_header ) + 16 )
+
+/** Maximum TX record tailroom
+ *
+ * This is the largest MAC (or authentication tag) plus the largest
+ * block cipher padding that we may need to append to the record
+ * content.
+ */
+#define TLS_TX_TAILROOM ( 32 /* SHA-256 MAC */ + 16 /* padding */ )
+
+/** A TLS AEAD nonce */
+struct tls_aead_nonce {
+	/** Fixed (implicit) part */
+	uint8_t fixed[TLS_AEAD_FIXED_IV_LEN];
+	/** Record (explicit) part */
+	uint64_t record;
+} __attribute__ (( packed ));
 
 /** TLS RX state machine state */
 enum tls_rx_state {
@@ -110,6 +164,10 @@ struct tls_cipherspec {
 	void *cipher_next_ctx;
 	/** MAC secret */
 	void *mac_secret;
+	/** Length of fixed (implicit) part of AEAD nonce */
+	size_t fixed_iv_len;
+	/** Fixed (implicit) part of AEAD nonce */
+	uint8_t fixed_iv[TLS_AEAD_FIXED_IV_LEN];
 };
 
 /** TLS pre-master secret */
@@ -146,6 +204,8 @@ struct tls_session {
 	struct tls_cipherspec rx_cipherspec;
 	/** Next RX cipher specification */
 	struct tls_cipherspec rx_cipherspec_pending;
+	/** Negotiated protocol version */
+	uint16_t version;
 	/** Premaster secret */
 	struct tls_pre_master_secret pre_master_secret;
 	/** Master secret */
@@ -158,6 +218,8 @@ struct tls_session {
 	uint8_t handshake_md5_ctx[MD5_CTX_SIZE];
 	/** SHA1 context for handshake verification */
 	uint8_t handshake_sha1_ctx[SHA1_CTX_SIZE];
+	/** SHA256 context for handshake verification */
+	uint8_t handshake_sha256_ctx[SHA256_CTX_SIZE];
 
 	/** Hack: server RSA public key */
 	struct x509_rsa_public_key rsa;
@@ -178,7 +240,7 @@ struct tls_session {
 	/** Current received record header */
 	struct tls_header rx_header;
 	/** Current received raw data buffer */
-	void *rx_data;
+	struct io_buffer *rx_data;
 };
 
 extern int add_tls ( struct xfer_interface *xfer,
@@ -26,6 +26,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 /* Include all architecture-independent I/O API headers */
 #include <gpxe/efi/efi_umalloc.h>
+#include <gpxe/linux/linux_umalloc.h>
 
 /* Include all architecture-dependent I/O API headers */
 #include <bits/umalloc.h>
@@ -50,6 +50,15 @@ struct xfer_interface_operations {
 	 * bytes.
 	 */
 	size_t ( * window ) ( struct xfer_interface *xfer );
+	/** Notify of change in flow control window
+	 *
+	 * @v xfer		Data transfer interface
+	 *
+	 * A receiver whose window has reopened (e.g. because data
+	 * have been consumed from a queue) sends this so that a
+	 * sender which was limited by the window can resume.
+	 */
+	void ( * window_changed ) ( struct xfer_interface *xfer );
 	/** Allocate I/O buffer
 	 *
 	 * @v xfer		Data transfer interface
@@ -140,6 +149,7 @@ extern int xfer_vredirect ( struct xfer_interface *xfer, int type,
 			    va_list args );
 extern int xfer_redirect ( struct xfer_interface *xfer, int type, ... );
 extern size_t xfer_window ( struct xfer_interface *xfer );
+extern void xfer_window_changed ( struct xfer_interface *xfer );
 extern struct io_buffer * xfer_alloc_iob ( struct xfer_interface *xfer,
 					   size_t len );
 extern int xfer_deliver_iob ( struct xfer_interface *xfer,
@@ -160,6 +170,7 @@ extern int ignore_xfer_vredirect ( struct xfer_interface *xfer,
 				   int type, va_list args );
 extern size_t unlimited_xfer_window ( struct xfer_interface *xfer );
 extern size_t no_xfer_window ( struct xfer_interface *xfer );
+extern void ignore_xfer_window_changed ( struct xfer_interface *xfer );
 extern struct io_buffer * default_xfer_alloc_iob ( struct xfer_interface *xfer,
 						   size_t len );
 extern int xfer_deliver_as_raw ( struct xfer_interface *xfer,
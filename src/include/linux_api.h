@@ -0,0 +1,202 @@
+#ifndef _LINUX_API_H
+#define _LINUX_API_H
+
+/** @file
+ *
+ * Linux host system call API
+ *
+ * The Linux userspace platform talks directly to the host kernel via
+ * system calls, rather than linking against the host C library
+ * (which would clash with our own C library).  Only the small subset
+ * of system calls required by the platform is provided.
+ *
+ * All wrappers return the raw kernel return value; a failure is
+ * indicated by a negative Linux error number.  Note that Linux error
+ * numbers are not the same as gPXE error numbers.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stddef.h>
+#include <bits/linux_api.h>
+
+/** A Linux time specification */
+struct linux_timespec {
+	/** Seconds */
+	long tv_sec;
+	/** Nanoseconds */
+	long tv_nsec;
+};
+
+/** A Linux poll() file descriptor */
+struct linux_pollfd {
+	/** File descriptor */
+	int fd;
+	/** Requested events */
+	short events;
+	/** Returned events */
+	short revents;
+};
+
+/** Number of Linux terminal control characters */
+#define LINUX_NCCS 19
+
+/** A Linux terminal configuration */
+struct linux_termios {
+	/** Input mode flags */
+	uint32_t c_iflag;
+	/** Output mode flags */
+	uint32_t c_oflag;
+	/** Control mode flags */
+	uint32_t c_cflag;
+	/** Local mode flags */
+	uint32_t c_lflag;
+	/** Line discipline */
+	uint8_t c_line;
+	/** Control characters */
+	uint8_t c_cc[LINUX_NCCS];
+};
+
+/** A Linux network interface request */
+struct linux_ifreq {
+	/** Interface name */
+	char ifr_name[16];
+	/** Interface flags */
+	short ifr_flags;
+	/** Padding to size of largest request */
+	uint8_t pad[22];
+};
+
+/* Open flags */
+#define LINUX_O_RDWR		0x0002
+#define LINUX_O_NONBLOCK	0x0800
+
+/* fcntl() commands */
+#define LINUX_F_GETFL		3
+#define LINUX_F_SETFL		4
+
+/* poll() events */
+#define LINUX_POLLIN		0x0001
+
+/* mmap() and mremap() flags */
+#define LINUX_PROT_READ		0x0001
+#define LINUX_PROT_WRITE	0x0002
+#define LINUX_MAP_PRIVATE	0x0002
+#define LINUX_MAP_ANONYMOUS	0x0020
+#define LINUX_MREMAP_MAYMOVE	0x0001
+
+/* Clocks */
+#define LINUX_CLOCK_MONOTONIC	1
+
+/* Terminal ioctls and flags */
+#define LINUX_TCGETS		0x5401
+#define LINUX_TCSETS		0x5402
+#define LINUX_ISIG		0x0001
+#define LINUX_ICANON		0x0002
+#define LINUX_ECHO		0x0008
+#define LINUX_ICRNL		0x0100
+#define LINUX_VTIME		5
+#define LINUX_VMIN		6
+
+/* TUN/TAP ioctls and flags */
+#define LINUX_TUNSETIFF		0x400454ca
+#define LINUX_IFF_TAP		0x0002
+#define LINUX_IFF_NO_PI		0x1000
+
+/* Linux error numbers */
+#define LINUX_EINTR		4
+#define LINUX_EAGAIN		11
+
+/** Maximum Linux error number returned by a system call */
+#define LINUX_MAX_ERRNO		4095
+
+/** Command-line argument count */
+extern int linux_argc;
+
+/** Command-line arguments */
+extern char **linux_argv;
+
+extern long linux_syscall ( long number, long arg1, long arg2, long arg3,
+			    long arg4, long arg5, long arg6 );
+
+/**
+ * Check for system call failure
+ *
+ * @v ret		System call return value
+ * @ret is_error	System call failed
+ */
+static inline __attribute__ (( always_inline )) int
+linux_is_error ( long ret ) {
+	return ( ( unsigned long ) ret >
+		 ( ( unsigned long ) - ( LINUX_MAX_ERRNO + 1 ) ) );
+}
+
+static inline long linux_read ( int fd, void *buf, size_t count ) {
+	return linux_syscall ( __NR_read, fd, ( long ) buf, count, 0, 0, 0 );
+}
+
+static inline long linux_write ( int fd, const void *buf, size_t count ) {
+	return linux_syscall ( __NR_write, fd, ( long ) buf, count, 0, 0, 0 );
+}
+
+static inline long linux_open ( const char *pathname, int flags ) {
+	return linux_syscall ( __NR_open, ( long ) pathname, flags,
+			       0, 0, 0, 0 );
+}
+
+static inline long linux_close ( int fd ) {
+	return linux_syscall ( __NR_close, fd, 0, 0, 0, 0, 0 );
+}
+
+static inline long linux_poll ( struct linux_pollfd *fds, unsigned int nfds,
+				int timeout ) {
+	return linux_syscall ( __NR_poll, ( long ) fds, nfds, timeout,
+			       0, 0, 0 );
+}
+
+static inline long linux_ioctl ( int fd, unsigned int request, void *arg ) {
+	return linux_syscall ( __NR_ioctl, fd, request, ( long ) arg,
+			       0, 0, 0 );
+}
+
+static inline long linux_fcntl ( int fd, int cmd, long arg ) {
+	return linux_syscall ( __NR_fcntl, fd, cmd, arg, 0, 0, 0 );
+}
+
+static inline void * linux_mmap ( void *addr, size_t length, int prot,
+				  int flags, int fd, long offset ) {
+	return ( ( void * ) linux_syscall ( __NR_mmap, ( long ) addr, length,
+					    prot, flags, fd, offset ) );
+}
+
+static inline void * linux_mremap ( void *old_address, size_t old_size,
+				    size_t new_size, int flags ) {
+	return ( ( void * ) linux_syscall ( __NR_mremap,
+					    ( long ) old_address, old_size,
+					    new_size, flags, 0, 0 ) );
+}
+
+static inline long linux_munmap ( void *addr, size_t length ) {
+	return linux_syscall ( __NR_munmap, ( long ) addr, length,
+			       0, 0, 0, 0 );
+}
+
+static inline long linux_nanosleep ( const struct linux_timespec *req,
+				     struct linux_timespec *rem ) {
+	return linux_syscall ( __NR_nanosleep, ( long ) req, ( long ) rem,
+			       0, 0, 0, 0 );
+}
+
+static inline long linux_clock_gettime ( int clk_id,
+					 struct linux_timespec *tp ) {
+	return linux_syscall ( __NR_clock_gettime, clk_id, ( long ) tp,
+			       0, 0, 0, 0 );
+}
+
+static inline void __attribute__ (( noreturn )) linux_exit ( int status ) {
+	linux_syscall ( __NR_exit_group, status, 0, 0, 0, 0, 0 );
+	while ( 1 ) {}
+}
+
+#endif /* _LINUX_API_H */
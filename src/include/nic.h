@@ -55,6 +55,8 @@ struct nic_operations {
 	void ( *transmit ) ( struct nic *, const char *,
 			     unsigned int, unsigned int, const char * );
 	void ( *irq ) ( struct nic *, irq_action_t );
+	/* Optional; if absent, link is assumed to be always up */
+	int ( *link ) ( struct nic * );
 };
 
 extern struct nic nic;
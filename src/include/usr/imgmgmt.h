@@ -10,9 +10,13 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 struct image;
+struct bgjob;
 
 extern int imgfetch ( struct image *image, const char *uri_string,
 		      int ( * image_register ) ( struct image *image ) );
+extern int imgfetch_background ( struct image *image, const char *uri_string,
+				 int ( * image_register ) ( struct image *image ),
+				 struct bgjob **bgjob );
 extern int imgload ( struct image *image );
 extern int imgexec ( struct image *image );
 extern struct image * imgautoselect ( void );
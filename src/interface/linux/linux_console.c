@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stddef.h>
+#include <console.h>
+#include <gpxe/init.h>
+#include <linux_api.h>
+
+/** @file
+ *
+ * Linux userspace console
+ *
+ * The console uses the process's standard input and output.  If
+ * standard input is a terminal, it is switched into raw mode for as
+ * long as gPXE is running, so that keys (including Ctrl-C) are passed
+ * through immediately.
+ */
+
+/** Standard input file descriptor */
+#define LINUX_STDIN 0
+
+/** Standard output file descriptor */
+#define LINUX_STDOUT 1
+
+/** Original terminal configuration */
+static struct linux_termios linux_saved_termios;
+
+/** Terminal configuration has been modified */
+static int linux_termios_modified;
+
+/** Standard input has reached end of file */
+static int linux_stdin_eof;
+
+/**
+ * Write a character to the Linux console
+ *
+ * @v character		Character to be written
+ */
+static void linux_putchar ( int character ) {
+	char c = character;
+
+	/* Translate line endings if we are driving a raw terminal */
+	if ( ( character == '\n' ) && linux_termios_modified )
+		linux_putchar ( '\r' );
+	linux_write ( LINUX_STDOUT, &c, sizeof ( c ) );
+}
+
+/**
+ * Get character from Linux console
+ *
+ * @ret character	Character read from console
+ */
+static int linux_getchar ( void ) {
+	unsigned char c;
+
+	if ( linux_read ( LINUX_STDIN, &c, sizeof ( c ) ) != sizeof ( c ) ) {
+		linux_stdin_eof = 1;
+		return 0;
+	}
+	return c;
+}
+
+/**
+ * Check for character ready to read from Linux console
+ *
+ * @ret True		Character available to read
+ * @ret False		No character available to read
+ */
+static int linux_iskey ( void ) {
+	struct linux_pollfd pollfd;
+
+	if ( linux_stdin_eof )
+		return 0;
+	pollfd.fd = LINUX_STDIN;
+	pollfd.events = LINUX_POLLIN;
+	pollfd.revents = 0;
+	return ( linux_poll ( &pollfd, 1, 0 ) > 0 );
+}
+
+struct console_driver linux_console __console_driver = {
+	.putchar = linux_putchar,
+	.getchar = linux_getchar,
+	.iskey = linux_iskey,
+};
+
+/**
+ * Switch terminal into raw mode
+ *
+ */
+static void linux_console_startup ( void ) {
+	struct linux_termios raw;
+
+	/* Do nothing if standard input is not a terminal */
+	if ( linux_ioctl ( LINUX_STDIN, LINUX_TCGETS,
+			   &linux_saved_termios ) != 0 )
+		return;
+
+	raw = linux_saved_termios;
+	raw.c_iflag &= ~LINUX_ICRNL;
+	raw.c_lflag &= ~( LINUX_ISIG | LINUX_ICANON | LINUX_ECHO );
+	raw.c_cc[LINUX_VMIN] = 1;
+	raw.c_cc[LINUX_VTIME] = 0;
+	if ( linux_ioctl ( LINUX_STDIN, LINUX_TCSETS, &raw ) != 0 )
+		return;
+	linux_termios_modified = 1;
+}
+
+/**
+ * Restore original terminal configuration
+ *
+ * @v flags		Shutdown flags
+ */
+static void linux_console_shutdown ( int flags __unused ) {
+
+	if ( ! linux_termios_modified )
+		return;
+	linux_ioctl ( LINUX_STDIN, LINUX_TCSETS, &linux_saved_termios );
+	linux_termios_modified = 0;
+}
+
+/** Linux console startup function */
+struct startup_fn linux_console_startup_fn __startup_fn ( STARTUP_EARLY ) = {
+	.startup = linux_console_startup,
+	.shutdown = linux_console_shutdown,
+};
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <gpxe/nap.h>
+#include <linux_api.h>
+
+/** @file
+ *
+ * gPXE CPU sleeping API for Linux userspace
+ *
+ */
+
+/** Maximum time to sleep, in milliseconds */
+#define LINUX_NAP_MS 1
+
+/**
+ * Sleep until something happens
+ *
+ * We wait for input on the console (or for the maximum nap time to
+ * expire, so that network devices continue to be polled).
+ */
+static void linux_cpu_nap ( void ) {
+	struct linux_pollfd pollfd;
+
+	pollfd.fd = 0;
+	pollfd.events = LINUX_POLLIN;
+	pollfd.revents = 0;
+	linux_poll ( &pollfd, 1, LINUX_NAP_MS );
+}
+
+PROVIDE_NAP ( linux, cpu_nap, linux_cpu_nap );
+PROVIDE_NAP_INLINE ( linux, nap_irq_hook );
+PROVIDE_NAP_INLINE ( linux, nap_irq_unhook );
+PROVIDE_NAP_INLINE ( linux, nap_irq_triggered );
+PROVIDE_NAP_INLINE ( linux, nap_irq_rearm );
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <errno.h>
+#include <gpxe/smbios.h>
+
+/** @file
+ *
+ * gPXE SMBIOS API for Linux userspace
+ *
+ */
+
+/**
+ * Find SMBIOS
+ *
+ * @v smbios		SMBIOS entry point descriptor structure to fill in
+ * @ret rc		Return status code
+ *
+ * The host's SMBIOS is not accessible to an unprivileged process, so
+ * no SMBIOS is ever found.
+ */
+static int linux_find_smbios ( struct smbios *smbios __unused ) {
+
+	DBG ( "No SMBIOS available in Linux userspace\n" );
+	return -ENODEV;
+}
+
+PROVIDE_SMBIOS ( linux, find_smbios, linux_find_smbios );
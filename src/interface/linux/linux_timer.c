@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <gpxe/timer.h>
+#include <linux_api.h>
+
+/** @file
+ *
+ * gPXE timer API for Linux userspace
+ *
+ * The timer is backed by the host's monotonic clock, with a
+ * resolution of one microsecond.
+ */
+
+/** Number of ticks per second */
+#define LINUX_TICKS_PER_SEC 1000000UL
+
+/**
+ * Delay for a fixed number of microseconds
+ *
+ * @v usecs		Number of microseconds for which to delay
+ */
+static void linux_udelay ( unsigned long usecs ) {
+	struct linux_timespec delay;
+	struct linux_timespec remaining;
+
+	delay.tv_sec = ( usecs / LINUX_TICKS_PER_SEC );
+	delay.tv_nsec = ( ( usecs % LINUX_TICKS_PER_SEC ) * 1000 );
+	while ( linux_nanosleep ( &delay, &remaining ) == -LINUX_EINTR )
+		delay = remaining;
+}
+
+/**
+ * Get current system time in ticks
+ *
+ * @ret ticks		Current time, in ticks
+ */
+static unsigned long linux_currticks ( void ) {
+	struct linux_timespec now;
+
+	if ( linux_clock_gettime ( LINUX_CLOCK_MONOTONIC, &now ) != 0 )
+		return 0;
+	return ( ( now.tv_sec * LINUX_TICKS_PER_SEC ) +
+		 ( now.tv_nsec / 1000 ) );
+}
+
+/**
+ * Get number of ticks per second
+ *
+ * @ret ticks_per_sec	Number of ticks per second
+ */
+static unsigned long linux_ticks_per_sec ( void ) {
+	return LINUX_TICKS_PER_SEC;
+}
+
+PROVIDE_TIMER ( linux, udelay, linux_udelay );
+PROVIDE_TIMER ( linux, currticks, linux_currticks );
+PROVIDE_TIMER ( linux, ticks_per_sec, linux_ticks_per_sec );
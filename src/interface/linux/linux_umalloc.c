@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <gpxe/umalloc.h>
+#include <linux_api.h>
+
+/** @file
+ *
+ * gPXE user memory allocation API for Linux userspace
+ *
+ * External memory is allocated as anonymous mappings, which allows
+ * large images to grow via mremap() without copying.  The size of
+ * each block is recorded in a header page preceding the block, so
+ * that the returned memory remains page-aligned.
+ */
+
+/** Equivalent of NOWHERE for user pointers */
+#define UNOWHERE ( ~UNULL )
+
+/** Size of block header */
+#define LINUX_UMALLOC_HEADER 4096
+
+/**
+ * Reallocate external memory
+ *
+ * @v old_ptr		Memory previously allocated by umalloc(), or UNULL
+ * @v new_size		Requested size
+ * @ret new_ptr		Allocated memory, or UNULL
+ *
+ * Calling realloc() with a new size of zero is a valid way to free a
+ * memory block.
+ */
+static userptr_t linux_urealloc ( userptr_t old_ptr, size_t new_size ) {
+	size_t *old_block = NULL;
+	size_t *new_block;
+	size_t old_len = 0;
+	size_t new_len = ( LINUX_UMALLOC_HEADER + new_size );
+
+	/* Locate old block, if any */
+	if ( old_ptr && ( old_ptr != UNOWHERE ) ) {
+		old_block = user_to_virt ( old_ptr, -LINUX_UMALLOC_HEADER );
+		old_len = ( LINUX_UMALLOC_HEADER + *old_block );
+	}
+
+	/* Free old block if asked to do so */
+	if ( ! new_size ) {
+		if ( old_block ) {
+			linux_munmap ( old_block, old_len );
+			DBG ( "Linux freed %zd bytes at %p\n",
+			      old_len, old_block );
+		}
+		return UNOWHERE;
+	}
+
+	/* Allocate or resize block */
+	if ( old_block ) {
+		new_block = linux_mremap ( old_block, old_len, new_len,
+					   LINUX_MREMAP_MAYMOVE );
+	} else {
+		new_block = linux_mmap ( NULL, new_len,
+					 ( LINUX_PROT_READ | LINUX_PROT_WRITE ),
+					 ( LINUX_MAP_PRIVATE |
+					   LINUX_MAP_ANONYMOUS ), -1, 0 );
+	}
+	if ( linux_is_error ( ( long ) new_block ) ) {
+		DBG ( "Linux could not allocate %zd bytes: error %ld\n",
+		      new_len, -( ( long ) new_block ) );
+		return UNULL;
+	}
+	*new_block = new_size;
+	DBG ( "Linux allocated %zd bytes at %p\n", new_len, new_block );
+
+	return virt_to_user ( ( ( void * ) new_block ) +
+			      LINUX_UMALLOC_HEADER );
+}
+
+PROVIDE_UMALLOC ( linux, urealloc, linux_urealloc );
@@ -115,8 +115,8 @@ static int aoe_send_command ( struct aoe_session *aoe ) {
 	switch ( aoe->aoe_cmd_type ) {
 	case AOE_CMD_ATA:
 		count = command->cb.count.native;
-		if ( count > AOE_MAX_COUNT )
-			count = AOE_MAX_COUNT;
+		if ( count > aoe->max_count )
+			count = aoe->max_count;
 		data_out_len = ( command->data_out ?
 				 ( count * ATA_SECTOR_SIZE ) : 0 );
 		aoecmdlen = sizeof ( aoecmd->ata );
@@ -203,16 +203,39 @@ static void aoe_timer_expired ( struct retry_timer *timer, int fail ) {
  * Handle AoE configuration command response
  *
  * @v aoe		AoE session
+ * @v aoecfg		AoE config command
+ * @v len		Length of AoE config command
  * @v ll_source		Link-layer source address
  * @ret rc		Return status code
  */
-static int aoe_rx_cfg ( struct aoe_session *aoe, const void *ll_source ) {
+static int aoe_rx_cfg ( struct aoe_session *aoe, struct aoecfg *aoecfg,
+			size_t len, const void *ll_source ) {
+	size_t max_data_len;
+	unsigned int max_count;
 
 	/* Record target MAC address */
 	memcpy ( aoe->target, ll_source, sizeof ( aoe->target ) );
 	DBGC ( aoe, "AoE %p target MAC address %s\n",
 	       aoe, eth_ntoa ( aoe->target ) );
 
+	/* Send as many sectors per command as will fit within the
+	 * network device's MTU, limited by the sector count
+	 * advertised by the target (if any).
+	 */
+	max_data_len = ( aoe->netdev->mtu - sizeof ( struct aoehdr ) -
+			 sizeof ( struct aoeata ) );
+	max_count = ( max_data_len / ATA_SECTOR_SIZE );
+	if ( ( len >= sizeof ( *aoecfg ) ) && aoecfg->scnt &&
+	     ( max_count > aoecfg->scnt ) )
+		max_count = aoecfg->scnt;
+	if ( max_count > 0xff )
+		max_count = 0xff;
+	if ( max_count ) {
+		aoe->max_count = max_count;
+		DBGC ( aoe, "AoE %p using %d sectors per command\n",
+		       aoe, aoe->max_count );
+	}
+
 	/* Mark config request as complete */
 	aoe_done ( aoe, 0 );
 
@@ -243,8 +266,8 @@ static int aoe_rx_ata ( struct aoe_session *aoe, struct aoeata *aoeata,
 
 	/* Calculate count and data_len for this subcommand */
 	count = command->cb.count.native;
-	if ( count > AOE_MAX_COUNT )
-		count = AOE_MAX_COUNT;
+	if ( count > aoe->max_count )
+		count = aoe->max_count;
 	data_len = count * ATA_SECTOR_SIZE;
 
 	/* Merge into overall ATA status */
@@ -324,7 +347,8 @@ static int aoe_rx ( struct io_buffer *iobuf,
 			rc = aoe_rx_ata ( aoe, iobuf->data, iob_len ( iobuf ));
 			break;
 		case AOE_CMD_CONFIG:
-			rc = aoe_rx_cfg ( aoe, ll_source );
+			rc = aoe_rx_cfg ( aoe, iobuf->data, iob_len ( iobuf ),
+					  ll_source );
 			break;
 		default:
 			DBGC ( aoe, "AoE %p ignoring command %02x\n",
@@ -443,6 +467,7 @@ int aoe_attach ( struct ata_device *ata, struct net_device *netdev,
 	aoe->netdev = netdev_get ( netdev );
 	memcpy ( aoe->target, netdev->ll_broadcast, sizeof ( aoe->target ) );
 	aoe->tag = AOE_TAG_MAGIC;
+	aoe->max_count = AOE_MAX_COUNT;
 
 	/* Parse root path */
 	if ( ( rc = aoe_parse_root_path ( aoe, root_path ) ) != 0 )
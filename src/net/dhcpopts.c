@@ -91,6 +91,67 @@ static unsigned int dhcp_option_len ( struct dhcp_option *option ) {
 	}
 }
 
+/**
+ * Build index of top-level DHCP options
+ *
+ * @v options		DHCP options block
+ *
+ * The index records the offset of the first instance of each
+ * top-level option, so that repeated lookups within a DHCP packet
+ * (e.g. when fetching settings from a registered DHCP packet) do not
+ * need to walk the option list from the start each time.
+ */
+static void dhcpopt_build_index ( struct dhcp_options *options ) {
+	struct dhcp_option *option;
+	int offset = 0;
+	ssize_t remaining = options->len;
+	unsigned int option_len;
+	int index_len = 0;
+
+	while ( remaining ) {
+		option = dhcp_option ( options, offset );
+		option_len = dhcp_option_len ( option );
+		remaining -= option_len;
+		if ( ( remaining < 0 ) || ( option->tag == DHCP_END ) )
+			break;
+		if ( ( option->tag != DHCP_PAD ) &&
+		     ( memchr ( options->index_tag, option->tag,
+				index_len ) == NULL ) ) {
+			if ( index_len == DHCP_OPTION_INDEX_MAX ) {
+				index_len = DHCP_OPTION_INDEX_FULL;
+				break;
+			}
+			options->index_tag[index_len] = option->tag;
+			options->index_offset[index_len] = offset;
+			index_len++;
+		}
+		offset += option_len;
+	}
+	options->index_len = index_len;
+
+	DBGC2 ( options, "DHCPOPT %p indexed %d options\n",
+		options, index_len );
+}
+
+/**
+ * Find top-level DHCP option using index
+ *
+ * @v options		DHCP options block
+ * @v tag		DHCP option tag (not encapsulated)
+ * @ret offset		Offset of DHCP option, or negative error
+ */
+static int dhcpopt_find_indexed ( struct dhcp_options *options,
+				  unsigned int tag ) {
+	uint8_t *found;
+
+	if ( tag > 0xff )
+		return -ENOENT;
+	found = memchr ( options->index_tag, tag, options->index_len );
+	if ( ! found )
+		return -ENOENT;
+	return options->index_offset[ found - options->index_tag ];
+}
+
 /**
  * Find DHCP option within DHCP options block, and its encapsulator (if any)
  *
@@ -124,6 +185,32 @@ static int find_dhcp_option_with_encap ( struct dhcp_options *options,
 	if ( tag == DHCP_PAD )
 		return -ENOENT;
 
+	/* Use index to locate top-level option (or encapsulator), if
+	 * an up-to-date index is available.
+	 */
+	if ( ( options->index_len >= 0 ) && ( tag != DHCP_END ) ) {
+		offset = dhcpopt_find_indexed ( options,
+						( DHCP_IS_ENCAP_OPT ( tag ) ?
+						  DHCP_ENCAPSULATOR ( tag ) :
+						  tag ) );
+		if ( offset < 0 )
+			return offset;
+		option = dhcp_option ( options, offset );
+		option_len = dhcp_option_len ( option );
+		if ( ! DHCP_IS_ENCAP_OPT ( tag ) ) {
+			DBGC ( options, "DHCPOPT %p found %s (length %d)\n",
+			       options, dhcp_tag_name ( original_tag ),
+			       option_len );
+			return offset;
+		}
+		if ( encap_offset )
+			*encap_offset = offset;
+		/* Continue search within encapsulated option block */
+		tag = DHCP_ENCAPSULATED ( tag );
+		remaining = option_len;
+		offset += DHCP_OPTION_HEADER_LEN;
+	}
+
 	/* Search for option */
 	while ( remaining ) {
 		/* Calculate length of this option.  Abort processing
@@ -194,6 +281,9 @@ static int resize_dhcp_option ( struct dhcp_options *options,
 	void *dest;
 	void *end;
 
+	/* Any resize invalidates the option index */
+	options->index_len = DHCP_OPTION_INDEX_STALE;
+
 	/* Check for sufficient space, and update length fields */
 	if ( new_len > DHCP_MAX_LEN ) {
 		DBGC ( options, "DHCPOPT %p overlength option\n", options );
@@ -381,6 +471,10 @@ int dhcpopt_fetch ( struct dhcp_options *options, unsigned int tag,
 	struct dhcp_option *option;
 	size_t option_len;
 
+	/* Rebuild option index, if necessary */
+	if ( options->index_len == DHCP_OPTION_INDEX_STALE )
+		dhcpopt_build_index ( options );
+
 	offset = find_dhcp_option_with_encap ( options, tag, NULL );
 	if ( offset < 0 )
 		return offset;
@@ -438,6 +532,7 @@ void dhcpopt_init ( struct dhcp_options *options, void *data,
 	/* Fill in fields */
 	options->data = data;
 	options->max_len = max_len;
+	options->index_len = DHCP_OPTION_INDEX_STALE;
 
 	/* Update length */
 	dhcpopt_update_len ( options );
@@ -225,7 +225,7 @@ int icmp6_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 		rc = ndp_process_nsolicit ( iobuf, st_src, st_dest, netdev, icmp6_net_protocol );
 		break;
 	case ICMP6_NADVERT:
-		rc = ndp_process_nadvert ( iobuf, st_src, st_dest, icmp6_net_protocol );
+		rc = ndp_process_nadvert ( iobuf, st_src, st_dest, netdev, icmp6_net_protocol );
 		break;
 	case ICMP6_ECHO_REQUEST:
 		rc = icmp6_handle_echo ( iobuf, st_src, st_dest, icmp6_net_protocol );
@@ -0,0 +1,652 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <gpxe/iobuf.h>
+#include <gpxe/timer.h>
+#include <gpxe/netdevice.h>
+#include <gpxe/impairnet.h>
+
+/** @file
+ *
+ * Impaired network devices
+ *
+ * An impaired network device applies a reproducible pattern of
+ * loss, duplication, reordering, delay and rate limiting to the
+ * frames passing through an existing network device, in both
+ * directions.  This allows the behaviour of protocols under adverse
+ * network conditions to be measured repeatably, either on a real
+ * network device or on a loopback device connected to stand-in
+ * servers within the same process.
+ *
+ */
+
+/****************************************************************************
+ *
+ * Impairment queues
+ *
+ */
+
+/** A frame held by an impairment queue */
+struct impair_frame {
+	/** List of frames held by the impairment queue */
+	struct list_head list;
+	/** I/O buffer */
+	struct io_buffer *iobuf;
+	/** Delivery time, in microseconds */
+	uint64_t due;
+};
+
+/**
+ * Get current time
+ *
+ * @ret now		Current time, in microseconds
+ */
+static uint64_t impair_now ( void ) {
+	return ( ( ( uint64_t ) currticks() * 1000000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Generate pseudo-random number
+ *
+ * @v queue		Impairment queue
+ * @ret random		Pseudo-random number in the range [0,32767]
+ */
+static unsigned int impair_random ( struct impair_queue *queue ) {
+
+	queue->random = ( ( queue->random * 1103515245UL ) + 12345 );
+	return ( ( queue->random >> 16 ) & 0x7fff );
+}
+
+/**
+ * Make pseudo-random decision
+ *
+ * @v queue		Impairment queue
+ * @v probability	Probability, in parts per thousand
+ * @ret happens		Event happens
+ */
+static int impair_chance ( struct impair_queue *queue,
+			   unsigned int probability ) {
+
+	if ( ! probability )
+		return 0;
+	return ( ( ( impair_random ( queue ) * 1000 ) >> 15 ) < probability );
+}
+
+/**
+ * Find network impairment profile
+ *
+ * @v name		Name
+ * @ret impairment	Network impairment profile, or NULL
+ */
+struct impairment * find_impairment ( const char *name ) {
+	struct impairment *impairment;
+
+	for_each_table_entry ( impairment, IMPAIRMENTS ) {
+		if ( strcmp ( impairment->name, name ) == 0 )
+			return impairment;
+	}
+	return NULL;
+}
+
+/**
+ * Initialise impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v impairment	Network impairment profile
+ * @v op		Queue operations
+ * @v seed		Seed for pseudo-random decisions
+ */
+void impair_init ( struct impair_queue *queue, struct impairment *impairment,
+		   struct impair_queue_operations *op, unsigned long seed ) {
+
+	memset ( queue, 0, sizeof ( *queue ) );
+	queue->impairment = impairment;
+	queue->op = op;
+	INIT_LIST_HEAD ( &queue->frames );
+	queue->random = seed;
+}
+
+/**
+ * Schedule frame for delivery
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ */
+static void impair_schedule ( struct impair_queue *queue,
+			      struct io_buffer *iobuf ) {
+	struct impairment *impairment = queue->impairment;
+	struct impair_frame *frame;
+	struct impair_frame *pos;
+	uint64_t now = impair_now();
+	uint64_t due;
+
+	/* Drop frame if queue is full */
+	if ( queue->count >= IMPAIR_MAX_FRAMES ) {
+		queue->stats.overflowed++;
+		queue->op->discard ( queue, iobuf, -ENOBUFS );
+		return;
+	}
+
+	/* Allocate frame descriptor */
+	frame = malloc ( sizeof ( *frame ) );
+	if ( ! frame ) {
+		queue->op->discard ( queue, iobuf, -ENOMEM );
+		return;
+	}
+	frame->iobuf = iobuf;
+
+	/* Serialise frame onto the link */
+	if ( queue->idle < now )
+		queue->idle = now;
+	if ( impairment->rate ) {
+		queue->idle += ( ( ( uint64_t ) iob_len ( iobuf ) * 1000000 ) /
+				 impairment->rate );
+	}
+
+	/* Apply delay and jitter */
+	due = ( queue->idle + ( impairment->delay * 1000ULL ) );
+	if ( impairment->jitter ) {
+		due += ( ( ( uint64_t ) impair_random ( queue ) *
+			   impairment->jitter * 1000 ) >> 15 );
+	}
+
+	/* Hold frame back behind its successors, or ensure that it
+	 * does not overtake its predecessors.
+	 */
+	if ( impair_chance ( queue, impairment->reorder ) ) {
+		due += ( IMPAIR_REORDER_DELAY * 1000 );
+		queue->stats.reordered++;
+	} else {
+		if ( due < queue->last )
+			due = queue->last;
+		queue->last = due;
+	}
+	frame->due = due;
+
+	/* Insert after all frames due no later than this frame */
+	list_for_each_entry_reverse ( pos, &queue->frames, list ) {
+		if ( pos->due <= due )
+			break;
+	}
+	list_add ( &frame->list, &pos->list );
+	queue->count++;
+}
+
+/**
+ * Add frame to impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ *
+ * This function takes ownership of the I/O buffer.
+ */
+void impair_enqueue ( struct impair_queue *queue, struct io_buffer *iobuf ) {
+	struct impairment *impairment = queue->impairment;
+	struct io_buffer *copy = NULL;
+	size_t len = iob_len ( iobuf );
+
+	/* Lose frame */
+	if ( impair_chance ( queue, impairment->loss ) ) {
+		queue->stats.lost++;
+		queue->op->discard ( queue, iobuf, 0 );
+		return;
+	}
+
+	/* Duplicate frame */
+	if ( impair_chance ( queue, impairment->duplicate ) ) {
+		copy = alloc_iob ( len );
+		if ( copy ) {
+			memcpy ( iob_put ( copy, len ), iobuf->data, len );
+			queue->stats.duplicated++;
+		}
+	}
+
+	/* Schedule frame(s) for delivery */
+	impair_schedule ( queue, iobuf );
+	if ( copy )
+		impair_schedule ( queue, copy );
+}
+
+/**
+ * Deliver any frames now due from impairment queue
+ *
+ * @v queue		Impairment queue
+ */
+void impair_poll ( struct impair_queue *queue ) {
+	struct impair_frame *frame;
+	struct io_buffer *iobuf;
+	uint64_t now;
+
+	if ( list_empty ( &queue->frames ) )
+		return;
+	now = impair_now();
+
+	while ( ! list_empty ( &queue->frames ) ) {
+		frame = list_entry ( queue->frames.next, struct impair_frame,
+				     list );
+		if ( frame->due > now )
+			break;
+		list_del ( &frame->list );
+		queue->count--;
+		iobuf = frame->iobuf;
+		free ( frame );
+		queue->stats.delivered++;
+		queue->op->deliver ( queue, iobuf );
+	}
+}
+
+/**
+ * Discard all frames held by impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v rc		Reason for discard
+ */
+void impair_flush ( struct impair_queue *queue, int rc ) {
+	struct impair_frame *frame;
+	struct impair_frame *tmp;
+
+	list_for_each_entry_safe ( frame, tmp, &queue->frames, list ) {
+		list_del ( &frame->list );
+		queue->count--;
+		queue->op->discard ( queue, frame->iobuf, rc );
+		free ( frame );
+	}
+}
+
+/****************************************************************************
+ *
+ * Impaired network devices
+ *
+ */
+
+/** List of impaired network devices */
+static LIST_HEAD ( impairnets );
+
+/**
+ * Find impaired network device
+ *
+ * @v netdev		Network device
+ * @ret impairnet	Impaired network device, or NULL
+ */
+struct impairnet * find_impairnet ( struct net_device *netdev ) {
+	struct impairnet *impairnet;
+
+	list_for_each_entry ( impairnet, &impairnets, list ) {
+		if ( impairnet->netdev == netdev )
+			return impairnet;
+	}
+	return NULL;
+}
+
+/**
+ * Update count of frames held by impaired network device
+ *
+ * @v impairnet		Impaired network device
+ *
+ * The network stack treats a device holding frames as having work
+ * pending, so that held frames are released when due rather than at
+ * the next periodic poll of an interrupt-driven device.
+ */
+static void impairnet_update_held ( struct impairnet *impairnet ) {
+
+	impairnet->netdev->held = ( impairnet->tx.count + impairnet->rx.count );
+}
+
+/**
+ * Return frame to network device's transmit queue
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ *
+ * Frames are removed from the transmit queue list while they are
+ * held by the transmit impairment queue, so that drivers which
+ * complete transmissions in order never see a frame that has not yet
+ * been handed to them.  They remain counted as queued throughout, so
+ * that the queue statistics record each frame exactly once.
+ */
+static void impairnet_tx_requeue ( struct net_device *netdev,
+				   struct io_buffer *iobuf ) {
+
+	list_add_tail ( &iobuf->list, &netdev->tx_queue );
+}
+
+/**
+ * Deliver frame from transmit impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ */
+static void impairnet_tx_deliver ( struct impair_queue *queue,
+				   struct io_buffer *iobuf ) {
+	struct impairnet *impairnet =
+		container_of ( queue, struct impairnet, tx );
+	struct net_device *netdev = impairnet->netdev;
+	int rc;
+
+	impairnet_tx_requeue ( netdev, iobuf );
+	if ( ( rc = impairnet->op->transmit ( netdev, iobuf ) ) != 0 )
+		netdev_tx_complete_err ( netdev, iobuf, rc );
+}
+
+/**
+ * Discard frame from transmit impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ * @v rc		Reason for discard, or zero if the frame was lost
+ *
+ * A frame lost on the wire appears to the sender to have been
+ * transmitted successfully.
+ */
+static void impairnet_tx_discard ( struct impair_queue *queue,
+				   struct io_buffer *iobuf, int rc ) {
+	struct impairnet *impairnet =
+		container_of ( queue, struct impairnet, tx );
+	struct net_device *netdev = impairnet->netdev;
+
+	impairnet_tx_requeue ( netdev, iobuf );
+	netdev_tx_complete_err ( netdev, iobuf, rc );
+}
+
+/** Transmit impairment queue operations */
+static struct impair_queue_operations impairnet_tx_operations = {
+	.deliver	= impairnet_tx_deliver,
+	.discard	= impairnet_tx_discard,
+};
+
+/**
+ * Deliver frame from receive impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ */
+static void impairnet_rx_deliver ( struct impair_queue *queue,
+				   struct io_buffer *iobuf ) {
+	struct impairnet *impairnet =
+		container_of ( queue, struct impairnet, rx );
+
+	netdev_rx ( impairnet->netdev, iobuf );
+}
+
+/**
+ * Discard frame from receive impairment queue
+ *
+ * @v queue		Impairment queue
+ * @v iobuf		I/O buffer
+ * @v rc		Reason for discard, or zero if the frame was lost
+ *
+ * A frame lost on the wire is never seen by the receiver.
+ */
+static void impairnet_rx_discard ( struct impair_queue *queue,
+				   struct io_buffer *iobuf, int rc ) {
+	struct impairnet *impairnet =
+		container_of ( queue, struct impairnet, rx );
+
+	if ( rc == 0 ) {
+		free_iob ( iobuf );
+	} else {
+		netdev_rx_err ( impairnet->netdev, iobuf, rc );
+	}
+}
+
+/** Receive impairment queue operations */
+static struct impair_queue_operations impairnet_rx_operations = {
+	.deliver	= impairnet_rx_deliver,
+	.discard	= impairnet_rx_discard,
+};
+
+/**
+ * Open impaired network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int impairnet_open ( struct net_device *netdev ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+
+	return impairnet->op->open ( netdev );
+}
+
+/**
+ * Close impaired network device
+ *
+ * @v netdev		Network device
+ */
+static void impairnet_close ( struct net_device *netdev ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+
+	impair_flush ( &impairnet->tx, -ECANCELED );
+	impair_flush ( &impairnet->rx, -ECANCELED );
+	impairnet_update_held ( impairnet );
+	impairnet->op->close ( netdev );
+}
+
+/**
+ * Transmit packet via impaired network device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ */
+static int impairnet_transmit ( struct net_device *netdev,
+				struct io_buffer *iobuf ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+
+	/* Hold frame outside the transmit queue until it is released
+	 * to the underlying driver.
+	 */
+	list_del ( &iobuf->list );
+	impair_enqueue ( &impairnet->tx, iobuf );
+	impairnet_update_held ( impairnet );
+
+	return 0;
+}
+
+/**
+ * Poll impaired network device
+ *
+ * @v netdev		Network device
+ */
+static void impairnet_poll ( struct net_device *netdev ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+	struct net_device_stats *stats = &netdev->rx_stats;
+	unsigned int occupancy[NETDEV_OCCUPANCY_BUCKETS];
+	unsigned int max_queued = stats->max_queued;
+	unsigned int good = stats->good;
+	unsigned long bytes = stats->bytes;
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	LIST_HEAD ( released );
+
+	/* Set aside any frames already released to the network
+	 * stack, so that only newly received frames are impaired.
+	 */
+	list_for_each_entry_safe ( iobuf, tmp, &netdev->rx_queue, list ) {
+		list_del ( &iobuf->list );
+		list_add_tail ( &iobuf->list, &released );
+	}
+
+	/* Poll underlying device, diverting newly received frames
+	 * into the receive impairment queue.  The frames have not
+	 * yet arrived as far as the network stack is concerned, so
+	 * the statistics recorded for them by netdev_rx() are undone;
+	 * they will be recorded when the frames are released.
+	 */
+	memcpy ( occupancy, stats->occupancy, sizeof ( occupancy ) );
+	impairnet->op->poll ( netdev );
+	while ( ( iobuf = netdev_rx_dequeue ( netdev ) ) )
+		impair_enqueue ( &impairnet->rx, iobuf );
+	memcpy ( stats->occupancy, occupancy, sizeof ( stats->occupancy ) );
+	stats->max_queued = max_queued;
+	stats->good = good;
+	stats->bytes = bytes;
+
+	/* Restore frames set aside */
+	list_for_each_entry_safe ( iobuf, tmp, &released, list ) {
+		list_del ( &iobuf->list );
+		list_add_tail ( &iobuf->list, &netdev->rx_queue );
+	}
+
+	/* Release any frames now due */
+	impair_poll ( &impairnet->tx );
+	impair_poll ( &impairnet->rx );
+	impairnet_update_held ( impairnet );
+}
+
+/**
+ * Enable or disable interrupts
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void impairnet_irq ( struct net_device *netdev, int enable ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+
+	impairnet->op->irq ( netdev, enable );
+}
+
+/** Impaired network device operations */
+static struct net_device_operations impairnet_operations = {
+	.open		= impairnet_open,
+	.close		= impairnet_close,
+	.transmit	= impairnet_transmit,
+	.poll		= impairnet_poll,
+	.irq		= impairnet_irq,
+};
+
+/**
+ * Impair network device
+ *
+ * @v netdev		Network device
+ * @v impairment	Network impairment profile
+ * @v seed		Seed for pseudo-random decisions
+ * @ret rc		Return status code
+ *
+ * Any existing impairment is replaced.  The transmit and receive
+ * directions are impaired independently, using different
+ * pseudo-random sequences derived from the same seed.
+ */
+int impair_netdev ( struct net_device *netdev, struct impairment *impairment,
+		    unsigned long seed ) {
+	struct impairnet *impairnet;
+
+	/* Remove any existing impairment */
+	unimpair_netdev ( netdev );
+
+	/* Allocate and initialise structure */
+	impairnet = zalloc ( sizeof ( *impairnet ) );
+	if ( ! impairnet )
+		return -ENOMEM;
+	impairnet->netdev = netdev_get ( netdev );
+	impairnet->op = netdev->op;
+	impair_init ( &impairnet->tx, impairment, &impairnet_tx_operations,
+		      seed );
+	impair_init ( &impairnet->rx, impairment, &impairnet_rx_operations,
+		      ~seed );
+
+	/* Interpose on network device operations */
+	list_add ( &impairnet->list, &impairnets );
+	netdev->op = &impairnet_operations;
+	DBGC ( impairnet, "IMPAIRNET %p impairing %s as \"%s\" (seed %ld)\n",
+	       impairnet, netdev->name, impairment->name, seed );
+
+	return 0;
+}
+
+/**
+ * Stop impairing network device
+ *
+ * @v netdev		Network device
+ *
+ * Any frames still held by the impairment queues are discarded.
+ */
+void unimpair_netdev ( struct net_device *netdev ) {
+	struct impairnet *impairnet = find_impairnet ( netdev );
+
+	if ( ! impairnet )
+		return;
+
+	DBGC ( impairnet, "IMPAIRNET %p no longer impairing %s\n",
+	       impairnet, netdev->name );
+	impair_flush ( &impairnet->tx, -ECANCELED );
+	impair_flush ( &impairnet->rx, -ECANCELED );
+	netdev->held = 0;
+	netdev->op = impairnet->op;
+	list_del ( &impairnet->list );
+	netdev_put ( netdev );
+	free ( impairnet );
+}
+
+/****************************************************************************
+ *
+ * Network impairment profiles
+ *
+ */
+
+/** Unimpaired link
+ *
+ * This measures the overhead of the impairment mechanism itself.
+ */
+struct impairment none_impairment __impairment = {
+	.name = "none",
+};
+
+/** Link with occasional loss */
+struct impairment lossy_impairment __impairment = {
+	.name = "lossy",
+	.loss = 10,
+};
+
+/** Link with frequent reordering */
+struct impairment reorder_impairment __impairment = {
+	.name = "reorder",
+	.reorder = 50,
+	.delay = 2,
+	.jitter = 2,
+};
+
+/** Link with frequent duplication */
+struct impairment duplicate_impairment __impairment = {
+	.name = "duplicate",
+	.duplicate = 50,
+};
+
+/** Wide-area link */
+struct impairment wan_impairment __impairment = {
+	.name = "wan",
+	.delay = 40,
+	.jitter = 5,
+	.rate = 2500000,
+};
+
+/** Link exhibiting every kind of impairment */
+struct impairment hostile_impairment __impairment = {
+	.name = "hostile",
+	.loss = 30,
+	.duplicate = 10,
+	.reorder = 30,
+	.delay = 20,
+	.jitter = 10,
+	.rate = 500000,
+};
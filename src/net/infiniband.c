@@ -49,6 +49,13 @@ struct list_head ib_devices = LIST_HEAD_INIT ( ib_devices );
 /** List of open Infiniband devices, in reverse order of opening */
 static struct list_head open_ib_devices = LIST_HEAD_INIT ( open_ib_devices );
 
+/** Number of work queue entries completed
+ *
+ * Used by the Infiniband event queue process to detect whether or
+ * not polling found any work to do.
+ */
+static unsigned long ib_completions;
+
 /* Disambiguate the various possible EINPROGRESSes */
 #define EINPROGRESS_INIT __einfo_error ( EINFO_EINPROGRESS_INIT )
 #define EINFO_EINPROGRESS_INIT __einfo_uniqify \
@@ -477,6 +484,7 @@ void ib_complete_send ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 		free_iob ( iobuf );
 	}
 	qp->send.fill--;
+	ib_completions++;
 }
 
 /**
@@ -498,6 +506,7 @@ void ib_complete_recv ( struct ib_device *ibdev, struct ib_queue_pair *qp,
 		free_iob ( iobuf );
 	}
 	qp->recv.fill--;
+	ib_completions++;
 }
 
 /**
@@ -830,18 +839,26 @@ void ib_poll_eq ( struct ib_device *ibdev ) {
  * Single-step the Infiniband event queue
  *
  * @v process		Infiniband event queue process
+ *
+ * If polling found no completions, this will yield the remainder of
+ * the process' turn, so that the CPU may be halted while idle.
  */
-static void ib_step ( struct process *process __unused ) {
+static void ib_step ( struct process *process ) {
 	struct ib_device *ibdev;
+	unsigned long completions = ib_completions;
 
 	for_each_ibdev ( ibdev )
 		ib_poll_eq ( ibdev );
+
+	if ( ib_completions == completions )
+		process_yield ( process );
 }
 
 /** Infiniband event queue process */
 struct process ib_process __permanent_process = {
 	.list = LIST_HEAD_INIT ( ib_process.list ),
 	.step = ib_step,
+	.name = "ib",
 };
 
 /***************************************************************************
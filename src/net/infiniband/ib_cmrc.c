@@ -358,6 +358,7 @@ static struct xfer_interface_operations ib_cmrc_xfer_operations = {
 	.close		= ib_cmrc_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= ib_cmrc_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= ib_cmrc_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -14,6 +14,7 @@
 #include <gpxe/tcpip.h>
 #include <gpxe/dhcp.h>
 #include <gpxe/settings.h>
+#include <gpxe/init.h>
 
 /** @file
  *
@@ -31,7 +32,7 @@ struct net_protocol ipv4_protocol;
 /** List of IPv4 miniroutes */
 struct list_head ipv4_miniroutes = LIST_HEAD_INIT ( ipv4_miniroutes );
 
-/** List of fragment reassembly buffers */
+/** List of fragment reassembly buffers, most recently created first */
 static LIST_HEAD ( frag_buffers );
 
 /**
@@ -133,104 +134,346 @@ static struct ipv4_miniroute * ipv4_route ( struct in_addr *dest ) {
 	return NULL;
 }
 
+/** Fragment reassembly buffer hash buckets */
+static struct list_head frag_hash[IP_FRAG_HASH_SIZE];
+
+/** Total length of fragment data held in all reassembly buffers */
+static size_t frag_mem;
+
+/** Number of fragment reassembly buffers */
+static unsigned int num_frag_buffers;
+
 /**
- * Fragment reassembly counter timeout
+ * Calculate fragment reassembly buffer hash bucket
  *
- * @v timer	Retry timer
- * @v over	If asserted, the timer is greater than @c MAX_TIMEOUT 
+ * @v iphdr		IPv4 header
+ * @ret bucket		Hash bucket
  */
-static void ipv4_frag_expired ( struct retry_timer *timer __unused,
-				int over ) {
-	if ( over ) {
-		DBG ( "Fragment reassembly timeout" );
-		/* Free the fragment buffer */
-	}
+static struct list_head * ipv4_frag_bucket ( struct iphdr *iphdr ) {
+	uint32_t hash = ( ntohl ( iphdr->src.s_addr ) ^ ntohs ( iphdr->ident ) ^
+			  iphdr->protocol );
+
+	hash ^= ( hash >> 16 );
+	hash ^= ( hash >> 8 );
+	return &frag_hash[ hash & ( IP_FRAG_HASH_SIZE - 1 ) ];
 }
 
 /**
- * Free fragment buffer
+ * Free fragment reassembly buffer
  *
- * @v fragbug	Fragment buffer
+ * @v fragbuf		Fragment reassembly buffer
  */
-static void free_fragbuf ( struct frag_buffer *fragbuf ) {
+static void ipv4_frag_free ( struct ipv4_frag_buffer *fragbuf ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp_iobuf;
+	struct ipv4_frag_hole *hole;
+	struct ipv4_frag_hole *tmp_hole;
+
+	stop_timer ( &fragbuf->timer );
+	list_for_each_entry_safe ( iobuf, tmp_iobuf, &fragbuf->fragments,
+				   list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+	}
+	list_for_each_entry_safe ( hole, tmp_hole, &fragbuf->holes, list ) {
+		list_del ( &hole->list );
+		free ( hole );
+	}
+	list_del ( &fragbuf->hash );
+	list_del ( &fragbuf->list );
+	frag_mem -= fragbuf->mem;
+	num_frag_buffers--;
 	free ( fragbuf );
 }
 
+/**
+ * Fragment reassembly timeout
+ *
+ * @v timer		Reassembly timer
+ * @v fail		Failure indicator
+ */
+static void ipv4_frag_expired ( struct retry_timer *timer,
+				int fail __unused ) {
+	struct ipv4_frag_buffer *fragbuf =
+		container_of ( timer, struct ipv4_frag_buffer, timer );
+
+	DBG ( "IPv4 fragment reassembly timeout for id %04x\n",
+	      ntohs ( fragbuf->ident ) );
+	ipv4_frag_free ( fragbuf );
+}
+
+/**
+ * Discard oldest fragment reassembly buffer
+ *
+ * @v keep		Reassembly buffer which must not be discarded
+ * @ret rc		Return status code
+ */
+static int ipv4_frag_discard ( struct ipv4_frag_buffer *keep ) {
+	struct ipv4_frag_buffer *fragbuf;
+
+	list_for_each_entry_reverse ( fragbuf, &frag_buffers, list ) {
+		if ( fragbuf == keep )
+			continue;
+		DBG ( "IPv4 discarding incomplete datagram id %04x\n",
+		      ntohs ( fragbuf->ident ) );
+		ipv4_frag_free ( fragbuf );
+		return 0;
+	}
+	return -ENOBUFS;
+}
+
+/**
+ * Find or create fragment reassembly buffer
+ *
+ * @v iphdr		IPv4 header
+ * @ret fragbuf		Fragment reassembly buffer, or NULL
+ */
+static struct ipv4_frag_buffer * ipv4_frag_find ( struct iphdr *iphdr ) {
+	struct list_head *bucket = ipv4_frag_bucket ( iphdr );
+	struct ipv4_frag_buffer *fragbuf;
+	struct ipv4_frag_hole *hole;
+
+	/* Look for an existing reassembly buffer */
+	list_for_each_entry ( fragbuf, bucket, hash ) {
+		if ( ( fragbuf->ident == iphdr->ident ) &&
+		     ( fragbuf->protocol == iphdr->protocol ) &&
+		     ( fragbuf->src.s_addr == iphdr->src.s_addr ) &&
+		     ( fragbuf->dest.s_addr == iphdr->dest.s_addr ) )
+			return fragbuf;
+	}
+
+	/* Make room for a new reassembly buffer, if necessary */
+	if ( num_frag_buffers >= IP_FRAG_MAX_BUFFERS )
+		ipv4_frag_discard ( NULL );
+
+	/* Create new reassembly buffer with a single infinite hole */
+	fragbuf = zalloc ( sizeof ( *fragbuf ) );
+	if ( ! fragbuf )
+		return NULL;
+	hole = malloc ( sizeof ( *hole ) );
+	if ( ! hole ) {
+		free ( fragbuf );
+		return NULL;
+	}
+	fragbuf->src = iphdr->src;
+	fragbuf->dest = iphdr->dest;
+	fragbuf->ident = iphdr->ident;
+	fragbuf->protocol = iphdr->protocol;
+	INIT_LIST_HEAD ( &fragbuf->fragments );
+	INIT_LIST_HEAD ( &fragbuf->holes );
+	hole->first = 0;
+	hole->last = IP_FRAG_INFINITY;
+	list_add ( &hole->list, &fragbuf->holes );
+	timer_init ( &fragbuf->timer, ipv4_frag_expired );
+	start_timer_fixed ( &fragbuf->timer, IP_FRAG_TIMEOUT );
+	list_add ( &fragbuf->hash, bucket );
+	list_add ( &fragbuf->list, &frag_buffers );
+	num_frag_buffers++;
+
+	return fragbuf;
+}
+
+/**
+ * Fill holes covered by a fragment
+ *
+ * @v fragbuf		Fragment reassembly buffer
+ * @v first		Offset of first byte in fragment
+ * @v last		Offset of last byte in fragment
+ * @v more		More fragments follow
+ * @ret filled		Number of holes (partially) filled, or negative error
+ *
+ * This is the hole descriptor algorithm from RFC 815.
+ */
+static int ipv4_frag_fill ( struct ipv4_frag_buffer *fragbuf, size_t first,
+			    size_t last, int more ) {
+	struct ipv4_frag_hole *hole;
+	struct ipv4_frag_hole *tmp;
+	struct ipv4_frag_hole *split;
+	int filled = 0;
+
+	list_for_each_entry_safe ( hole, tmp, &fragbuf->holes, list ) {
+
+		/* Skip holes not covered by this fragment */
+		if ( ( first > hole->last ) || ( last < hole->first ) )
+			continue;
+		filled++;
+
+		/* Part of hole may remain after this fragment */
+		if ( more && ( last < hole->last ) ) {
+			if ( first > hole->first ) {
+				/* Hole is split in two */
+				split = malloc ( sizeof ( *split ) );
+				if ( ! split )
+					return -ENOMEM;
+				split->first = hole->first;
+				split->last = ( first - 1 );
+				list_add_tail ( &split->list, &hole->list );
+			}
+			hole->first = ( last + 1 );
+			continue;
+		}
+
+		/* Part of hole may remain before this fragment */
+		if ( first > hole->first ) {
+			hole->last = ( first - 1 );
+			continue;
+		}
+
+		/* Hole is completely filled */
+		list_del ( &hole->list );
+		free ( hole );
+	}
+
+	return filled;
+}
+
+/**
+ * Build reassembled datagram
+ *
+ * @v fragbuf		Fragment reassembly buffer
+ * @ret iobuf		Reassembled datagram, or NULL
+ */
+static struct io_buffer * ipv4_frag_build ( struct ipv4_frag_buffer *fragbuf ) {
+	struct io_buffer *iobuf = NULL;
+	struct io_buffer *frag;
+	struct iphdr *iphdr;
+	size_t hdrlen = 0;
+	size_t frag_hdrlen;
+	size_t offset;
+	size_t len;
+
+	/* Copy IPv4 header from first fragment */
+	list_for_each_entry ( frag, &fragbuf->fragments, list ) {
+		iphdr = frag->data;
+		if ( ( ntohs ( iphdr->frags ) & IP_MASK_OFFSET ) != 0 )
+			continue;
+		hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+		iobuf = alloc_iob ( hdrlen + fragbuf->len );
+		if ( ! iobuf )
+			return NULL;
+		memcpy ( iob_put ( iobuf, hdrlen ), iphdr, hdrlen );
+		break;
+	}
+	if ( ! iobuf )
+		return NULL;
+
+	/* Copy in fragment data */
+	iob_put ( iobuf, fragbuf->len );
+	list_for_each_entry ( frag, &fragbuf->fragments, list ) {
+		iphdr = frag->data;
+		frag_hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+		offset = ( ( ntohs ( iphdr->frags ) & IP_MASK_OFFSET ) * 8 );
+		len = ( iob_len ( frag ) - frag_hdrlen );
+		if ( offset >= fragbuf->len )
+			continue;
+		if ( len > ( fragbuf->len - offset ) )
+			len = ( fragbuf->len - offset );
+		memcpy ( ( iobuf->data + hdrlen + offset ),
+			 ( frag->data + frag_hdrlen ), len );
+	}
+
+	/* Fix up IPv4 header */
+	iphdr = iobuf->data;
+	iphdr->len = htons ( hdrlen + fragbuf->len );
+	iphdr->frags &= htons ( IP_MASK_DONOTFRAG );
+	iphdr->chksum = 0;
+	iphdr->chksum = tcpip_chksum ( iphdr, hdrlen );
+
+	return iobuf;
+}
+
 /**
  * Fragment reassembler
  *
  * @v iobuf		I/O buffer, fragment of the datagram
- * @ret frag_iob	Reassembled packet, or NULL
+ * @ret iobuf		Reassembled datagram, or NULL
+ *
+ * Fragments may arrive in any order, and fragments of several
+ * datagrams may be interleaved.  The I/O buffer must contain the
+ * complete IPv4 header and must have been truncated to the length
+ * specified in the header.  The reassembled datagram is returned with
+ * an IPv4 header describing the whole datagram.
  */
-static struct io_buffer * ipv4_reassemble ( struct io_buffer * iobuf ) {
+static struct io_buffer * ipv4_reassemble ( struct io_buffer *iobuf ) {
 	struct iphdr *iphdr = iobuf->data;
-	struct frag_buffer *fragbuf;
-	
-	/**
-	 * Check if the fragment belongs to any fragment series
-	 */
-	list_for_each_entry ( fragbuf, &frag_buffers, list ) {
-		if ( fragbuf->ident == iphdr->ident &&
-		     fragbuf->src.s_addr == iphdr->src.s_addr ) {
-			/**
-			 * Check if the packet is the expected fragment
-			 * 
-			 * The offset of the new packet must be equal to the
-			 * length of the data accumulated so far (the length of
-			 * the reassembled I/O buffer
-			 */
-			if ( iob_len ( fragbuf->frag_iob ) == 
-			      ( iphdr->frags & IP_MASK_OFFSET ) ) {
-				/**
-				 * Append the contents of the fragment to the
-				 * reassembled I/O buffer
-				 */
-				iob_pull ( iobuf, sizeof ( *iphdr ) );
-				memcpy ( iob_put ( fragbuf->frag_iob,
-							iob_len ( iobuf ) ),
-					 iobuf->data, iob_len ( iobuf ) );
-				free_iob ( iobuf );
-
-				/** Check if the fragment series is over */
-				if ( ! ( iphdr->frags & IP_MASK_MOREFRAGS ) ) {
-					iobuf = fragbuf->frag_iob;
-					free_fragbuf ( fragbuf );
-					return iobuf;
-				}
-
-			} else {
-				/* Discard the fragment series */
-				free_fragbuf ( fragbuf );
-				free_iob ( iobuf );
-			}
-			return NULL;
+	size_t hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	unsigned int frags = ntohs ( iphdr->frags );
+	int more = ( frags & IP_MASK_MOREFRAGS );
+	size_t first = ( ( frags & IP_MASK_OFFSET ) * 8 );
+	size_t len = ( iob_len ( iobuf ) - hdrlen );
+	size_t size = ( iobuf->end - iobuf->head );
+	struct ipv4_frag_buffer *fragbuf;
+	size_t last;
+	int filled;
+
+	/* Sanity checks */
+	if ( ( len == 0 ) || ( more && ( len & 7 ) ) ||
+	     ( ( hdrlen + first + len ) > 0xffff ) ) {
+		DBG ( "IPv4 fragment id %04x offset %zd len %zd invalid\n",
+		      ntohs ( iphdr->ident ), first, len );
+		goto drop;
+	}
+	last = ( first + len - 1 );
+
+	/* Find or create reassembly buffer */
+	fragbuf = ipv4_frag_find ( iphdr );
+	if ( ! fragbuf ) {
+		DBG ( "IPv4 could not allocate fragment reassembly buffer\n" );
+		goto drop;
+	}
+
+	/* Record datagram length if this is the final fragment */
+	if ( ! more ) {
+		if ( fragbuf->len && ( fragbuf->len != ( last + 1 ) ) ) {
+			DBG ( "IPv4 fragment id %04x has inconsistent length\n",
+			      ntohs ( iphdr->ident ) );
+			goto drop;
 		}
+		fragbuf->len = ( last + 1 );
 	}
-	
-	/** Check if the fragment is the first in the fragment series */
-	if ( iphdr->frags & IP_MASK_MOREFRAGS &&
-			( ( iphdr->frags & IP_MASK_OFFSET ) == 0 ) ) {
-	
-		/** Create a new fragment buffer */
-		fragbuf = ( struct frag_buffer* ) malloc ( sizeof( *fragbuf ) );
-		fragbuf->ident = iphdr->ident;
-		fragbuf->src = iphdr->src;
-
-		/* Set up the reassembly I/O buffer */
-		fragbuf->frag_iob = alloc_iob ( IP_FRAG_IOB_SIZE );
-		iob_pull ( iobuf, sizeof ( *iphdr ) );
-		memcpy ( iob_put ( fragbuf->frag_iob, iob_len ( iobuf ) ),
-			 iobuf->data, iob_len ( iobuf ) );
-		free_iob ( iobuf );
 
-		/* Set the reassembly timer */
-		timer_init ( &fragbuf->frag_timer, ipv4_frag_expired );
-		start_timer_fixed ( &fragbuf->frag_timer, IP_FRAG_TIMEOUT );
+	/* Fill in holes */
+	filled = ipv4_frag_fill ( fragbuf, first, last, more );
+	if ( filled < 0 ) {
+		ipv4_frag_free ( fragbuf );
+		goto drop;
+	}
+	if ( filled == 0 ) {
+		DBG2 ( "IPv4 fragment id %04x offset %zd is a duplicate\n",
+		       ntohs ( iphdr->ident ), first );
+		goto drop;
+	}
 
-		/* Add the fragment buffer to the list of fragment buffers */
-		list_add ( &fragbuf->list, &frag_buffers );
+	/* Enforce memory limit by discarding older datagrams */
+	while ( ( frag_mem + size ) > IP_FRAG_MAX_MEM ) {
+		if ( ipv4_frag_discard ( fragbuf ) != 0 ) {
+			DBG ( "IPv4 datagram id %04x exceeds fragment memory "
+			      "limit\n", ntohs ( iphdr->ident ) );
+			ipv4_frag_free ( fragbuf );
+			goto drop;
+		}
 	}
-	
+
+	/* Hold fragment */
+	list_add_tail ( &iobuf->list, &fragbuf->fragments );
+	fragbuf->mem += size;
+	frag_mem += size;
+
+	/* Wait until all holes are filled */
+	if ( ! list_empty ( &fragbuf->holes ) )
+		return NULL;
+
+	/* Build reassembled datagram */
+	iobuf = ipv4_frag_build ( fragbuf );
+	if ( ! iobuf ) {
+		DBG ( "IPv4 could not allocate reassembled datagram id %04x\n",
+		      ntohs ( fragbuf->ident ) );
+	}
+	ipv4_frag_free ( fragbuf );
+	return iobuf;
+
+ drop:
+	free_iob ( iobuf );
 	return NULL;
 }
 
@@ -258,16 +501,17 @@ static uint16_t ipv4_pshdr_chksum ( struct io_buffer *iobuf, uint16_t csum ) {
 }
 
 /**
- * Determine link-layer address
+ * Determine link-layer broadcast or multicast address
  *
  * @v dest		IPv4 destination address
- * @v src		IPv4 source address
  * @v netdev		Network device
  * @v ll_dest		Link-layer destination address buffer
  * @ret rc		Return status code
+ *
+ * Unicast addresses are resolved via the neighbour cache by arp_tx().
  */
-static int ipv4_ll_addr ( struct in_addr dest, struct in_addr src,
-			  struct net_device *netdev, uint8_t *ll_dest ) {
+static int ipv4_ll_addr ( struct in_addr dest, struct net_device *netdev,
+			  uint8_t *ll_dest ) {
 	struct ll_protocol *ll_protocol = netdev->ll_protocol;
 
 	if ( dest.s_addr == INADDR_BROADCAST ) {
@@ -275,12 +519,9 @@ static int ipv4_ll_addr ( struct in_addr dest, struct in_addr src,
 		memcpy ( ll_dest, netdev->ll_broadcast,
 			 ll_protocol->ll_addr_len );
 		return 0;
-	} else if ( IN_MULTICAST ( ntohl ( dest.s_addr ) ) ) {
-		return ll_protocol->mc_hash ( AF_INET, &dest, ll_dest );
 	} else {
-		/* Unicast address: resolve via ARP */
-		return arp_resolve ( netdev, &ipv4_protocol, &dest,
-				     &src, ll_dest );
+		/* Multicast address */
+		return ll_protocol->mc_hash ( AF_INET, &dest, ll_dest );
 	}
 }
 
@@ -309,6 +550,7 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	struct ipv4_miniroute *miniroute;
 	struct in_addr next_hop;
 	uint8_t ll_dest[MAX_LL_ADDR_LEN];
+	int unicast;
 	int rc;
 
 	/* Fill up the IP header, except source address */
@@ -337,17 +579,26 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 		goto err;
 	}
 
-	/* Determine link-layer destination address */
-	if ( ( rc = ipv4_ll_addr ( next_hop, iphdr->src, netdev,
-				   ll_dest ) ) != 0 ) {
+	/* Determine link-layer destination address, if not unicast */
+	unicast = ( ( next_hop.s_addr != INADDR_BROADCAST ) &&
+		    ( ! IN_MULTICAST ( ntohl ( next_hop.s_addr ) ) ) );
+	if ( ( ! unicast ) &&
+	     ( ( rc = ipv4_ll_addr ( next_hop, netdev, ll_dest ) ) != 0 ) ) {
 		DBG ( "IPv4 has no link-layer address for %s: %s\n",
 		      inet_ntoa ( next_hop ), strerror ( rc ) );
 		goto err;
 	}
 
 	/* Fix up checksums */
-	if ( trans_csum )
-		*trans_csum = ipv4_pshdr_chksum ( iobuf, *trans_csum );
+	if ( trans_csum ) {
+		if ( iobuf->flags & IOB_CSUM_PARTIAL ) {
+			tcpip_tx_csum ( iobuf, netdev, trans_csum,
+					ipv4_pshdr_chksum ( iobuf,
+							    TCPIP_EMPTY_CSUM ));
+		} else {
+			*trans_csum = ipv4_pshdr_chksum ( iobuf, *trans_csum );
+		}
+	}
 	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
 
 	/* Print IP4 header for debugging */
@@ -356,8 +607,14 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	      inet_ntoa ( iphdr->dest ), ntohs ( iphdr->len ), iphdr->protocol,
 	      ntohs ( iphdr->ident ), ntohs ( iphdr->chksum ) );
 
-	/* Hand off to link layer */
-	if ( ( rc = net_tx ( iobuf, netdev, &ipv4_protocol, ll_dest ) ) != 0 ) {
+	/* Hand off to link layer (via ARP for unicast addresses) */
+	if ( unicast ) {
+		rc = arp_tx ( iobuf, netdev, &ipv4_protocol, &next_hop,
+			      &iphdr->src );
+	} else {
+		rc = net_tx ( iobuf, netdev, &ipv4_protocol, ll_dest );
+	}
+	if ( rc != 0 ) {
 		DBG ( "IPv4 could not transmit packet via %s: %s\n",
 		      netdev->name, strerror ( rc ) );
 		return rc;
@@ -370,6 +627,21 @@ static int ipv4_tx ( struct io_buffer *iobuf,
 	return rc;
 }
 
+/**
+ * Identify transmitting network device
+ *
+ * @v st_dest		Destination network-layer address
+ * @ret netdev		Network device, or NULL
+ */
+static struct net_device * ipv4_netdev ( struct sockaddr_tcpip *st_dest ) {
+	struct sockaddr_in *sin_dest = ( ( struct sockaddr_in * ) st_dest );
+	struct in_addr next_hop = sin_dest->sin_addr;
+	struct ipv4_miniroute *miniroute;
+
+	miniroute = ipv4_route ( &next_hop );
+	return ( miniroute ? miniroute->netdev : NULL );
+}
+
 /**
  * Process incoming packets
  *
@@ -437,24 +709,27 @@ static int ipv4_rx ( struct io_buffer *iobuf, struct net_device *netdev __unused
 	      inet_ntoa ( iphdr->src ), ntohs ( iphdr->len ), iphdr->protocol,
 	      ntohs ( iphdr->ident ), ntohs ( iphdr->chksum ) );
 
-	/* Truncate packet to correct length, calculate pseudo-header
-	 * checksum and then strip off the IPv4 header.
-	 */
+	/* Truncate packet to correct length */
 	iob_unput ( iobuf, ( iob_len ( iobuf ) - len ) );
-	pshdr_csum = ipv4_pshdr_chksum ( iobuf, TCPIP_EMPTY_CSUM );
-	iob_pull ( iobuf, hdrlen );
 
 	/* Fragment reassembly */
-	if ( ( iphdr->frags & htons ( IP_MASK_MOREFRAGS ) ) || 
-	     ( ( iphdr->frags & htons ( IP_MASK_OFFSET ) ) != 0 ) ) {
+	if ( iphdr->frags & htons ( IP_MASK_MOREFRAGS | IP_MASK_OFFSET ) ) {
 		/* Pass the fragment to ipv4_reassemble() which either
 		 * returns a fully reassembled I/O buffer or NULL.
 		 */
 		iobuf = ipv4_reassemble ( iobuf );
 		if ( ! iobuf )
 			return 0;
+		iphdr = iobuf->data;
+		hdrlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
 	}
 
+	/* Calculate pseudo-header checksum and then strip off the
+	 * IPv4 header.
+	 */
+	pshdr_csum = ipv4_pshdr_chksum ( iobuf, TCPIP_EMPTY_CSUM );
+	iob_pull ( iobuf, hdrlen );
+
 	/* Construct socket addresses and hand off to transport layer */
 	memset ( &src, 0, sizeof ( src ) );
 	src.sin.sin_family = AF_INET;
@@ -536,6 +811,7 @@ struct tcpip_net_protocol ipv4_tcpip_protocol __tcpip_net_protocol = {
 	.name = "IPv4",
 	.sa_family = AF_INET,
 	.tx = ipv4_tx,
+	.netdev = ipv4_netdev,
 };
 
 /** IPv4 ARP protocol */
@@ -630,5 +906,21 @@ struct settings_applicator ipv4_settings_applicator __settings_applicator = {
 	.apply = ipv4_create_routes,
 };
 
+/**
+ * Initialise IPv4 fragment reassembly
+ *
+ */
+static void ipv4_frag_init ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < IP_FRAG_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &frag_hash[i] );
+}
+
+/** IPv4 fragment reassembly initialisation function */
+struct init_fn ipv4_frag_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = ipv4_frag_init,
+};
+
 /* Drag in ICMP */
 REQUIRE_OBJECT ( icmp );
@@ -382,8 +382,15 @@ int ipv6_tx ( struct io_buffer *iobuf,
 	ip6hdr->dest = dest->sin6_addr;
 
 	/* Complete the transport layer checksum */
-	if ( trans_csum )
-		*trans_csum = ipv6_tx_csum ( iobuf, *trans_csum );
+	if ( trans_csum ) {
+		if ( iobuf->flags & IOB_CSUM_PARTIAL ) {
+			tcpip_tx_csum ( iobuf, netdev, trans_csum,
+					ipv6_tx_csum ( iobuf,
+						       TCPIP_EMPTY_CSUM ) );
+		} else {
+			*trans_csum = ipv6_tx_csum ( iobuf, *trans_csum );
+		}
+	}
 
 	/* Print IPv6 header */
 	/* ipv6_dump ( ip6hdr ); */
@@ -398,11 +405,7 @@ int ipv6_tx ( struct io_buffer *iobuf,
 		ll_dest_buf[5] = next_hop.in6_u.u6_addr8[15];
 	} else {
 		/* Unicast address needs to be resolved by NDP */
-		if ( ( rc = ndp_resolve ( netdev, &next_hop, &ip6hdr->src,
-					  ll_dest_buf ) ) != 0 ) {
-			DBG ( "No entry for %s\n", inet6_ntoa ( next_hop ) );
-			goto err;
-		}
+		return ndp_tx ( iobuf, netdev, &next_hop, &ip6hdr->src );
 	}
 
 	/* Transmit packet */
@@ -9,6 +9,7 @@
 #include <gpxe/icmp6.h>
 #include <gpxe/ip6.h>
 #include <gpxe/netdevice.h>
+#include <gpxe/neighbour.h>
 #include <gpxe/retry.h>
 #include <gpxe/timer.h>
 #include <gpxe/job.h>
@@ -22,18 +23,6 @@
  * family.
  */
 
-/* A neighbour entry */
-struct ndp_entry {
-	/** Target IP6 address */
-	struct in6_addr in6;
-	/** Link layer protocol */
-	struct ll_protocol *ll_protocol;
-	/** Link-layer address */
-	uint8_t ll_addr[MAX_LL_ADDR_LEN];
-	/** State of the neighbour entry */
-	int state;
-};
-
 /** A pending router solicitation. */
 struct pending_rsolicit {
 	/** Network device for the solicit. */
@@ -52,18 +41,12 @@ struct pending_rsolicit {
 	struct retry_timer timer;
 };
 
-/** Number of entries in the neighbour cache table */
-#define NUM_NDP_ENTRIES 4
-
-/** The neighbour cache table */
-static struct ndp_entry ndp_table[NUM_NDP_ENTRIES];
-#define ndp_table_end &ndp_table[NUM_NDP_ENTRIES]
-
-static unsigned int next_new_ndp_entry = 0;
+/** Number of entries in the pending solicit table */
+#define NUM_RSOLICIT_ENTRIES 4
 
 /** The pending solicit table */
-static struct pending_rsolicit solicit_table[NUM_NDP_ENTRIES];
-#define solicit_table_end &solicit_table[NUM_NDP_ENTRIES]
+static struct pending_rsolicit solicit_table[NUM_RSOLICIT_ENTRIES];
+#define solicit_table_end &solicit_table[NUM_RSOLICIT_ENTRIES]
 
 static unsigned int next_new_solicit_entry = 0;
 
@@ -108,24 +91,6 @@ static void rsolicit_timer_expired ( struct retry_timer *timer, int fail __unuse
 	rsolicit_job_kill ( &entry->job );
 }
 
-/**
- * Find entry in the neighbour cache
- *
- * @v in6	IP6 address
- */
-static struct ndp_entry *
-ndp_find_entry ( struct in6_addr *in6 ) {
-	struct ndp_entry *ndp;
-
-	for ( ndp = ndp_table ; ndp < ndp_table_end ; ndp++ ) {
-		if ( IP6_EQUAL ( ( *in6 ), ndp->in6 ) &&
-		     ( ndp->state != NDP_STATE_INVALID ) ) {
-			return ndp;
-		}
-	}
-	return NULL;
-}
-
 /**
  * Find a pending router solicitation for an interface.
  *
@@ -144,34 +109,6 @@ solicit_find_entry ( struct net_device *netdev ) {
 	return NULL;
 }
 
-/**
- * Add NDP entry
- *
- * @v netdev	Network device
- * @v in6	IP6 address
- * @v ll_addr	Link-layer address
- * @v state	State of the entry - one of the NDP_STATE_XXX values
- */
-static void
-add_ndp_entry ( struct net_device *netdev, struct in6_addr *in6,
-		void *ll_addr, int state ) {
-	struct ndp_entry *ndp;
-	ndp = &ndp_table[next_new_ndp_entry++ % NUM_NDP_ENTRIES];
-
-	/* Fill up entry */
-	ndp->ll_protocol = netdev->ll_protocol;
-	memcpy ( &ndp->in6, &( *in6 ), sizeof ( *in6 ) );
-	if ( ll_addr ) {
-		memcpy ( ndp->ll_addr, ll_addr, netdev->ll_protocol->ll_addr_len );
-	} else {
-		memset ( ndp->ll_addr, 0, netdev->ll_protocol->ll_addr_len );
-	}
-	ndp->state = state;
-	DBG ( "New neighbour cache entry: IP6 %s => %s %s\n",
-	      inet6_ntoa ( ndp->in6 ), netdev->ll_protocol->name,
-	      netdev->ll_protocol->ntoa ( ndp->ll_addr ) );
-}
-
 /**
  * Add pending solicit entry
  *
@@ -181,7 +118,7 @@ add_ndp_entry ( struct net_device *netdev, struct in6_addr *in6,
 static struct pending_rsolicit *
 add_solicit_entry ( struct net_device *netdev, int state ) {
 	struct pending_rsolicit *entry;
-	entry = &solicit_table[next_new_solicit_entry++ % NUM_NDP_ENTRIES];
+	entry = &solicit_table[next_new_solicit_entry++ % NUM_RSOLICIT_ENTRIES];
 
 	/* Fill up entry */
 	entry->netdev = netdev;
@@ -193,59 +130,31 @@ add_solicit_entry ( struct net_device *netdev, int state ) {
 }
 
 /**
- * Resolve the link-layer address
+ * Transmit neighbour solicitation
  *
  * @v netdev		Network device
- * @v dest		Destination address
- * @v src		Source address
- * @ret dest_ll_addr	Destination link-layer address or NULL
- * @ret rc		Status
- *
- * This function looks up the neighbour cache for an entry corresponding to the
- * destination address. If it finds a valid entry, it fills up dest_ll_addr and
- * returns 0. Otherwise it sends a neighbour solicitation to the solicited
- * multicast address.
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v net_source	Source network-layer address
+ * @ret rc		Return status code
  */
-int ndp_resolve ( struct net_device *netdev, struct in6_addr *dest,
-		  struct in6_addr *src, void *dest_ll_addr ) {
-	struct ll_protocol *ll_protocol = netdev->ll_protocol;
-	struct ndp_entry *ndp;
-	int rc;
-
-	ndp = ndp_find_entry ( dest );
-	/* Check if the entry is valid */
-	if ( ndp && ndp->state == NDP_STATE_REACHABLE ) {
-		DBG ( "Neighbour cache hit: IP6 %s => %s %s\n",
-		      inet6_ntoa ( *dest ), ll_protocol->name,
-		      ll_protocol->ntoa ( ndp->ll_addr ) );
-		memcpy ( dest_ll_addr, ndp->ll_addr, ll_protocol->ll_addr_len );
-		return 0;
-	}
-
-	/* Check if the entry was already created */
-	if ( ndp ) {
-		DBG ( "Awaiting neighbour advertisement\n" );
-		/* For test */
-//		ndp->state = NDP_STATE_REACHABLE;
-//		memcpy ( ndp->ll_addr, netdev->ll_addr, 6 );
-//		assert ( ndp->ll_protocol->ll_addr_len == 6 );
-//		icmp6_test_nadvert ( netdev, dest, ndp->ll_addr );
-//		assert ( ndp->state == NDP_STATE_REACHABLE );
-		/* Take it out till here */
-		return -ENOENT;
-	}
-	DBG ( "Neighbour cache miss: IP6 %s\n", inet6_ntoa ( *dest ) );
-
-	/* Add entry in the neighbour cache */
-	add_ndp_entry ( netdev, dest, NULL, NDP_STATE_INCOMPLETE );
-
-	/* Send neighbour solicitation */
-	if ( ( rc = icmp6_send_solicit ( netdev, src, dest ) ) != 0 ) {
-		return rc;
-	}
-	return -ENOENT;
+static int ndp_tx_request ( struct net_device *netdev,
+			    struct net_protocol *net_protocol __unused,
+			    const void *net_dest, const void *net_source ) {
+	struct in6_addr dest;
+	struct in6_addr src;
+
+	memcpy ( &dest, net_dest, sizeof ( dest ) );
+	memcpy ( &src, net_source, sizeof ( src ) );
+	return icmp6_send_solicit ( netdev, &src, &dest );
 }
 
+/** NDP neighbour discovery protocol */
+struct neighbour_discovery ndp_discovery = {
+	.name = "NDP",
+	.tx_request = ndp_tx_request,
+};
+
 /**
  * Send router solicitation packet
  *
@@ -424,9 +333,8 @@ int ndp_process_radvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src
 			ll_opt = (struct ll_option *) opt;
 
 			/* Add entry in the neighbour cache for the router */
-			if ( ! ndp_find_entry ( &router_addr ) ) {
-				add_ndp_entry ( netdev, &router_addr, ll_opt->address, NDP_STATE_REACHABLE );
-			}
+			neighbour_define ( netdev, &ipv6_protocol,
+					   &router_addr, ll_opt->address );
 
 			}
 			break;
@@ -474,13 +382,13 @@ int ndp_process_radvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src
  * @v iobuf	I/O buffer
  * @v st_src	Source address
  * @v st_dest	Destination address
+ * @v netdev	Network device the packet was received on.
  */
 int ndp_process_nadvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src __unused,
-			   struct sockaddr_tcpip *st_dest __unused,
+			   struct sockaddr_tcpip *st_dest __unused, struct net_device *netdev,
 			   struct icmp6_net_protocol *net_protocol __unused ) {
 	struct neighbour_advert *nadvert = iobuf->data;
 	struct ll_option *ll_opt;
-	struct ndp_entry *ndp;
 
 	/* Sanity check */
 	if ( iob_len ( iobuf ) < ( sizeof ( *nadvert ) + sizeof ( *ll_opt ) ) ) {
@@ -497,32 +405,23 @@ int ndp_process_nadvert ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src
 		return 0;
 	}
 
-	/* Check for an existing entry in the cache that we can update. */
-	ndp = ndp_find_entry ( &nadvert->target );
-	if ( ndp ) {
-		/* Verify the packet is actually a response to this entry. */
-		if ( ! IP6_EQUAL ( ndp->in6, nadvert->target ) ) {
-			DBG ( "ndp: advert for unknown target\n" );
-			return -EINVAL;
-		}
-
-		/* Parse options, looking for "target link-layer address". */
-		while ( iob_len ( iobuf ) ) {
-			if ( ll_opt->type == NDP_OPTION_TARGET_LL ) {
-				/* Check the length for validity. */
-				if ( ll_opt->length ==
-					( 2 + ndp->ll_protocol->ll_addr_len ) / 8 ) {
-					memcpy ( ndp->ll_addr, ll_opt->address,
-						 ndp->ll_protocol->ll_addr_len );
-					ndp->state = NDP_STATE_REACHABLE;
-					break;
+	/* Parse options, looking for "target link-layer address". */
+	while ( iob_len ( iobuf ) ) {
+		if ( ll_opt->type == NDP_OPTION_TARGET_LL ) {
+			/* Check the length for validity. */
+			if ( ll_opt->length ==
+			     ( 2 + netdev->ll_protocol->ll_addr_len ) / 8 ) {
+				/* Update any existing neighbour cache entry */
+				if ( neighbour_update ( netdev, &ipv6_protocol,
+							&nadvert->target,
+							ll_opt->address ) != 0 ) {
+					DBG ( "ndp: advert for unknown target\n" );
 				}
+				break;
 			}
-
-			ll_opt = iob_pull ( iobuf, ll_opt->length * 8 );
 		}
-	} else {
-		DBG ( "Unsolicited advertisement (dropping packet)\n" );
+
+		ll_opt = iob_pull ( iobuf, ll_opt->length * 8 );
 	}
 	return 0;
 }
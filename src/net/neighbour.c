@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <gpxe/iobuf.h>
+#include <gpxe/netdevice.h>
+#include <gpxe/retry.h>
+#include <gpxe/init.h>
+#include <gpxe/neighbour.h>
+#include <config/general.h>
+
+/** @file
+ *
+ * Neighbour discovery
+ *
+ * This file implements a protocol-independent neighbour cache, shared
+ * by ARP (for IPv4) and NDP (for IPv6).  Cache entries are kept in a
+ * small hash table for lookup, and in a least-recently-used list for
+ * eviction once the cache reaches @c NEIGHBOUR_CACHE_SIZE entries.
+ *
+ * Packets transmitted to a neighbour whose link-layer address is not
+ * yet known are held in a per-entry queue (of up to @c
+ * NEIGHBOUR_MAX_PENDING packets) and are transmitted as soon as the
+ * address is discovered, rather than being dropped and left to the
+ * transport layer to retransmit.
+ */
+
+/** Number of neighbour cache hash buckets (must be a power of two) */
+#define NEIGHBOUR_HASH_SIZE 16
+
+/** Neighbour cache hash buckets */
+static struct list_head neighbour_hash[NEIGHBOUR_HASH_SIZE];
+
+/** Neighbour cache, most recently used first */
+static LIST_HEAD ( neighbours );
+
+/** Number of entries in the neighbour cache */
+static unsigned int num_neighbours;
+
+/**
+ * Calculate neighbour cache hash bucket
+ *
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @ret bucket		Hash bucket
+ */
+static struct list_head * neighbour_bucket ( struct net_protocol *net_protocol,
+					     const void *net_dest ) {
+	const uint8_t *bytes = net_dest;
+	unsigned int hash = 0;
+	unsigned int i;
+
+	for ( i = 0 ; i < net_protocol->net_addr_len ; i++ )
+		hash = ( ( hash * 31 ) + bytes[i] );
+	return &neighbour_hash[ hash & ( NEIGHBOUR_HASH_SIZE - 1 ) ];
+}
+
+/**
+ * Find neighbour cache entry
+ *
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @ret neighbour	Neighbour cache entry, or NULL if not found
+ *
+ * A matching entry is moved to the head of the least-recently-used
+ * list.
+ */
+static struct neighbour * neighbour_find ( struct net_device *netdev,
+					   struct net_protocol *net_protocol,
+					   const void *net_dest ) {
+	struct list_head *bucket = neighbour_bucket ( net_protocol, net_dest );
+	struct neighbour *neighbour;
+
+	list_for_each_entry ( neighbour, bucket, hash ) {
+		if ( ( neighbour->netdev == netdev ) &&
+		     ( neighbour->net_protocol == net_protocol ) &&
+		     ( memcmp ( neighbour->net_dest, net_dest,
+				net_protocol->net_addr_len ) == 0 ) ) {
+			list_del ( &neighbour->lru );
+			list_add ( &neighbour->lru, &neighbours );
+			return neighbour;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Destroy neighbour cache entry
+ *
+ * @v neighbour		Neighbour cache entry
+ * @v rc		Reason for destruction
+ *
+ * Any packets still awaiting neighbour discovery are discarded.
+ */
+static void neighbour_destroy ( struct neighbour *neighbour, int rc ) {
+	struct net_device *netdev = neighbour->netdev;
+	struct net_protocol *net_protocol = neighbour->net_protocol;
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+
+	DBGC ( neighbour, "NEIGHBOUR %s %s %s destroyed: %s\n", netdev->name,
+	       net_protocol->name, net_protocol->ntoa ( neighbour->net_dest ),
+	       strerror ( rc ) );
+
+	/* Stop any discovery in progress */
+	stop_timer ( &neighbour->timer );
+
+	/* Discard any pending packets */
+	list_for_each_entry_safe ( iobuf, tmp, &neighbour->tx_queue, list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+	}
+
+	/* Remove from cache */
+	list_del ( &neighbour->hash );
+	list_del ( &neighbour->lru );
+	num_neighbours--;
+
+	netdev_put ( netdev );
+	free ( neighbour );
+}
+
+/**
+ * Handle neighbour discovery timer expiry
+ *
+ * @v timer		Retransmission timer
+ * @v fail		Failure indicator
+ */
+static void neighbour_expired ( struct retry_timer *timer, int fail ) {
+	struct neighbour *neighbour =
+		container_of ( timer, struct neighbour, timer );
+	struct net_device *netdev = neighbour->netdev;
+	struct net_protocol *net_protocol = neighbour->net_protocol;
+	struct neighbour_discovery *discovery = neighbour->discovery;
+	int rc;
+
+	/* Give up if we have retried too many times */
+	if ( fail ) {
+		neighbour_destroy ( neighbour, -ETIMEDOUT );
+		return;
+	}
+
+	/* Restart timer before retransmitting */
+	start_timer ( &neighbour->timer );
+
+	/* Transmit discovery request */
+	DBGC ( neighbour, "NEIGHBOUR %s %s %s transmitting %s request\n",
+	       netdev->name, net_protocol->name,
+	       net_protocol->ntoa ( neighbour->net_dest ), discovery->name );
+	if ( ( rc = discovery->tx_request ( netdev, net_protocol,
+					    neighbour->net_dest,
+					    neighbour->net_source ) ) != 0 ) {
+		DBGC ( neighbour, "NEIGHBOUR %s %s %s could not transmit %s "
+		       "request: %s\n", netdev->name, net_protocol->name,
+		       net_protocol->ntoa ( neighbour->net_dest ),
+		       discovery->name, strerror ( rc ) );
+		/* Retransmit when timer next expires */
+	}
+}
+
+/**
+ * Create neighbour cache entry
+ *
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @ret neighbour	Neighbour cache entry, or NULL on allocation failure
+ *
+ * If the cache is full, the least recently used entry is evicted.
+ */
+static struct neighbour * neighbour_create ( struct net_device *netdev,
+					     struct net_protocol *net_protocol,
+					     const void *net_dest ) {
+	struct neighbour *neighbour;
+
+	/* Evict least recently used entry, if necessary */
+	if ( num_neighbours >= NEIGHBOUR_CACHE_SIZE ) {
+		neighbour = list_entry ( neighbours.prev, struct neighbour,
+					 lru );
+		neighbour_destroy ( neighbour, -ENOBUFS );
+	}
+
+	/* Allocate and initialise entry */
+	neighbour = zalloc ( sizeof ( *neighbour ) );
+	if ( ! neighbour )
+		return NULL;
+	neighbour->netdev = netdev_get ( netdev );
+	neighbour->net_protocol = net_protocol;
+	memcpy ( neighbour->net_dest, net_dest, net_protocol->net_addr_len );
+	timer_init ( &neighbour->timer, neighbour_expired );
+	INIT_LIST_HEAD ( &neighbour->tx_queue );
+
+	/* Add to cache */
+	list_add ( &neighbour->hash,
+		   neighbour_bucket ( net_protocol, net_dest ) );
+	list_add ( &neighbour->lru, &neighbours );
+	num_neighbours++;
+
+	DBGC ( neighbour, "NEIGHBOUR %s %s %s created\n", netdev->name,
+	       net_protocol->name, net_protocol->ntoa ( net_dest ) );
+	return neighbour;
+}
+
+/**
+ * Start neighbour discovery
+ *
+ * @v neighbour		Neighbour cache entry
+ * @v discovery		Neighbour discovery protocol
+ * @v net_source	Source network-layer address
+ */
+static void neighbour_discover ( struct neighbour *neighbour,
+				 struct neighbour_discovery *discovery,
+				 const void *net_source ) {
+	struct net_protocol *net_protocol = neighbour->net_protocol;
+
+	/* Record discovery protocol and source address */
+	neighbour->discovery = discovery;
+	memcpy ( neighbour->net_source, net_source,
+		 net_protocol->net_addr_len );
+
+	/* Transmit first request immediately */
+	start_timer_nodelay ( &neighbour->timer );
+}
+
+/**
+ * Complete neighbour discovery
+ *
+ * @v neighbour		Neighbour cache entry
+ * @v ll_dest		Destination link-layer address
+ *
+ * Any packets awaiting neighbour discovery are transmitted.
+ */
+static void neighbour_discovered ( struct neighbour *neighbour,
+				   const void *ll_dest ) {
+	struct net_device *netdev = neighbour->netdev;
+	struct ll_protocol *ll_protocol = netdev->ll_protocol;
+	struct net_protocol *net_protocol = neighbour->net_protocol;
+	struct io_buffer *iobuf;
+	int rc;
+
+	/* Record link-layer address */
+	memcpy ( neighbour->ll_dest, ll_dest, ll_protocol->ll_addr_len );
+	DBGC ( neighbour, "NEIGHBOUR %s %s %s is %s %s\n", netdev->name,
+	       net_protocol->name, net_protocol->ntoa ( neighbour->net_dest ),
+	       ll_protocol->name, ll_protocol->ntoa ( neighbour->ll_dest ) );
+
+	/* Stop discovery, if applicable */
+	if ( ! neighbour->discovery )
+		return;
+	stop_timer ( &neighbour->timer );
+	neighbour->discovery = NULL;
+
+	/* Transmit any packets in queue */
+	while ( ! list_empty ( &neighbour->tx_queue ) ) {
+		iobuf = list_entry ( neighbour->tx_queue.next,
+				     struct io_buffer, list );
+		list_del ( &iobuf->list );
+		neighbour->tx_queue_len--;
+		DBGC2 ( neighbour, "NEIGHBOUR %s %s %s transmitting deferred "
+			"packet\n", netdev->name, net_protocol->name,
+			net_protocol->ntoa ( neighbour->net_dest ) );
+		if ( ( rc = net_tx ( iobuf, netdev, net_protocol,
+				     neighbour->ll_dest ) ) != 0 ) {
+			DBGC ( neighbour, "NEIGHBOUR %s %s %s could not "
+			       "transmit deferred packet: %s\n",
+			       netdev->name, net_protocol->name,
+			       net_protocol->ntoa ( neighbour->net_dest ),
+			       strerror ( rc ) );
+			/* Ignore error and continue */
+		}
+	}
+}
+
+/**
+ * Transmit packet, determining link-layer address via neighbour cache
+ *
+ * @v iobuf		I/O buffer
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v discovery		Neighbour discovery protocol
+ * @v net_source	Source network-layer address
+ * @ret rc		Return status code
+ *
+ * If the destination link-layer address is not yet known, the packet
+ * is queued and neighbour discovery is started.  The I/O buffer is
+ * always consumed, as for net_tx().
+ */
+int neighbour_tx ( struct io_buffer *iobuf, struct net_device *netdev,
+		   struct net_protocol *net_protocol, const void *net_dest,
+		   struct neighbour_discovery *discovery,
+		   const void *net_source ) {
+	struct neighbour *neighbour;
+	struct io_buffer *oldest;
+
+	/* Find or create neighbour cache entry */
+	neighbour = neighbour_find ( netdev, net_protocol, net_dest );
+	if ( ! neighbour ) {
+		neighbour = neighbour_create ( netdev, net_protocol, net_dest );
+		if ( ! neighbour ) {
+			free_iob ( iobuf );
+			return -ENOMEM;
+		}
+		neighbour_discover ( neighbour, discovery, net_source );
+	}
+
+	/* Transmit immediately if we have a link-layer address */
+	if ( neighbour_has_ll_dest ( neighbour ) )
+		return net_tx ( iobuf, netdev, net_protocol, neighbour->ll_dest );
+
+	/* Otherwise, queue for transmission, discarding the oldest
+	 * pending packet if the queue is full.
+	 */
+	if ( neighbour->tx_queue_len >= NEIGHBOUR_MAX_PENDING ) {
+		oldest = list_entry ( neighbour->tx_queue.next,
+				      struct io_buffer, list );
+		list_del ( &oldest->list );
+		free_iob ( oldest );
+		neighbour->tx_queue_len--;
+	}
+	DBGC2 ( neighbour, "NEIGHBOUR %s %s %s deferring packet\n",
+		netdev->name, net_protocol->name,
+		net_protocol->ntoa ( net_dest ) );
+	list_add_tail ( &iobuf->list, &neighbour->tx_queue );
+	neighbour->tx_queue_len++;
+
+	return 0;
+}
+
+/**
+ * Update existing neighbour cache entry
+ *
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v ll_dest		Destination link-layer address
+ * @ret rc		Return status code
+ *
+ * Returns -ENOENT if no entry exists for this neighbour.
+ */
+int neighbour_update ( struct net_device *netdev,
+		       struct net_protocol *net_protocol,
+		       const void *net_dest, const void *ll_dest ) {
+	struct neighbour *neighbour;
+
+	neighbour = neighbour_find ( netdev, net_protocol, net_dest );
+	if ( ! neighbour )
+		return -ENOENT;
+	neighbour_discovered ( neighbour, ll_dest );
+
+	return 0;
+}
+
+/**
+ * Define neighbour cache entry
+ *
+ * @v netdev		Network device
+ * @v net_protocol	Network-layer protocol
+ * @v net_dest		Destination network-layer address
+ * @v ll_dest		Destination link-layer address
+ * @ret rc		Return status code
+ *
+ * The entry is created if it does not already exist.
+ */
+int neighbour_define ( struct net_device *netdev,
+		       struct net_protocol *net_protocol,
+		       const void *net_dest, const void *ll_dest ) {
+	struct neighbour *neighbour;
+
+	neighbour = neighbour_find ( netdev, net_protocol, net_dest );
+	if ( ! neighbour ) {
+		neighbour = neighbour_create ( netdev, net_protocol, net_dest );
+		if ( ! neighbour )
+			return -ENOMEM;
+	}
+	neighbour_discovered ( neighbour, ll_dest );
+
+	return 0;
+}
+
+/**
+ * Flush neighbour cache entries for a network device
+ *
+ * @v netdev		Network device
+ */
+void neighbour_flush ( struct net_device *netdev ) {
+	struct neighbour *neighbour;
+	struct neighbour *tmp;
+
+	list_for_each_entry_safe ( neighbour, tmp, &neighbours, lru ) {
+		if ( neighbour->netdev == netdev )
+			neighbour_destroy ( neighbour, -ENODEV );
+	}
+}
+
+/**
+ * Initialise neighbour cache
+ *
+ */
+static void neighbour_init ( void ) {
+	unsigned int i;
+
+	for ( i = 0 ; i < NEIGHBOUR_HASH_SIZE ; i++ )
+		INIT_LIST_HEAD ( &neighbour_hash[i] );
+}
+
+/** Neighbour cache initialisation function */
+struct init_fn neighbour_init_fn __init_fn ( INIT_NORMAL ) = {
+	.initialise = neighbour_init,
+};
@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/settings.h>
 #include <gpxe/device.h>
 #include <gpxe/netdevice.h>
+#include <gpxe/netstats.h>
 
 /** @file
  *
@@ -43,6 +44,12 @@ struct setting busid_setting __setting = {
 	.description = "Bus ID",
 	.type = &setting_type_hex,
 };
+struct setting mtu_setting __setting = {
+	.name = "mtu",
+	.description = "Maximum transmission unit",
+	.tag = DHCP_MTU,
+	.type = &setting_type_uint16,
+};
 
 /**
  * Store value of network device setting
@@ -118,3 +125,205 @@ struct settings_operations netdev_settings_operations = {
 	.fetch = netdev_fetch,
 	.clear = netdev_clear,
 };
+
+/**
+ * Apply network device MTU setting
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ *
+ * The MTU is limited to the largest packet that the hardware can
+ * handle.  An increase in MTU while the device is open is deferred
+ * until the device is next opened, since the driver's receive
+ * buffers may be too small; reopening the device here would reset
+ * the link and discard queued packets in the middle of (for example)
+ * a DHCP transaction.
+ */
+static int apply_netdev_mtu ( struct net_device *netdev ) {
+	size_t max_mtu;
+	size_t mtu;
+
+	/* Do nothing unless an MTU has been specified */
+	mtu = fetch_uintz_setting ( netdev_settings ( netdev ), &mtu_setting );
+	if ( ! mtu )
+		return 0;
+
+	/* Limit to the range supported by the hardware and by IPv4 */
+	max_mtu = ( netdev->max_pkt_len - netdev->ll_protocol->ll_header_len );
+	if ( mtu > max_mtu ) {
+		DBGC ( netdev, "NETDEV %p limiting MTU %zd to %zd\n",
+		       netdev, mtu, max_mtu );
+		mtu = max_mtu;
+	}
+	if ( mtu < NETDEV_MIN_MTU ) {
+		DBGC ( netdev, "NETDEV %p ignoring invalid MTU %zd\n",
+		       netdev, mtu );
+		return 0;
+	}
+
+	/* Defer an increase until the device is next opened */
+	if ( ( mtu > netdev->mtu ) && netdev_is_open ( netdev ) ) {
+		if ( mtu != netdev->pending_mtu ) {
+			DBGC ( netdev, "NETDEV %p will use MTU %zd when "
+			       "reopened\n", netdev, mtu );
+		}
+		netdev->pending_mtu = mtu;
+		return 0;
+	}
+
+	/* Apply anything else immediately */
+	netdev->pending_mtu = 0;
+	if ( mtu == netdev->mtu )
+		return 0;
+	DBGC ( netdev, "NETDEV %p MTU changed from %zd to %zd\n",
+	       netdev, netdev->mtu, mtu );
+	netdev->mtu = mtu;
+
+	return 0;
+}
+
+/**
+ * Apply network device settings
+ *
+ * @ret rc		Return status code
+ */
+static int apply_netdev_settings ( void ) {
+	struct net_device *netdev;
+	int rc;
+
+	for_each_netdev ( netdev ) {
+		if ( ( rc = apply_netdev_mtu ( netdev ) ) != 0 )
+			return rc;
+	}
+
+	return 0;
+}
+
+/** Network device settings applicator */
+struct settings_applicator netdev_applicator __settings_applicator = {
+	.apply = apply_netdev_settings,
+};
+
+/******************************************************************************
+ *
+ * Network device statistics
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Fetch value of network device statistics setting
+ *
+ * @v settings		Settings block
+ * @v setting		Setting to fetch
+ * @v data		Buffer to fill with setting data
+ * @v len		Length of buffer
+ * @ret len		Length of setting data, or negative error
+ */
+static int netdev_stats_fetch ( struct settings *settings,
+				struct setting *setting,
+				void *data, size_t len ) {
+	struct net_device *netdev = container_of ( settings, struct net_device,
+						   stats_settings );
+	struct net_statistic *stat;
+	uint32_t value;
+
+	for_each_table_entry ( stat, NET_STATISTICS ) {
+		if ( setting_cmp ( setting, stat->setting ) != 0 )
+			continue;
+		value = htonl ( stat->value ( netdev ) );
+		if ( len > sizeof ( value ) )
+			len = sizeof ( value );
+		memcpy ( data, &value, len );
+		return sizeof ( value );
+	}
+
+	return -ENOENT;
+}
+
+/** Network device statistics settings operations */
+struct settings_operations netdev_stats_operations = {
+	.fetch = netdev_stats_fetch,
+};
+
+/** Network device statistics named settings */
+struct setting rx_bytes_setting __setting = {
+	.name = "rx-bytes",
+	.description = "Bytes received",
+	.type = &setting_type_uint32,
+};
+struct setting tx_bytes_setting __setting = {
+	.name = "tx-bytes",
+	.description = "Bytes transmitted",
+	.type = &setting_type_uint32,
+};
+struct setting rx_queue_max_setting __setting = {
+	.name = "rx-queue-max",
+	.description = "Maximum RX queue depth",
+	.type = &setting_type_uint32,
+};
+struct setting tx_queue_max_setting __setting = {
+	.name = "tx-queue-max",
+	.description = "Maximum TX ring occupancy",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Get number of bytes received
+ *
+ * @v netdev		Network device
+ * @ret value		Number of bytes received
+ */
+static unsigned long netdev_rx_bytes ( struct net_device *netdev ) {
+	return netdev->rx_stats.bytes;
+}
+
+/**
+ * Get number of bytes transmitted
+ *
+ * @v netdev		Network device
+ * @ret value		Number of bytes transmitted
+ */
+static unsigned long netdev_tx_bytes ( struct net_device *netdev ) {
+	return netdev->tx_stats.bytes;
+}
+
+/**
+ * Get maximum RX queue depth
+ *
+ * @v netdev		Network device
+ * @ret value		Maximum RX queue depth
+ */
+static unsigned long netdev_rx_queue_max ( struct net_device *netdev ) {
+	return netdev->rx_stats.max_queued;
+}
+
+/**
+ * Get maximum TX ring occupancy
+ *
+ * @v netdev		Network device
+ * @ret value		Maximum TX ring occupancy
+ */
+static unsigned long netdev_tx_queue_max ( struct net_device *netdev ) {
+	return netdev->tx_stats.max_queued;
+}
+
+/** Network device statistics */
+struct net_statistic netdev_statistics[] __net_statistic = {
+	{
+		.setting = &rx_bytes_setting,
+		.value = netdev_rx_bytes,
+	},
+	{
+		.setting = &tx_bytes_setting,
+		.value = netdev_tx_bytes,
+	},
+	{
+		.setting = &rx_queue_max_setting,
+		.value = netdev_rx_queue_max,
+	},
+	{
+		.setting = &tx_queue_max_setting,
+		.value = netdev_tx_queue_max,
+	},
+};
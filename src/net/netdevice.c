@@ -23,15 +23,22 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdio.h>
 #include <byteswap.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <gpxe/if_ether.h>
 #include <gpxe/iobuf.h>
 #include <gpxe/tables.h>
 #include <gpxe/process.h>
+#include <gpxe/timer.h>
 #include <gpxe/init.h>
 #include <gpxe/device.h>
 #include <gpxe/errortab.h>
 #include <gpxe/netdevice.h>
+#include <gpxe/neighbour.h>
+#include <gpxe/bootprof.h>
+#include <gpxe/nap.h>
+#include <gpxe/impairnet.h>
+#include <config/general.h>
 
 /** @file
  *
@@ -45,6 +52,26 @@ struct list_head net_devices = LIST_HEAD_INIT ( net_devices );
 /** List of open network devices, in reverse order of opening */
 static struct list_head open_net_devices = LIST_HEAD_INIT ( open_net_devices );
 
+#ifdef NET_IRQ_NAP
+#define NET_NAP 1
+#else
+#define NET_NAP 0
+#endif
+
+/** Maximum time between polls of an interrupt-driven network device
+ *
+ * Interrupt-driven network devices are still polled occasionally, in
+ * order to catch events (such as link state changes) for which the
+ * device may not raise an interrupt.
+ */
+#define NETDEV_IRQ_POLL_INTERVAL ( TICKS_PER_SEC / 10 )
+
+/** Network idle statistics */
+struct net_idle_stats net_idle_stats;
+
+/** Scheduler progress count as of the previous idle network step */
+static unsigned long net_idle_busy;
+
 /** Default link status code */
 #define EUNKNOWN_LINK_STATUS __einfo_error ( EINFO_EUNKNOWN_LINK_STATUS )
 #define EINFO_EUNKNOWN_LINK_STATUS \
@@ -55,6 +82,31 @@ struct errortab netdev_errors[] __errortab = {
 	__einfo_errortab ( EINFO_EUNKNOWN_LINK_STATUS ),
 };
 
+/**
+ * Mark network device as having link up
+ *
+ * @v netdev		Network device
+ *
+ * The first link-up after the device is opened records the time
+ * taken to achieve link-up.  Drivers should report link-up from
+ * their poll() method as soon as it occurs, rather than waiting for
+ * it within open().
+ */
+void netdev_link_up ( struct net_device *netdev ) {
+
+	netdev->link_rc = 0;
+
+	/* Record time taken to achieve link-up, if applicable */
+	if ( ( netdev->state & NETDEV_OPEN ) &&
+	     ! ( netdev->state & NETDEV_LINK_TIMED ) ) {
+		netdev->link_time = ( currticks() - netdev->open_time );
+		netdev->state |= NETDEV_LINK_TIMED;
+		DBGC ( netdev, "NETDEV %p link up after %ldms\n", netdev,
+		       ( ( netdev->link_time * 1000 ) / TICKS_PER_SEC ) );
+		bootprof_trace ( "link-up", netdev->name );
+	}
+}
+
 /**
  * Mark network device as having link down
  *
@@ -110,6 +162,23 @@ static void netdev_record_stat ( struct net_device_stats *stats, int rc ) {
 	least_common_error->count = 1;
 }
 
+/**
+ * Record addition of packet to network device queue
+ *
+ * @v stats		Network device statistics
+ */
+static void netdev_record_enqueue ( struct net_device_stats *stats ) {
+	unsigned int bucket;
+
+	stats->queued++;
+	if ( stats->queued > stats->max_queued )
+		stats->max_queued = stats->queued;
+	bucket = ( flsl ( stats->queued ) - 1 );
+	if ( bucket >= NETDEV_OCCUPANCY_BUCKETS )
+		bucket = ( NETDEV_OCCUPANCY_BUCKETS - 1 );
+	stats->occupancy[bucket]++;
+}
+
 /**
  * Transmit raw packet via network device
  *
@@ -127,6 +196,7 @@ int netdev_tx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 	       netdev, iobuf, iobuf->data, iob_len ( iobuf ) );
 
 	list_add_tail ( &iobuf->list, &netdev->tx_queue );
+	netdev_record_enqueue ( &netdev->tx_stats );
 
 	if ( ! netdev_is_open ( netdev ) ) {
 		rc = -ENETUNREACH;
@@ -158,6 +228,7 @@ void netdev_tx_complete_err ( struct net_device *netdev,
 	/* Update statistics counter */
 	netdev_record_stat ( &netdev->tx_stats, rc );
 	if ( rc == 0 ) {
+		netdev->tx_stats.bytes += iob_len ( iobuf );
 		DBGC ( netdev, "NETDEV %p transmission %p complete\n",
 		       netdev, iobuf );
 	} else {
@@ -171,6 +242,7 @@ void netdev_tx_complete_err ( struct net_device *netdev,
 
 	/* Dequeue and free I/O buffer */
 	list_del ( &iobuf->list );
+	netdev->tx_stats.queued--;
 	free_iob ( iobuf );
 }
 
@@ -220,9 +292,50 @@ void netdev_rx ( struct net_device *netdev, struct io_buffer *iobuf ) {
 
 	/* Enqueue packet */
 	list_add_tail ( &iobuf->list, &netdev->rx_queue );
+	netdev_record_enqueue ( &netdev->rx_stats );
 
 	/* Update statistics counter */
 	netdev_record_stat ( &netdev->rx_stats, 0 );
+	netdev->rx_stats.bytes += iob_len ( iobuf );
+}
+
+/**
+ * Select hardware queue for transmission
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret queue		Hardware queue index
+ *
+ * Packets belonging to the same flow are always assigned to the same
+ * queue, so that they cannot be reordered by the hardware.
+ */
+unsigned int netdev_queue_tx ( struct net_device *netdev,
+			       struct io_buffer *iobuf ) {
+	unsigned int queue;
+
+	queue = ( iobuf->flow % netdev->num_queues );
+	netdev->queues[queue].tx++;
+	DBGC2 ( netdev, "NETDEV %p transmitting %p on queue %d\n",
+		netdev, iobuf, queue );
+	return queue;
+}
+
+/**
+ * Add packet received from a hardware queue to receive queue
+ *
+ * @v netdev		Network device
+ * @v queue		Hardware queue index
+ * @v iobuf		I/O buffer
+ *
+ * The packet is added to the network device's RX queue.  This
+ * function takes ownership of the I/O buffer.
+ */
+void netdev_queue_rx ( struct net_device *netdev, unsigned int queue,
+		       struct io_buffer *iobuf ) {
+
+	assert ( queue < netdev->num_queues );
+	netdev->queues[queue].rx++;
+	netdev_rx ( netdev, iobuf );
 }
 
 /**
@@ -265,6 +378,37 @@ void netdev_poll ( struct net_device *netdev ) {
 		netdev->op->poll ( netdev );
 }
 
+/**
+ * Poll network device, if it may have work pending
+ *
+ * @v netdev		Network device
+ *
+ * Network devices which are not interrupt-driven are always polled.
+ */
+static void netdev_poll_pending ( struct net_device *netdev ) {
+
+	if ( ! ( netdev->state & NETDEV_IRQ_IDLE ) ) {
+		netdev_poll ( netdev );
+		return;
+	}
+
+	/* Poll only if the device has raised an interrupt, has
+	 * transmissions awaiting completion, is holding packets for
+	 * later release, or has not been polled for a while.
+	 */
+	if ( nap_irq_triggered ( netdev->idle_irq ) ||
+	     ( ! list_empty ( &netdev->tx_queue ) ) || netdev->held ||
+	     ( ( currticks() - netdev->poll_time ) >=
+	       NETDEV_IRQ_POLL_INTERVAL ) ) {
+		netdev->poll_time = currticks();
+		netdev_poll ( netdev );
+		nap_irq_rearm ( netdev->idle_irq );
+		net_idle_stats.polls++;
+	} else {
+		net_idle_stats.skipped++;
+	}
+}
+
 /**
  * Remove packet from device's receive queue
  *
@@ -279,6 +423,7 @@ struct io_buffer * netdev_rx_dequeue ( struct net_device *netdev ) {
 
 	list_for_each_entry ( iobuf, &netdev->rx_queue, list ) {
 		list_del ( &iobuf->list );
+		netdev->rx_stats.queued--;
 		return iobuf;
 	}
 	return NULL;
@@ -332,6 +477,7 @@ struct net_device * alloc_netdev ( size_t priv_size ) {
 		netdev->link_rc = -EUNKNOWN_LINK_STATUS;
 		INIT_LIST_HEAD ( &netdev->tx_queue );
 		INIT_LIST_HEAD ( &netdev->rx_queue );
+		netdev->num_queues = 1;
 		netdev_settings_init ( netdev );
 		netdev->priv = ( ( ( void * ) netdev ) + sizeof ( *netdev ) );
 	}
@@ -351,6 +497,16 @@ int register_netdev ( struct net_device *netdev ) {
 	static unsigned int ifindex = 0;
 	int rc;
 
+	assert ( netdev->num_queues > 0 );
+	assert ( netdev->num_queues <= NETDEV_MAX_QUEUES );
+
+	/* Default to the largest MTU supported by the hardware */
+	if ( ! netdev->mtu ) {
+		netdev->mtu = ( netdev->max_pkt_len -
+				netdev->ll_protocol->ll_header_len );
+	}
+	assert ( netdev_max_rx_len ( netdev ) <= netdev->max_pkt_len );
+
 	/* Create device name */
 	snprintf ( netdev->name, sizeof ( netdev->name ), "net%d",
 		   ifindex++ );
@@ -365,6 +521,13 @@ int register_netdev ( struct net_device *netdev ) {
 		       netdev, strerror ( rc ) );
 		return rc;
 	}
+	if ( ( rc = register_settings ( &netdev->stats_settings,
+					netdev_settings ( netdev ) ) ) != 0 ) {
+		DBGC ( netdev, "NETDEV %p could not register statistics "
+		       "settings: %s\n", netdev, strerror ( rc ) );
+		unregister_settings ( netdev_settings ( netdev ) );
+		return rc;
+	}
 
 	/* Add to device list */
 	netdev_get ( netdev );
@@ -372,10 +535,62 @@ int register_netdev ( struct net_device *netdev ) {
 	DBGC ( netdev, "NETDEV %p registered as %s (phys %s hwaddr %s)\n",
 	       netdev, netdev->name, netdev->dev->name,
 	       netdev_addr ( netdev ) );
+	bootprof_trace ( "netdev-register", netdev->name );
 
 	return 0;
 }
 
+/**
+ * Start using interrupts to wake from idle
+ *
+ * @v netdev		Network device
+ */
+static void netdev_irq_idle_start ( struct net_device *netdev ) {
+	unsigned int irq;
+
+	/* Do nothing unless the device can raise useful interrupts */
+	if ( ! ( NET_NAP && ( netdev->features & NETDEV_F_IRQ ) ) )
+		return;
+
+	/* Do nothing if interrupts are already in use */
+	if ( netdev->state & ( NETDEV_IRQ_IDLE | NETDEV_IRQ_ENABLED ) )
+		return;
+
+	/* Hook interrupt line */
+	irq = netdev->dev->desc.irq;
+	if ( ! nap_irq_hook ( irq ) ) {
+		DBGC ( netdev, "NETDEV %p cannot wake from idle via IRQ %d\n",
+		       netdev, irq );
+		return;
+	}
+
+	/* Enable interrupts */
+	netdev->idle_irq = irq;
+	netdev->poll_time = currticks();
+	netdev->state |= NETDEV_IRQ_IDLE;
+	netdev->op->irq ( netdev, 1 );
+	DBGC ( netdev, "NETDEV %p waking from idle via IRQ %d\n",
+	       netdev, irq );
+}
+
+/**
+ * Stop using interrupts to wake from idle
+ *
+ * @v netdev		Network device
+ */
+static void netdev_irq_idle_stop ( struct net_device *netdev ) {
+
+	/* Do nothing unless interrupts are in use */
+	if ( ! ( netdev->state & NETDEV_IRQ_IDLE ) )
+		return;
+
+	/* Disable interrupts and unhook interrupt line */
+	netdev->op->irq ( netdev, 0 );
+	netdev->state &= ~NETDEV_IRQ_IDLE;
+	nap_irq_unhook ( netdev->idle_irq );
+	DBGC ( netdev, "NETDEV %p no longer waking from idle\n", netdev );
+}
+
 /**
  * Open network device
  *
@@ -383,6 +598,7 @@ int register_netdev ( struct net_device *netdev ) {
  * @ret rc		Return status code
  */
 int netdev_open ( struct net_device *netdev ) {
+	size_t old_mtu;
 	int rc;
 
 	/* Do nothing if device is already open */
@@ -390,17 +606,43 @@ int netdev_open ( struct net_device *netdev ) {
 		return 0;
 
 	DBGC ( netdev, "NETDEV %p opening\n", netdev );
+	bootprof_trace ( "netdev-open", netdev->name );
 
-	/* Open the device */
-	if ( ( rc = netdev->op->open ( netdev ) ) != 0 )
-		return rc;
+	/* Apply any pending MTU change */
+	old_mtu = netdev->mtu;
+	if ( netdev->pending_mtu ) {
+		netdev->mtu = netdev->pending_mtu;
+		netdev->pending_mtu = 0;
+	}
+
+	/* Open the device, falling back to the previous MTU if the
+	 * driver cannot accommodate the new one
+	 */
+	netdev->open_time = currticks();
+	netdev->state &= ~NETDEV_LINK_TIMED;
+	if ( ( rc = netdev->op->open ( netdev ) ) != 0 ) {
+		if ( netdev->mtu == old_mtu )
+			return rc;
+		DBGC ( netdev, "NETDEV %p could not open with MTU %zd: %s\n",
+		       netdev, netdev->mtu, strerror ( rc ) );
+		netdev->mtu = old_mtu;
+		if ( ( rc = netdev->op->open ( netdev ) ) != 0 )
+			return rc;
+	}
 
 	/* Mark as opened */
 	netdev->state |= NETDEV_OPEN;
 
+	/* Record time to link-up if link is already up */
+	if ( netdev_link_ok ( netdev ) )
+		netdev_link_up ( netdev );
+
 	/* Add to head of open devices list */
 	list_add ( &netdev->open_list, &open_net_devices );
 
+	/* Use interrupts to wake from idle, if possible */
+	netdev_irq_idle_start ( netdev );
+
 	return 0;
 }
 
@@ -417,6 +659,9 @@ void netdev_close ( struct net_device *netdev ) {
 
 	DBGC ( netdev, "NETDEV %p closing\n", netdev );
 
+	/* Stop using interrupts to wake from idle */
+	netdev_irq_idle_stop ( netdev );
+
 	/* Close the device */
 	netdev->op->close ( netdev );
 
@@ -424,6 +669,9 @@ void netdev_close ( struct net_device *netdev ) {
 	netdev_tx_flush ( netdev );
 	netdev_rx_flush ( netdev );
 
+	/* Discard neighbour cache entries */
+	neighbour_flush ( netdev );
+
 	/* Mark as closed */
 	netdev->state &= ~NETDEV_OPEN;
 
@@ -431,6 +679,17 @@ void netdev_close ( struct net_device *netdev ) {
 	list_del ( &netdev->open_list );
 }
 
+/**
+ * Stop impairing network device
+ *
+ * @v netdev		Network device
+ *
+ * This is a stub used when impaired network devices are not present.
+ */
+__weak void unimpair_netdev ( struct net_device *netdev __unused ) {
+	/* Nothing to do */
+}
+
 /**
  * Unregister network device
  *
@@ -443,6 +702,12 @@ void unregister_netdev ( struct net_device *netdev ) {
 	/* Ensure device is closed */
 	netdev_close ( netdev );
 
+	/* Remove any impairment */
+	unimpair_netdev ( netdev );
+
+	/* Discard any neighbour cache entries created while closed */
+	neighbour_flush ( netdev );
+
 	/* Unregister per-netdev configuration settings */
 	unregister_settings ( netdev_settings ( netdev ) );
 
@@ -459,6 +724,11 @@ void unregister_netdev ( struct net_device *netdev ) {
  */
 void netdev_irq ( struct net_device *netdev, int enable ) {
 
+	/* Interrupts are now under external control (e.g. via the
+	 * PXE UNDI API), and can no longer be used to wake from idle.
+	 */
+	netdev_irq_idle_stop ( netdev );
+
 	/* Enable or disable device interrupts */
 	netdev->op->irq ( netdev, enable );
 
@@ -582,28 +852,74 @@ int net_rx ( struct io_buffer *iobuf, struct net_device *netdev,
 	return 0;
 }
 
+/**
+ * Halt until network activity, if idle
+ *
+ * The CPU is halted only if no process has made progress since the
+ * previous idle network step, and every open network device is
+ * interrupt-driven and has no work pending.  The halt will last
+ * until the next interrupt, which will be either an interrupt from a
+ * network device or a timer interrupt.
+ */
+static void net_idle ( void ) {
+	struct net_device *netdev;
+	unsigned long start;
+	int open = 0;
+
+	/* Do nothing if any process has made progress during the
+	 * current round; halting would delay CPU-bound work.
+	 */
+	if ( scheduler_stats.busy != net_idle_busy ) {
+		net_idle_busy = scheduler_stats.busy;
+		return;
+	}
+
+	/* Do nothing unless every open device is idle */
+	list_for_each_entry ( netdev, &open_net_devices, open_list ) {
+		if ( ! ( netdev->state & NETDEV_IRQ_IDLE ) )
+			return;
+		if ( nap_irq_triggered ( netdev->idle_irq ) ||
+		     ( ! list_empty ( &netdev->tx_queue ) ) ||
+		     ( ! list_empty ( &netdev->rx_queue ) ) ||
+		     netdev->held )
+			return;
+		open = 1;
+	}
+	if ( ! open )
+		return;
+
+	/* Halt until next interrupt */
+	start = currticks();
+	cpu_nap();
+	net_idle_stats.naps++;
+	net_idle_stats.ticks += ( currticks() - start );
+}
+
 /**
  * Single-step the network stack
  *
  * @v process		Network stack process
  *
  * This polls all interfaces for received packets, and processes
- * packets from the RX queue.
+ * packets from the RX queue.  If there is no work pending on any
+ * interface, this will yield the remainder of the process' turn and
+ * halt the CPU until there is more work.
  */
-static void net_step ( struct process *process __unused ) {
+static void net_step ( struct process *process ) {
 	struct net_device *netdev;
 	struct io_buffer *iobuf;
 	struct ll_protocol *ll_protocol;
 	const void *ll_dest;
 	const void *ll_source;
 	uint16_t net_proto;
+	int busy = 0;
 	int rc;
 
 	/* Poll and process each network device */
 	list_for_each_entry ( netdev, &net_devices, list ) {
 
 		/* Poll for new packets */
-		netdev_poll ( netdev );
+		netdev_poll_pending ( netdev );
 
 		/* Process at most one received packet.  Give priority
 		 * to getting packets out of the NIC over processing
@@ -613,6 +929,7 @@ static void net_step ( struct process *process __unused ) {
 		 */
 		if ( ( iobuf = netdev_rx_dequeue ( netdev ) ) ) {
 
+			busy = 1;
 			DBGC ( netdev, "NETDEV %p processing %p (%p+%zx)\n",
 			       netdev, iobuf, iobuf->data,
 			       iob_len ( iobuf ) );
@@ -629,10 +946,53 @@ static void net_step ( struct process *process __unused ) {
 			net_rx ( iobuf, netdev, net_proto, ll_source );
 		}
 	}
+
+	/* Let other processes run and halt until more work arrives,
+	 * if idle
+	 */
+	if ( ! busy ) {
+		process_yield ( process );
+		net_idle();
+	}
 }
 
+/**
+ * Resume using interrupts to wake from idle
+ *
+ */
+static void net_idle_startup ( void ) {
+	struct net_device *netdev;
+
+	list_for_each_entry ( netdev, &open_net_devices, open_list )
+		netdev_irq_idle_start ( netdev );
+}
+
+/**
+ * Stop using interrupts to wake from idle
+ *
+ * @v flags		Shutdown flags
+ *
+ * Network devices may be left open beyond shutdown (e.g. for a SAN
+ * boot).  Such devices revert to being polled, since whatever is
+ * being booted will not expect their interrupt lines to be hooked.
+ */
+static void net_idle_shutdown ( int flags __unused ) {
+	struct net_device *netdev;
+
+	list_for_each_entry ( netdev, &open_net_devices, open_list )
+		netdev_irq_idle_stop ( netdev );
+}
+
+/** Network idle startup/shutdown function */
+struct startup_fn net_idle_startup_fn __startup_fn ( STARTUP_LATE ) = {
+	.startup = net_idle_startup,
+	.shutdown = net_idle_shutdown,
+};
+
 /** Networking stack process */
 struct process net_process __permanent_process = {
 	.list = LIST_HEAD_INIT ( net_process.list ),
 	.step = net_step,
+	.priority = PROCESS_PRIO_NETWORK,
+	.name = "net",
 };
@@ -171,22 +171,32 @@ static void timer_expired ( struct retry_timer *timer ) {
  * Single-step the retry timer list
  *
  * @v process		Retry timer process
+ *
+ * The process yields if no timer has expired, so that checking the
+ * timer list is not mistaken for progress.
  */
-static void retry_step ( struct process *process __unused ) {
+static void retry_step ( struct process *process ) {
 	struct retry_timer *timer;
 	struct retry_timer *tmp;
 	unsigned long now = currticks();
 	unsigned long used;
+	int expired = 0;
 
 	list_for_each_entry_safe ( timer, tmp, &timers, list ) {
 		used = ( now - timer->start );
-		if ( used >= timer->timeout )
+		if ( used >= timer->timeout ) {
 			timer_expired ( timer );
+			expired = 1;
+		}
 	}
+	if ( ! expired )
+		process_yield ( process );
 }
 
 /** Retry timer process */
 struct process retry_process __permanent_process = {
 	.list = LIST_HEAD_INIT ( retry_process.list ),
 	.step = retry_step,
+	.priority = PROCESS_PRIO_NORMAL,
+	.name = "retry",
 };
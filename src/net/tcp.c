@@ -1,3 +1,4 @@
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -12,8 +13,12 @@
 #include <gpxe/xfer.h>
 #include <gpxe/open.h>
 #include <gpxe/uri.h>
+#include <gpxe/netdevice.h>
 #include <gpxe/tcpip.h>
 #include <gpxe/tcp.h>
+#include <gpxe/bootprof.h>
+#include <gpxe/settings.h>
+#include <gpxe/netstats.h>
 
 /** @file
  *
@@ -78,6 +83,14 @@ struct tcp_connection {
 	 * Equivalent to TS.Recent in RFC 1323 terminology.
 	 */
 	uint32_t ts_recent;
+	/** Maximum segment size
+	 *
+	 * This is the largest payload (excluding TCP options) that
+	 * may be sent in a single segment.  It is initially derived
+	 * from the MTU of the network device used to reach the peer,
+	 * and is reduced if the peer advertises a smaller MSS.
+	 */
+	size_t mss;
 
 	/** Transmit queue */
 	struct list_head tx_queue;
@@ -87,6 +100,11 @@ struct tcp_connection {
 	struct retry_timer timer;
 	/** Shutdown (TIME_WAIT) timer */
 	struct retry_timer wait;
+
+	/** Smoothed round-trip time (in ticks) */
+	unsigned long srtt;
+	/** Number of retransmissions */
+	unsigned int retransmits;
 };
 
 /** TCP flags */
@@ -127,6 +145,20 @@ struct tcp_rx_queued_header {
  */
 static LIST_HEAD ( tcp_conns );
 
+/** TCP statistics */
+static struct {
+	/** Number of connections opened */
+	unsigned long connections;
+	/** Number of retransmissions */
+	unsigned long retransmits;
+	/** Most recent smoothed round-trip time (in ticks) */
+	unsigned long srtt;
+	/** Maximum round-trip time sample (in ticks) */
+	unsigned long rtt_max;
+	/** Most recent send window */
+	unsigned long window;
+} tcp_stats;
+
 /* Forward declarations */
 static struct xfer_interface_operations tcp_xfer_operations;
 static void tcp_expired ( struct retry_timer *timer, int over );
@@ -241,6 +273,26 @@ static int tcp_bind ( struct tcp_connection *tcp, unsigned int port ) {
 	return 0;
 }
 
+/**
+ * Calculate maximum segment size for a peer
+ *
+ * @v st_peer		Peer address
+ * @ret mss		Maximum segment size
+ */
+static size_t tcp_mss ( struct sockaddr_tcpip *st_peer ) {
+	struct net_device *netdev;
+
+	/* Use default MSS if the peer is not yet reachable */
+	netdev = tcpip_netdev ( st_peer );
+	if ( ! netdev )
+		return TCP_MSS;
+
+	/* Allow for the network-layer and TCP headers */
+	if ( st_peer->st_family == AF_INET6 )
+		return ( netdev->mtu - TCP_MSS_IPV6_OVERHEAD );
+	return ( netdev->mtu - TCP_MSS_IPV4_OVERHEAD );
+}
+
 /**
  * Open a TCP connection
  *
@@ -273,6 +325,7 @@ static int tcp_open ( struct xfer_interface *xfer, struct sockaddr *peer,
 	INIT_LIST_HEAD ( &tcp->tx_queue );
 	INIT_LIST_HEAD ( &tcp->rx_queue );
 	memcpy ( &tcp->peer, st_peer, sizeof ( tcp->peer ) );
+	tcp->mss = tcp_mss ( &tcp->peer );
 
 	/* Bind to local port */
 	bind_port = ( st_local ? ntohs ( st_local->st_port ) : 0 );
@@ -281,6 +334,8 @@ static int tcp_open ( struct xfer_interface *xfer, struct sockaddr *peer,
 
 	/* Start timer to initiate SYN */
 	start_timer_nodelay ( &tcp->timer );
+	bootprof_trace ( "tcp-connect", NULL );
+	tcp_stats.connections++;
 
 	/* Attach parent interface, transfer reference to connection
 	 * list and return
@@ -307,6 +362,9 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 	struct io_buffer *iobuf;
 	struct io_buffer *tmp;
 
+	DBGC ( tcp, "TCP %p closing after %d retransmissions (RTT %ld ticks)\n",
+	       tcp, tcp->retransmits, tcp->srtt );
+
 	/* Close data transfer interface */
 	xfer_nullify ( &tcp->xfer );
 	xfer_close ( &tcp->xfer, rc );
@@ -336,6 +394,7 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
 
 		/* Remove from list and drop reference */
 		stop_timer ( &tcp->timer );
+		stop_timer ( &tcp->wait );
 		list_del ( &tcp->list );
 		ref_put ( &tcp->refcnt );
 		DBGC ( tcp, "TCP %p connection deleted\n", tcp );
@@ -370,20 +429,53 @@ static void tcp_close ( struct tcp_connection *tcp, int rc ) {
  * @ret len		Maximum length that can be sent in a single packet
  */
 static size_t tcp_xmit_win ( struct tcp_connection *tcp ) {
+	struct net_device *netdev;
+	size_t max_len = tcp->mss;
 	size_t len;
 
 	/* Not ready if we're not in a suitable connection state */
 	if ( ! TCP_CAN_SEND_DATA ( tcp->tcp_state ) )
 		return 0;
 
-	/* Length is the minimum of the receiver's window and the path MTU */
+	/* Leave room for the timestamp option, if used */
+	if ( tcp->flags & TCP_TS_ENABLED )
+		max_len -= sizeof ( struct tcp_timestamp_padded_option );
+
+	/* Allow oversized packets if the device can segment them */
+	netdev = tcpip_netdev ( &tcp->peer );
+	if ( netdev && ( netdev->features & NETDEV_F_TSO ) )
+		max_len = TCP_TSO_MAX_LEN;
+
+	/* Length is the minimum of the receiver's window and the
+	 * maximum packet length
+	 */
 	len = tcp->snd_win;
-	if ( len > TCP_PATH_MTU )
-		len = TCP_PATH_MTU;
+	if ( len > max_len )
+		len = max_len;
 
 	return len;
 }
 
+/**
+ * Calculate maximum receive window
+ *
+ * @v tcp		TCP connection
+ * @ret max_win		Maximum receive window
+ *
+ * The window must always be able to hold a couple of maximum-sized
+ * segments, otherwise a peer sending jumbo frames would be unable to
+ * fill them.
+ */
+static uint32_t tcp_max_window ( struct tcp_connection *tcp ) {
+	uint32_t max_win = TCP_MAX_WINDOW_SIZE;
+
+	if ( max_win < ( TCP_MIN_WINDOW_SEGMENTS * tcp->mss ) )
+		max_win = ( TCP_MIN_WINDOW_SEGMENTS * tcp->mss );
+	if ( max_win > TCP_WINDOW_LIMIT )
+		max_win = TCP_WINDOW_LIMIT;
+	return max_win;
+}
+
 /**
  * Process TCP transmit queue
  *
@@ -448,6 +540,7 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 	uint32_t seq_len;
 	uint32_t app_win;
 	uint32_t max_rcv_win;
+	size_t seg_len;
 	int rc;
 
 	/* If retransmission timer is already running, do nothing */
@@ -497,8 +590,8 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 
 	/* Expand receive window if possible */
 	max_rcv_win = ( ( freemem * 3 ) / 4 );
-	if ( max_rcv_win > TCP_MAX_WINDOW_SIZE )
-		max_rcv_win = TCP_MAX_WINDOW_SIZE;
+	if ( max_rcv_win > tcp_max_window ( tcp ) )
+		max_rcv_win = tcp_max_window ( tcp );
 	app_win = xfer_window ( &tcp->xfer );
 	if ( max_rcv_win > app_win )
 		max_rcv_win = app_win;
@@ -512,7 +605,7 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 		mssopt = iob_push ( iobuf, sizeof ( *mssopt ) );
 		mssopt->kind = TCP_OPTION_MSS;
 		mssopt->length = sizeof ( *mssopt );
-		mssopt->mss = htons ( TCP_MSS );
+		mssopt->mss = htons ( tcp->mss );
 	}
 	if ( ( flags & TCP_SYN ) || ( tcp->flags & TCP_TS_ENABLED ) ) {
 		tsopt = iob_push ( iobuf, sizeof ( *tsopt ) );
@@ -533,7 +626,21 @@ static int tcp_xmit ( struct tcp_connection *tcp ) {
 	tcphdr->hlen = ( ( payload - iobuf->data ) << 2 );
 	tcphdr->flags = flags;
 	tcphdr->win = htons ( tcp->rcv_win );
-	tcphdr->csum = tcpip_chksum ( iobuf->data, iob_len ( iobuf ) );
+
+	/* Defer checksum to the network layer, which may in turn
+	 * defer it to the hardware.  Packets larger than the path MTU
+	 * can arise only when the device supports segmentation.
+	 */
+	iobuf->flags = IOB_CSUM_PARTIAL;
+	iobuf->csum_start = ( iobuf->data - iobuf->head );
+	iobuf->csum_offset = offsetof ( struct tcp_header, csum );
+	iobuf->flow = tcpip_flow ( tcphdr->src, tcphdr->dest );
+	seg_len = ( tcp->mss -
+		    ( ( payload - iobuf->data ) - sizeof ( *tcphdr ) ) );
+	if ( len > seg_len ) {
+		iobuf->flags |= IOB_TSO;
+		iobuf->mss = seg_len;
+	}
 
 	/* Dump header */
 	DBGC2 ( tcp, "TCP %p TX %d->%d %08x..%08x           %08x %4zd",
@@ -588,6 +695,8 @@ static void tcp_expired ( struct retry_timer *timer, int over ) {
 		tcp_close ( tcp, -ETIMEDOUT );
 	} else {
 		/* Otherwise, retransmit the packet */
+		tcp->retransmits++;
+		tcp_stats.retransmits++;
 		tcp_xmit ( tcp );
 	}
 }
@@ -759,11 +868,22 @@ static void tcp_rx_seq ( struct tcp_connection *tcp, uint32_t seq_len ) {
 static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 			struct tcp_options *options ) {
 
+	size_t mss;
+
 	/* Synchronise sequence numbers on first SYN */
 	if ( ! ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) ) {
 		tcp->rcv_ack = seq;
 		if ( options->tsopt )
 			tcp->flags |= TCP_TS_ENABLED;
+		if ( options->mssopt ) {
+			mss = ntohs ( options->mssopt->mss );
+			if ( mss && ( mss < tcp->mss ) ) {
+				DBGC ( tcp, "TCP %p using peer MSS %zd\n",
+				       tcp, mss );
+				tcp->mss = mss;
+			}
+		}
+		bootprof_trace ( "tcp-established", NULL );
 	}
 
 	/* Ignore duplicate SYN */
@@ -780,6 +900,29 @@ static int tcp_rx_syn ( struct tcp_connection *tcp, uint32_t seq,
 	return 0;
 }
 
+/**
+ * Record TCP round-trip time sample
+ *
+ * @v tcp		TCP connection
+ * @v rtt		Round-trip time sample (in ticks)
+ */
+static void tcp_rtt ( struct tcp_connection *tcp, unsigned long rtt ) {
+
+	/* Smooth according to s := ( 7 s + r ) / 8 */
+	if ( tcp->srtt ) {
+		tcp->srtt = ( ( ( 7 * tcp->srtt ) + rtt ) / 8 );
+	} else {
+		tcp->srtt = rtt;
+	}
+	DBGC2 ( tcp, "TCP %p RTT %ld (smoothed %ld) ticks\n",
+		tcp, rtt, tcp->srtt );
+
+	/* Update statistics */
+	tcp_stats.srtt = tcp->srtt;
+	if ( rtt > tcp_stats.rtt_max )
+		tcp_stats.rtt_max = rtt;
+}
+
 /**
  * Handle TCP received ACK
  *
@@ -822,6 +965,12 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	if ( ack_len == 0 )
 		return 0;
 
+	/* Update round-trip time estimate, ignoring samples from
+	 * retransmitted segments (Karn's algorithm)
+	 */
+	if ( timer_running ( &tcp->timer ) && ( tcp->timer.count == 0 ) )
+		tcp_rtt ( tcp, ( currticks() - tcp->timer.start ) );
+
 	/* Stop the retransmission timer */
 	stop_timer ( &tcp->timer );
 
@@ -836,6 +985,7 @@ static int tcp_rx_ack ( struct tcp_connection *tcp, uint32_t ack,
 	tcp->snd_seq = ack;
 	tcp->snd_sent = 0;
 	tcp->snd_win = win;
+	tcp_stats.window = win;
 
 	/* Remove any acknowledged data from transmit queue */
 	tcp_process_tx_queue ( tcp, len, NULL, 1 );
@@ -1088,8 +1238,9 @@ static int tcp_rx ( struct io_buffer *iobuf,
 		rc = -EINVAL;
 		goto discard;
 	}
-	csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data,
-				       iob_len ( iobuf ) );
+	csum = ( ( iobuf->flags & IOB_CSUM_VALID ) ? 0 :
+		 tcpip_continue_chksum ( pshdr_csum, iobuf->data,
+					 iob_len ( iobuf ) ) );
 	if ( csum != 0 ) {
 		DBG ( "TCP checksum incorrect (is %04x including checksum "
 		      "field, should be 0000)\n", csum );
@@ -1263,6 +1414,24 @@ static size_t tcp_xfer_window ( struct xfer_interface *xfer ) {
 	return tcp_xmit_win ( tcp );
 }
 
+/**
+ * Handle change in application receive window
+ *
+ * @v xfer		Data transfer interface
+ *
+ * Sends a window update, since the peer may otherwise wait for a
+ * zero-window probe before sending any more data.
+ */
+static void tcp_xfer_window_changed ( struct xfer_interface *xfer ) {
+	struct tcp_connection *tcp =
+		container_of ( xfer, struct tcp_connection, xfer );
+
+	if ( tcp->tcp_state & TCP_STATE_RCVD ( TCP_SYN ) ) {
+		tcp->flags |= TCP_ACK_PENDING;
+		tcp_xmit ( tcp );
+	}
+}
+
 /**
  * Deliver datagram as I/O buffer
  *
@@ -1291,6 +1460,7 @@ static struct xfer_interface_operations tcp_xfer_operations = {
 	.close		= tcp_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= tcp_xfer_window,
+	.window_changed	= tcp_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= tcp_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -1346,3 +1516,111 @@ struct uri_opener tcp_uri_opener __uri_opener = {
 	.open		= tcp_open_uri,
 };
 
+
+/***************************************************************************
+ *
+ * Statistics
+ *
+ ***************************************************************************
+ */
+
+/** TCP statistics named settings */
+struct setting tcp_connections_setting __setting = {
+	.name = "tcp-connections",
+	.description = "TCP connections opened",
+	.type = &setting_type_uint32,
+};
+struct setting tcp_retransmits_setting __setting = {
+	.name = "tcp-retransmits",
+	.description = "TCP retransmissions",
+	.type = &setting_type_uint32,
+};
+struct setting tcp_rtt_setting __setting = {
+	.name = "tcp-rtt",
+	.description = "TCP smoothed round-trip time (ms)",
+	.type = &setting_type_uint32,
+};
+struct setting tcp_rtt_max_setting __setting = {
+	.name = "tcp-rtt-max",
+	.description = "TCP maximum round-trip time (ms)",
+	.type = &setting_type_uint32,
+};
+struct setting tcp_window_setting __setting = {
+	.name = "tcp-window",
+	.description = "TCP send window",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Get number of TCP connections opened
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Number of connections
+ */
+static unsigned long tcp_connections ( struct net_device *netdev __unused ) {
+	return tcp_stats.connections;
+}
+
+/**
+ * Get number of TCP retransmissions
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Number of retransmissions
+ */
+static unsigned long tcp_retransmits ( struct net_device *netdev __unused ) {
+	return tcp_stats.retransmits;
+}
+
+/**
+ * Get TCP smoothed round-trip time
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Round-trip time (in ms)
+ */
+static unsigned long tcp_rtt_ms ( struct net_device *netdev __unused ) {
+	return ( ( tcp_stats.srtt * 1000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Get TCP maximum round-trip time
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Round-trip time (in ms)
+ */
+static unsigned long tcp_rtt_max_ms ( struct net_device *netdev __unused ) {
+	return ( ( tcp_stats.rtt_max * 1000 ) / TICKS_PER_SEC );
+}
+
+/**
+ * Get TCP send window
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Send window
+ */
+static unsigned long tcp_window ( struct net_device *netdev __unused ) {
+	return tcp_stats.window;
+}
+
+/** TCP statistics */
+struct net_statistic tcp_statistics[] __net_statistic = {
+	{
+		.setting = &tcp_connections_setting,
+		.value = tcp_connections,
+	},
+	{
+		.setting = &tcp_retransmits_setting,
+		.value = tcp_retransmits,
+	},
+	{
+		.setting = &tcp_rtt_setting,
+		.value = tcp_rtt_ms,
+	},
+	{
+		.setting = &tcp_rtt_max_setting,
+		.value = tcp_rtt_max_ms,
+	},
+	{
+		.setting = &tcp_window_setting,
+		.value = tcp_window,
+	},
+};
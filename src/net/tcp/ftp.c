@@ -359,6 +359,7 @@ static struct xfer_interface_operations ftp_control_operations = {
 	.close		= ftp_control_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ftp_control_deliver_raw,
@@ -426,6 +427,7 @@ static struct xfer_interface_operations ftp_data_operations = {
 	.close		= ftp_data_closed,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= ftp_data_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -458,6 +460,7 @@ static struct xfer_interface_operations ftp_xfer_operations = {
 	.close		= ftp_xfer_closed,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
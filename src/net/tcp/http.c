@@ -466,6 +466,9 @@ static void http_step ( struct process *process ) {
 					  host ) ) != 0 ) {
 			http_done ( http, rc );
 		}
+	} else {
+		/* Nothing to do until the connection is established */
+		process_yield ( process );
 	}
 }
 
@@ -485,11 +488,28 @@ static void http_socket_close ( struct xfer_interface *socket, int rc ) {
 	http_done ( http, rc );
 }
 
+/**
+ * Check HTTP socket flow control window
+ *
+ * @v socket		Transport layer interface
+ * @ret len		Length of window
+ *
+ * The window is that of the data transfer interface, so that a
+ * consumer which applies flow control can throttle the server.
+ */
+static size_t http_socket_window ( struct xfer_interface *socket ) {
+	struct http_request *http =
+		container_of ( socket, struct http_request, socket );
+
+	return xfer_window ( &http->xfer );
+}
+
 /** HTTP socket operations */
 static struct xfer_interface_operations http_socket_operations = {
 	.close		= http_socket_close,
 	.vredirect	= xfer_vreopen,
-	.window		= unlimited_xfer_window,
+	.window		= http_socket_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= http_socket_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -511,11 +531,24 @@ static void http_xfer_close ( struct xfer_interface *xfer, int rc ) {
 	http_done ( http, rc );
 }
 
+/**
+ * Handle change in HTTP data transfer interface flow control window
+ *
+ * @v xfer		Data transfer interface
+ */
+static void http_xfer_window_changed ( struct xfer_interface *xfer ) {
+	struct http_request *http =
+		container_of ( xfer, struct http_request, xfer );
+
+	xfer_window_changed ( &http->socket );
+}
+
 /** HTTP data transfer interface operations */
 static struct xfer_interface_operations http_xfer_operations = {
 	.close		= http_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= http_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
@@ -1193,6 +1193,7 @@ static void iscsi_start_tx ( struct iscsi_session *iscsi ) {
 
 	/* Flag TX engine to start transmitting */
 	iscsi->tx_state = ISCSI_TX_BHS;
+	process_wake ( &iscsi->process );
 }
 
 /**
@@ -1305,7 +1306,8 @@ static void iscsi_tx_step ( struct process *process ) {
 	while ( 1 ) {
 		switch ( iscsi->tx_state ) {
 		case ISCSI_TX_IDLE:
-			/* Stop processing */
+			/* Sleep until iscsi_start_tx() is called */
+			process_sleep ( process );
 			return;
 		case ISCSI_TX_BHS:
 			tx = iscsi_tx_bhs;
@@ -1587,6 +1589,7 @@ static struct xfer_interface_operations iscsi_socket_operations = {
 	.close		= iscsi_socket_close,
 	.vredirect	= iscsi_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= iscsi_socket_deliver_raw,
@@ -1795,6 +1798,8 @@ int iscsi_attach ( struct scsi_device *scsi, const char *root_path ) {
 	ref_init ( &iscsi->refcnt, iscsi_free );
 	xfer_init ( &iscsi->socket, &iscsi_socket_operations, &iscsi->refcnt );
 	process_init ( &iscsi->process, iscsi_tx_step, &iscsi->refcnt );
+	iscsi->process.priority = PROCESS_PRIO_TRANSFER;
+	iscsi->process.name = "iscsi";
 
 	/* Parse root path */
 	if ( ( rc = iscsi_parse_root_path ( iscsi, root_path ) ) != 0 )
@@ -4,6 +4,7 @@
 #include <byteswap.h>
 #include <gpxe/iobuf.h>
 #include <gpxe/tables.h>
+#include <gpxe/netdevice.h>
 #include <gpxe/tcpip.h>
 
 /** @file
@@ -79,6 +80,68 @@ int tcpip_tx ( struct io_buffer *iobuf, struct tcpip_protocol *tcpip_protocol,
 	return -EAFNOSUPPORT;
 }
 
+/**
+ * Identify network device used to reach a TCP/IP address
+ *
+ * @v st_dest		Destination address
+ * @ret netdev		Network device, or NULL if not known
+ */
+struct net_device * tcpip_netdev ( struct sockaddr_tcpip *st_dest ) {
+	struct tcpip_net_protocol *tcpip_net;
+
+	for_each_table_entry ( tcpip_net, TCPIP_NET_PROTOCOLS ) {
+		if ( tcpip_net->sa_family == st_dest->st_family ) {
+			if ( ! tcpip_net->netdev )
+				return NULL;
+			return tcpip_net->netdev ( st_dest );
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Complete a deferred transport-layer checksum
+ *
+ * @v iobuf		I/O buffer marked with IOB_CSUM_PARTIAL
+ * @v netdev		Transmitting network device
+ * @v trans_csum	Transport-layer checksum field
+ * @v pshdr_csum	Pseudo-header checksum
+ *
+ * The pseudo-header checksum is placed into the checksum field.  If
+ * the network device is capable of checksum insertion, the packet is
+ * left marked with IOB_CSUM_PARTIAL for the driver to complete;
+ * otherwise the checksum is completed immediately.
+ */
+void tcpip_tx_csum ( struct io_buffer *iobuf, struct net_device *netdev,
+		     uint16_t *trans_csum, uint16_t pshdr_csum ) {
+
+	/* Seed checksum field with pseudo-header checksum */
+	*trans_csum = ~pshdr_csum;
+
+	/* Complete in software if the device cannot help us */
+	if ( ! ( netdev->features & NETDEV_F_TX_CSUM ) )
+		tcpip_complete_chksum ( iobuf );
+}
+
+/**
+ * Complete a partial transport-layer checksum in software
+ *
+ * @v iobuf		I/O buffer marked with IOB_CSUM_PARTIAL
+ *
+ * This may be used by drivers that cannot offload a particular
+ * packet's checksum (e.g. due to unsupported header layout).
+ */
+void tcpip_complete_chksum ( struct io_buffer *iobuf ) {
+	void *start = ( iobuf->head + iobuf->csum_start );
+	uint16_t *csum = ( start + iobuf->csum_offset );
+
+	assert ( iobuf->flags & IOB_CSUM_PARTIAL );
+	assert ( ! ( iobuf->flags & IOB_TSO ) );
+
+	*csum = tcpip_chksum ( start, ( iobuf->tail - start ) );
+	iobuf->flags &= ~IOB_CSUM_PARTIAL;
+}
+
 /**
  * Calculate continued TCP/IP checkum
  *
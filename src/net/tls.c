@@ -33,8 +33,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/hmac.h>
 #include <gpxe/md5.h>
 #include <gpxe/sha1.h>
+#include <gpxe/sha256.h>
 #include <gpxe/aes.h>
 #include <gpxe/rsa.h>
+#include <gpxe/iobuf.h>
 #include <gpxe/xfer.h>
 #include <gpxe/open.h>
 #include <gpxe/filter.h>
@@ -44,6 +46,8 @@ FILE_LICENCE ( GPL2_OR_LATER );
 
 static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 				const void *data, size_t len );
+static int tls_send_record ( struct tls_session *tls, unsigned int type,
+			     struct io_buffer *iobuf );
 static void tls_clear_cipher ( struct tls_session *tls,
 			       struct tls_cipherspec *cipherspec );
 
@@ -89,7 +93,7 @@ static void free_tls ( struct refcnt *refcnt ) {
 	tls_clear_cipher ( tls, &tls->rx_cipherspec );
 	tls_clear_cipher ( tls, &tls->rx_cipherspec_pending );
 	x509_free_rsa_public_key ( &tls->rsa );
-	free ( tls->rx_data );
+	free_iob ( tls->rx_data );
 
 	/* Free TLS structure itself */
 	free ( tls );	
@@ -241,6 +245,14 @@ static void tls_prf ( struct tls_session *tls, void *secret, size_t secret_len,
 
 	va_start ( seeds, out_len );
 
+	/* TLSv1.2 uses a single SHA-256 based PRF */
+	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
+		tls_p_hash_va ( tls, &sha256_algorithm, secret, secret_len,
+				out, out_len, seeds );
+		va_end ( seeds );
+		return;
+	}
+
 	/* Split secret into two, with an overlap of up to one byte */
 	subsecret_len = ( ( secret_len + 1 ) / 2 );
 	md5_secret = secret;
@@ -327,7 +339,9 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 	struct tls_cipherspec *rx_cipherspec = &tls->rx_cipherspec_pending;
 	size_t hash_size = tx_cipherspec->digest->digestsize;
 	size_t key_size = tx_cipherspec->key_len;
-	size_t iv_size = tx_cipherspec->cipher->blocksize;
+	size_t iv_size = ( is_auth_cipher ( tx_cipherspec->cipher ) ?
+			   tx_cipherspec->fixed_iv_len :
+			   tx_cipherspec->cipher->blocksize );
 	size_t total = ( 2 * ( hash_size + key_size + iv_size ) );
 	uint8_t key_block[total];
 	uint8_t *key;
@@ -378,14 +392,24 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 	DBGC_HD ( tls, key, key_size );
 	key += key_size;
 
-	/* TX initialisation vector */
-	cipher_setiv ( tx_cipherspec->cipher, tx_cipherspec->cipher_ctx, key );
+	/* TX initialisation vector (or fixed part of AEAD nonce) */
+	if ( is_auth_cipher ( tx_cipherspec->cipher ) ) {
+		memcpy ( tx_cipherspec->fixed_iv, key, iv_size );
+	} else {
+		cipher_setiv ( tx_cipherspec->cipher,
+			       tx_cipherspec->cipher_ctx, key );
+	}
 	DBGC ( tls, "TLS %p TX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
 
-	/* RX initialisation vector */
-	cipher_setiv ( rx_cipherspec->cipher, rx_cipherspec->cipher_ctx, key );
+	/* RX initialisation vector (or fixed part of AEAD nonce) */
+	if ( is_auth_cipher ( rx_cipherspec->cipher ) ) {
+		memcpy ( rx_cipherspec->fixed_iv, key, iv_size );
+	} else {
+		cipher_setiv ( rx_cipherspec->cipher,
+			       rx_cipherspec->cipher_ctx, key );
+	}
 	DBGC ( tls, "TLS %p RX IV:\n", tls );
 	DBGC_HD ( tls, key, iv_size );
 	key += iv_size;
@@ -410,7 +434,7 @@ static int tls_generate_keys ( struct tls_session *tls ) {
 static void tls_clear_cipher ( struct tls_session *tls __unused,
 			       struct tls_cipherspec *cipherspec ) {
 	free ( cipherspec->dynamic );
-	memset ( cipherspec, 0, sizeof ( cipherspec ) );
+	memset ( cipherspec, 0, sizeof ( *cipherspec ) );
 	cipherspec->pubkey = &pubkey_null;
 	cipherspec->cipher = &cipher_null;
 	cipherspec->digest = &digest_null;
@@ -425,6 +449,7 @@ static void tls_clear_cipher ( struct tls_session *tls __unused,
  * @v cipher		Bulk encryption cipher algorithm
  * @v digest		MAC digest algorithm
  * @v key_len		Key length
+ * @v fixed_iv_len	Length of fixed part of AEAD nonce
  * @ret rc		Return status code
  */
 static int tls_set_cipher ( struct tls_session *tls,
@@ -432,7 +457,7 @@ static int tls_set_cipher ( struct tls_session *tls,
 			    struct pubkey_algorithm *pubkey,
 			    struct cipher_algorithm *cipher,
 			    struct digest_algorithm *digest,
-			    size_t key_len ) {
+			    size_t key_len, size_t fixed_iv_len ) {
 	size_t total;
 	void *dynamic;
 
@@ -462,6 +487,7 @@ static int tls_set_cipher ( struct tls_session *tls,
 	cipherspec->cipher = cipher;
 	cipherspec->digest = digest;
 	cipherspec->key_len = key_len;
+	cipherspec->fixed_iv_len = fixed_iv_len;
 
 	return 0;
 }
@@ -479,6 +505,8 @@ static int tls_select_cipher ( struct tls_session *tls,
 	struct cipher_algorithm *cipher = &cipher_null;
 	struct digest_algorithm *digest = &digest_null;
 	unsigned int key_len = 0;
+	unsigned int fixed_iv_len = 0;
+	uint16_t min_version = TLS_VERSION_TLS_1_0;
 	int rc;
 
 	switch ( cipher_suite ) {
@@ -492,18 +520,46 @@ static int tls_select_cipher ( struct tls_session *tls,
 		cipher = &aes_cbc_algorithm;
 		digest = &sha1_algorithm;
 		break;
+	case htons ( TLS_RSA_WITH_AES_128_CBC_SHA256 ):
+		key_len = ( 128 / 8 );
+		cipher = &aes_cbc_algorithm;
+		digest = &sha256_algorithm;
+		min_version = TLS_VERSION_TLS_1_2;
+		break;
+	case htons ( TLS_RSA_WITH_AES_256_CBC_SHA256 ):
+		key_len = ( 256 / 8 );
+		cipher = &aes_cbc_algorithm;
+		digest = &sha256_algorithm;
+		min_version = TLS_VERSION_TLS_1_2;
+		break;
+	case htons ( TLS_RSA_WITH_AES_128_GCM_SHA256 ):
+		key_len = ( 128 / 8 );
+		fixed_iv_len = TLS_AEAD_FIXED_IV_LEN;
+		cipher = &aes_gcm_algorithm;
+		min_version = TLS_VERSION_TLS_1_2;
+		break;
 	default:
 		DBGC ( tls, "TLS %p does not support cipher %04x\n",
 		       tls, ntohs ( cipher_suite ) );
 		return -ENOTSUP;
 	}
 
+	/* Check that cipher suite is valid for this protocol version */
+	if ( tls->version < min_version ) {
+		DBGC ( tls, "TLS %p cannot use cipher %04x with protocol "
+		       "version %04x\n", tls, ntohs ( cipher_suite ),
+		       tls->version );
+		return -ENOTSUP;
+	}
+
 	/* Set ciphers */
 	if ( ( rc = tls_set_cipher ( tls, &tls->tx_cipherspec_pending, pubkey,
-				     cipher, digest, key_len ) ) != 0 )
+				     cipher, digest, key_len,
+				     fixed_iv_len ) ) != 0 )
 		return rc;
 	if ( ( rc = tls_set_cipher ( tls, &tls->rx_cipherspec_pending, pubkey,
-				     cipher, digest, key_len ) ) != 0 )
+				     cipher, digest, key_len,
+				     fixed_iv_len ) ) != 0 )
 		return rc;
 
 	DBGC ( tls, "TLS %p selected %s-%s-%d-%s\n", tls,
@@ -528,7 +584,8 @@ static int tls_change_cipher ( struct tls_session *tls,
 	if ( /* FIXME (when pubkey is not hard-coded to RSA):
 	      * ( pending->pubkey == &pubkey_null ) || */
 	     ( pending->cipher == &cipher_null ) ||
-	     ( pending->digest == &digest_null ) ) {
+	     ( ( pending->digest == &digest_null ) &&
+	       ! is_auth_cipher ( pending->cipher ) ) ) {
 		DBGC ( tls, "TLS %p refusing to use null cipher\n", tls );
 		return -ENOTSUP;
 	}
@@ -557,6 +614,8 @@ static void tls_add_handshake ( struct tls_session *tls,
 
 	digest_update ( &md5_algorithm, tls->handshake_md5_ctx, data, len );
 	digest_update ( &sha1_algorithm, tls->handshake_sha1_ctx, data, len );
+	digest_update ( &sha256_algorithm, tls->handshake_sha256_ctx,
+			data, len );
 }
 
 /**
@@ -564,22 +623,34 @@ static void tls_add_handshake ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v out		Output buffer
+ * @ret len		Length of verification hash
  *
- * Calculates the MD5+SHA1 digest over all handshake messages seen so
- * far.
+ * Calculates the MD5+SHA1 digest (or, for TLSv1.2, the SHA256
+ * digest) over all handshake messages seen so far.  The output
+ * buffer must be large enough to hold either form.
  */
-static void tls_verify_handshake ( struct tls_session *tls, void *out ) {
+static size_t tls_verify_handshake ( struct tls_session *tls, void *out ) {
 	struct digest_algorithm *md5 = &md5_algorithm;
 	struct digest_algorithm *sha1 = &sha1_algorithm;
+	struct digest_algorithm *sha256 = &sha256_algorithm;
 	uint8_t md5_ctx[md5->ctxsize];
 	uint8_t sha1_ctx[sha1->ctxsize];
+	uint8_t sha256_ctx[sha256->ctxsize];
 	void *md5_digest = out;
 	void *sha1_digest = ( out + md5->digestsize );
 
+	if ( tls->version >= TLS_VERSION_TLS_1_2 ) {
+		memcpy ( sha256_ctx, tls->handshake_sha256_ctx,
+			 sizeof ( sha256_ctx ) );
+		digest_final ( sha256, sha256_ctx, out );
+		return sha256->digestsize;
+	}
+
 	memcpy ( md5_ctx, tls->handshake_md5_ctx, sizeof ( md5_ctx ) );
 	memcpy ( sha1_ctx, tls->handshake_sha1_ctx, sizeof ( sha1_ctx ) );
 	digest_final ( md5, md5_ctx, md5_digest );
 	digest_final ( sha1, sha1_ctx, sha1_digest );
+	return ( md5->digestsize + sha1->digestsize );
 }
 
 /******************************************************************************
@@ -620,7 +691,7 @@ static int tls_send_client_hello ( struct tls_session *tls ) {
 		uint8_t random[32];
 		uint8_t session_id_len;
 		uint16_t cipher_suite_len;
-		uint16_t cipher_suites[2];
+		uint16_t cipher_suites[5];
 		uint8_t compression_methods_len;
 		uint8_t compression_methods[1];
 	} __attribute__ (( packed )) hello;
@@ -629,11 +700,14 @@ static int tls_send_client_hello ( struct tls_session *tls ) {
 	hello.type_length = ( cpu_to_le32 ( TLS_CLIENT_HELLO ) |
 			      htonl ( sizeof ( hello ) -
 				      sizeof ( hello.type_length ) ) );
-	hello.version = htons ( TLS_VERSION_TLS_1_0 );
+	hello.version = htons ( TLS_VERSION_TLS_1_2 );
 	memcpy ( &hello.random, &tls->client_random, sizeof ( hello.random ) );
 	hello.cipher_suite_len = htons ( sizeof ( hello.cipher_suites ) );
-	hello.cipher_suites[0] = htons ( TLS_RSA_WITH_AES_128_CBC_SHA );
-	hello.cipher_suites[1] = htons ( TLS_RSA_WITH_AES_256_CBC_SHA );
+	hello.cipher_suites[0] = htons ( TLS_RSA_WITH_AES_128_GCM_SHA256 );
+	hello.cipher_suites[1] = htons ( TLS_RSA_WITH_AES_128_CBC_SHA256 );
+	hello.cipher_suites[2] = htons ( TLS_RSA_WITH_AES_256_CBC_SHA256 );
+	hello.cipher_suites[3] = htons ( TLS_RSA_WITH_AES_128_CBC_SHA );
+	hello.cipher_suites[4] = htons ( TLS_RSA_WITH_AES_256_CBC_SHA );
 	hello.compression_methods_len = sizeof ( hello.compression_methods );
 
 	return tls_send_handshake ( tls, &hello, sizeof ( hello ) );
@@ -705,15 +779,16 @@ static int tls_send_finished ( struct tls_session *tls ) {
 		uint8_t verify_data[12];
 	} __attribute__ (( packed )) finished;
 	uint8_t digest[MD5_DIGEST_SIZE + SHA1_DIGEST_SIZE];
+	size_t digest_len;
 
 	memset ( &finished, 0, sizeof ( finished ) );
 	finished.type_length = ( cpu_to_le32 ( TLS_FINISHED ) |
 				 htonl ( sizeof ( finished ) -
 					 sizeof ( finished.type_length ) ) );
-	tls_verify_handshake ( tls, digest );
+	digest_len = tls_verify_handshake ( tls, digest );
 	tls_prf_label ( tls, &tls->master_secret, sizeof ( tls->master_secret ),
 			finished.verify_data, sizeof ( finished.verify_data ),
-			"client finished", digest, sizeof ( digest ) );
+			"client finished", digest, digest_len );
 
 	return tls_send_handshake ( tls, &finished, sizeof ( finished ) );
 }
@@ -819,12 +894,16 @@ static int tls_new_server_hello ( struct tls_session *tls,
 	}
 
 	/* Check protocol version */
-	if ( ntohs ( hello_a->version ) < TLS_VERSION_TLS_1_0 ) {
+	if ( ( ntohs ( hello_a->version ) < TLS_VERSION_TLS_1_0 ) ||
+	     ( ntohs ( hello_a->version ) > TLS_VERSION_TLS_1_2 ) ) {
 		DBGC ( tls, "TLS %p does not support protocol version %d.%d\n",
 		       tls, ( ntohs ( hello_a->version ) >> 8 ),
 		       ( ntohs ( hello_a->version ) & 0xff ) );
 		return -ENOTSUP;
 	}
+	tls->version = ntohs ( hello_a->version );
+	DBGC ( tls, "TLS %p using protocol version %d.%d\n", tls,
+	       ( tls->version >> 8 ), ( tls->version & 0xff ) );
 
 	/* Copy out server random bytes */
 	memcpy ( &tls->server_random, &hello_a->random,
@@ -932,6 +1011,7 @@ static int tls_new_server_hello_done ( struct tls_session *tls,
 
 	/* Start sending the Client Key Exchange */
 	tls->tx_state = TLS_TX_CLIENT_KEY_EXCHANGE;
+	process_wake ( &tls->process );
 
 	return 0;
 }
@@ -1030,29 +1110,41 @@ static int tls_new_handshake ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v type		Record type
- * @v data		Plaintext record
- * @v len		Length of plaintext record
+ * @v iobuf		I/O buffer containing plaintext record
  * @ret rc		Return status code
  */
-static int tls_new_record ( struct tls_session *tls,
-			    unsigned int type, void *data, size_t len ) {
+static int tls_new_record ( struct tls_session *tls, unsigned int type,
+			    struct io_buffer *iobuf ) {
+	void *data = iobuf->data;
+	size_t len = iob_len ( iobuf );
+	int rc;
 
 	switch ( type ) {
 	case TLS_TYPE_CHANGE_CIPHER:
-		return tls_new_change_cipher ( tls, data, len );
+		rc = tls_new_change_cipher ( tls, data, len );
+		break;
 	case TLS_TYPE_ALERT:
-		return tls_new_alert ( tls, data, len );
+		rc = tls_new_alert ( tls, data, len );
+		break;
 	case TLS_TYPE_HANDSHAKE:
-		return tls_new_handshake ( tls, data, len );
+		rc = tls_new_handshake ( tls, data, len );
+		break;
 	case TLS_TYPE_DATA:
-		return xfer_deliver_raw ( &tls->plainstream.xfer, data, len );
+		/* Hand the decrypted buffer straight to the plaintext
+		 * stream, without copying.
+		 */
+		return xfer_deliver_iob ( &tls->plainstream.xfer, iobuf );
 	default:
 		/* RFC4346 says that we should just ignore unknown
 		 * record types.
 		 */
 		DBGC ( tls, "TLS %p ignoring record type %d\n", tls, type );
-		return 0;
+		rc = 0;
+		break;
 	}
+
+	free_iob ( iobuf );
+	return rc;
 }
 
 /******************************************************************************
@@ -1067,191 +1159,150 @@ static int tls_new_record ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v cipherspec	Cipher specification
- * @v seq		Sequence number
- * @v tlshdr		TLS header
+ * @v authhdr		Authentication header
  * @v data		Data
  * @v len		Length of data
  * @v mac		HMAC to fill in
  */
 static void tls_hmac ( struct tls_session *tls __unused,
 		       struct tls_cipherspec *cipherspec,
-		       uint64_t seq, struct tls_header *tlshdr,
+		       struct tls_auth_header *authhdr,
 		       const void *data, size_t len, void *hmac ) {
 	struct digest_algorithm *digest = cipherspec->digest;
 	uint8_t digest_ctx[digest->ctxsize];
 
 	hmac_init ( digest, digest_ctx, cipherspec->mac_secret,
 		    &digest->digestsize );
-	seq = cpu_to_be64 ( seq );
-	hmac_update ( digest, digest_ctx, &seq, sizeof ( seq ) );
-	hmac_update ( digest, digest_ctx, tlshdr, sizeof ( *tlshdr ) );
+	hmac_update ( digest, digest_ctx, authhdr, sizeof ( *authhdr ) );
 	hmac_update ( digest, digest_ctx, data, len );
 	hmac_final ( digest, digest_ctx, cipherspec->mac_secret,
 		     &digest->digestsize, hmac );
 }
 
 /**
- * Allocate and assemble stream-ciphered record from data and MAC portions
+ * Allocate I/O buffer for a transmitted record
  *
  * @v tls		TLS session
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
- * @ret plaintext_len	Length of plaintext record
- * @ret plaintext	Allocated plaintext record
- */
-static void * __malloc tls_assemble_stream ( struct tls_session *tls,
-				    const void *data, size_t len,
-				    void *digest, size_t *plaintext_len ) {
-	size_t mac_len = tls->tx_cipherspec.digest->digestsize;
-	void *plaintext;
-	void *content;
-	void *mac;
-
-	/* Calculate stream-ciphered struct length */
-	*plaintext_len = ( len + mac_len );
-
-	/* Allocate stream-ciphered struct */
-	plaintext = malloc ( *plaintext_len );
-	if ( ! plaintext )
-		return NULL;
-	content = plaintext;
-	mac = ( content + len );
-
-	/* Fill in stream-ciphered struct */
-	memcpy ( content, data, len );
-	memcpy ( mac, digest, mac_len );
-
-	return plaintext;
-}
-
-/**
- * Allocate and assemble block-ciphered record from data and MAC portions
+ * @v len		Length of record content
+ * @ret iobuf		I/O buffer, or NULL
  *
- * @v tls		TLS session
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
- * @ret plaintext_len	Length of plaintext record
- * @ret plaintext	Allocated plaintext record
+ * The I/O buffer will have sufficient headroom and tailroom to allow
+ * the record to be encrypted in place by tls_send_record().
  */
-static void * tls_assemble_block ( struct tls_session *tls,
-				   const void *data, size_t len,
-				   void *digest, size_t *plaintext_len ) {
-	size_t blocksize = tls->tx_cipherspec.cipher->blocksize;
-	size_t iv_len = blocksize;
-	size_t mac_len = tls->tx_cipherspec.digest->digestsize;
-	size_t padding_len;
-	void *plaintext;
-	void *iv;
-	void *content;
-	void *mac;
-	void *padding;
-
-	/* FIXME: TLSv1.1 has an explicit IV */
-	iv_len = 0;
+static struct io_buffer * tls_alloc_iob ( struct tls_session *tls,
+					  size_t len ) {
+	struct io_buffer *iobuf;
 
-	/* Calculate block-ciphered struct length */
-	padding_len = ( ( blocksize - 1 ) & -( iv_len + len + mac_len + 1 ) );
-	*plaintext_len = ( iv_len + len + mac_len + padding_len + 1 );
-
-	/* Allocate block-ciphered struct */
-	plaintext = malloc ( *plaintext_len );
-	if ( ! plaintext )
+	iobuf = xfer_alloc_iob ( &tls->cipherstream.xfer,
+				 ( TLS_TX_HEADROOM + len + TLS_TX_TAILROOM ) );
+	if ( ! iobuf ) {
+		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
+		       "record\n", tls, len );
 		return NULL;
-	iv = plaintext;
-	content = ( iv + iv_len );
-	mac = ( content + len );
-	padding = ( mac + mac_len );
-
-	/* Fill in block-ciphered struct */
-	memset ( iv, 0, iv_len );
-	memcpy ( content, data, len );
-	memcpy ( mac, digest, mac_len );
-	memset ( padding, padding_len, ( padding_len + 1 ) );
-
-	return plaintext;
+	}
+	iob_reserve ( iobuf, TLS_TX_HEADROOM );
+
+	return iobuf;
 }
 
 /**
- * Send plaintext record
+ * Send record
  *
  * @v tls		TLS session
  * @v type		Record type
- * @v data		Plaintext record
- * @v len		Length of plaintext record
+ * @v iobuf		I/O buffer containing plaintext record content
  * @ret rc		Return status code
+ *
+ * The record is encrypted in place.  If the I/O buffer does not have
+ * sufficient headroom or tailroom (i.e. was not allocated via
+ * tls_alloc_iob()), then the content will be copied into a new I/O
+ * buffer first.
  */
-static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
-				const void *data, size_t len ) {
-	struct tls_header plaintext_tlshdr;
-	struct tls_header *tlshdr;
+static int tls_send_record ( struct tls_session *tls, unsigned int type,
+			     struct io_buffer *iobuf ) {
 	struct tls_cipherspec *cipherspec = &tls->tx_cipherspec;
-	void *plaintext = NULL;
-	size_t plaintext_len;
-	struct io_buffer *ciphertext = NULL;
-	size_t ciphertext_len;
+	struct cipher_algorithm *cipher = cipherspec->cipher;
+	void *ctx = cipherspec->cipher_next_ctx;
 	size_t mac_len = cipherspec->digest->digestsize;
-	uint8_t mac[mac_len];
+	size_t blocksize = cipher->blocksize;
+	size_t len = iob_len ( iobuf );
+	struct tls_auth_header authhdr;
+	struct tls_aead_nonce nonce;
+	struct tls_header *tlshdr;
+	struct io_buffer *copy;
+	size_t padding_len;
 	int rc;
 
-	/* Construct header */
-	plaintext_tlshdr.type = type;
-	plaintext_tlshdr.version = htons ( TLS_VERSION_TLS_1_0 );
-	plaintext_tlshdr.length = htons ( len );
-
-	/* Calculate MAC */
-	tls_hmac ( tls, cipherspec, tls->tx_seq, &plaintext_tlshdr,
-		   data, len, mac );
-
-	/* Allocate and assemble plaintext struct */
-	if ( is_stream_cipher ( cipherspec->cipher ) ) {
-		plaintext = tls_assemble_stream ( tls, data, len, mac,
-						  &plaintext_len );
-	} else {
-		plaintext = tls_assemble_block ( tls, data, len, mac,
-						 &plaintext_len );
-	}
-	if ( ! plaintext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "plaintext\n", tls, plaintext_len );
-		rc = -ENOMEM;
-		goto done;
+	/* Ensure that we can encrypt in place */
+	if ( ( iob_headroom ( iobuf ) < TLS_TX_HEADROOM ) ||
+	     ( iob_tailroom ( iobuf ) < TLS_TX_TAILROOM ) ) {
+		copy = tls_alloc_iob ( tls, len );
+		if ( ! copy ) {
+			rc = -ENOMEM;
+			goto done;
+		}
+		memcpy ( iob_put ( copy, len ), iobuf->data, len );
+		free_iob ( iobuf );
+		iobuf = copy;
 	}
 
 	DBGC2 ( tls, "Sending plaintext data:\n" );
-	DBGC2_HD ( tls, plaintext, plaintext_len );
-
-	/* Allocate ciphertext */
-	ciphertext_len = ( sizeof ( *tlshdr ) + plaintext_len );
-	ciphertext = xfer_alloc_iob ( &tls->cipherstream.xfer,
-				      ciphertext_len );
-	if ( ! ciphertext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "ciphertext\n", tls, ciphertext_len );
-		rc = -ENOMEM;
-		goto done;
+	DBGC2_HD ( tls, iobuf->data, len );
+
+	/* Construct authentication header */
+	authhdr.seq = cpu_to_be64 ( tls->tx_seq );
+	authhdr.header.type = type;
+	authhdr.header.version = htons ( tls->version );
+	authhdr.header.length = htons ( len );
+
+	/* Encrypt using a copy of the cipher context, so that the
+	 * cipher state is unaffected if transmission fails.
+	 */
+	memcpy ( ctx, cipherspec->cipher_ctx, cipher->ctxsize );
+	if ( is_auth_cipher ( cipher ) ) {
+		/* Nonce is the fixed IV plus the sequence number,
+		 * which is also sent as the explicit nonce.
+		 */
+		memcpy ( nonce.fixed, cipherspec->fixed_iv,
+			 sizeof ( nonce.fixed ) );
+		nonce.record = authhdr.seq;
+		cipher_setiv ( cipher, ctx, &nonce );
+		cipher_encrypt ( cipher, ctx, &authhdr, NULL,
+				 sizeof ( authhdr ) );
+		cipher_encrypt ( cipher, ctx, iobuf->data, iobuf->data, len );
+		cipher_auth ( cipher, ctx, iob_put ( iobuf, cipher->authsize ));
+		memcpy ( iob_push ( iobuf, sizeof ( nonce.record ) ),
+			 &nonce.record, sizeof ( nonce.record ) );
+	} else {
+		/* Append MAC */
+		tls_hmac ( tls, cipherspec, &authhdr, iobuf->data, len,
+			   iob_put ( iobuf, mac_len ) );
+		if ( ! is_stream_cipher ( cipher ) ) {
+			/* Append padding */
+			padding_len = ( ( blocksize - 1 ) &
+					-( len + mac_len + 1 ) );
+			memset ( iob_put ( iobuf, ( padding_len + 1 ) ),
+				 padding_len, ( padding_len + 1 ) );
+			/* Prepend explicit IV (TLSv1.1 and later) */
+			if ( tls->version >= TLS_VERSION_TLS_1_1 ) {
+				tls_generate_random ( iob_push ( iobuf,
+								 blocksize ),
+						      blocksize );
+			}
+		}
+		cipher_encrypt ( cipher, ctx, iobuf->data, iobuf->data,
+				 iob_len ( iobuf ) );
 	}
 
-	/* Assemble ciphertext */
-	tlshdr = iob_put ( ciphertext, sizeof ( *tlshdr ) );
+	/* Prepend record header */
+	tlshdr = iob_push ( iobuf, sizeof ( *tlshdr ) );
 	tlshdr->type = type;
-	tlshdr->version = htons ( TLS_VERSION_TLS_1_0 );
-	tlshdr->length = htons ( plaintext_len );
-	memcpy ( cipherspec->cipher_next_ctx, cipherspec->cipher_ctx,
-		 cipherspec->cipher->ctxsize );
-	cipher_encrypt ( cipherspec->cipher, cipherspec->cipher_next_ctx,
-			 plaintext, iob_put ( ciphertext, plaintext_len ),
-			 plaintext_len );
-
-	/* Free plaintext as soon as possible to conserve memory */
-	free ( plaintext );
-	plaintext = NULL;
+	tlshdr->version = htons ( tls->version );
+	tlshdr->length = htons ( iob_len ( iobuf ) - sizeof ( *tlshdr ) );
 
 	/* Send ciphertext */
-	rc = xfer_deliver_iob ( &tls->cipherstream.xfer, ciphertext );
-	ciphertext = NULL;
-	if ( rc != 0 ) {
+	if ( ( rc = xfer_deliver_iob ( &tls->cipherstream.xfer,
+				       iob_disown ( iobuf ) ) ) != 0 ) {
 		DBGC ( tls, "TLS %p could not deliver ciphertext: %s\n",
 		       tls, strerror ( rc ) );
 		goto done;
@@ -1259,50 +1310,59 @@ static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
 
 	/* Update TX state machine to next record */
 	tls->tx_seq += 1;
-	memcpy ( tls->tx_cipherspec.cipher_ctx,
-		 tls->tx_cipherspec.cipher_next_ctx,
-		 tls->tx_cipherspec.cipher->ctxsize );
+	memcpy ( cipherspec->cipher_ctx, cipherspec->cipher_next_ctx,
+		 cipher->ctxsize );
 
  done:
-	free ( plaintext );
-	free_iob ( ciphertext );
+	free_iob ( iobuf );
 	return rc;
 }
 
+/**
+ * Send plaintext record
+ *
+ * @v tls		TLS session
+ * @v type		Record type
+ * @v data		Plaintext record
+ * @v len		Length of plaintext record
+ * @ret rc		Return status code
+ */
+static int tls_send_plaintext ( struct tls_session *tls, unsigned int type,
+				const void *data, size_t len ) {
+	struct io_buffer *iobuf;
+
+	/* Allocate I/O buffer with room to encrypt in place */
+	iobuf = tls_alloc_iob ( tls, len );
+	if ( ! iobuf )
+		return -ENOMEM;
+	memcpy ( iob_put ( iobuf, len ), data, len );
+
+	return tls_send_record ( tls, type, iobuf );
+}
+
 /**
  * Split stream-ciphered record into data and MAC portions
  *
  * @v tls		TLS session
- * @v plaintext		Plaintext record
- * @v plaintext_len	Length of record
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
+ * @v iobuf		I/O buffer containing decrypted record
+ * @ret mac		MAC digest
  * @ret rc		Return status code
+ *
+ * On success, the I/O buffer is trimmed to contain only the record
+ * content.
  */
 static int tls_split_stream ( struct tls_session *tls,
-			      void *plaintext, size_t plaintext_len,
-			      void **data, size_t *len, void **digest ) {
-	void *content;
-	size_t content_len;
-	void *mac;
-	size_t mac_len;
+			      struct io_buffer *iobuf, void **mac ) {
+	size_t mac_len = tls->rx_cipherspec.digest->digestsize;
 
 	/* Decompose stream-ciphered data */
-	mac_len = tls->rx_cipherspec.digest->digestsize;
-	if ( plaintext_len < mac_len ) {
+	if ( iob_len ( iobuf ) < mac_len ) {
 		DBGC ( tls, "TLS %p received underlength record\n", tls );
-		DBGC_HD ( tls, plaintext, plaintext_len );
+		DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
 		return -EINVAL;
 	}
-	content_len = ( plaintext_len - mac_len );
-	content = plaintext;
-	mac = ( content + content_len );
-
-	/* Fill in return values */
-	*data = content;
-	*len = content_len;
-	*digest = mac;
+	iob_unput ( iobuf, mac_len );
+	*mac = iobuf->tail;
 
 	return 0;
 }
@@ -1311,64 +1371,99 @@ static int tls_split_stream ( struct tls_session *tls,
  * Split block-ciphered record into data and MAC portions
  *
  * @v tls		TLS session
- * @v plaintext		Plaintext record
- * @v plaintext_len	Length of record
- * @ret data		Data
- * @ret len		Length of data
- * @ret digest		MAC digest
+ * @v iobuf		I/O buffer containing decrypted record
+ * @ret mac		MAC digest
  * @ret rc		Return status code
+ *
+ * On success, the I/O buffer is trimmed to contain only the record
+ * content.
  */
 static int tls_split_block ( struct tls_session *tls,
-			     void *plaintext, size_t plaintext_len,
-			     void **data, size_t *len,
-			     void **digest ) {
-	void *iv;
+			     struct io_buffer *iobuf, void **mac ) {
+	size_t len = iob_len ( iobuf );
 	size_t iv_len;
-	void *content;
-	size_t content_len;
-	void *mac;
 	size_t mac_len;
-	void *padding;
+	uint8_t *padding;
 	size_t padding_len;
 	unsigned int i;
 
 	/* Decompose block-ciphered data */
-	if ( plaintext_len < 1 ) {
+	if ( len < 1 ) {
 		DBGC ( tls, "TLS %p received underlength record\n", tls );
-		DBGC_HD ( tls, plaintext, plaintext_len );
 		return -EINVAL;
 	}
-	iv_len = tls->rx_cipherspec.cipher->blocksize;
-
-	/* FIXME: TLSv1.1 uses an explicit IV */
-	iv_len = 0;
-
+	iv_len = ( ( tls->version >= TLS_VERSION_TLS_1_1 ) ?
+		   tls->rx_cipherspec.cipher->blocksize : 0 );
 	mac_len = tls->rx_cipherspec.digest->digestsize;
-	padding_len = *( ( uint8_t * ) ( plaintext + plaintext_len - 1 ) );
-	if ( plaintext_len < ( iv_len + mac_len + padding_len + 1 ) ) {
+	padding_len = *( ( uint8_t * ) ( iobuf->tail - 1 ) );
+	if ( len < ( iv_len + mac_len + padding_len + 1 ) ) {
 		DBGC ( tls, "TLS %p received underlength record\n", tls );
-		DBGC_HD ( tls, plaintext, plaintext_len );
+		DBGC_HD ( tls, iobuf->data, len );
 		return -EINVAL;
 	}
-	content_len = ( plaintext_len - iv_len - mac_len - padding_len - 1 );
-	iv = plaintext;
-	content = ( iv + iv_len );
-	mac = ( content + content_len );
-	padding = ( mac + mac_len );
+	padding = ( iobuf->tail - padding_len - 1 );
 
 	/* Verify padding bytes */
 	for ( i = 0 ; i < padding_len ; i++ ) {
-		if ( *( ( uint8_t * ) ( padding + i ) ) != padding_len ) {
+		if ( padding[i] != padding_len ) {
 			DBGC ( tls, "TLS %p received bad padding\n", tls );
-			DBGC_HD ( tls, plaintext, plaintext_len );
+			DBGC_HD ( tls, iobuf->data, len );
 			return -EINVAL;
 		}
 	}
 
-	/* Fill in return values */
-	*data = content;
-	*len = content_len;
-	*digest = mac;
+	/* Strip explicit IV, padding and MAC */
+	iob_pull ( iobuf, iv_len );
+	iob_unput ( iobuf, ( padding_len + 1 + mac_len ) );
+	*mac = iobuf->tail;
+
+	return 0;
+}
+
+/**
+ * Decrypt and authenticate AEAD-ciphered record
+ *
+ * @v tls		TLS session
+ * @v authhdr		Authentication header
+ * @v iobuf		I/O buffer containing ciphertext record
+ * @ret rc		Return status code
+ *
+ * The record is decrypted in place.  On success, the I/O buffer is
+ * trimmed to contain only the record content.
+ */
+static int tls_decrypt_aead ( struct tls_session *tls,
+			      struct tls_auth_header *authhdr,
+			      struct io_buffer *iobuf ) {
+	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
+	struct cipher_algorithm *cipher = cipherspec->cipher;
+	void *ctx = cipherspec->cipher_ctx;
+	size_t authsize = cipher->authsize;
+	struct tls_aead_nonce nonce;
+	uint8_t verify_auth[authsize];
+	size_t len;
+
+	/* Decompose AEAD-ciphered data */
+	if ( iob_len ( iobuf ) < ( sizeof ( nonce.record ) + authsize ) ) {
+		DBGC ( tls, "TLS %p received underlength record\n", tls );
+		DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
+		return -EINVAL;
+	}
+	memcpy ( nonce.fixed, cipherspec->fixed_iv, sizeof ( nonce.fixed ) );
+	memcpy ( &nonce.record, iobuf->data, sizeof ( nonce.record ) );
+	iob_pull ( iobuf, sizeof ( nonce.record ) );
+	len = ( iob_len ( iobuf ) - authsize );
+	iob_unput ( iobuf, authsize );
+
+	/* Decrypt and authenticate */
+	authhdr->header.length = htons ( len );
+	cipher_setiv ( cipher, ctx, &nonce );
+	cipher_decrypt ( cipher, ctx, authhdr, NULL, sizeof ( *authhdr ) );
+	cipher_decrypt ( cipher, ctx, iobuf->data, iobuf->data, len );
+	cipher_auth ( cipher, ctx, verify_auth );
+	if ( memcmp ( iobuf->tail, verify_auth, authsize ) != 0 ) {
+		DBGC ( tls, "TLS %p failed authentication\n", tls );
+		return -EINVAL;
+	}
 
 	return 0;
 }
@@ -1378,68 +1473,74 @@ static int tls_split_block ( struct tls_session *tls,
  *
  * @v tls		TLS session
  * @v tlshdr		Record header
- * @v ciphertext	Ciphertext record
+ * @v iobuf		I/O buffer containing ciphertext record
  * @ret rc		Return status code
+ *
+ * The record is decrypted in place, and the I/O buffer is then passed
+ * up to the record handler.
  */
 static int tls_new_ciphertext ( struct tls_session *tls,
-				struct tls_header *tlshdr, void *ciphertext ) {
-	struct tls_header plaintext_tlshdr;
+				struct tls_header *tlshdr,
+				struct io_buffer *iobuf ) {
 	struct tls_cipherspec *cipherspec = &tls->rx_cipherspec;
-	size_t record_len = ntohs ( tlshdr->length );
-	void *plaintext = NULL;
-	void *data;
-	size_t len;
+	struct cipher_algorithm *cipher = cipherspec->cipher;
+	struct tls_auth_header authhdr;
 	void *mac;
 	size_t mac_len = cipherspec->digest->digestsize;
 	uint8_t verify_mac[mac_len];
 	int rc;
 
-	/* Allocate buffer for plaintext */
-	plaintext = malloc ( record_len );
-	if ( ! plaintext ) {
-		DBGC ( tls, "TLS %p could not allocate %zd bytes for "
-		       "decryption buffer\n", tls, record_len );
-		rc = -ENOMEM;
-		goto done;
-	}
-
-	/* Decrypt the record */
-	cipher_decrypt ( cipherspec->cipher, cipherspec->cipher_ctx,
-			 ciphertext, plaintext, record_len );
+	/* Construct authentication header */
+	authhdr.seq = cpu_to_be64 ( tls->rx_seq );
+	authhdr.header.type = tlshdr->type;
+	authhdr.header.version = tlshdr->version;
 
-	/* Split record into content and MAC */
-	if ( is_stream_cipher ( cipherspec->cipher ) ) {
-		if ( ( rc = tls_split_stream ( tls, plaintext, record_len,
-					       &data, &len, &mac ) ) != 0 )
+	if ( is_auth_cipher ( cipher ) ) {
+		/* Decrypt and verify the record */
+		if ( ( rc = tls_decrypt_aead ( tls, &authhdr, iobuf ) ) != 0 )
 			goto done;
 	} else {
-		if ( ( rc = tls_split_block ( tls, plaintext, record_len,
-					      &data, &len, &mac ) ) != 0 )
+		/* Decrypt the record */
+		if ( iob_len ( iobuf ) & ( cipher->blocksize - 1 ) ) {
+			DBGC ( tls, "TLS %p received misaligned record\n",
+			       tls );
+			rc = -EINVAL;
 			goto done;
-	}
+		}
+		cipher_decrypt ( cipher, cipherspec->cipher_ctx,
+				 iobuf->data, iobuf->data, iob_len ( iobuf ) );
+
+		/* Split record into content and MAC */
+		if ( is_stream_cipher ( cipher ) ) {
+			if ( ( rc = tls_split_stream ( tls, iobuf,
+						       &mac ) ) != 0 )
+				goto done;
+		} else {
+			if ( ( rc = tls_split_block ( tls, iobuf,
+						      &mac ) ) != 0 )
+				goto done;
+		}
 
-	/* Verify MAC */
-	plaintext_tlshdr.type = tlshdr->type;
-	plaintext_tlshdr.version = tlshdr->version;
-	plaintext_tlshdr.length = htons ( len );
-	tls_hmac ( tls, cipherspec, tls->rx_seq, &plaintext_tlshdr,
-		   data, len, verify_mac);
-	if ( memcmp ( mac, verify_mac, mac_len ) != 0 ) {
-		DBGC ( tls, "TLS %p failed MAC verification\n", tls );
-		DBGC_HD ( tls, plaintext, record_len );
-		goto done;
+		/* Verify MAC */
+		authhdr.header.length = htons ( iob_len ( iobuf ) );
+		tls_hmac ( tls, cipherspec, &authhdr, iobuf->data,
+			   iob_len ( iobuf ), verify_mac );
+		if ( memcmp ( mac, verify_mac, mac_len ) != 0 ) {
+			DBGC ( tls, "TLS %p failed MAC verification\n", tls );
+			DBGC_HD ( tls, iobuf->data, iob_len ( iobuf ) );
+			rc = -EINVAL;
+			goto done;
+		}
 	}
 
 	DBGC2 ( tls, "Received plaintext data:\n" );
-	DBGC2_HD ( tls, data, len );
+	DBGC2_HD ( tls, iobuf->data, iob_len ( iobuf ) );
 
 	/* Process plaintext record */
-	if ( ( rc = tls_new_record ( tls, tlshdr->type, data, len ) ) != 0 )
-		goto done;
+	return tls_new_record ( tls, tlshdr->type, iobuf );
 
-	rc = 0;
  done:
-	free ( plaintext );
+	free_iob ( iobuf );
 	return rc;
 }
 
@@ -1481,23 +1582,58 @@ static size_t tls_plainstream_window ( struct xfer_interface *xfer ) {
 }
 
 /**
- * Deliver datagram as raw data
+ * Allocate I/O buffer
  *
  * @v xfer		Plainstream data transfer interface
- * @v data		Data buffer
- * @v len		Length of data buffer
+ * @v len		I/O buffer payload length
+ * @ret iobuf		I/O buffer
+ *
+ * The I/O buffer is allocated with enough headroom and tailroom to
+ * allow it to be encrypted in place.
+ */
+static struct io_buffer * tls_plainstream_alloc_iob ( struct xfer_interface
+						      *xfer, size_t len ) {
+	struct tls_session *tls =
+		container_of ( xfer, struct tls_session, plainstream.xfer );
+
+	return tls_alloc_iob ( tls, len );
+}
+
+/**
+ * Deliver datagram as I/O buffer
+ *
+ * @v xfer		Plainstream data transfer interface
+ * @v iobuf		Datagram I/O buffer
+ * @v meta		Data transfer metadata
  * @ret rc		Return status code
  */
-static int tls_plainstream_deliver_raw ( struct xfer_interface *xfer,
-					 const void *data, size_t len ) {
+static int tls_plainstream_deliver_iob ( struct xfer_interface *xfer,
+					 struct io_buffer *iobuf,
+					 struct xfer_metadata *meta __unused ) {
 	struct tls_session *tls =
 		container_of ( xfer, struct tls_session, plainstream.xfer );
-	
+	int rc;
+
 	/* Refuse unless we are ready to accept data */
-	if ( tls->tx_state != TLS_TX_DATA )
-		return -ENOTCONN;
+	if ( tls->tx_state != TLS_TX_DATA ) {
+		rc = -ENOTCONN;
+		goto err;
+	}
+
+	/* Split oversized buffers into maximum-length records */
+	while ( iob_len ( iobuf ) > TLS_MAX_FRAGMENT_LEN ) {
+		if ( ( rc = tls_send_plaintext ( tls, TLS_TYPE_DATA,
+						 iobuf->data,
+						 TLS_MAX_FRAGMENT_LEN ) ) != 0 )
+			goto err;
+		iob_pull ( iobuf, TLS_MAX_FRAGMENT_LEN );
+	}
+
+	return tls_send_record ( tls, TLS_TYPE_DATA, iobuf );
 
-	return tls_send_plaintext ( tls, TLS_TYPE_DATA, data, len );
+ err:
+	free_iob ( iobuf );
+	return rc;
 }
 
 /** TLS plaintext stream operations */
@@ -1505,9 +1641,10 @@ static struct xfer_interface_operations tls_plainstream_operations = {
 	.close		= tls_plainstream_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= tls_plainstream_window,
-	.alloc_iob	= default_xfer_alloc_iob,
-	.deliver_iob	= xfer_deliver_as_raw,
-	.deliver_raw	= tls_plainstream_deliver_raw,
+	.window_changed	= filter_window_changed,
+	.alloc_iob	= tls_plainstream_alloc_iob,
+	.deliver_iob	= tls_plainstream_deliver_iob,
+	.deliver_raw	= xfer_deliver_as_iob,
 };
 
 /******************************************************************************
@@ -1539,14 +1676,24 @@ static void tls_cipherstream_close ( struct xfer_interface *xfer, int rc ) {
 static int tls_newdata_process_header ( struct tls_session *tls ) {
 	size_t data_len = ntohs ( tls->rx_header.length );
 
-	/* Allocate data buffer now that we know the length */
+	/* Sanity check */
+	if ( data_len > TLS_RX_MAX_LEN ) {
+		DBGC ( tls, "TLS %p received overlength record (%zd bytes)\n",
+		       tls, data_len );
+		return -EINVAL;
+	}
+
+	/* Allocate data buffer now that we know the length.  The
+	 * record will be decrypted in place within this buffer.
+	 */
 	assert ( tls->rx_data == NULL );
-	tls->rx_data = malloc ( data_len );
+	tls->rx_data = alloc_iob ( data_len );
 	if ( ! tls->rx_data ) {
 		DBGC ( tls, "TLS %p could not allocate %zd bytes "
 		       "for receive buffer\n", tls, data_len );
 		return -ENOMEM;
 	}
+	iob_put ( tls->rx_data, data_len );
 
 	/* Move to data state */
 	tls->rx_state = TLS_RX_DATA;
@@ -1565,16 +1712,12 @@ static int tls_newdata_process_data ( struct tls_session *tls ) {
 
 	/* Process record */
 	if ( ( rc = tls_new_ciphertext ( tls, &tls->rx_header,
-					 tls->rx_data ) ) != 0 )
+					 iob_disown ( tls->rx_data ) ) ) != 0 )
 		return rc;
 
 	/* Increment RX sequence number */
 	tls->rx_seq += 1;
 
-	/* Free data buffer */
-	free ( tls->rx_data );
-	tls->rx_data = NULL;
-
 	/* Return to header state */
 	tls->rx_state = TLS_RX_HEADER;
 
@@ -1608,8 +1751,8 @@ static int tls_cipherstream_deliver_raw ( struct xfer_interface *xfer,
 			process = tls_newdata_process_header;
 			break;
 		case TLS_RX_DATA:
-			buf = tls->rx_data;
-			buf_len = ntohs ( tls->rx_header.length );
+			buf = tls->rx_data->data;
+			buf_len = iob_len ( tls->rx_data );
 			process = tls_newdata_process_data;
 			break;
 		default:
@@ -1644,6 +1787,7 @@ static struct xfer_interface_operations tls_cipherstream_operations = {
 	.close		= tls_cipherstream_close,
 	.vredirect	= xfer_vreopen,
 	.window		= filter_window,
+	.window_changed	= filter_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= tls_cipherstream_deliver_raw,
@@ -1672,7 +1816,8 @@ static void tls_step ( struct process *process ) {
 
 	switch ( tls->tx_state ) {
 	case TLS_TX_NONE:
-		/* Nothing to do */
+		/* Nothing to do until the server responds */
+		process_sleep ( process );
 		break;
 	case TLS_TX_CLIENT_HELLO:
 		/* Send Client Hello */
@@ -1719,7 +1864,8 @@ static void tls_step ( struct process *process ) {
 		tls->tx_state = TLS_TX_NONE;
 		break;
 	case TLS_TX_DATA:
-		/* Nothing to do */
+		/* Handshake complete; nothing more to do */
+		process_sleep ( process );
 		break;
 	default:
 		assert ( 0 );
@@ -1757,13 +1903,17 @@ int add_tls ( struct xfer_interface *xfer, struct xfer_interface **next ) {
 	tls->client_random.gmt_unix_time = 0;
 	tls_generate_random ( &tls->client_random.random,
 			      ( sizeof ( tls->client_random.random ) ) );
-	tls->pre_master_secret.version = htons ( TLS_VERSION_TLS_1_0 );
+	tls->version = TLS_VERSION_TLS_1_0;
+	tls->pre_master_secret.version = htons ( TLS_VERSION_TLS_1_2 );
 	tls_generate_random ( &tls->pre_master_secret.random,
 			      ( sizeof ( tls->pre_master_secret.random ) ) );
 	digest_init ( &md5_algorithm, tls->handshake_md5_ctx );
 	digest_init ( &sha1_algorithm, tls->handshake_sha1_ctx );
+	digest_init ( &sha256_algorithm, tls->handshake_sha256_ctx );
 	tls->tx_state = TLS_TX_CLIENT_HELLO;
 	process_init ( &tls->process, tls_step, &tls->refcnt );
+	tls->process.priority = PROCESS_PRIO_TRANSFER;
+	tls->process.name = "tls";
 
 	/* Attach to parent interface, mortalise self, and return */
 	xfer_plug_plug ( &tls->plainstream.xfer, xfer );
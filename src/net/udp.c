@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -216,7 +217,10 @@ static int udp_tx ( struct udp_connection *udp, struct io_buffer *iobuf,
 	udphdr->src = src->st_port;
 	udphdr->len = htons ( len );
 	udphdr->chksum = 0;
-	udphdr->chksum = tcpip_chksum ( udphdr, len );
+	iobuf->flags = IOB_CSUM_PARTIAL;
+	iobuf->csum_start = ( iobuf->data - iobuf->head );
+	iobuf->csum_offset = offsetof ( struct udp_header, chksum );
+	iobuf->flow = tcpip_flow ( udphdr->src, udphdr->dest );
 
 	/* Dump debugging information */
 	DBGC ( udp, "UDP %p TX %d->%d len %d\n", udp,
@@ -298,7 +302,7 @@ static int udp_rx ( struct io_buffer *iobuf, struct sockaddr_tcpip *st_src,
 		rc = -EINVAL;
 		goto done;
 	}
-	if ( udphdr->chksum ) {
+	if ( udphdr->chksum && ! ( iobuf->flags & IOB_CSUM_VALID ) ) {
 		csum = tcpip_continue_chksum ( pshdr_csum, iobuf->data, ulen );
 		if ( csum != 0 ) {
 			DBG ( "UDP checksum incorrect (is %04x including "
@@ -414,6 +418,7 @@ static struct xfer_interface_operations udp_xfer_operations = {
 	.close		= udp_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= udp_alloc_iob,
 	.deliver_iob	= udp_xfer_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
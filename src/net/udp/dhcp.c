@@ -28,6 +28,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/if_ether.h>
 #include <gpxe/netdevice.h>
 #include <gpxe/device.h>
+#include <gpxe/list.h>
 #include <gpxe/xfer.h>
 #include <gpxe/open.h>
 #include <gpxe/job.h>
@@ -42,6 +43,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/dhcppkt.h>
 #include <gpxe/dhcp_arch.h>
 #include <gpxe/features.h>
+#include <gpxe/bootprof.h>
 
 /** @file
  *
@@ -82,8 +84,9 @@ static uint8_t dhcp_request_options_data[] = {
 	DHCP_PARAMETER_REQUEST_LIST,
 	DHCP_OPTION ( DHCP_SUBNET_MASK, DHCP_ROUTERS, DHCP_DNS_SERVERS,
 		      DHCP_LOG_SERVERS, DHCP_HOST_NAME, DHCP_DOMAIN_NAME,
-		      DHCP_ROOT_PATH, DHCP_VENDOR_ENCAP, DHCP_VENDOR_CLASS_ID,
-		      DHCP_TFTP_SERVER_NAME, DHCP_BOOTFILE_NAME,
+		      DHCP_ROOT_PATH, DHCP_MTU, DHCP_VENDOR_ENCAP,
+		      DHCP_VENDOR_CLASS_ID, DHCP_TFTP_SERVER_NAME,
+		      DHCP_BOOTFILE_NAME,
 		      DHCP_EB_ENCAP, DHCP_ISCSI_INITIATOR_IQN ),
 	DHCP_END
 };
@@ -115,6 +118,14 @@ struct setting use_cached_setting __setting = {
 	.type = &setting_type_uint8,
 };
 
+/** DHCP early-commit policy setting */
+struct setting dhcp_commit_setting __setting = {
+	.name = "dhcp-commit",
+	.description = "DHCP early-commit policy",
+	.tag = DHCP_EB_COMMIT,
+	.type = &setting_type_uint8,
+};
+
 /**
  * Name a DHCP packet type
  *
@@ -237,6 +248,8 @@ struct dhcp_offer {
 struct dhcp_session {
 	/** Reference counter */
 	struct refcnt refcnt;
+	/** List of active DHCP sessions */
+	struct list_head list;
 	/** Job control interface */
 	struct job_interface job;
 	/** Data transfer interface */
@@ -244,6 +257,8 @@ struct dhcp_session {
 
 	/** Network device being configured */
 	struct net_device *netdev;
+	/** Early-commit policy (a DHCP_COMMIT_XXX value) */
+	unsigned int commit;
 	/** Local socket address */
 	struct sockaddr_in local;
 	/** State of the session */
@@ -267,6 +282,15 @@ struct dhcp_session {
 	struct dhcp_offer offers[DHCP_MAX_OFFERS];
 };
 
+/** Active DHCP sessions
+ *
+ * Sessions on different network devices all listen on the BOOTPC
+ * port, so any one session's socket may receive packets intended for
+ * another.  Received packets are therefore matched to sessions by
+ * transaction ID.
+ */
+static LIST_HEAD ( dhcp_sessions );
+
 /**
  * Free DHCP session
  *
@@ -301,6 +325,13 @@ static void dhcp_finished ( struct dhcp_session *dhcp, int rc ) {
 	/* Stop retry timer */
 	stop_timer ( &dhcp->timer );
 
+	/* Remove from list of active sessions */
+	list_del ( &dhcp->list );
+	INIT_LIST_HEAD ( &dhcp->list );
+
+	if ( rc == 0 )
+		bootprof_trace ( "dhcp-done", dhcp->netdev->name );
+
 	/* Free resources and close interfaces */
 	xfer_close ( &dhcp->xfer, rc );
 	job_done ( &dhcp->job, rc );
@@ -316,6 +347,7 @@ static void dhcp_set_state ( struct dhcp_session *dhcp,
 			     struct dhcp_session_state *state ) {
 
 	DBGC ( dhcp, "DHCP %p entering %s state\n", dhcp, state->name );
+	bootprof_trace ( "dhcp", state->name );
 	dhcp->state = state;
 	dhcp->start = currticks();
 	stop_timer ( &dhcp->timer );
@@ -499,6 +531,45 @@ static void dhcp_rx_offer ( struct dhcp_session *dhcp,
 		offer->valid |= DHCP_OFFER_PXE;
 }
 
+/**
+ * Check whether DHCP discovery is complete
+ *
+ * @v dhcp		DHCP session
+ * @ret complete	DHCP discovery is complete
+ *
+ * We can exit the discovery state when we have a valid DHCPOFFER,
+ * and either:
+ *
+ *  o  The DHCPOFFER instructs us to ignore ProxyDHCPOFFERs, or
+ *  o  We have allowed sufficient time for ProxyDHCPOFFERs, or
+ *  o  The early-commit policy allows us to stop waiting.
+ */
+static int dhcp_discovery_complete ( struct dhcp_session *dhcp ) {
+	unsigned long elapsed = ( currticks() - dhcp->start );
+	struct dhcp_offer *ip_offer;
+
+	/* If we don't yet have a DHCPOFFER, we are not complete */
+	ip_offer = dhcp_next_offer ( dhcp, DHCP_OFFER_IP );
+	if ( ! ip_offer )
+		return 0;
+
+	/* Stop waiting if instructed to, or if we have waited long
+	 * enough for ProxyDHCPOFFERs.
+	 */
+	if ( ip_offer->no_pxedhcp || ( elapsed > PROXYDHCP_MAX_TIMEOUT ) )
+		return 1;
+
+	/* Otherwise, apply early-commit policy */
+	switch ( dhcp->commit ) {
+	case DHCP_COMMIT_FIRST:
+		return 1;
+	case DHCP_COMMIT_WAIT:
+		return 0;
+	default:
+		return ( dhcp_next_offer ( dhcp, DHCP_OFFER_PXE ) != NULL );
+	}
+}
+
 /**
  * Handle received packet during DHCP discovery
  *
@@ -512,29 +583,11 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
 				struct dhcp_packet *dhcppkt,
 				struct sockaddr_in *peer, uint8_t msgtype,
 				struct in_addr server_id ) {
-	unsigned long elapsed;
-	struct dhcp_offer *ip_offer;
 
 	dhcp_rx_offer ( dhcp, dhcppkt, peer, msgtype, server_id );
 
-	/* We can exit the discovery state when we have a valid
-	 * DHCPOFFER, and either:
-	 *
-	 *  o  The DHCPOFFER instructs us to ignore ProxyDHCPOFFERs, or
-	 *  o  We have a valid ProxyDHCPOFFER, or
-	 *  o  We have allowed sufficient time for ProxyDHCPOFFERs.
-	 */
-
-	/* If we don't yet have a DHCPOFFER, do nothing */
-	ip_offer = dhcp_next_offer ( dhcp, DHCP_OFFER_IP );
-	if ( ! ip_offer )
-		return;
-
 	/* If we can't yet transition to DHCPREQUEST, do nothing */
-	elapsed = ( currticks() - dhcp->start );
-	if ( ! ( ip_offer->no_pxedhcp ||
-		 dhcp_next_offer ( dhcp, DHCP_OFFER_PXE ) ||
-		 ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) )
+	if ( ! dhcp_discovery_complete ( dhcp ) )
 		return;
 
 	/* Transition to DHCPREQUEST */
@@ -547,11 +600,9 @@ static void dhcp_discovery_rx ( struct dhcp_session *dhcp,
  * @v dhcp		DHCP session
  */
 static void dhcp_discovery_expired ( struct dhcp_session *dhcp ) {
-	unsigned long elapsed = ( currticks() - dhcp->start );
 
 	/* Give up waiting for ProxyDHCP before we reach the failure point */
-	if ( dhcp_next_offer ( dhcp, DHCP_OFFER_IP ) &&
-	     ( elapsed > PROXYDHCP_MAX_TIMEOUT ) ) {
+	if ( dhcp_discovery_complete ( dhcp ) ) {
 		dhcp_set_state ( dhcp, &dhcp_state_request );
 		return;
 	}
@@ -1272,6 +1323,7 @@ static int dhcp_deliver_iob ( struct xfer_interface *xfer,
 			      struct xfer_metadata *meta ) {
 	struct dhcp_session *dhcp =
 		container_of ( xfer, struct dhcp_session, xfer );
+	struct dhcp_session *xid_dhcp;
 	struct sockaddr_in *peer;
 	size_t data_len;
 	struct dhcp_packet *dhcppkt;
@@ -1312,18 +1364,28 @@ static int dhcp_deliver_iob ( struct xfer_interface *xfer,
 	dhcppkt_fetch ( dhcppkt, DHCP_SERVER_IDENTIFIER,
 			&server_id, sizeof ( server_id ) );
 
-	/* Check for matching transaction ID */
+	/* Identify session with matching transaction ID */
 	if ( dhcphdr->xid != dhcp_xid ( dhcp->netdev ) ) {
-		DBGC ( dhcp, "DHCP %p %s from %s:%d has bad transaction "
-		       "ID\n", dhcp, dhcp_msgtype_name ( msgtype ),
-		       inet_ntoa ( peer->sin_addr ),
-		       ntohs ( peer->sin_port ) );
-		rc = -EINVAL;
-		goto err_xid;
-	};
+		list_for_each_entry ( xid_dhcp, &dhcp_sessions, list ) {
+			if ( dhcphdr->xid == dhcp_xid ( xid_dhcp->netdev ) )
+				break;
+		}
+		if ( &xid_dhcp->list == &dhcp_sessions ) {
+			DBGC ( dhcp, "DHCP %p %s from %s:%d has bad "
+			       "transaction ID\n", dhcp,
+			       dhcp_msgtype_name ( msgtype ),
+			       inet_ntoa ( peer->sin_addr ),
+			       ntohs ( peer->sin_port ) );
+			rc = -EINVAL;
+			goto err_xid;
+		}
+		dhcp = xid_dhcp;
+	}
 
 	/* Handle packet based on current state */
+	ref_get ( &dhcp->refcnt );
 	dhcp->state->rx ( dhcp, dhcppkt, peer, msgtype, server_id );
+	ref_put ( &dhcp->refcnt );
 
  err_xid:
 	dhcppkt_put ( dhcppkt );
@@ -1338,6 +1400,7 @@ static struct xfer_interface_operations dhcp_xfer_operations = {
 	.close		= ignore_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= dhcp_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -1443,12 +1506,14 @@ int start_dhcp ( struct job_interface *job, struct net_device *netdev ) {
 	if ( ! dhcp )
 		return -ENOMEM;
 	ref_init ( &dhcp->refcnt, dhcp_free );
+	list_add ( &dhcp->list, &dhcp_sessions );
 	job_init ( &dhcp->job, &dhcp_job_operations, &dhcp->refcnt );
 	xfer_init ( &dhcp->xfer, &dhcp_xfer_operations, &dhcp->refcnt );
 	timer_init ( &dhcp->timer, dhcp_timer_expired );
 	dhcp->netdev = netdev_get ( netdev );
 	dhcp->local.sin_family = AF_INET;
 	dhcp->local.sin_port = htons ( BOOTPC_PORT );
+	dhcp->commit = fetch_uintz_setting ( NULL, &dhcp_commit_setting );
 
 	/* Instantiate child objects and attach to our interfaces */
 	if ( ( rc = xfer_open_socket ( &dhcp->xfer, SOCK_DGRAM, &dhcp_peer,
@@ -1546,6 +1611,7 @@ int start_pxebs ( struct job_interface *job, struct net_device *netdev,
 	if ( ! dhcp )
 		return -ENOMEM;
 	ref_init ( &dhcp->refcnt, dhcp_free );
+	list_add ( &dhcp->list, &dhcp_sessions );
 	job_init ( &dhcp->job, &dhcp_job_operations, &dhcp->refcnt );
 	xfer_init ( &dhcp->xfer, &dhcp_xfer_operations, &dhcp->refcnt );
 	timer_init ( &dhcp->timer, dhcp_timer_expired );
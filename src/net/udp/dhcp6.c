@@ -736,6 +736,7 @@ static struct xfer_interface_operations dhcp6_xfer_operations = {
 	.close		= ignore_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= dhcp6_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
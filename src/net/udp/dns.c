@@ -25,6 +25,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <strings.h>
 #include <errno.h>
 #include <byteswap.h>
 #include <gpxe/refcnt.h>
@@ -32,52 +33,295 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/open.h>
 #include <gpxe/resolv.h>
 #include <gpxe/retry.h>
+#include <gpxe/timer.h>
+#include <gpxe/process.h>
+#include <gpxe/malloc.h>
 #include <gpxe/tcpip.h>
 #include <gpxe/settings.h>
 #include <gpxe/features.h>
 #include <gpxe/dns.h>
+#include <gpxe/bootprof.h>
 
 /** @file
  *
  * DNS protocol
  *
+ * A and AAAA queries for a name are issued in parallel to every
+ * configured name server, and the first usable answer is taken.  A
+ * records are preferred over AAAA records.  Answers (both positive
+ * and negative) are cached for the lifetime given by their TTLs, so
+ * that repeated lookups of the same name (e.g. for each file
+ * downloaded from a boot server) do not generate further queries.
  */
 
 FEATURE ( FEATURE_PROTOCOL, "DNS", DHCP_EB_FEATURE_DNS, 1 );
 
-/** The DNS server */
-static struct sockaddr_tcpip nameserver = {
-	.st_port = htons ( DNS_PORT ),
-};
+/** The DNS servers */
+static struct sockaddr_tcpip nameservers[DNS_MAX_SERVERS];
+
+/** Number of DNS servers */
+static unsigned int num_nameservers;
 
 /** The local domain */
 static char *localdomain;
 
+/** DNS question indices */
+enum dns_question_index {
+	/** A record question */
+	DNS_QUESTION_A = 0,
+	/** AAAA record question */
+	DNS_QUESTION_AAAA,
+	/** Number of questions */
+	DNS_NUM_QUESTIONS
+};
+
+/** A DNS question within a request */
+struct dns_question {
+	/** Query type (in host byte order) */
+	unsigned int qtype;
+	/** Current query packet */
+	struct dns_query query;
+	/** Location of query info structure within current packet
+	 *
+	 * The query info structure is located immediately after the
+	 * compressed name.
+	 */
+	struct dns_query_info *qinfo;
+	/** Recursion counter */
+	unsigned int recursion;
+	/** Lowest TTL seen while following CNAME records */
+	uint32_t ttl;
+	/** Status code, or -EINPROGRESS if still outstanding */
+	int rc;
+	/** Resolved socket address */
+	struct sockaddr sa;
+};
+
+/** A DNS server socket */
+struct dns_socket {
+	/** DNS request */
+	struct dns_request *dns;
+	/** Data transfer interface */
+	struct xfer_interface xfer;
+	/** Socket is open */
+	int open;
+};
+
 /** A DNS request */
 struct dns_request {
 	/** Reference counter */
 	struct refcnt refcnt;
 	/** Name resolution interface */
 	struct resolv_interface resolv;
-	/** Data transfer interface */
-	struct xfer_interface socket;
+	/** Server sockets */
+	struct dns_socket sockets[DNS_MAX_SERVERS];
+	/** Number of open server sockets */
+	unsigned int num_sockets;
 	/** Retry timer */
 	struct retry_timer timer;
+	/** Completion process (used for cached answers) */
+	struct process process;
 
 	/** Socket address to fill in with resolved address */
 	struct sockaddr sa;
-	/** Current query packet */
-	struct dns_query query;
-	/** Location of query info structure within current packet
+	/** Questions */
+	struct dns_question questions[DNS_NUM_QUESTIONS];
+	/** Fully-qualified name being resolved */
+	char *fqdn;
+};
+
+/******************************************************************************
+ *
+ * Cache
+ *
+ ******************************************************************************
+ */
+
+/** A DNS cache entry */
+struct dns_cache_entry {
+	/** List of cache entries, most recently used first */
+	struct list_head list;
+	/** Query type (in host byte order) */
+	unsigned int qtype;
+	/** Status code (zero for a positive answer) */
+	int rc;
+	/** Resolved socket address (for a positive answer) */
+	struct sockaddr sa;
+	/** Time at which entry was created (in ticks) */
+	unsigned long created;
+	/** Lifetime of entry (in ticks) */
+	unsigned long lifetime;
+	/** Fully-qualified name
 	 *
-	 * The query info structure is located immediately after the
-	 * compressed name.
+	 * Must be at end of structure
 	 */
-	struct dns_query_info *qinfo;
-	/** Recursion counter */
-	unsigned int recursion;
+	char name[0];
+};
+
+/** DNS cache */
+static LIST_HEAD ( dns_cache );
+
+/** Number of entries in DNS cache */
+static unsigned int dns_cache_count;
+
+/**
+ * Remove DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ */
+static void dns_cache_del ( struct dns_cache_entry *entry ) {
+	list_del ( &entry->list );
+	dns_cache_count--;
+	free ( entry );
+}
+
+/**
+ * Find DNS cache entry
+ *
+ * @v name		Fully-qualified name
+ * @v qtype		Query type (in host byte order)
+ * @ret entry		DNS cache entry, or NULL if not found
+ *
+ * Expired entries are removed from the cache as they are encountered.
+ */
+static struct dns_cache_entry * dns_cache_find ( const char *name,
+						 unsigned int qtype ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+	unsigned long now = currticks();
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list ) {
+		if ( ( now - entry->created ) >= entry->lifetime ) {
+			DBG ( "DNS cache expired %s type %d\n",
+			      entry->name, entry->qtype );
+			dns_cache_del ( entry );
+			continue;
+		}
+		if ( ( entry->qtype == qtype ) &&
+		     ( strcasecmp ( entry->name, name ) == 0 ) ) {
+			list_del ( &entry->list );
+			list_add ( &entry->list, &dns_cache );
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Fill in socket address from DNS cache entry
+ *
+ * @v entry		DNS cache entry
+ * @v sa		Socket address to fill in
+ *
+ * The port number within the socket address is left unaltered.
+ */
+static void dns_cache_address ( struct dns_cache_entry *entry,
+				struct sockaddr *sa ) {
+	struct sockaddr_tcpip *st = ( ( struct sockaddr_tcpip * ) sa );
+	uint16_t port = st->st_port;
+
+	memcpy ( sa, &entry->sa, sizeof ( *sa ) );
+	st->st_port = port;
+}
+
+/**
+ * Add DNS cache entry
+ *
+ * @v name		Fully-qualified name
+ * @v qtype		Query type (in host byte order)
+ * @v rc		Status code (zero for a positive answer)
+ * @v sa		Resolved socket address (for a positive answer)
+ * @v ttl		Time to live (in seconds)
+ */
+static void dns_cache_add ( const char *name, unsigned int qtype, int rc,
+			    struct sockaddr *sa, uint32_t ttl ) {
+	struct dns_cache_entry *entry;
+	size_t name_len = ( strlen ( name ) + 1 );
+
+	/* Do not cache answers which must not be cached */
+	if ( ! ttl )
+		return;
+	if ( ttl > DNS_CACHE_MAX_TTL )
+		ttl = DNS_CACHE_MAX_TTL;
+
+	/* Remove any existing entry, and make room for new entry */
+	entry = dns_cache_find ( name, qtype );
+	if ( entry )
+		dns_cache_del ( entry );
+	if ( dns_cache_count >= DNS_CACHE_SIZE ) {
+		dns_cache_del ( list_entry ( dns_cache.prev,
+					     struct dns_cache_entry, list ) );
+	}
+
+	/* Allocate and populate entry */
+	entry = zalloc ( sizeof ( *entry ) + name_len );
+	if ( ! entry )
+		return;
+	entry->qtype = qtype;
+	entry->rc = rc;
+	if ( rc == 0 )
+		memcpy ( &entry->sa, sa, sizeof ( entry->sa ) );
+	entry->created = currticks();
+	entry->lifetime = ( ttl * TICKS_PER_SEC );
+	memcpy ( entry->name, name, name_len );
+	list_add ( &entry->list, &dns_cache );
+	dns_cache_count++;
+
+	DBG ( "DNS cache add %s type %d %s for %ds\n", name, qtype,
+	      ( rc ? "negative" : "positive" ), ttl );
+}
+
+/**
+ * Flush DNS cache
+ *
+ */
+static void dns_cache_flush ( void ) {
+	struct dns_cache_entry *entry;
+	struct dns_cache_entry *tmp;
+
+	list_for_each_entry_safe ( entry, tmp, &dns_cache, list )
+		dns_cache_del ( entry );
+}
+
+/**
+ * Discard some cached DNS answers
+ *
+ * @ret discarded	Number of cached items discarded
+ */
+static unsigned int dns_discard ( void ) {
+
+	if ( list_empty ( &dns_cache ) )
+		return 0;
+	dns_cache_del ( list_entry ( dns_cache.prev,
+				     struct dns_cache_entry, list ) );
+	return 1;
+}
+
+/** DNS cache discarder */
+struct cache_discarder dns_cache_discarder __cache_discarder = {
+	.discard = dns_discard,
 };
 
+/******************************************************************************
+ *
+ * Requests
+ *
+ ******************************************************************************
+ */
+
+/**
+ * Free DNS request
+ *
+ * @v refcnt		Reference counter
+ */
+static void dns_free ( struct refcnt *refcnt ) {
+	struct dns_request *dns =
+		container_of ( refcnt, struct dns_request, refcnt );
+
+	free ( dns->fqdn );
+	free ( dns );
+}
+
 /**
  * Mark DNS request as complete
  *
@@ -85,31 +329,97 @@ struct dns_request {
  * @v rc		Return status code
  */
 static void dns_done ( struct dns_request *dns, int rc ) {
+	unsigned int i;
 
-	/* Stop the retry timer */
+	/* Stop the retry timer and completion process */
 	stop_timer ( &dns->timer );
+	process_del ( &dns->process );
 
-	/* Close data transfer interface */
-	xfer_nullify ( &dns->socket );
-	xfer_close ( &dns->socket, rc );
+	/* Close data transfer interfaces */
+	for ( i = 0 ; i < DNS_MAX_SERVERS ; i++ ) {
+		xfer_nullify ( &dns->sockets[i].xfer );
+		xfer_close ( &dns->sockets[i].xfer, rc );
+		dns->sockets[i].open = 0;
+	}
+	dns->num_sockets = 0;
 
 	/* Mark name resolution as complete */
+	if ( rc == 0 )
+		bootprof_trace ( "dns-done", dns->fqdn );
 	resolv_done ( &dns->resolv, &dns->sa, rc );
 }
 
 /**
- * Compare DNS reply name against the query name from the original request
+ * Determine overall result of DNS request
+ *
+ * @v dns		DNS request
+ * @ret rc		Return status code, or -EINPROGRESS
+ *
+ * An A record is preferred over an AAAA record, so an AAAA record is
+ * used only once the A record question has failed.
+ */
+static int dns_result ( struct dns_request *dns ) {
+	struct dns_question *question;
+	int rc = -EINPROGRESS;
+	unsigned int i;
+
+	for ( i = 0 ; i < DNS_NUM_QUESTIONS ; i++ ) {
+		question = &dns->questions[i];
+		if ( question->rc == 0 ) {
+			memcpy ( &dns->sa, &question->sa, sizeof ( dns->sa ) );
+			return 0;
+		}
+		if ( question->rc == -EINPROGRESS )
+			return -EINPROGRESS;
+		if ( rc == -EINPROGRESS )
+			rc = question->rc;
+	}
+	return rc;
+}
+
+/**
+ * Complete DNS request if possible
+ *
+ * @v dns		DNS request
+ */
+static void dns_check ( struct dns_request *dns ) {
+	int rc;
+
+	rc = dns_result ( dns );
+	if ( rc != -EINPROGRESS )
+		dns_done ( dns, rc );
+}
+
+/**
+ * Record answer to DNS question
  *
  * @v dns		DNS request
+ * @v question		DNS question
+ * @v rc		Status code (zero for a positive answer)
+ * @v ttl		Time to live (in seconds), or zero to avoid caching
+ */
+static void dns_answer ( struct dns_request *dns,
+			 struct dns_question *question, int rc,
+			 uint32_t ttl ) {
+
+	question->rc = rc;
+	dns_cache_add ( dns->fqdn, question->qtype, rc, &question->sa, ttl );
+	dns_check ( dns );
+}
+
+/**
+ * Compare DNS reply name against the query name from the original request
+ *
+ * @v question		DNS question
  * @v reply		DNS reply
  * @v rname		Reply name
  * @ret	zero		Names match
  * @ret non-zero	Names do not match
  */
-static int dns_name_cmp ( struct dns_request *dns,
+static int dns_name_cmp ( struct dns_question *question,
 			  const struct dns_header *reply, 
 			  const char *rname ) {
-	const char *qname = dns->query.payload;
+	const char *qname = question->query.payload;
 	int i;
 
 	while ( 1 ) {
@@ -153,38 +463,108 @@ static const char * dns_skip_name ( const char *name ) {
 	}
 }
 
+/**
+ * Skip over the questions section of a reply packet
+ *
+ * @v reply		DNS reply
+ * @ret p		Start of answers section
+ */
+static const char * dns_skip_questions ( const struct dns_header *reply ) {
+	const char *p = ( ( char * ) reply ) + sizeof ( struct dns_header );
+	int i;
+
+	for ( i = ntohs ( reply->qdcount ) ; i > 0 ; i-- )
+		p = dns_skip_name ( p ) + sizeof ( struct dns_query_info );
+	return p;
+}
+
+/**
+ * Skip over a resource record
+ *
+ * @v rr_info		DNS RR
+ * @ret p		Start of next RR
+ */
+static const char * dns_skip_rr ( const union dns_rr_info *rr_info ) {
+	return ( ( ( const char * ) rr_info ) + sizeof ( rr_info->common ) +
+		 ntohs ( rr_info->common.rdlength ) );
+}
+
 /**
  * Find an RR in a reply packet corresponding to our query
  *
- * @v dns		DNS request
+ * @v question		DNS question
  * @v reply		DNS reply
  * @ret rr		DNS RR, or NULL if not found
+ *
+ * Only RRs of the type being queried for, and CNAME RRs, are
+ * considered.
  */
-static union dns_rr_info * dns_find_rr ( struct dns_request *dns,
+static union dns_rr_info * dns_find_rr ( struct dns_question *question,
 					 const struct dns_header *reply ) {
-	int i, cmp;
-	const char *p = ( ( char * ) reply ) + sizeof ( struct dns_header );
+	const char *p = dns_skip_questions ( reply );
 	union dns_rr_info *rr_info;
-
-	/* Skip over the questions section */
-	for ( i = ntohs ( reply->qdcount ) ; i > 0 ; i-- ) {
-		p = dns_skip_name ( p ) + sizeof ( struct dns_query_info );
-	}
+	unsigned int type;
+	int i, cmp;
 
 	/* Process the answers section */
 	for ( i = ntohs ( reply->ancount ) ; i > 0 ; i-- ) {
-		cmp = dns_name_cmp ( dns, reply, p );
+		cmp = dns_name_cmp ( question, reply, p );
 		p = dns_skip_name ( p );
 		rr_info = ( ( union dns_rr_info * ) p );
-		if ( cmp == 0 )
+		type = ntohs ( rr_info->common.type );
+		if ( ( cmp == 0 ) && ( ( type == question->qtype ) ||
+				       ( type == DNS_TYPE_CNAME ) ) )
 			return rr_info;
-		p += ( sizeof ( rr_info->common ) +
-		       ntohs ( rr_info->common.rdlength ) );
+		p = dns_skip_rr ( rr_info );
 	}
 
 	return NULL;
 }
 
+/**
+ * Determine negative caching TTL from a reply packet
+ *
+ * @v reply		DNS reply
+ * @ret ttl		Time to live (in seconds), or zero
+ *
+ * As described in RFC 2308, the TTL for a negative answer is taken
+ * from the SOA record in the authority section.  If there is no SOA
+ * record, the negative answer must not be cached.
+ */
+static uint32_t dns_negative_ttl ( const struct dns_header *reply ) {
+	const char *p = dns_skip_questions ( reply );
+	const union dns_rr_info *rr_info;
+	const uint32_t *minimum;
+	uint32_t ttl;
+	int i;
+
+	/* Skip over the answers section */
+	for ( i = ntohs ( reply->ancount ) ; i > 0 ; i-- ) {
+		rr_info = ( ( union dns_rr_info * ) dns_skip_name ( p ) );
+		p = dns_skip_rr ( rr_info );
+	}
+
+	/* Look for an SOA record in the authority section */
+	for ( i = ntohs ( reply->nscount ) ; i > 0 ; i-- ) {
+		rr_info = ( ( union dns_rr_info * ) dns_skip_name ( p ) );
+		p = dns_skip_rr ( rr_info );
+		if ( rr_info->common.type != htons ( DNS_TYPE_SOA ) )
+			continue;
+		/* SOA RDATA is MNAME, RNAME, then SERIAL, REFRESH,
+		 * RETRY, EXPIRE and MINIMUM.
+		 */
+		minimum = ( ( const uint32_t * )
+			    dns_skip_name ( dns_skip_name ( rr_info->soa.mname )));
+		minimum += 4;
+		ttl = ntohl ( rr_info->common.ttl );
+		if ( ttl > ntohl ( *minimum ) )
+			ttl = ntohl ( *minimum );
+		return ttl;
+	}
+
+	return 0;
+}
+
 /**
  * Append DHCP domain name if available and name is not fully qualified
  *
@@ -280,26 +660,58 @@ static char * dns_decompress_name ( const struct dns_header *reply,
 }
 
 /**
- * Send next packet in DNS request
+ * Send DNS question to all servers
  *
  * @v dns		DNS request
+ * @v question		DNS question
  */
-static int dns_send_packet ( struct dns_request *dns ) {
+static void dns_send_question ( struct dns_request *dns,
+				struct dns_question *question ) {
 	static unsigned int qid = 0;
 	size_t qlen;
+	unsigned int i;
+	int rc;
 
 	/* Increment query ID */
-	dns->query.dns.id = htons ( ++qid );
+	question->query.dns.id = htons ( ++qid );
+
+	/* Send the data to each server */
+	qlen = ( ( ( void * ) question->qinfo ) -
+		 ( ( void * ) &question->query ) +
+		 sizeof ( *question->qinfo ) );
+	for ( i = 0 ; i < DNS_MAX_SERVERS ; i++ ) {
+		if ( ! dns->sockets[i].open )
+			continue;
+		DBGC ( dns, "DNS %p sending type %d query ID %d to server "
+		       "%d\n", dns, question->qtype, qid, i );
+		if ( ( rc = xfer_deliver_raw ( &dns->sockets[i].xfer,
+					       &question->query,
+					       qlen ) ) != 0 ) {
+			DBGC ( dns, "DNS %p could not send to server %d: "
+			       "%s\n", dns, i, strerror ( rc ) );
+			/* Ignore and rely on retransmission */
+		}
+	}
+}
 
-	DBGC ( dns, "DNS %p sending query ID %d\n", dns, qid );
+/**
+ * Send all outstanding DNS questions
+ *
+ * @v dns		DNS request
+ */
+static void dns_send_packet ( struct dns_request *dns ) {
+	struct dns_question *question;
+	unsigned int i;
 
 	/* Start retransmission timer */
 	start_timer ( &dns->timer );
 
-	/* Send the data */
-	qlen = ( ( ( void * ) dns->qinfo ) - ( ( void * ) &dns->query )
-		 + sizeof ( dns->qinfo ) );
-	return xfer_deliver_raw ( &dns->socket, &dns->query, qlen );
+	/* Send outstanding questions */
+	for ( i = 0 ; i < DNS_NUM_QUESTIONS ; i++ ) {
+		question = &dns->questions[i];
+		if ( question->rc == -EINPROGRESS )
+			dns_send_question ( dns, question );
+	}
 }
 
 /**
@@ -311,9 +723,14 @@ static int dns_send_packet ( struct dns_request *dns ) {
 static void dns_timer_expired ( struct retry_timer *timer, int fail ) {
 	struct dns_request *dns =
 		container_of ( timer, struct dns_request, timer );
+	unsigned int i;
 
 	if ( fail ) {
-		dns_done ( dns, -ETIMEDOUT );
+		for ( i = 0 ; i < DNS_NUM_QUESTIONS ; i++ ) {
+			if ( dns->questions[i].rc == -EINPROGRESS )
+				dns->questions[i].rc = -ETIMEDOUT;
+		}
+		dns_check ( dns );
 	} else {
 		dns_send_packet ( dns );
 	}
@@ -322,20 +739,24 @@ static void dns_timer_expired ( struct retry_timer *timer, int fail ) {
 /**
  * Receive new data
  *
- * @v socket		UDP socket
+ * @v xfer		UDP socket
  * @v data		DNS reply
  * @v len		Length of DNS reply
  * @ret rc		Return status code
  */
-static int dns_xfer_deliver_raw ( struct xfer_interface *socket,
+static int dns_xfer_deliver_raw ( struct xfer_interface *xfer,
 				  const void *data, size_t len ) {
-	struct dns_request *dns =
-		container_of ( socket, struct dns_request, socket );
+	struct dns_socket *socket =
+		container_of ( xfer, struct dns_socket, xfer );
+	struct dns_request *dns = socket->dns;
 	const struct dns_header *reply = data;
+	struct dns_question *question = NULL;
 	union dns_rr_info *rr_info;
 	struct sockaddr_in *sin;
 	struct sockaddr_in6 *sin6;
-	unsigned int qtype = dns->qinfo->qtype;
+	uint32_t ttl;
+	int restart = 0;
+	unsigned int i;
 
 	/* Sanity check */
 	if ( len < sizeof ( *reply ) ) {
@@ -344,29 +765,47 @@ static int dns_xfer_deliver_raw ( struct xfer_interface *socket,
 		return -EINVAL;
 	}
 
-	/* Check reply ID matches query ID */
-	if ( reply->id != dns->query.dns.id ) {
-		DBGC ( dns, "DNS %p received unexpected reply ID %d "
-		       "(wanted %d)\n", dns, ntohs ( reply->id ),
-		       ntohs ( dns->query.dns.id ) );
+	/* Check reply ID matches an outstanding query ID.  Since the
+	 * same query is sent to every server, the first server to
+	 * reply supplies the answer; later replies are ignored.
+	 */
+	for ( i = 0 ; i < DNS_NUM_QUESTIONS ; i++ ) {
+		if ( ( dns->questions[i].rc == -EINPROGRESS ) &&
+		     ( dns->questions[i].query.dns.id == reply->id ) ) {
+			question = &dns->questions[i];
+			break;
+		}
+	}
+	if ( ! question ) {
+		DBGC ( dns, "DNS %p received unexpected reply ID %d\n",
+		       dns, ntohs ( reply->id ) );
 		return -EINVAL;
 	}
 
-	DBGC ( dns, "DNS %p received reply ID %d\n", dns, ntohs ( reply->id ));
+	DBGC ( dns, "DNS %p received reply ID %d from server %d\n", dns,
+	       ntohs ( reply->id ), ( int ) ( socket - dns->sockets ) );
 
-	/* Stop the retry timer.  After this point, each code path
-	 * must either restart the timer by calling dns_send_packet(),
-	 * or mark the DNS operation as complete by calling
-	 * dns_done()
-	 */
-	stop_timer ( &dns->timer );
+	/* Handle nonexistent names */
+	if ( DNS_FLAG_RCODE ( ntohs ( reply->flags ) ) ==
+	     DNS_FLAG_RCODE_NX ) {
+		DBGC ( dns, "DNS %p name does not exist\n", dns );
+		dns_answer ( dns, question, -ENXIO,
+			     dns_negative_ttl ( reply ) );
+		return 0;
+	}
 
 	/* Search through response for useful answers.  Do this
 	 * multiple times, to take advantage of useful nameservers
 	 * which send us e.g. the CNAME *and* the A record for the
 	 * pointed-to name.
 	 */
-	while ( ( rr_info = dns_find_rr ( dns, reply ) ) ) {
+	while ( ( rr_info = dns_find_rr ( question, reply ) ) ) {
+
+		/* Track lowest TTL along the CNAME chain */
+		ttl = ntohl ( rr_info->common.ttl );
+		if ( ttl < question->ttl )
+			question->ttl = ttl;
+
 		switch ( rr_info->common.type ) {
 
 		case htons ( DNS_TYPE_A ):
@@ -374,111 +813,84 @@ static int dns_xfer_deliver_raw ( struct xfer_interface *socket,
 			/* Found the target A record */
 			DBGC ( dns, "DNS %p found address %s\n",
 			       dns, inet_ntoa ( rr_info->a.in_addr ) );
-			sin = ( struct sockaddr_in * ) &dns->sa;
+			sin = ( struct sockaddr_in * ) &question->sa;
 			sin->sin_family = AF_INET;
 			sin->sin_addr = rr_info->a.in_addr;
+			dns_answer ( dns, question, 0, question->ttl );
+			return 0;
 
-			/* Mark operation as complete */
-			dns_done ( dns, 0 );
+		case htons ( DNS_TYPE_AAAA ):
+
+			/* Found the target AAAA record */
+			DBGC ( dns, "DNS %p found address %s\n",
+			       dns, inet6_ntoa ( rr_info->aaaa.in6_addr ) );
+			sin6 = ( struct sockaddr_in6 * ) &question->sa;
+			sin6->sin_family = AF_INET6;
+			sin6->sin6_addr = rr_info->aaaa.in6_addr;
+			dns_answer ( dns, question, 0, question->ttl );
 			return 0;
 
 		case htons ( DNS_TYPE_CNAME ):
 
 			/* Found a CNAME record; update query and recurse */
 			DBGC ( dns, "DNS %p found CNAME\n", dns );
-			dns->qinfo = ( void * ) dns_decompress_name ( reply,
-							 rr_info->cname.cname,
-							 dns->query.payload );
-			dns->qinfo->qtype = htons ( DNS_TYPE_A );
-			dns->qinfo->qclass = htons ( DNS_CLASS_IN );
-			
-			/* Terminate the operation if we recurse too far */
-			if ( ++dns->recursion > DNS_MAX_CNAME_RECURSION ) {
+			question->qinfo = ( void * )
+				dns_decompress_name ( reply,
+						      rr_info->cname.cname,
+						      question->query.payload );
+			question->qinfo->qtype = htons ( question->qtype );
+			question->qinfo->qclass = htons ( DNS_CLASS_IN );
+			restart = 1;
+
+			/* Terminate the question if we recurse too far */
+			if ( ++question->recursion > DNS_MAX_CNAME_RECURSION ) {
 				DBGC ( dns, "DNS %p recursion exceeded\n",
 				       dns );
-				dns_done ( dns, -ELOOP );
+				dns_answer ( dns, question, -ELOOP, 0 );
 				return 0;
 			}
 			break;
-		
-		case htons ( DNS_TYPE_AAAA ):
-
-			/* Found the target AAAA record */
-			DBGC ( dns, "DNS %p found address %s\n",
-			       dns, inet6_ntoa ( rr_info->aaaa.in6_addr ) );
-			sin6 = ( struct sockaddr_in6 * ) &dns->sa;
-			sin6->sin_family = AF_INET6;
-			sin6->sin6_addr = rr_info->aaaa.in6_addr;
-
-			/* Mark operation as complete */
-			dns_done ( dns, 0 );
-			return 0;
 
 		default:
-			DBGC ( dns, "DNS %p got unknown record type %d\n",
-			       dns, ntohs ( rr_info->common.type ) );
+			assert ( 0 );
 			break;
 		}
 	}
-	
-	/* Determine what to do next based on the type of query we
-	 * issued and the reponse we received
-	 */
-	switch ( qtype ) {
-
-	case htons ( DNS_TYPE_A ):
-		/* We asked for an A record and got nothing;
-		 * try the AAAA record.
-		 */
-		DBGC ( dns, "DNS %p found no A record; trying AAAA\n", dns );
-		dns->qinfo->qtype = htons ( DNS_TYPE_AAAA );
-		dns_send_packet ( dns );
-		return 0;
 
-	case htons ( DNS_TYPE_AAAA ):
-		/* We asked for an AAAA record and got nothing;
-		 * try the CNAME.
-		 */
-		DBGC ( dns, "DNS %p found no AAAA record; trying CNAME\n", dns );
-		dns->qinfo->qtype = htons ( DNS_TYPE_CNAME );
-		dns_send_packet ( dns );
-		return 0;
-
-	case htons ( DNS_TYPE_CNAME ):
-		/* We asked for a CNAME record.  If we got a response
-		 * (i.e. if the next AAAA query is already set up), then
-		 * issue it, otherwise abort.
-		 */
-		if ( dns->qinfo->qtype == htons ( DNS_TYPE_AAAA ) ) {
-			dns_send_packet ( dns );
-			return 0;
-		} else {
-			DBGC ( dns, "DNS %p found no CNAME record\n", dns );
-			dns_done ( dns, -ENXIO );
-			return 0;
-		}
-
-	default:
-		assert ( 0 );
-		dns_done ( dns, -EINVAL );
+	/* If we followed a CNAME to a name for which the reply has
+	 * no answer, then ask about the new name.
+	 */
+	if ( restart ) {
+		dns_send_question ( dns, question );
 		return 0;
 	}
+
+	/* Otherwise, the name has no record of this type */
+	DBGC ( dns, "DNS %p found no type %d record\n", dns, question->qtype );
+	dns_answer ( dns, question, -ENXIO, dns_negative_ttl ( reply ) );
+	return 0;
 }
 
 /**
- * Receive new data
+ * Handle close of a DNS server socket
  *
- * @v socket		UDP socket
+ * @v xfer		UDP socket
  * @v rc		Reason for close
  */
-static void dns_xfer_close ( struct xfer_interface *socket, int rc ) {
-	struct dns_request *dns =
-		container_of ( socket, struct dns_request, socket );
+static void dns_xfer_close ( struct xfer_interface *xfer, int rc ) {
+	struct dns_socket *socket =
+		container_of ( xfer, struct dns_socket, xfer );
+	struct dns_request *dns = socket->dns;
 
 	if ( ! rc )
 		rc = -ECONNABORTED;
 
-	dns_done ( dns, rc );
+	/* Close this socket, and fail only when no servers remain */
+	xfer_nullify ( xfer );
+	xfer_close ( xfer, rc );
+	socket->open = 0;
+	if ( --dns->num_sockets == 0 )
+		dns_done ( dns, rc );
 }
 
 /** DNS socket operations */
@@ -486,11 +898,24 @@ static struct xfer_interface_operations dns_socket_operations = {
 	.close		= dns_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= dns_xfer_deliver_raw,
 };
 
+/**
+ * Complete DNS request from cache
+ *
+ * @v process		Process
+ */
+static void dns_step ( struct process *process ) {
+	struct dns_request *dns =
+		container_of ( process, struct dns_request, process );
+
+	dns_check ( dns );
+}
+
 /**
  * Resolve name using DNS
  *
@@ -501,68 +926,110 @@ static struct xfer_interface_operations dns_socket_operations = {
  */
 static int dns_resolv ( struct resolv_interface *resolv,
 			const char *name, struct sockaddr *sa ) {
+	static const unsigned int qtypes[DNS_NUM_QUESTIONS] = {
+		[DNS_QUESTION_A] = DNS_TYPE_A,
+		[DNS_QUESTION_AAAA] = DNS_TYPE_AAAA,
+	};
 	struct dns_request *dns;
-	char *fqdn;
+	struct dns_question *question;
+	struct dns_cache_entry *entry;
+	unsigned int i;
 	int rc;
 
 	/* Fail immediately if no DNS servers */
-	if ( ! nameserver.st_family ) {
+	if ( ! num_nameservers ) {
 		DBG ( "DNS not attempting to resolve \"%s\": "
 		      "no DNS servers\n", name );
 		rc = -ENXIO;
 		goto err_no_nameserver;
 	}
 
-	/* Ensure fully-qualified domain name if DHCP option was given */
-	fqdn = dns_qualify_name ( name );
-	if ( ! fqdn ) {
-		rc = -ENOMEM;
-		goto err_qualify_name;
-	}
-
 	/* Allocate DNS structure */
 	dns = zalloc ( sizeof ( *dns ) );
 	if ( ! dns ) {
 		rc = -ENOMEM;
 		goto err_alloc_dns;
 	}
-	ref_init ( &dns->refcnt, NULL );
+	ref_init ( &dns->refcnt, dns_free );
 	resolv_init ( &dns->resolv, &null_resolv_ops, &dns->refcnt );
-	xfer_init ( &dns->socket, &dns_socket_operations, &dns->refcnt );
+	for ( i = 0 ; i < DNS_MAX_SERVERS ; i++ ) {
+		dns->sockets[i].dns = dns;
+		xfer_init ( &dns->sockets[i].xfer, &dns_socket_operations,
+			    &dns->refcnt );
+	}
 	timer_init ( &dns->timer, dns_timer_expired );
+	process_init_stopped ( &dns->process, dns_step, &dns->refcnt );
 	memcpy ( &dns->sa, sa, sizeof ( dns->sa ) );
 
-	/* Create query */
-	dns->query.dns.flags = htons ( DNS_FLAG_QUERY | DNS_FLAG_OPCODE_QUERY |
-				       DNS_FLAG_RD );
-	dns->query.dns.qdcount = htons ( 1 );
-	dns->qinfo = ( void * ) dns_make_name ( fqdn, dns->query.payload );
-	dns->qinfo->qtype = htons ( DNS_TYPE_A );
-	dns->qinfo->qclass = htons ( DNS_CLASS_IN );
-
-	/* Open UDP connection */
-	if ( ( rc = xfer_open_socket ( &dns->socket, SOCK_DGRAM,
-				       ( struct sockaddr * ) &nameserver,
-				       NULL ) ) != 0 ) {
-		DBGC ( dns, "DNS %p could not open socket: %s\n",
-		       dns, strerror ( rc ) );
-		goto err_open_socket;
+	/* Ensure fully-qualified domain name if DHCP option was given */
+	dns->fqdn = dns_qualify_name ( name );
+	if ( ! dns->fqdn ) {
+		rc = -ENOMEM;
+		goto err_qualify_name;
 	}
+	bootprof_trace ( "dns", dns->fqdn );
+
+	/* Create questions, using cached answers where available */
+	for ( i = 0 ; i < DNS_NUM_QUESTIONS ; i++ ) {
+		question = &dns->questions[i];
+		question->qtype = qtypes[i];
+		memcpy ( &question->sa, sa, sizeof ( question->sa ) );
+		entry = dns_cache_find ( dns->fqdn, question->qtype );
+		if ( entry ) {
+			DBGC ( dns, "DNS %p using cached type %d answer for "
+			       "%s\n", dns, question->qtype, dns->fqdn );
+			question->rc = entry->rc;
+			dns_cache_address ( entry, &question->sa );
+			continue;
+		}
+		question->rc = -EINPROGRESS;
+		question->ttl = DNS_CACHE_MAX_TTL;
+		question->query.dns.flags = htons ( DNS_FLAG_QUERY |
+						    DNS_FLAG_OPCODE_QUERY |
+						    DNS_FLAG_RD );
+		question->query.dns.qdcount = htons ( 1 );
+		question->qinfo = ( void * )
+			dns_make_name ( dns->fqdn, question->query.payload );
+		question->qinfo->qtype = htons ( question->qtype );
+		question->qinfo->qclass = htons ( DNS_CLASS_IN );
+	}
+
+	/* Complete via process if the cache has answered the request */
+	if ( dns_result ( dns ) != -EINPROGRESS ) {
+		process_add ( &dns->process );
+		goto done;
+	}
+
+	/* Open UDP connection to each server */
+	rc = -ENXIO;
+	for ( i = 0 ; i < num_nameservers ; i++ ) {
+		if ( ( rc = xfer_open_socket ( &dns->sockets[i].xfer,
+					       SOCK_DGRAM,
+					       ( struct sockaddr * )
+					       &nameservers[i], NULL ) ) != 0 ){
+			DBGC ( dns, "DNS %p could not open socket to server "
+			       "%d: %s\n", dns, i, strerror ( rc ) );
+			continue;
+		}
+		dns->sockets[i].open = 1;
+		dns->num_sockets++;
+	}
+	if ( ! dns->num_sockets )
+		goto err_open_socket;
 
-	/* Send first DNS packet */
+	/* Send first DNS packets */
 	dns_send_packet ( dns );
 
+ done:
 	/* Attach parent interface, mortalise self, and return */
 	resolv_plug_plug ( &dns->resolv, resolv );
 	ref_put ( &dns->refcnt );
-	free ( fqdn );
 	return 0;	
 
  err_open_socket:
- err_alloc_dns:
-	ref_put ( &dns->refcnt );
  err_qualify_name:
-	free ( fqdn );
+	ref_put ( &dns->refcnt );
+ err_alloc_dns:
  err_no_nameserver:
 	return rc;
 }
@@ -610,24 +1077,45 @@ struct setting domain_setting __setting = {
  * @ret rc		Return status code
  */
 static int apply_dns_settings ( void ) {
-	struct sockaddr_in *sin_nameserver =
-		( struct sockaddr_in * ) &nameserver;
-	struct sockaddr_in6 *sin6_nameserver =
-		( struct sockaddr_in6 * ) &nameserver;
+	struct sockaddr_in *sin_nameserver;
+	struct sockaddr_in6 *sin6_nameserver;
+	struct in_addr servers[DNS_MAX_SERVERS];
+	unsigned int count;
+	unsigned int i;
 	int len;
 
+	/* Cached answers may have come from different servers */
+	dns_cache_flush();
+	memset ( nameservers, 0, sizeof ( nameservers ) );
+	num_nameservers = 0;
+
 	/* Favor IPv6 nameservers if they are available. */
+	sin6_nameserver = ( struct sockaddr_in6 * ) &nameservers[0];
 	if ( ( len = fetch_ipv6_setting ( NULL, &dns6_setting,
 					  &sin6_nameserver->sin6_addr ) ) >= 0 ){
 		sin6_nameserver->sin_family = AF_INET6;
 		DBG ( "DNS using IPv6 nameserver %s\n",
 		      inet6_ntoa ( sin6_nameserver->sin6_addr ) );
-	} else if ( ( len = fetch_ipv4_setting ( NULL, &dns_setting,
-						 &sin_nameserver->sin_addr ) ) >= 0 ){
-		sin_nameserver->sin_family = AF_INET;
-		DBG ( "DNS using nameserver %s\n",
-		      inet_ntoa ( sin_nameserver->sin_addr ) );
+		num_nameservers++;
+	}
+
+	/* Add as many IPv4 nameservers as will fit */
+	if ( ( len = fetch_setting ( NULL, &dns_setting, servers,
+				     sizeof ( servers ) ) ) > 0 ) {
+		count = ( len / sizeof ( servers[0] ) );
+		if ( count > ( DNS_MAX_SERVERS - num_nameservers ) )
+			count = ( DNS_MAX_SERVERS - num_nameservers );
+		for ( i = 0 ; i < count ; i++ ) {
+			sin_nameserver = ( struct sockaddr_in * )
+				&nameservers[num_nameservers++];
+			sin_nameserver->sin_family = AF_INET;
+			sin_nameserver->sin_addr = servers[i];
+			DBG ( "DNS using nameserver %s\n",
+			      inet_ntoa ( sin_nameserver->sin_addr ) );
+		}
 	}
+	for ( i = 0 ; i < num_nameservers ; i++ )
+		nameservers[i].st_port = htons ( DNS_PORT );
 
 	/* Get local domain DHCP option */
 	if ( ( len = fetch_string_setting_copy ( NULL, &domain_setting,
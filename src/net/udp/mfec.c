@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <byteswap.h>
+#include <gpxe/iobuf.h>
+#include <gpxe/in.h>
+#include <gpxe/xfer.h>
+#include <gpxe/open.h>
+#include <gpxe/uri.h>
+#include <gpxe/tcpip.h>
+#include <gpxe/timer.h>
+#include <gpxe/retry.h>
+#include <gpxe/fec.h>
+#include <gpxe/mfec.h>
+
+/** @file
+ *
+ * Multicast forward-error-corrected download protocol
+ *
+ * An MFEC server (such as util/mfecd) transmits a file to a multicast
+ * group as a continuous carousel of source and repair blocks, and
+ * never listens for any reply.  Each group of @c k source blocks is
+ * extended with @c r repair blocks, and a client can reconstruct the
+ * group from any @c k of the @c k+r blocks.  A client may therefore
+ * join at any point in the carousel, and will finish as soon as it
+ * has received a sufficient set of packets, without needing any
+ * per-client retransmission.  This makes the protocol well-suited to
+ * boot storms, in which many clients download the same image at
+ * once.
+ *
+ * The URI format is x-mfec://<multicast address>[:<port>]/
+ */
+
+/** MFEC inactivity timeout */
+#define MFEC_TIMEOUT ( 30 * TICKS_PER_SEC )
+
+/** An MFEC request */
+struct mfec_request {
+	/** Reference counter */
+	struct refcnt refcnt;
+
+	/** Data transfer interface */
+	struct xfer_interface xfer;
+	/** Multicast socket */
+	struct xfer_interface socket;
+
+	/** Inactivity timer */
+	struct retry_timer timer;
+
+	/** Session parameters (from first packet received) */
+	struct mfec_header params;
+	/** FEC decoder */
+	struct fec_decoder fec;
+};
+
+/**
+ * Free an MFEC request
+ *
+ * @v refcnt		Reference counter
+ */
+static void mfec_free ( struct refcnt *refcnt ) {
+	struct mfec_request *mfec =
+		container_of ( refcnt, struct mfec_request, refcnt );
+
+	fec_decoder_free ( &mfec->fec );
+	free ( mfec );
+}
+
+/**
+ * Mark MFEC request as complete
+ *
+ * @v mfec		MFEC request
+ * @v rc		Return status code
+ */
+static void mfec_finished ( struct mfec_request *mfec, int rc ) {
+
+	DBGC ( mfec, "MFEC %p finished with status code %d (%s)\n",
+	       mfec, rc, strerror ( rc ) );
+
+	/* Stop the inactivity timer */
+	stop_timer ( &mfec->timer );
+
+	/* Close all data transfer interfaces */
+	xfer_nullify ( &mfec->socket );
+	xfer_close ( &mfec->socket, rc );
+	xfer_nullify ( &mfec->xfer );
+	xfer_close ( &mfec->xfer, rc );
+}
+
+/**
+ * Handle MFEC inactivity timer expiry
+ *
+ * @v timer		Inactivity timer
+ * @v fail		Failure indicator
+ */
+static void mfec_timer_expired ( struct retry_timer *timer,
+				 int fail __unused ) {
+	struct mfec_request *mfec =
+		container_of ( timer, struct mfec_request, timer );
+
+	DBGC ( mfec, "MFEC %p timed out with %ld of %ld groups "
+	       "incomplete\n", mfec, mfec->fec.remaining,
+	       mfec->fec.num_groups );
+	mfec_finished ( mfec, -ETIMEDOUT );
+}
+
+/**
+ * Pass source block to recipient
+ *
+ * @v fec		FEC decoder
+ * @v group		Group index
+ * @v index		Source block index within group
+ * @v data		Block data
+ * @ret rc		Return status code
+ */
+static int mfec_deliver_block ( struct fec_decoder *fec, unsigned long group,
+				unsigned int index, const void *data ) {
+	struct mfec_request *mfec =
+		container_of ( fec, struct mfec_request, fec );
+	size_t total_len = ntohl ( mfec->params.len );
+	struct xfer_metadata meta;
+	struct io_buffer *iobuf;
+	size_t offset;
+	size_t len;
+
+	/* Ignore padding beyond the end of the file */
+	offset = ( ( ( group * fec->k ) + index ) * fec->blksize );
+	if ( offset >= total_len )
+		return 0;
+	len = ( total_len - offset );
+	if ( len > fec->blksize )
+		len = fec->blksize;
+
+	/* Deliver block */
+	iobuf = xfer_alloc_iob ( &mfec->xfer, len );
+	if ( ! iobuf )
+		return -ENOMEM;
+	memcpy ( iob_put ( iobuf, len ), data, len );
+	memset ( &meta, 0, sizeof ( meta ) );
+	meta.whence = SEEK_SET;
+	meta.offset = offset;
+	return xfer_deliver_iob_meta ( &mfec->xfer, iobuf, &meta );
+}
+
+/**
+ * Start MFEC session
+ *
+ * @v mfec		MFEC request
+ * @v hdr		Header of first packet received
+ * @ret rc		Return status code
+ */
+static int mfec_start ( struct mfec_request *mfec,
+			struct mfec_header *hdr ) {
+	size_t len = ntohl ( hdr->len );
+	int rc;
+
+	DBGC ( mfec, "MFEC %p joined session %08x (%zd bytes, %d+%d blocks "
+	       "of %d bytes)\n", mfec, ntohl ( hdr->session ), len, hdr->k,
+	       hdr->r, ntohs ( hdr->blksize ) );
+
+	/* Initialise decoder */
+	memcpy ( &mfec->params, hdr, sizeof ( mfec->params ) );
+	if ( ( rc = fec_decoder_init ( &mfec->fec, len, ntohs ( hdr->blksize ),
+				       hdr->k, hdr->r,
+				       mfec_deliver_block ) ) != 0 ) {
+		DBGC ( mfec, "MFEC %p could not initialise decoder: %s\n",
+		       mfec, strerror ( rc ) );
+		memset ( &mfec->params, 0, sizeof ( mfec->params ) );
+		return rc;
+	}
+
+	/* Notify recipient of file size */
+	xfer_seek ( &mfec->xfer, len, SEEK_SET );
+
+	return 0;
+}
+
+/**
+ * Receive MFEC packet
+ *
+ * @v socket		MFEC multicast socket
+ * @v iobuf		I/O buffer
+ * @v meta		Data transfer metadata
+ * @ret rc		Return status code
+ */
+static int mfec_socket_deliver ( struct xfer_interface *socket,
+				 struct io_buffer *iobuf,
+				 struct xfer_metadata *meta __unused ) {
+	struct mfec_request *mfec =
+		container_of ( socket, struct mfec_request, socket );
+	struct mfec_header *hdr = iobuf->data;
+	unsigned long group;
+	int rc;
+
+	/* Sanity checks */
+	if ( ( iob_len ( iobuf ) < sizeof ( *hdr ) ) ||
+	     ( hdr->magic != htonl ( MFEC_MAGIC ) ) ) {
+		DBGC ( mfec, "MFEC %p received malformed packet\n", mfec );
+		rc = -EINVAL;
+		goto done;
+	}
+
+	/* Join session if not already joined, otherwise ignore
+	 * packets from any other session.
+	 */
+	if ( ! mfec->params.magic ) {
+		if ( ( rc = mfec_start ( mfec, hdr ) ) != 0 ) {
+			mfec_finished ( mfec, rc );
+			goto done;
+		}
+	} else if ( memcmp ( hdr, &mfec->params,
+			     offsetof ( struct mfec_header, group ) ) != 0 ) {
+		rc = 0;
+		goto done;
+	}
+	if ( ( iob_len ( iobuf ) - sizeof ( *hdr ) ) < mfec->fec.blksize ) {
+		DBGC ( mfec, "MFEC %p received short packet\n", mfec );
+		rc = -EINVAL;
+		goto done;
+	}
+
+	/* Restart inactivity timer */
+	stop_timer ( &mfec->timer );
+	start_timer_fixed ( &mfec->timer, MFEC_TIMEOUT );
+
+	/* Pass to decoder, which passes source blocks on to the
+	 * recipient as they become available.
+	 */
+	group = ntohl ( hdr->group );
+	if ( ( group >= mfec->fec.num_groups ) ||
+	     ( hdr->index >= ( mfec->fec.k + mfec->fec.r ) ) ) {
+		DBGC ( mfec, "MFEC %p received invalid block %ld:%d\n",
+		       mfec, group, hdr->index );
+		rc = -EINVAL;
+		goto done;
+	}
+	if ( ( rc = fec_decoder_rx ( &mfec->fec, group, hdr->index,
+				     ( hdr + 1 ) ) ) != 0 ) {
+		DBGC ( mfec, "MFEC %p could not deliver block %ld:%d: %s\n",
+		       mfec, group, hdr->index, strerror ( rc ) );
+		mfec_finished ( mfec, rc );
+		goto done;
+	}
+
+	/* Terminate when all groups are complete */
+	if ( ! mfec->fec.remaining )
+		mfec_finished ( mfec, 0 );
+
+ done:
+	free_iob ( iobuf );
+	return rc;
+}
+
+/**
+ * Close MFEC multicast socket
+ *
+ * @v socket		MFEC multicast socket
+ * @v rc		Reason for close
+ */
+static void mfec_socket_close ( struct xfer_interface *socket, int rc ) {
+	struct mfec_request *mfec =
+		container_of ( socket, struct mfec_request, socket );
+
+	DBGC ( mfec, "MFEC %p multicast socket closed: %s\n",
+	       mfec, strerror ( rc ) );
+
+	mfec_finished ( mfec, rc );
+}
+
+/** MFEC multicast socket data transfer operations */
+static struct xfer_interface_operations mfec_socket_operations = {
+	.close		= mfec_socket_close,
+	.vredirect	= xfer_vreopen,
+	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
+	.alloc_iob	= default_xfer_alloc_iob,
+	.deliver_iob	= mfec_socket_deliver,
+	.deliver_raw	= xfer_deliver_as_iob,
+};
+
+/**
+ * Close MFEC data transfer interface
+ *
+ * @v xfer		MFEC data transfer interface
+ * @v rc		Reason for close
+ */
+static void mfec_xfer_close ( struct xfer_interface *xfer, int rc ) {
+	struct mfec_request *mfec =
+		container_of ( xfer, struct mfec_request, xfer );
+
+	DBGC ( mfec, "MFEC %p data transfer interface closed: %s\n",
+	       mfec, strerror ( rc ) );
+
+	mfec_finished ( mfec, rc );
+}
+
+/** MFEC data transfer operations */
+static struct xfer_interface_operations mfec_xfer_operations = {
+	.close		= mfec_xfer_close,
+	.vredirect	= ignore_xfer_vredirect,
+	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
+	.alloc_iob	= default_xfer_alloc_iob,
+	.deliver_iob	= xfer_deliver_as_raw,
+	.deliver_raw	= ignore_xfer_deliver_raw,
+};
+
+/**
+ * Initiate an MFEC request
+ *
+ * @v xfer		Data transfer interface
+ * @v uri		Uniform Resource Identifier
+ * @ret rc		Return status code
+ */
+static int mfec_open ( struct xfer_interface *xfer, struct uri *uri ) {
+	struct mfec_request *mfec;
+	struct sockaddr_in multicast;
+	int rc;
+
+	/* Sanity checks */
+	if ( ! uri->host )
+		return -EINVAL;
+
+	/* Parse multicast address */
+	memset ( &multicast, 0, sizeof ( multicast ) );
+	multicast.sin_family = AF_INET;
+	multicast.sin_port = htons ( uri_port ( uri, MFEC_DEFAULT_PORT ) );
+	if ( inet_aton ( uri->host, &multicast.sin_addr ) == 0 )
+		return -EINVAL;
+
+	/* Allocate and populate structure */
+	mfec = zalloc ( sizeof ( *mfec ) );
+	if ( ! mfec )
+		return -ENOMEM;
+	ref_init ( &mfec->refcnt, mfec_free );
+	xfer_init ( &mfec->xfer, &mfec_xfer_operations, &mfec->refcnt );
+	xfer_init ( &mfec->socket, &mfec_socket_operations, &mfec->refcnt );
+	timer_init ( &mfec->timer, mfec_timer_expired );
+
+	/* Open multicast socket */
+	if ( ( rc = xfer_open_socket ( &mfec->socket, SOCK_DGRAM,
+				       ( struct sockaddr * ) &multicast,
+				       ( struct sockaddr * ) &multicast ) ) != 0){
+		DBGC ( mfec, "MFEC %p could not open multicast socket: %s\n",
+		       mfec, strerror ( rc ) );
+		goto err;
+	}
+
+	/* Start inactivity timer */
+	start_timer_fixed ( &mfec->timer, MFEC_TIMEOUT );
+
+	/* Attach to parent interface, mortalise self, and return */
+	xfer_plug_plug ( &mfec->xfer, xfer );
+	ref_put ( &mfec->refcnt );
+	return 0;
+
+ err:
+	mfec_finished ( mfec, rc );
+	ref_put ( &mfec->refcnt );
+	return rc;
+}
+
+/** MFEC URI opener */
+struct uri_opener mfec_uri_opener __uri_opener = {
+	.scheme	= "x-mfec",
+	.open	= mfec_open,
+};
@@ -618,6 +618,7 @@ static struct xfer_interface_operations slam_socket_operations = {
 	.close		= slam_socket_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= slam_socket_deliver,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -644,6 +645,7 @@ static struct xfer_interface_operations slam_mc_socket_operations = {
 	.close		= slam_mc_socket_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= slam_mc_socket_deliver,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -676,6 +678,7 @@ static struct xfer_interface_operations slam_xfer_operations = {
 	.close		= slam_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
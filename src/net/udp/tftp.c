@@ -31,6 +31,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/open.h>
 #include <gpxe/uri.h>
 #include <gpxe/tcpip.h>
+#include <gpxe/netdevice.h>
 #include <gpxe/retry.h>
 #include <gpxe/features.h>
 #include <gpxe/bitmap.h>
@@ -38,6 +39,7 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/dhcp.h>
 #include <gpxe/uri.h>
 #include <gpxe/tftp.h>
+#include <gpxe/netstats.h>
 
 /** @file
  *
@@ -70,6 +72,9 @@ FEATURE ( FEATURE_PROTOCOL, "TFTP", DHCP_EB_FEATURE_TFTP, 1 );
 #define EINFO_EINVAL_MC_INVALID_PORT __einfo_uniqify \
 	( EINFO_EINVAL, 0x07, "Invalid multicast port" )
 
+/** Number of TFTP retransmissions */
+static unsigned long tftp_retries;
+
 /**
  * A TFTP request
  *
@@ -291,9 +296,11 @@ static int tftp_presize ( struct tftp_request *tftp, size_t filesize ) {
 /**
  * TFTP requested blocksize
  *
- * This is treated as a global configuration parameter.
+ * This is treated as a global configuration parameter.  A value of
+ * zero indicates that the blocksize should be chosen to fit within
+ * the MTU of the network device used to reach the server.
  */
-static unsigned int tftp_request_blksize = TFTP_MAX_BLKSIZE;
+static unsigned int tftp_request_blksize = 0;
 
 /**
  * Set TFTP request blocksize
@@ -335,6 +342,43 @@ void tftp_set_mtftp_port ( unsigned int port ) {
 	tftp_mtftp_socket.sin_port = htons ( port );
 }
 
+/**
+ * Calculate TFTP blocksize to request
+ *
+ * @v tftp		TFTP connection
+ * @ret blksize		Requested block size
+ */
+static unsigned int tftp_rrq_blksize ( struct tftp_request *tftp ) {
+	struct sockaddr_in sin;
+	struct net_device *netdev;
+	size_t blksize;
+
+	/* Use configured blocksize, if any */
+	if ( tftp_request_blksize )
+		return tftp_request_blksize;
+
+	/* Identify network device used to reach the server.  The
+	 * server address is known in advance only if the URI
+	 * contains an IP address rather than a host name.
+	 */
+	memset ( &sin, 0, sizeof ( sin ) );
+	sin.sin_family = AF_INET;
+	if ( ! ( tftp->uri->host &&
+		 inet_aton ( tftp->uri->host, &sin.sin_addr ) ) )
+		return TFTP_MAX_BLKSIZE;
+	netdev = tcpip_netdev ( ( struct sockaddr_tcpip * ) &sin );
+	if ( ! netdev )
+		return TFTP_MAX_BLKSIZE;
+
+	/* Use the largest blocksize that fits within the MTU */
+	if ( netdev->mtu < ( TFTP_DEFAULT_BLKSIZE + TFTP_MTU_OVERHEAD ) )
+		return TFTP_DEFAULT_BLKSIZE;
+	blksize = ( netdev->mtu - TFTP_MTU_OVERHEAD );
+	if ( blksize > TFTP_LIMIT_BLKSIZE )
+		blksize = TFTP_LIMIT_BLKSIZE;
+	return blksize;
+}
+
 /**
  * Transmit RRQ
  *
@@ -380,7 +424,8 @@ static int tftp_send_rrq ( struct tftp_request *tftp ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
 					    iob_tailroom ( iobuf ),
 					    "blksize%c%d%ctsize%c0", 0,
-					    tftp_request_blksize, 0, 0 ) + 1 );
+					    tftp_rrq_blksize ( tftp ),
+					    0, 0 ) + 1 );
 	}
 	if ( tftp->flags & TFTP_FL_RRQ_MULTICAST ) {
 		iob_put ( iobuf, snprintf ( iobuf->tail,
@@ -470,6 +515,21 @@ static int tftp_send_error ( struct tftp_request *tftp, int errcode,
  */
 static int tftp_send_packet ( struct tftp_request *tftp ) {
 
+	/* Withhold the ACK while our parent has no room for further
+	 * data.  The retransmission timer is stopped so that a slow
+	 * consumer does not cause the transfer to time out; the ACK
+	 * will be sent when the window reopens.  The final ACK is
+	 * always sent, since there is no further data to wait for.
+	 */
+	if ( tftp->peer.st_family && ( tftp->flags & TFTP_FL_SEND_ACK ) &&
+	     ( ! bitmap_full ( &tftp->bitmap ) ) &&
+	     ( xfer_window ( &tftp->xfer ) == 0 ) ) {
+		DBGC2 ( tftp, "TFTP %p deferring ACK (window closed)\n",
+			tftp );
+		stop_timer ( &tftp->timer );
+		return 0;
+	}
+
 	/* Update retransmission timer.  While name resolution takes place the
 	 * window is zero.  Avoid unnecessary delay after name resolution
 	 * completes by retrying immediately.
@@ -552,6 +612,7 @@ static void tftp_timer_expired ( struct retry_timer *timer, int fail ) {
 			goto err;
 		}
 	}
+	tftp_retries++;
 	tftp_send_packet ( tftp );
 	return;
 
@@ -843,6 +904,16 @@ static int tftp_rx_data ( struct tftp_request *tftp,
 	}
 	block += ( ntohs ( data->block ) - 1 );
 
+	/* Discard data that our parent has no room for; the server
+	 * will retransmit it once we acknowledge the preceding block.
+	 */
+	if ( xfer_window ( &tftp->xfer ) == 0 ) {
+		DBGC2 ( tftp, "TFTP %p discarding block %d (window closed)\n",
+			tftp, block );
+		rc = 0;
+		goto done;
+	}
+
 	/* Extract data */
 	offset = ( block * tftp->blksize );
 	iob_pull ( iobuf, sizeof ( *data ) );
@@ -1034,6 +1105,7 @@ static struct xfer_interface_operations tftp_socket_operations = {
 	.close		= ignore_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= tftp_socket_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -1061,6 +1133,7 @@ static struct xfer_interface_operations tftp_mc_socket_operations = {
 	.close		= ignore_xfer_close,
 	.vredirect	= xfer_vreopen,
 	.window		= unlimited_xfer_window,
+	.window_changed	= ignore_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= tftp_mc_socket_deliver_iob,
 	.deliver_raw	= xfer_deliver_as_iob,
@@ -1100,11 +1173,27 @@ static size_t tftp_xfer_window ( struct xfer_interface *xfer ) {
 	return tftp->blksize;
 }
 
+/**
+ * Handle reopened flow control window
+ *
+ * @v xfer		Data transfer interface
+ */
+static void tftp_xfer_window_changed ( struct xfer_interface *xfer ) {
+	struct tftp_request *tftp =
+		container_of ( xfer, struct tftp_request, xfer );
+
+	/* Send any ACK withheld while the window was closed */
+	if ( tftp->peer.st_family && ( tftp->flags & TFTP_FL_SEND_ACK ) &&
+	     ( ! timer_running ( &tftp->timer ) ) )
+		tftp_send_packet ( tftp );
+}
+
 /** TFTP data transfer interface operations */
 static struct xfer_interface_operations tftp_xfer_operations = {
 	.close		= tftp_xfer_close,
 	.vredirect	= ignore_xfer_vredirect,
 	.window		= tftp_xfer_window,
+	.window_changed	= tftp_xfer_window_changed,
 	.alloc_iob	= default_xfer_alloc_iob,
 	.deliver_iob	= xfer_deliver_as_raw,
 	.deliver_raw	= ignore_xfer_deliver_raw,
@@ -1303,3 +1392,28 @@ static int tftp_apply_settings ( void ) {
 struct settings_applicator tftp_settings_applicator __settings_applicator = {
 	.apply = tftp_apply_settings,
 };
+
+/** TFTP retries setting */
+struct setting tftp_retries_setting __setting = {
+	.name = "tftp-retries",
+	.description = "TFTP retransmissions",
+	.type = &setting_type_uint32,
+};
+
+/**
+ * Get number of TFTP retransmissions
+ *
+ * @v netdev		Network device (ignored)
+ * @ret value		Number of retransmissions
+ */
+static unsigned long tftp_retries_value ( struct net_device *netdev __unused ){
+	return tftp_retries;
+}
+
+/** TFTP statistics */
+struct net_statistic tftp_statistics[] __net_statistic = {
+	{
+		.setting = &tftp_retries_setting,
+		.value = tftp_retries_value,
+	},
+};
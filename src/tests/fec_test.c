@@ -0,0 +1,110 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <gpxe/fec.h>
+
+/*
+ * Loopback simulation of an MFEC carousel with random packet loss
+ *
+ */
+
+#define FEC_TEST_LEN ( 100 * 1024 + 123 )
+#define FEC_TEST_BLKSIZE 512
+#define FEC_TEST_K 16
+#define FEC_TEST_R 4
+#define FEC_TEST_LOSS_PERCENT 15
+#define FEC_TEST_MAX_ROUNDS 10
+
+/** Reassembled data */
+static uint8_t *fec_test_check;
+
+static int fec_test_deliver ( struct fec_decoder *fec, unsigned long group,
+			      unsigned int index, const void *data ) {
+	size_t offset = ( ( ( group * fec->k ) + index ) * fec->blksize );
+	size_t len = fec->blksize;
+
+	if ( offset >= FEC_TEST_LEN )
+		return 0;
+	if ( len > ( FEC_TEST_LEN - offset ) )
+		len = ( FEC_TEST_LEN - offset );
+	memcpy ( ( fec_test_check + offset ), data, len );
+	return 0;
+}
+
+void fec_test ( void ) {
+	size_t group_len = ( FEC_TEST_K * FEC_TEST_BLKSIZE );
+	unsigned long num_groups =
+		( ( FEC_TEST_LEN + group_len - 1 ) / group_len );
+	struct fec_decoder fec;
+	uint8_t repair[FEC_TEST_BLKSIZE];
+	uint8_t *data;
+	uint8_t *check;
+	unsigned long group;
+	unsigned long sent = 0;
+	unsigned long dropped = 0;
+	unsigned int round;
+	unsigned int index;
+	size_t i;
+	int rc;
+
+	/* Construct random source data, padded to whole groups */
+	data = zalloc ( num_groups * group_len );
+	check = zalloc ( FEC_TEST_LEN );
+	if ( ! ( data && check ) ) {
+		printf ( "FEC test out of memory\n" );
+		goto out;
+	}
+	for ( i = 0 ; i < FEC_TEST_LEN ; i++ )
+		data[i] = random();
+
+	fec_test_check = check;
+	if ( ( rc = fec_decoder_init ( &fec, FEC_TEST_LEN, FEC_TEST_BLKSIZE,
+				       FEC_TEST_K, FEC_TEST_R,
+				       fec_test_deliver ) ) != 0 ) {
+		printf ( "FEC test could not initialise decoder: %s\n",
+			 strerror ( rc ) );
+		goto out;
+	}
+
+	/* Transmit carousel rounds, dropping packets at random */
+	for ( round = 0 ; ( fec.remaining && ( round < FEC_TEST_MAX_ROUNDS ) ) ;
+	      round++ ) {
+		for ( index = 0 ; index < ( FEC_TEST_K + FEC_TEST_R ) ;
+		      index++ ) {
+			for ( group = 0 ; group < num_groups ; group++ ) {
+				sent++;
+				if ( ( random() % 100 ) <
+				     FEC_TEST_LOSS_PERCENT ) {
+					dropped++;
+					continue;
+				}
+				if ( index < FEC_TEST_K ) {
+					fec_decoder_rx ( &fec, group, index,
+						( data + ( group * group_len ) +
+						  ( index * FEC_TEST_BLKSIZE ) ) );
+				} else {
+					fec_encode ( FEC_TEST_K, FEC_TEST_R,
+						     ( index - FEC_TEST_K ),
+						     ( data +
+						       ( group * group_len ) ),
+						     FEC_TEST_BLKSIZE, repair );
+					fec_decoder_rx ( &fec, group, index,
+							 repair );
+				}
+			}
+		}
+	}
+
+	/* Verify reconstructed data */
+	printf ( "FEC test: %ld groups, %ld packets sent, %ld dropped, "
+		 "%d rounds: %s\n", num_groups, sent, dropped, round,
+		 ( fec.remaining ? "INCOMPLETE" :
+		   ( memcmp ( check, data, FEC_TEST_LEN ) ? "CORRUPT" :
+		     "ok" ) ) );
+
+	fec_decoder_free ( &fec );
+ out:
+	free ( check );
+	free ( data );
+}
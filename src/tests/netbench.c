@@ -0,0 +1,2180 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <byteswap.h>
+#include <gpxe/list.h>
+#include <gpxe/iobuf.h>
+#include <gpxe/device.h>
+#include <gpxe/netdevice.h>
+#include <gpxe/ethernet.h>
+#include <gpxe/if_ether.h>
+#include <gpxe/if_arp.h>
+#include <gpxe/ip.h>
+#include <gpxe/tcpip.h>
+#include <gpxe/tcp.h>
+#include <gpxe/udp.h>
+#include <gpxe/tftp.h>
+#include <gpxe/iscsi.h>
+#include <gpxe/scsi.h>
+#include <gpxe/aoe.h>
+#include <gpxe/ata.h>
+#include <gpxe/dhcp.h>
+#include <gpxe/impairnet.h>
+#include <gpxe/settings.h>
+#include <gpxe/timer.h>
+#include <gpxe/image.h>
+#include <gpxe/open.h>
+#include <gpxe/downloader.h>
+#include <gpxe/monojob.h>
+#include <gpxe/umalloc.h>
+#include <gpxe/command.h>
+
+/** @file
+ *
+ * Network throughput benchmark
+ *
+ * The benchmark measures the throughput of the TFTP, HTTP, iSCSI, AoE
+ * and DHCP clients, along with the UDP, TCP, IPv4 and network device
+ * layers beneath them.  It is intended to be built as a Linux
+ * userspace executable (e.g. "make bin-x86_64-linux/netbench.linux")
+ * and run on a plain Linux host:
+ *
+ * @code
+ *
+ *   echo "netbench -s 16M" | bin-x86_64-linux/netbench.linux
+ *
+ * @endcode
+ *
+ * Each transfer is served by a stand-in server running in the same
+ * process, on the far side of an in-process loopback network device.
+ * The stand-in servers implement only as much of each protocol as is
+ * needed to serve gPXE's own clients.  File names (and disk
+ * capacities) encode the transfer size, e.g.
+ * "tftp://10.254.0.1/1048576".
+ *
+ * The loopback device may be impaired using any network impairment
+ * profile (e.g. "netbench -p lossy"), or using each profile in turn
+ * ("netbench -p all").  The stand-in servers retransmit just enough
+ * to recover from impairment, so that the results reflect the
+ * behaviour of gPXE's clients.  A given seed ("-S <seed>") always
+ * produces the same pattern of impairments.
+ */
+
+FILE_LICENCE ( GPL2_OR_LATER );
+
+/* Drag in the clients under test */
+REQUIRE_OBJECT ( tftp );
+REQUIRE_OBJECT ( http );
+REQUIRE_OBJECT ( iscsi );
+REQUIRE_OBJECT ( aoe );
+
+/** Stand-in server IPv4 address */
+#define NETBENCH_SERVER_IP 0x0afe0001UL
+
+/** Client IPv4 address */
+#define NETBENCH_CLIENT_IP 0x0afe0002UL
+
+/** Netmask */
+#define NETBENCH_NETMASK 0xffffff00UL
+
+/** Stand-in server MAC address */
+static const uint8_t netbench_server_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+/** Client MAC address */
+static const uint8_t netbench_client_mac[ETH_ALEN] =
+	{ 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+/** Default transfer size */
+#define NETBENCH_DEFAULT_SIZE ( 4 * 1024 * 1024 )
+
+/** Headroom reserved in each transmitted frame */
+#define NETBENCH_HEADROOM ( ETH_HLEN + sizeof ( struct iphdr ) + \
+			    sizeof ( struct tcp_header ) + 4 /* MSS */ )
+
+/** Stand-in TFTP server transfer ID (i.e. source port) */
+#define NETBENCH_TFTP_TID 1069
+
+/** Maximum TFTP block size */
+#define NETBENCH_TFTP_MAX_BLKSIZE 1432
+
+/** Stand-in TFTP server retransmission timeout */
+#define NETBENCH_TFTP_TIMEOUT ( TICKS_PER_SEC / 4 )
+
+/** Stand-in HTTP server port */
+#define NETBENCH_HTTP_PORT 80
+
+/** Stand-in iSCSI target port */
+#define NETBENCH_ISCSI_PORT 3260
+
+/** iSCSI root path */
+#define NETBENCH_ISCSI_ROOT_PATH \
+	"iscsi:10.254.0.1::::iqn.2010-04.org.etherboot:netbench"
+
+/** iSCSI block size */
+#define NETBENCH_ISCSI_BLKSIZE 512
+
+/** Number of blocks to read per command */
+#define NETBENCH_BLOCK_COUNT 64
+
+/** Maximum iSCSI data segment length (as declared by gPXE) */
+#define NETBENCH_ISCSI_MAX_SEGMENT 8192
+
+/** AoE root path */
+#define NETBENCH_AOE_ROOT_PATH "aoe:e0.1"
+
+/** Stand-in AoE target major number */
+#define NETBENCH_AOE_MAJOR 0
+
+/** Stand-in AoE target minor number */
+#define NETBENCH_AOE_MINOR 1
+
+/** Number of DHCP transactions to perform */
+#define NETBENCH_DHCP_COUNT 4
+
+/** Stand-in DHCP lease time, in seconds */
+#define NETBENCH_DHCP_LEASE 3600
+
+/** Stand-in TCP maximum segment size */
+#define NETBENCH_TCP_MSS 1460
+
+/** Maximum number of stand-in TCP segments to send per poll */
+#define NETBENCH_TCP_BURST 4
+
+/** Stand-in TCP advertised window */
+#define NETBENCH_TCP_WINDOW 65535
+
+/** Maximum number of concurrent stand-in TCP connections */
+#define NETBENCH_TCP_MAX_CONNS 4
+
+/** Maximum number of stand-in TCP transmit stream chunks */
+#define NETBENCH_TCP_MAX_CHUNKS 16
+
+/** Stand-in TCP retransmission timeout */
+#define NETBENCH_TCP_RTO ( TICKS_PER_SEC / 2 )
+
+/** Byte used to fill bulk transfer data */
+#define NETBENCH_FILL 0xa5
+
+/** Frames queued for delivery to the client */
+static LIST_HEAD ( netbench_rx_queue );
+
+/** Client network device */
+static struct net_device *netbench_netdev;
+
+/** IPv4 identifier of last frame sent by stand-in server */
+static uint16_t netbench_ip_ident;
+
+/****************************************************************************
+ *
+ * Stand-in link and network layers
+ *
+ */
+
+/**
+ * Allocate I/O buffer for stand-in server frame
+ *
+ * @v len		Payload length
+ * @ret iobuf		I/O buffer, or NULL
+ */
+static struct io_buffer * netbench_alloc_iob ( size_t len ) {
+	struct io_buffer *iobuf;
+
+	iobuf = alloc_iob ( NETBENCH_HEADROOM + len );
+	if ( iobuf )
+		iob_reserve ( iobuf, NETBENCH_HEADROOM );
+	return iobuf;
+}
+
+/**
+ * Queue stand-in server frame for delivery to the client
+ *
+ * @v iobuf		I/O buffer containing network-layer packet
+ * @v net_proto		Network-layer protocol, in network byte order
+ */
+static void netbench_ll_tx ( struct io_buffer *iobuf, uint16_t net_proto ) {
+	struct ethhdr *ethhdr;
+
+	ethhdr = iob_push ( iobuf, sizeof ( *ethhdr ) );
+	memcpy ( ethhdr->h_dest, netbench_client_mac, ETH_ALEN );
+	memcpy ( ethhdr->h_source, netbench_server_mac, ETH_ALEN );
+	ethhdr->h_protocol = net_proto;
+	list_add_tail ( &iobuf->list, &netbench_rx_queue );
+}
+
+/**
+ * Transmit IPv4 packet from stand-in server
+ *
+ * @v iobuf		I/O buffer containing transport-layer packet
+ * @v protocol		Transport-layer protocol
+ * @v csum		Transport-layer checksum field
+ */
+static void netbench_ipv4_tx ( struct io_buffer *iobuf, uint8_t protocol,
+			       uint16_t *csum ) {
+	struct ipv4_pseudo_header pshdr;
+	struct iphdr *iphdr;
+	size_t len = iob_len ( iobuf );
+
+	/* Fill in transport-layer checksum */
+	pshdr.src.s_addr = htonl ( NETBENCH_SERVER_IP );
+	pshdr.dest.s_addr = htonl ( NETBENCH_CLIENT_IP );
+	pshdr.zero_padding = 0;
+	pshdr.protocol = protocol;
+	pshdr.len = htons ( len );
+	*csum = 0;
+	*csum = tcpip_continue_chksum ( tcpip_chksum ( iobuf->data, len ),
+					&pshdr, sizeof ( pshdr ) );
+
+	/* Construct IPv4 header */
+	iphdr = iob_push ( iobuf, sizeof ( *iphdr ) );
+	memset ( iphdr, 0, sizeof ( *iphdr ) );
+	iphdr->verhdrlen = ( IP_VER | ( sizeof ( *iphdr ) / 4 ) );
+	iphdr->len = htons ( iob_len ( iobuf ) );
+	iphdr->ident = htons ( ++netbench_ip_ident );
+	iphdr->ttl = 64;
+	iphdr->protocol = protocol;
+	iphdr->src = pshdr.src;
+	iphdr->dest = pshdr.dest;
+	iphdr->chksum = tcpip_chksum ( iphdr, sizeof ( *iphdr ) );
+
+	netbench_ll_tx ( iobuf, htons ( ETH_P_IP ) );
+}
+
+/**
+ * Receive ARP packet at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_arp_rx ( struct io_buffer *iobuf ) {
+	struct arphdr *arphdr = iobuf->data;
+	struct arphdr *reply;
+	struct io_buffer *reply_iob;
+	struct in_addr server = { .s_addr = htonl ( NETBENCH_SERVER_IP ) };
+	size_t len = ( sizeof ( *arphdr ) + ( 2 * ( ETH_ALEN + 4 ) ) );
+
+	/* Respond only to requests for the stand-in server's address */
+	if ( ( iob_len ( iobuf ) < len ) ||
+	     ( arphdr->ar_op != htons ( ARPOP_REQUEST ) ) ||
+	     ( memcmp ( arp_target_pa ( arphdr ), &server,
+			sizeof ( server ) ) != 0 ) )
+		return;
+
+	/* Construct reply */
+	reply_iob = netbench_alloc_iob ( len );
+	if ( ! reply_iob )
+		return;
+	reply = iob_put ( reply_iob, len );
+	memcpy ( reply, arphdr, len );
+	reply->ar_op = htons ( ARPOP_REPLY );
+	memcpy ( arp_target_ha ( reply ), arp_sender_ha ( arphdr ), ETH_ALEN );
+	memcpy ( arp_target_pa ( reply ), arp_sender_pa ( arphdr ), 4 );
+	memcpy ( arp_sender_ha ( reply ), netbench_server_mac, ETH_ALEN );
+	memcpy ( arp_sender_pa ( reply ), &server, sizeof ( server ) );
+	netbench_ll_tx ( reply_iob, htons ( ETH_P_ARP ) );
+}
+
+/****************************************************************************
+ *
+ * Stand-in TFTP server
+ *
+ */
+
+/** Stand-in TFTP transfer state */
+static struct {
+	/** Client port */
+	uint16_t port;
+	/** Transfer size */
+	size_t size;
+	/** Block size */
+	size_t blksize;
+	/** Last block sent */
+	unsigned long block;
+	/** Last block sent has been acknowledged */
+	int acked;
+	/** Final block has been sent */
+	int finished;
+	/** Time at which last block was sent */
+	unsigned long sent;
+} netbench_tftp;
+
+/**
+ * Parse transfer size from file name
+ *
+ * @v name		File name (e.g. "/1048576")
+ * @ret size		Transfer size, or zero if invalid
+ */
+static size_t netbench_parse_size ( const char *name ) {
+	char *end;
+	size_t size;
+
+	if ( *name == '/' )
+		name++;
+	size = strtoul ( name, &end, 0 );
+	if ( *end )
+		return 0;
+	return size;
+}
+
+/**
+ * Transmit UDP packet from stand-in server
+ *
+ * @v iobuf		I/O buffer containing UDP payload
+ * @v src		Source port
+ * @v dest		Destination port
+ */
+static void netbench_udp_tx ( struct io_buffer *iobuf, uint16_t src,
+			      uint16_t dest ) {
+	struct udp_header *udphdr;
+
+	udphdr = iob_push ( iobuf, sizeof ( *udphdr ) );
+	udphdr->src = htons ( src );
+	udphdr->dest = htons ( dest );
+	udphdr->len = htons ( iob_len ( iobuf ) );
+	netbench_ipv4_tx ( iobuf, IP_UDP, &udphdr->chksum );
+}
+
+/**
+ * Transmit next TFTP data block
+ *
+ */
+static void netbench_tftp_tx_data ( void ) {
+	struct io_buffer *iobuf;
+	struct tftp_data *data;
+	size_t offset = ( netbench_tftp.block * netbench_tftp.blksize );
+	size_t len = ( netbench_tftp.size - offset );
+
+	if ( len > netbench_tftp.blksize )
+		len = netbench_tftp.blksize;
+	iobuf = netbench_alloc_iob ( sizeof ( *data ) + len );
+	if ( ! iobuf )
+		return;
+	data = iob_put ( iobuf, sizeof ( *data ) );
+	data->opcode = htons ( TFTP_DATA );
+	data->block = htons ( ++netbench_tftp.block );
+	memset ( iob_put ( iobuf, len ), NETBENCH_FILL, len );
+	netbench_tftp.acked = 0;
+	netbench_tftp.finished = ( len < netbench_tftp.blksize );
+	netbench_tftp.sent = currticks();
+	netbench_udp_tx ( iobuf, NETBENCH_TFTP_TID, netbench_tftp.port );
+}
+
+/**
+ * Retransmit TFTP data block if acknowledgement is overdue
+ *
+ * Duplicate acknowledgements are ignored, since responding to them
+ * would allow a duplicated frame to double the number of data
+ * blocks sent for the remainder of the transfer.
+ */
+static void netbench_tftp_poll ( void ) {
+
+	if ( ( ! netbench_tftp.block ) || netbench_tftp.acked ||
+	     ( ( currticks() - netbench_tftp.sent ) < NETBENCH_TFTP_TIMEOUT ) )
+		return;
+	netbench_tftp.block--;
+	netbench_tftp_tx_data();
+}
+
+/**
+ * Receive TFTP read request at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ * @v port		Client port
+ */
+static void netbench_tftp_rx_rrq ( struct io_buffer *iobuf, uint16_t port ) {
+	struct tftp_rrq *rrq = iobuf->data;
+	struct io_buffer *reply;
+	char *data = rrq->data;
+	char *end = ( iobuf->data + iob_len ( iobuf ) );
+	char *name;
+	char *value;
+	char oack[64];
+	size_t oack_len = 0;
+	uint16_t *opcode;
+
+	/* Reject truncated requests */
+	if ( ( end == data ) || end[-1] ) {
+		printf ( "NETBENCH TFTP server received malformed RRQ\n" );
+		return;
+	}
+
+	/* Parse file name, and skip transfer mode */
+	memset ( &netbench_tftp, 0, sizeof ( netbench_tftp ) );
+	netbench_tftp.port = port;
+	netbench_tftp.size = netbench_parse_size ( data );
+	netbench_tftp.blksize = 512;
+	data += ( strlen ( data ) + 1 );
+	if ( data < end )
+		data += ( strlen ( data ) + 1 );
+
+	/* Parse options */
+	while ( data < end ) {
+		name = data;
+		data += ( strlen ( data ) + 1 );
+		if ( data >= end )
+			break;
+		value = data;
+		data += ( strlen ( data ) + 1 );
+		if ( strcasecmp ( name, "blksize" ) == 0 ) {
+			netbench_tftp.blksize = strtoul ( value, NULL, 0 );
+			if ( netbench_tftp.blksize > NETBENCH_TFTP_MAX_BLKSIZE )
+				netbench_tftp.blksize =
+					NETBENCH_TFTP_MAX_BLKSIZE;
+			oack_len += ( snprintf ( &oack[oack_len],
+						 ( sizeof ( oack ) - oack_len ),
+						 "blksize%c%zd", 0,
+						 netbench_tftp.blksize ) + 1 );
+		} else if ( strcasecmp ( name, "tsize" ) == 0 ) {
+			oack_len += ( snprintf ( &oack[oack_len],
+						 ( sizeof ( oack ) - oack_len ),
+						 "tsize%c%zd", 0,
+						 netbench_tftp.size ) + 1 );
+		}
+	}
+
+	/* Acknowledge options, or start sending data immediately */
+	if ( ! oack_len ) {
+		netbench_tftp_tx_data();
+		return;
+	}
+	reply = netbench_alloc_iob ( sizeof ( *opcode ) + oack_len );
+	if ( ! reply )
+		return;
+	opcode = iob_put ( reply, sizeof ( *opcode ) );
+	*opcode = htons ( TFTP_OACK );
+	memcpy ( iob_put ( reply, oack_len ), oack, oack_len );
+	netbench_udp_tx ( reply, NETBENCH_TFTP_TID, port );
+}
+
+/**
+ * Receive TFTP acknowledgement at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_tftp_rx_ack ( struct io_buffer *iobuf ) {
+	struct tftp_ack *ack = iobuf->data;
+
+	if ( ( iob_len ( iobuf ) < sizeof ( *ack ) ) ||
+	     ( ntohs ( ack->block ) !=
+	       ( ( uint16_t ) netbench_tftp.block ) ) ||
+	     netbench_tftp.acked )
+		return;
+	netbench_tftp.acked = 1;
+	if ( ! netbench_tftp.finished )
+		netbench_tftp_tx_data();
+}
+
+/****************************************************************************
+ *
+ * Stand-in DHCP server
+ *
+ */
+
+/**
+ * Find DHCP message type
+ *
+ * @v dhcphdr		DHCP packet
+ * @v len		Length of DHCP packet
+ * @ret msgtype		DHCP message type, or zero if not found
+ */
+static unsigned int netbench_dhcp_msgtype ( struct dhcphdr *dhcphdr,
+					    size_t len ) {
+	uint8_t *option = dhcphdr->options;
+	uint8_t *end = ( ( ( uint8_t * ) dhcphdr ) + len );
+
+	if ( ( len < sizeof ( *dhcphdr ) ) ||
+	     ( dhcphdr->magic != htonl ( DHCP_MAGIC_COOKIE ) ) )
+		return 0;
+	while ( ( option + 2 ) <= end ) {
+		if ( option[0] == DHCP_END )
+			break;
+		if ( option[0] == DHCP_PAD ) {
+			option++;
+			continue;
+		}
+		if ( ( option[0] == DHCP_MESSAGE_TYPE ) && ( option[1] == 1 ) &&
+		     ( ( option + 3 ) <= end ) )
+			return option[2];
+		option += ( 2 + option[1] );
+	}
+	return 0;
+}
+
+/**
+ * Receive DHCP packet at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ *
+ * The stand-in server offers the client's usual address in response
+ * to every DHCPDISCOVER and DHCPREQUEST, and instructs the client not
+ * to wait for ProxyDHCP offers.
+ */
+static void netbench_dhcp_rx ( struct io_buffer *iobuf ) {
+	struct dhcphdr *request = iobuf->data;
+	struct dhcphdr *reply;
+	struct io_buffer *reply_iob;
+	unsigned int msgtype;
+	struct netbench_dhcp_u32 {
+		uint8_t tag;
+		uint8_t len;
+		uint32_t value;
+	} __attribute__ (( packed ));
+	struct {
+		uint8_t msgtype[3];
+		struct netbench_dhcp_u32 server_id;
+		struct netbench_dhcp_u32 netmask;
+		struct netbench_dhcp_u32 lease;
+		uint8_t eb_encap[5];
+		uint8_t end[1];
+	} __attribute__ (( packed )) options = {
+		.msgtype = { DHCP_MESSAGE_TYPE, 1, 0 },
+		.server_id = { DHCP_SERVER_IDENTIFIER, 4,
+			       htonl ( NETBENCH_SERVER_IP ) },
+		.netmask = { DHCP_SUBNET_MASK, 4, htonl ( NETBENCH_NETMASK ) },
+		.lease = { DHCP_LEASE_TIME, 4, htonl ( NETBENCH_DHCP_LEASE ) },
+		.eb_encap = { DHCP_EB_ENCAP, 3,
+			      DHCP_ENCAPSULATED ( DHCP_EB_NO_PXEDHCP ), 1, 1 },
+		.end = { DHCP_END },
+	};
+
+	/* Determine reply type */
+	msgtype = netbench_dhcp_msgtype ( request, iob_len ( iobuf ) );
+	switch ( msgtype ) {
+	case DHCPDISCOVER:
+		options.msgtype[2] = DHCPOFFER;
+		break;
+	case DHCPREQUEST:
+		options.msgtype[2] = DHCPACK;
+		break;
+	default:
+		return;
+	}
+
+	/* Construct reply */
+	reply_iob = netbench_alloc_iob ( sizeof ( *reply ) +
+					 sizeof ( options ) );
+	if ( ! reply_iob )
+		return;
+	reply = iob_put ( reply_iob, sizeof ( *reply ) );
+	memset ( reply, 0, sizeof ( *reply ) );
+	reply->op = BOOTP_REPLY;
+	reply->htype = request->htype;
+	reply->hlen = request->hlen;
+	reply->xid = request->xid;
+	reply->flags = request->flags;
+	reply->yiaddr.s_addr = htonl ( NETBENCH_CLIENT_IP );
+	reply->siaddr.s_addr = htonl ( NETBENCH_SERVER_IP );
+	memcpy ( reply->chaddr, request->chaddr, sizeof ( reply->chaddr ) );
+	reply->magic = htonl ( DHCP_MAGIC_COOKIE );
+	memcpy ( iob_put ( reply_iob, sizeof ( options ) ), &options,
+		 sizeof ( options ) );
+	netbench_udp_tx ( reply_iob, BOOTPS_PORT, BOOTPC_PORT );
+}
+
+/**
+ * Receive UDP packet at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_udp_rx ( struct io_buffer *iobuf ) {
+	struct udp_header *udphdr = iobuf->data;
+	struct tftp_common *common;
+	uint16_t src;
+	uint16_t dest;
+
+	if ( iob_len ( iobuf ) < ( sizeof ( *udphdr ) + sizeof ( *common ) ) )
+		return;
+	src = ntohs ( udphdr->src );
+	dest = ntohs ( udphdr->dest );
+	iob_pull ( iobuf, sizeof ( *udphdr ) );
+	common = iobuf->data;
+
+	if ( dest == BOOTPS_PORT ) {
+		netbench_dhcp_rx ( iobuf );
+	} else if ( ( dest == TFTP_PORT ) &&
+	     ( common->opcode == htons ( TFTP_RRQ ) ) ) {
+		/* Ignore duplicate requests once data is flowing */
+		if ( ( src == netbench_tftp.port ) && netbench_tftp.block )
+			return;
+		netbench_tftp_rx_rrq ( iobuf, src );
+	} else if ( ( dest == NETBENCH_TFTP_TID ) &&
+		    ( src == netbench_tftp.port ) &&
+		    ( common->opcode == htons ( TFTP_ACK ) ) ) {
+		netbench_tftp_rx_ack ( iobuf );
+	}
+}
+
+/****************************************************************************
+ *
+ * Stand-in TCP
+ *
+ */
+
+struct netbench_tcp;
+
+/** A stand-in TCP application */
+struct netbench_tcp_application {
+	/** Listening port */
+	uint16_t port;
+	/**
+	 * Receive data
+	 *
+	 * @v conn		Connection
+	 * @v data		Received data
+	 * @v len		Length of received data
+	 * @ret used		Length of data consumed
+	 *
+	 * This is called only when all of the transmit stream has
+	 * been sent and there is space to extend it.  The application
+	 * may extend the transmit stream.
+	 */
+	size_t ( * rx ) ( struct netbench_tcp *conn, const void *data,
+			  size_t len );
+	/**
+	 * Extend transmit stream
+	 *
+	 * @v conn		Connection
+	 *
+	 * This is called whenever all of the transmit stream has been
+	 * sent and there is space to extend it.
+	 */
+	void ( * tx ) ( struct netbench_tcp *conn );
+};
+
+/** A chunk of a stand-in TCP transmit stream
+ *
+ * A chunk comprises explicit data followed by bulk data.  Chunks
+ * are retained until acknowledged, so that any part of the transmit
+ * stream can be regenerated for retransmission.
+ */
+struct netbench_tcp_chunk {
+	/** Sequence number of first byte */
+	uint32_t seq;
+	/** Length of explicit data */
+	size_t len;
+	/** Length of bulk data following explicit data */
+	size_t bulk;
+	/** Explicit data */
+	uint8_t data[96];
+};
+
+/** A stand-in TCP connection */
+struct netbench_tcp {
+	/** Application, or NULL if connection is unused */
+	struct netbench_tcp_application *app;
+	/** Client port */
+	uint16_t port;
+	/** Connection is established */
+	int established;
+	/** Oldest unacknowledged sequence number */
+	uint32_t snd_una;
+	/** Next sequence number to send */
+	uint32_t snd_nxt;
+	/** Sequence number following end of transmit stream */
+	uint32_t snd_end;
+	/** Right edge of client's receive window */
+	uint32_t snd_wnd_edge;
+	/** Time at which retransmission timer was last restarted */
+	unsigned long rtx_start;
+	/** Next sequence number expected from client */
+	uint32_t rcv_nxt;
+	/** Close connection once transmit stream has been sent */
+	int closing;
+	/** FIN has been sent */
+	int fin_sent;
+	/** Received data awaiting processing */
+	uint8_t rx_buf[1024];
+	/** Length of received data */
+	size_t rx_len;
+	/** Transmit stream chunks */
+	struct netbench_tcp_chunk chunks[NETBENCH_TCP_MAX_CHUNKS];
+	/** Transmit stream chunk producer counter */
+	unsigned int chunk_prod;
+	/** Transmit stream chunk consumer counter */
+	unsigned int chunk_cons;
+	/** Application state */
+	union {
+		/** iSCSI target state */
+		struct {
+			/** Status sequence number */
+			uint32_t statsn;
+			/** Initiator task tag of current command */
+			uint32_t itt;
+			/** Data sequence number */
+			uint32_t datasn;
+			/** Offset of next data segment */
+			size_t offset;
+			/** Remaining length of command data */
+			size_t remaining;
+		} iscsi;
+	};
+};
+
+/** Stand-in TCP connections */
+static struct netbench_tcp netbench_tcp_conns[NETBENCH_TCP_MAX_CONNS];
+
+/** Initial sequence number of stand-in server */
+static uint32_t netbench_tcp_iss = 0x50000000UL;
+
+/**
+ * Get length of unsent transmit stream
+ *
+ * @v conn		Connection
+ * @ret len		Length of unsent data
+ */
+static size_t netbench_tcp_stream_len ( struct netbench_tcp *conn ) {
+	int32_t len = ( conn->snd_end - conn->snd_nxt );
+
+	return ( ( len > 0 ) ? len : 0 );
+}
+
+/**
+ * Check whether transmit stream may be extended
+ *
+ * @v conn		Connection
+ * @ret ok		Transmit stream may be extended
+ */
+static int netbench_tcp_stream_ready ( struct netbench_tcp *conn ) {
+	return ( ( netbench_tcp_stream_len ( conn ) == 0 ) &&
+		 ( ( conn->chunk_prod - conn->chunk_cons ) <
+		   NETBENCH_TCP_MAX_CHUNKS ) );
+}
+
+/**
+ * Add data to transmit stream
+ *
+ * @v conn		Connection
+ * @v data		Explicit data
+ * @v len		Length of explicit data
+ * @v bulk		Length of bulk data to follow
+ *
+ * Must be called only when the transmit stream may be extended.
+ */
+static void netbench_tcp_send ( struct netbench_tcp *conn, const void *data,
+				size_t len, size_t bulk ) {
+	struct netbench_tcp_chunk *chunk;
+
+	assert ( netbench_tcp_stream_ready ( conn ) );
+	chunk = &conn->chunks[ conn->chunk_prod++ % NETBENCH_TCP_MAX_CHUNKS ];
+	assert ( len <= sizeof ( chunk->data ) );
+	chunk->seq = conn->snd_end;
+	chunk->len = len;
+	chunk->bulk = bulk;
+	memcpy ( chunk->data, data, len );
+	conn->snd_end += ( len + bulk );
+}
+
+/**
+ * Copy data from transmit stream
+ *
+ * @v conn		Connection
+ * @v seq		Sequence number of first byte
+ * @v buf		Buffer
+ * @v len		Length of data
+ */
+static void netbench_tcp_copy ( struct netbench_tcp *conn, uint32_t seq,
+				uint8_t *buf, size_t len ) {
+	struct netbench_tcp_chunk *chunk;
+	unsigned int i;
+	size_t offset;
+	size_t frag_len;
+	size_t explicit_len;
+
+	for ( i = conn->chunk_cons ; len && ( i != conn->chunk_prod ) ; i++ ) {
+		chunk = &conn->chunks[ i % NETBENCH_TCP_MAX_CHUNKS ];
+		offset = ( seq - chunk->seq );
+		if ( offset >= ( chunk->len + chunk->bulk ) )
+			continue;
+		frag_len = ( chunk->len + chunk->bulk - offset );
+		if ( frag_len > len )
+			frag_len = len;
+		explicit_len = 0;
+		if ( offset < chunk->len ) {
+			explicit_len = ( chunk->len - offset );
+			if ( explicit_len > frag_len )
+				explicit_len = frag_len;
+			memcpy ( buf, &chunk->data[offset], explicit_len );
+		}
+		memset ( ( buf + explicit_len ), NETBENCH_FILL,
+			 ( frag_len - explicit_len ) );
+		buf += frag_len;
+		seq += frag_len;
+		len -= frag_len;
+	}
+	assert ( len == 0 );
+}
+
+/**
+ * Transmit stand-in TCP segment
+ *
+ * @v conn		Connection
+ * @v flags		TCP flags
+ * @v len		Length of data to send from transmit stream
+ */
+static void netbench_tcp_tx ( struct netbench_tcp *conn, unsigned int flags,
+			      size_t len ) {
+	struct io_buffer *iobuf;
+	struct tcp_header *tcphdr;
+	size_t hlen = sizeof ( *tcphdr );
+	uint8_t *mss;
+
+	iobuf = netbench_alloc_iob ( len );
+	if ( ! iobuf )
+		return;
+
+	/* Copy data from transmit stream */
+	netbench_tcp_copy ( conn, conn->snd_nxt, iob_put ( iobuf, len ), len );
+
+	/* Add MSS option to SYN */
+	if ( flags & TCP_SYN ) {
+		mss = iob_push ( iobuf, 4 );
+		mss[0] = TCP_OPTION_MSS;
+		mss[1] = 4;
+		mss[2] = ( NETBENCH_TCP_MSS >> 8 );
+		mss[3] = ( NETBENCH_TCP_MSS & 0xff );
+		hlen += 4;
+	}
+
+	/* Construct TCP header */
+	tcphdr = iob_push ( iobuf, sizeof ( *tcphdr ) );
+	memset ( tcphdr, 0, sizeof ( *tcphdr ) );
+	tcphdr->src = htons ( conn->app->port );
+	tcphdr->dest = htons ( conn->port );
+	tcphdr->seq = htonl ( conn->snd_nxt );
+	tcphdr->ack = htonl ( conn->rcv_nxt );
+	tcphdr->hlen = ( ( hlen / 4 ) << 4 );
+	tcphdr->flags = flags;
+	tcphdr->win = htons ( NETBENCH_TCP_WINDOW );
+
+	/* Start retransmission timer if nothing was outstanding */
+	if ( len || ( flags & ( TCP_SYN | TCP_FIN ) ) ) {
+		if ( conn->snd_una == conn->snd_nxt )
+			conn->rtx_start = currticks();
+		conn->snd_nxt += ( len + ( ( flags & ( TCP_SYN | TCP_FIN ) ) ?
+					   1 : 0 ) );
+	}
+	if ( flags & TCP_FIN )
+		conn->fin_sent = 1;
+
+	netbench_ipv4_tx ( iobuf, IP_TCP, &tcphdr->csum );
+}
+
+/**
+ * Process received data and extend transmit stream
+ *
+ * @v conn		Connection
+ */
+static void netbench_tcp_process ( struct netbench_tcp *conn ) {
+	size_t used;
+
+	while ( netbench_tcp_stream_ready ( conn ) ) {
+		conn->app->tx ( conn );
+		if ( netbench_tcp_stream_len ( conn ) || ( ! conn->rx_len ) )
+			break;
+		used = conn->app->rx ( conn, conn->rx_buf, conn->rx_len );
+		if ( ! used )
+			break;
+		conn->rx_len -= used;
+		memmove ( conn->rx_buf, &conn->rx_buf[used], conn->rx_len );
+	}
+}
+
+/**
+ * Transmit pending stand-in TCP data
+ *
+ * @v conn		Connection
+ */
+static void netbench_tcp_poll ( struct netbench_tcp *conn ) {
+	unsigned int burst = NETBENCH_TCP_BURST;
+	int32_t window;
+	size_t len;
+
+	if ( ! conn->established )
+		return;
+
+	/* Go back to the oldest unacknowledged byte if the
+	 * retransmission timer has expired.
+	 */
+	if ( ( conn->snd_una != conn->snd_nxt ) &&
+	     ( ( currticks() - conn->rtx_start ) >= NETBENCH_TCP_RTO ) ) {
+		conn->snd_nxt = conn->snd_una;
+		conn->fin_sent = 0;
+		conn->rtx_start = currticks();
+	}
+
+	while ( burst-- ) {
+		netbench_tcp_process ( conn );
+		window = ( conn->snd_wnd_edge - conn->snd_nxt );
+		len = netbench_tcp_stream_len ( conn );
+		if ( window <= 0 )
+			break;
+		if ( len > ( size_t ) window )
+			len = window;
+		if ( len > NETBENCH_TCP_MSS )
+			len = NETBENCH_TCP_MSS;
+		if ( ! len ) {
+			if ( conn->closing && ! conn->fin_sent )
+				netbench_tcp_tx ( conn, ( TCP_FIN | TCP_ACK ),
+						  0 );
+			break;
+		}
+		netbench_tcp_tx ( conn, ( TCP_ACK | TCP_PSH ), len );
+	}
+}
+
+/** Stand-in TCP applications */
+static struct netbench_tcp_application netbench_http_app;
+static struct netbench_tcp_application netbench_iscsi_app;
+
+/**
+ * Find stand-in TCP application
+ *
+ * @v port		Listening port
+ * @ret app		Application, or NULL
+ */
+static struct netbench_tcp_application *
+netbench_tcp_find_app ( unsigned int port ) {
+
+	if ( port == NETBENCH_HTTP_PORT )
+		return &netbench_http_app;
+	if ( port == NETBENCH_ISCSI_PORT )
+		return &netbench_iscsi_app;
+	return NULL;
+}
+
+/**
+ * Reset unknown stand-in TCP connection
+ *
+ * @v app		Application
+ * @v tcphdr		Received TCP header
+ * @v len		Length of received data
+ *
+ * This allows the client to close a connection that the stand-in
+ * server has already forgotten (e.g. because its final ACK was lost).
+ */
+static void netbench_tcp_reset ( struct netbench_tcp_application *app,
+				 struct tcp_header *tcphdr, size_t len ) {
+	struct netbench_tcp conn;
+
+	memset ( &conn, 0, sizeof ( conn ) );
+	conn.app = app;
+	conn.port = ntohs ( tcphdr->src );
+	conn.snd_nxt = ntohl ( tcphdr->ack );
+	conn.rcv_nxt = ( ntohl ( tcphdr->seq ) + len +
+			 ( ( tcphdr->flags & TCP_FIN ) ? 1 : 0 ) );
+	netbench_tcp_tx ( &conn, ( TCP_RST | TCP_ACK ), 0 );
+}
+
+/**
+ * Receive TCP segment at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_tcp_rx ( struct io_buffer *iobuf ) {
+	struct tcp_header *tcphdr = iobuf->data;
+	struct netbench_tcp_application *app;
+	struct netbench_tcp *conn = NULL;
+	struct netbench_tcp *tmp;
+	struct netbench_tcp_chunk *chunk;
+	unsigned int i;
+	uint16_t port;
+	uint32_t seq;
+	uint32_t ack;
+	uint32_t end;
+	size_t hlen;
+	size_t len;
+	int send_ack = 0;
+
+	/* Parse header */
+	if ( iob_len ( iobuf ) < sizeof ( *tcphdr ) )
+		return;
+	hlen = ( ( tcphdr->hlen & TCP_MASK_HLEN ) / 16 ) * 4;
+	if ( iob_len ( iobuf ) < hlen )
+		return;
+	app = netbench_tcp_find_app ( ntohs ( tcphdr->dest ) );
+	if ( ! app )
+		return;
+	port = ntohs ( tcphdr->src );
+	seq = ntohl ( tcphdr->seq );
+	ack = ntohl ( tcphdr->ack );
+	iob_pull ( iobuf, hlen );
+	len = iob_len ( iobuf );
+
+	/* Find (or create) connection */
+	for ( i = 0 ; i < NETBENCH_TCP_MAX_CONNS ; i++ ) {
+		tmp = &netbench_tcp_conns[i];
+		if ( ( tmp->app == app ) && ( tmp->port == port ) ) {
+			conn = tmp;
+			break;
+		}
+		if ( ( ! tmp->app ) && ( ! conn ) &&
+		     ( tcphdr->flags & TCP_SYN ) )
+			conn = tmp;
+	}
+	if ( ! conn ) {
+		if ( ! ( tcphdr->flags & ( TCP_SYN | TCP_RST ) ) )
+			netbench_tcp_reset ( app, tcphdr, len );
+		return;
+	}
+
+	/* Handle SYN */
+	if ( tcphdr->flags & TCP_SYN ) {
+		if ( ! conn->app ) {
+			memset ( conn, 0, sizeof ( *conn ) );
+			conn->app = app;
+			conn->port = port;
+			conn->snd_una = conn->snd_nxt = netbench_tcp_iss;
+			conn->snd_end = ( netbench_tcp_iss + 1 );
+			netbench_tcp_iss += 0x01000000UL;
+		} else if ( conn->established ) {
+			/* Ignore duplicated SYN */
+			return;
+		} else {
+			/* Retransmitted SYN */
+			conn->snd_nxt = conn->snd_una;
+		}
+		conn->rcv_nxt = ( seq + 1 );
+		netbench_tcp_tx ( conn, ( TCP_SYN | TCP_ACK ), 0 );
+		return;
+	}
+
+	/* Handle RST */
+	if ( tcphdr->flags & TCP_RST ) {
+		conn->app = NULL;
+		return;
+	}
+
+	/* Handle ACK.  An acknowledgement may cover data beyond
+	 * snd_nxt if we have gone back to retransmit data that had
+	 * in fact arrived.
+	 */
+	if ( ( tcphdr->flags & TCP_ACK ) &&
+	     ( ( int32_t ) ( ack - conn->snd_una ) >= 0 ) &&
+	     ( ( int32_t ) ( ack - conn->snd_end ) <= 1 ) ) {
+		conn->established = 1;
+		if ( ack != conn->snd_una )
+			conn->rtx_start = currticks();
+		conn->snd_una = ack;
+		if ( ( int32_t ) ( ack - conn->snd_nxt ) > 0 )
+			conn->snd_nxt = ack;
+		conn->snd_wnd_edge = ( ack + ntohs ( tcphdr->win ) );
+		while ( conn->chunk_cons != conn->chunk_prod ) {
+			chunk = &conn->chunks[ conn->chunk_cons %
+					       NETBENCH_TCP_MAX_CHUNKS ];
+			end = ( chunk->seq + chunk->len + chunk->bulk );
+			if ( ( int32_t ) ( ack - end ) < 0 )
+				break;
+			conn->chunk_cons++;
+		}
+	}
+
+	/* Handle data */
+	if ( len ) {
+		if ( ( seq == conn->rcv_nxt ) &&
+		     ( len <= ( sizeof ( conn->rx_buf ) - conn->rx_len ) ) ) {
+			memcpy ( &conn->rx_buf[conn->rx_len], iobuf->data,
+				 len );
+			conn->rx_len += len;
+			conn->rcv_nxt += len;
+		}
+		send_ack = 1;
+	}
+
+	/* Handle FIN.  We close our side immediately, and forget the
+	 * connection.
+	 */
+	if ( ( tcphdr->flags & TCP_FIN ) &&
+	     ( ( seq + len ) == conn->rcv_nxt ) ) {
+		conn->rcv_nxt++;
+		if ( ! conn->fin_sent )
+			conn->snd_nxt = conn->snd_end;
+		netbench_tcp_tx ( conn, ( conn->fin_sent ? TCP_ACK :
+					  ( TCP_FIN | TCP_ACK ) ), 0 );
+		conn->app = NULL;
+		return;
+	}
+
+	/* Acknowledge data */
+	if ( send_ack )
+		netbench_tcp_tx ( conn, TCP_ACK, 0 );
+
+	/* Process received data */
+	netbench_tcp_process ( conn );
+}
+
+/****************************************************************************
+ *
+ * Stand-in HTTP server
+ *
+ */
+
+/**
+ * Receive data at stand-in HTTP server
+ *
+ * @v conn		Connection
+ * @v data		Received data
+ * @v len		Length of received data
+ * @ret used		Length of data consumed
+ */
+static size_t netbench_http_rx ( struct netbench_tcp *conn, const void *data,
+				 size_t len ) {
+	char request[ len + 1 /* NUL */ ];
+	char header[128];
+	char *path;
+	char *end;
+	size_t size = 0;
+	size_t header_len;
+
+	/* Wait for end of request headers */
+	memcpy ( request, data, len );
+	request[len] = '\0';
+	if ( ! strstr ( request, "\r\n\r\n" ) )
+		return 0;
+
+	/* Parse request line */
+	if ( strncmp ( request, "GET ", 4 ) == 0 ) {
+		path = &request[4];
+		end = strchr ( path, ' ' );
+		if ( end ) {
+			*end = '\0';
+			size = netbench_parse_size ( path );
+		}
+	}
+
+	/* Construct response */
+	if ( size ) {
+		header_len = snprintf ( header, sizeof ( header ),
+					"HTTP/1.0 200 OK\r\n"
+					"Content-Length: %zd\r\n\r\n", size );
+	} else {
+		header_len = snprintf ( header, sizeof ( header ),
+					"HTTP/1.0 404 Not Found\r\n\r\n" );
+	}
+	netbench_tcp_send ( conn, header, header_len, size );
+	conn->closing = 1;
+
+	return len;
+}
+
+/**
+ * Refill stand-in HTTP server transmit stream
+ *
+ * @v conn		Connection
+ */
+static void netbench_http_tx ( struct netbench_tcp *conn __unused ) {
+	/* Nothing to do */
+}
+
+/** Stand-in HTTP server */
+static struct netbench_tcp_application netbench_http_app = {
+	.port = NETBENCH_HTTP_PORT,
+	.rx = netbench_http_rx,
+	.tx = netbench_http_tx,
+};
+
+/****************************************************************************
+ *
+ * Stand-in iSCSI target
+ *
+ */
+
+/** Size of stand-in iSCSI disk, in blocks */
+static uint64_t netbench_iscsi_blocks;
+
+/**
+ * Send iSCSI data-in PDU
+ *
+ * @v conn		Connection
+ * @v data		Explicit data, or NULL to send bulk data
+ * @v len		Length of data
+ *
+ * The stand-in target returns status along with the final data-in
+ * PDU, and so never needs to send a SCSI response PDU for a command
+ * that returns data.
+ */
+static void netbench_iscsi_tx_data_in ( struct netbench_tcp *conn,
+					const void *data, size_t len ) {
+	struct {
+		struct iscsi_bhs_data_in data_in;
+		uint8_t data[32];
+	} __attribute__ (( packed )) pdu;
+	size_t explicit_len = ( data ? len : 0 );
+
+	assert ( explicit_len <= sizeof ( pdu.data ) );
+	memset ( &pdu, 0, sizeof ( pdu ) );
+	pdu.data_in.opcode = ISCSI_OPCODE_DATA_IN;
+	if ( len == conn->iscsi.remaining ) {
+		pdu.data_in.flags = ( ISCSI_FLAG_FINAL |
+				      ISCSI_DATA_FLAG_STATUS );
+		pdu.data_in.statsn = htonl ( conn->iscsi.statsn++ );
+	}
+	ISCSI_SET_LENGTHS ( pdu.data_in.lengths, 0, len );
+	pdu.data_in.itt = conn->iscsi.itt;
+	pdu.data_in.ttt = htonl ( 0xffffffffUL );
+	pdu.data_in.datasn = htonl ( conn->iscsi.datasn++ );
+	pdu.data_in.offset = htonl ( conn->iscsi.offset );
+	if ( data )
+		memcpy ( pdu.data, data, len );
+	netbench_tcp_send ( conn, &pdu, ( sizeof ( pdu.data_in ) +
+					  explicit_len ),
+			    ( len - explicit_len ) );
+	conn->iscsi.offset += len;
+	conn->iscsi.remaining -= len;
+}
+
+/**
+ * Receive iSCSI login request at stand-in target
+ *
+ * @v conn		Connection
+ * @v request		Login request
+ */
+static void netbench_iscsi_rx_login ( struct netbench_tcp *conn,
+				      struct iscsi_bhs_login_request *request ) {
+	union iscsi_bhs response;
+
+	/* Accept whatever transition the initiator asks for, ignoring
+	 * all key=value strings.
+	 */
+	memset ( &response, 0, sizeof ( response ) );
+	memcpy ( &response, request,
+		 offsetof ( struct iscsi_bhs_login_request, cid ) );
+	response.login_response.opcode = ISCSI_OPCODE_LOGIN_RESPONSE;
+	response.login_response.flags =
+		( request->flags & ( ISCSI_LOGIN_FLAG_TRANSITION |
+				     ISCSI_LOGIN_CSG_MASK |
+				     ISCSI_LOGIN_NSG_MASK ) );
+	ISCSI_SET_LENGTHS ( response.login_response.lengths, 0, 0 );
+	response.login_response.tsih = htons ( 1 );
+	response.login_response.statsn = htonl ( conn->iscsi.statsn++ );
+	response.login_response.expcmdsn = request->cmdsn;
+	response.login_response.maxcmdsn = request->cmdsn;
+	netbench_tcp_send ( conn, &response, sizeof ( response ), 0 );
+}
+
+/**
+ * Receive iSCSI SCSI command at stand-in target
+ *
+ * @v conn		Connection
+ * @v command		SCSI command
+ */
+static void netbench_iscsi_rx_command ( struct netbench_tcp *conn,
+				       struct iscsi_bhs_scsi_command *command ){
+	union scsi_cdb *cdb = &command->cdb;
+	struct scsi_capacity_10 capacity_10;
+	struct scsi_capacity_16 capacity_16;
+	struct iscsi_bhs_scsi_response response;
+	uint64_t lba = netbench_iscsi_blocks;
+	size_t len;
+
+	conn->iscsi.itt = command->itt;
+	conn->iscsi.datasn = 0;
+	conn->iscsi.offset = 0;
+
+	switch ( cdb->bytes[0] ) {
+	case SCSI_OPCODE_READ_CAPACITY_10:
+		memset ( &capacity_10, 0, sizeof ( capacity_10 ) );
+		capacity_10.lba = htonl ( ( lba > 0xffffffffULL ) ?
+					  0xffffffffUL : ( lba - 1 ) );
+		capacity_10.blksize = htonl ( NETBENCH_ISCSI_BLKSIZE );
+		conn->iscsi.remaining = sizeof ( capacity_10 );
+		netbench_iscsi_tx_data_in ( conn, &capacity_10,
+					    sizeof ( capacity_10 ) );
+		return;
+	case SCSI_OPCODE_SERVICE_ACTION_IN:
+		memset ( &capacity_16, 0, sizeof ( capacity_16 ) );
+		capacity_16.lba = cpu_to_be64 ( lba - 1 );
+		capacity_16.blksize = htonl ( NETBENCH_ISCSI_BLKSIZE );
+		conn->iscsi.remaining = sizeof ( capacity_16 );
+		netbench_iscsi_tx_data_in ( conn, &capacity_16,
+					    sizeof ( capacity_16 ) );
+		return;
+	case SCSI_OPCODE_READ_10:
+	case SCSI_OPCODE_READ_16:
+		/* Data is sent by netbench_iscsi_tx() */
+		len = ntohl ( command->exp_len );
+		if ( len ) {
+			conn->iscsi.remaining = len;
+			return;
+		}
+		break;
+	default:
+		break;
+	}
+
+	/* Respond with good status for anything else */
+	memset ( &response, 0, sizeof ( response ) );
+	response.opcode = ISCSI_OPCODE_SCSI_RESPONSE;
+	response.flags = ISCSI_FLAG_FINAL;
+	response.response = ISCSI_RESPONSE_COMMAND_COMPLETE;
+	response.itt = command->itt;
+	response.statsn = htonl ( conn->iscsi.statsn++ );
+	response.expcmdsn = htonl ( ntohl ( command->cmdsn ) + 1 );
+	response.maxcmdsn = response.expcmdsn;
+	netbench_tcp_send ( conn, &response, sizeof ( response ), 0 );
+}
+
+/**
+ * Receive data at stand-in iSCSI target
+ *
+ * @v conn		Connection
+ * @v data		Received data
+ * @v len		Length of received data
+ * @ret used		Length of data consumed
+ */
+static size_t netbench_iscsi_rx ( struct netbench_tcp *conn,
+				  const void *data, size_t len ) {
+	union iscsi_bhs bhs;
+	size_t pdu_len;
+
+	/* Wait for a complete PDU */
+	if ( len < sizeof ( bhs ) )
+		return 0;
+	memcpy ( &bhs, data, sizeof ( bhs ) );
+	pdu_len = ( sizeof ( bhs ) + ( 4 * ISCSI_AHS_LEN ( bhs.common.lengths ))
+		    + ISCSI_DATA_LEN ( bhs.common.lengths )
+		    + ISCSI_DATA_PAD_LEN ( bhs.common.lengths ) );
+	if ( pdu_len > sizeof ( conn->rx_buf ) ) {
+		printf ( "NETBENCH iSCSI target received oversized PDU\n" );
+		conn->rx_len = 0;
+		return 0;
+	}
+	if ( len < pdu_len )
+		return 0;
+
+	/* Handle PDU */
+	switch ( bhs.common.opcode & ISCSI_OPCODE_MASK ) {
+	case ISCSI_OPCODE_LOGIN_REQUEST:
+		netbench_iscsi_rx_login ( conn, &bhs.login_request );
+		break;
+	case ISCSI_OPCODE_SCSI_COMMAND:
+		netbench_iscsi_rx_command ( conn, &bhs.scsi_command );
+		break;
+	default:
+		/* Ignore */
+		break;
+	}
+
+	return pdu_len;
+}
+
+/**
+ * Refill stand-in iSCSI target transmit stream
+ *
+ * @v conn		Connection
+ */
+static void netbench_iscsi_tx ( struct netbench_tcp *conn ) {
+	size_t len = conn->iscsi.remaining;
+
+	if ( ! len )
+		return;
+	if ( len > NETBENCH_ISCSI_MAX_SEGMENT )
+		len = NETBENCH_ISCSI_MAX_SEGMENT;
+	netbench_iscsi_tx_data_in ( conn, NULL, len );
+}
+
+/** Stand-in iSCSI target */
+static struct netbench_tcp_application netbench_iscsi_app = {
+	.port = NETBENCH_ISCSI_PORT,
+	.rx = netbench_iscsi_rx,
+	.tx = netbench_iscsi_tx,
+};
+
+/****************************************************************************
+ *
+ * Stand-in AoE target
+ *
+ */
+
+/** Stand-in AoE target capacity (in sectors) */
+static uint64_t netbench_aoe_blocks;
+
+/**
+ * Receive ATA command at stand-in AoE target
+ *
+ * @v aoeata		AoE ATA command
+ * @v len		Length of AoE ATA command
+ * @v reply		I/O buffer for reply
+ * @ret rc		Return status code
+ */
+static int netbench_aoe_rx_ata ( struct aoeata *aoeata, size_t len,
+				 struct io_buffer *reply ) {
+	struct aoeata *reply_ata;
+	struct ata_identity *identity;
+	size_t data_len = ( aoeata->count * ATA_SECTOR_SIZE );
+
+	if ( len < sizeof ( *aoeata ) )
+		return -EINVAL;
+	reply_ata = iob_put ( reply, sizeof ( *reply_ata ) );
+	memcpy ( reply_ata, aoeata, sizeof ( *reply_ata ) );
+	reply_ata->cmd_stat = 0;
+
+	switch ( aoeata->cmd_stat ) {
+	case ATA_CMD_IDENTIFY:
+		identity = iob_put ( reply, sizeof ( *identity ) );
+		memset ( identity, 0, sizeof ( *identity ) );
+		identity->supports_lba48 = cpu_to_le16 ( ATA_SUPPORTS_LBA48 );
+		identity->lba48_sectors = cpu_to_le64 ( netbench_aoe_blocks );
+		identity->lba_sectors = cpu_to_le32 ( netbench_aoe_blocks );
+		return 0;
+	case ATA_CMD_READ:
+	case ATA_CMD_READ_EXT:
+		if ( data_len > iob_tailroom ( reply ) )
+			return -EINVAL;
+		memset ( iob_put ( reply, data_len ), NETBENCH_FILL,
+			 data_len );
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/**
+ * Receive AoE packet at stand-in AoE target
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_aoe_rx ( struct io_buffer *iobuf ) {
+	struct aoehdr *aoehdr = iobuf->data;
+	struct aoehdr *reply_hdr;
+	struct aoecfg *cfg;
+	struct io_buffer *reply;
+	uint16_t major;
+	uint8_t minor;
+
+	/* Respond only to requests addressed to the stand-in target */
+	if ( ( iob_len ( iobuf ) < sizeof ( *aoehdr ) ) ||
+	     ( ( aoehdr->ver_flags & AOE_VERSION_MASK ) != AOE_VERSION ) ||
+	     ( aoehdr->ver_flags & AOE_FL_RESPONSE ) )
+		return;
+	major = ntohs ( aoehdr->major );
+	minor = aoehdr->minor;
+	if ( ( ( major != NETBENCH_AOE_MAJOR ) &&
+	       ( major != AOE_MAJOR_BROADCAST ) ) ||
+	     ( ( minor != NETBENCH_AOE_MINOR ) &&
+	       ( minor != AOE_MINOR_BROADCAST ) ) )
+		return;
+	iob_pull ( iobuf, sizeof ( *aoehdr ) );
+
+	/* Construct reply */
+	reply = netbench_alloc_iob ( sizeof ( *reply_hdr ) +
+				     sizeof ( union aoecmd ) +
+				     ( AOE_MAX_COUNT * ATA_SECTOR_SIZE ) );
+	if ( ! reply )
+		return;
+	reply_hdr = iob_put ( reply, sizeof ( *reply_hdr ) );
+	memset ( reply_hdr, 0, sizeof ( *reply_hdr ) );
+	reply_hdr->ver_flags = ( AOE_VERSION | AOE_FL_RESPONSE );
+	reply_hdr->major = htons ( NETBENCH_AOE_MAJOR );
+	reply_hdr->minor = NETBENCH_AOE_MINOR;
+	reply_hdr->command = aoehdr->command;
+	reply_hdr->tag = aoehdr->tag;
+	switch ( aoehdr->command ) {
+	case AOE_CMD_CONFIG:
+		cfg = iob_put ( reply, sizeof ( *cfg ) );
+		memset ( cfg, 0, sizeof ( *cfg ) );
+		cfg->bufcnt = htons ( 1 );
+		cfg->scnt = AOE_MAX_COUNT;
+		break;
+	case AOE_CMD_ATA:
+		if ( netbench_aoe_rx_ata ( iobuf->data, iob_len ( iobuf ),
+					   reply ) != 0 ) {
+			reply_hdr->ver_flags |= AOE_FL_ERROR;
+			reply_hdr->error = AOE_ERR_BAD_COMMAND;
+		}
+		break;
+	default:
+		reply_hdr->ver_flags |= AOE_FL_ERROR;
+		reply_hdr->error = AOE_ERR_BAD_COMMAND;
+		break;
+	}
+	netbench_ll_tx ( reply, htons ( ETH_P_AOE ) );
+}
+
+/****************************************************************************
+ *
+ * Loopback network device
+ *
+ */
+
+/**
+ * Receive frame at stand-in server
+ *
+ * @v iobuf		I/O buffer
+ */
+static void netbench_server_rx ( struct io_buffer *iobuf ) {
+	struct ethhdr *ethhdr = iobuf->data;
+	struct iphdr *iphdr;
+	size_t hlen;
+
+	if ( iob_len ( iobuf ) < sizeof ( *ethhdr ) )
+		return;
+	iob_pull ( iobuf, sizeof ( *ethhdr ) );
+
+	/* Handle ARP */
+	if ( ethhdr->h_protocol == htons ( ETH_P_ARP ) ) {
+		netbench_arp_rx ( iobuf );
+		return;
+	}
+
+	/* Handle AoE */
+	if ( ethhdr->h_protocol == htons ( ETH_P_AOE ) ) {
+		netbench_aoe_rx ( iobuf );
+		return;
+	}
+
+	/* Handle IPv4 packets addressed to the stand-in server, or
+	 * broadcast (e.g. DHCP requests).
+	 */
+	if ( ( ethhdr->h_protocol != htons ( ETH_P_IP ) ) ||
+	     ( iob_len ( iobuf ) < sizeof ( *iphdr ) ) )
+		return;
+	iphdr = iobuf->data;
+	hlen = ( ( iphdr->verhdrlen & IP_MASK_HLEN ) * 4 );
+	if ( ( ( iphdr->dest.s_addr != htonl ( NETBENCH_SERVER_IP ) ) &&
+	       ( iphdr->dest.s_addr != INADDR_BROADCAST ) ) ||
+	     ( iob_len ( iobuf ) < ntohs ( iphdr->len ) ) )
+		return;
+	iob_unput ( iobuf, ( iob_len ( iobuf ) - ntohs ( iphdr->len ) ) );
+	iob_pull ( iobuf, hlen );
+	switch ( iphdr->protocol ) {
+	case IP_UDP:
+		netbench_udp_rx ( iobuf );
+		break;
+	case IP_TCP:
+		netbench_tcp_rx ( iobuf );
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Reset stand-in servers
+ *
+ */
+static void netbench_reset ( void ) {
+	memset ( &netbench_tftp, 0, sizeof ( netbench_tftp ) );
+	memset ( netbench_tcp_conns, 0, sizeof ( netbench_tcp_conns ) );
+}
+
+/**
+ * Open loopback network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int netbench_open ( struct net_device *netdev __unused ) {
+	return 0;
+}
+
+/**
+ * Close loopback network device
+ *
+ * @v netdev		Network device
+ */
+static void netbench_close ( struct net_device *netdev __unused ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+
+	list_for_each_entry_safe ( iobuf, tmp, &netbench_rx_queue, list ) {
+		list_del ( &iobuf->list );
+		free_iob ( iobuf );
+	}
+	netbench_reset();
+}
+
+/**
+ * Transmit packet via loopback network device
+ *
+ * @v netdev		Network device
+ * @v iobuf		I/O buffer
+ * @ret rc		Return status code
+ *
+ * The stand-in server processes the packet immediately; any response
+ * is queued for delivery on the next poll.
+ */
+static int netbench_transmit ( struct net_device *netdev,
+			       struct io_buffer *iobuf ) {
+	struct io_buffer *copy;
+
+	/* Process a copy, since the stand-in server modifies the
+	 * packet as it parses it.
+	 */
+	copy = alloc_iob ( iob_len ( iobuf ) );
+	if ( copy ) {
+		memcpy ( iob_put ( copy, iob_len ( iobuf ) ), iobuf->data,
+			 iob_len ( iobuf ) );
+		netbench_server_rx ( copy );
+		free_iob ( copy );
+	}
+	netdev_tx_complete ( netdev, iobuf );
+	return 0;
+}
+
+/**
+ * Poll loopback network device
+ *
+ * @v netdev		Network device
+ */
+static void netbench_poll ( struct net_device *netdev ) {
+	struct io_buffer *iobuf;
+	struct io_buffer *tmp;
+	unsigned int i;
+
+	/* Allow stand-in TCP to transmit any pending data */
+	for ( i = 0 ; i < NETBENCH_TCP_MAX_CONNS ; i++ ) {
+		if ( netbench_tcp_conns[i].app )
+			netbench_tcp_poll ( &netbench_tcp_conns[i] );
+	}
+
+	/* Allow stand-in TFTP server to retransmit */
+	netbench_tftp_poll();
+
+	/* Deliver queued frames */
+	list_for_each_entry_safe ( iobuf, tmp, &netbench_rx_queue, list ) {
+		list_del ( &iobuf->list );
+		netdev_rx ( netdev, iobuf );
+	}
+}
+
+/**
+ * Enable or disable interrupts
+ *
+ * @v netdev		Network device
+ * @v enable		Interrupts should be enabled
+ */
+static void netbench_irq ( struct net_device *netdev __unused,
+			   int enable __unused ) {
+	/* Nothing to do */
+}
+
+/** Loopback network device operations */
+static struct net_device_operations netbench_operations = {
+	.open		= netbench_open,
+	.close		= netbench_close,
+	.transmit	= netbench_transmit,
+	.poll		= netbench_poll,
+	.irq		= netbench_irq,
+};
+
+/** Loopback device */
+static struct device netbench_dev;
+
+/**
+ * Probe loopback root bus
+ *
+ * @v rootdev		Loopback bus root device
+ * @ret rc		Return status code
+ */
+static int netbench_probe ( struct root_device *rootdev ) {
+	struct net_device *netdev;
+	int rc;
+
+	/* Allocate network device */
+	netdev = alloc_etherdev ( 0 );
+	if ( ! netdev ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+	netdev_init ( netdev, &netbench_operations );
+	memcpy ( netdev->hw_addr, netbench_client_mac, ETH_ALEN );
+
+	/* Add to device hierarchy */
+	strcpy ( netbench_dev.name, "netbench" );
+	netbench_dev.parent = &rootdev->dev;
+	list_add ( &netbench_dev.siblings, &rootdev->dev.children );
+	INIT_LIST_HEAD ( &netbench_dev.children );
+	netdev->dev = &netbench_dev;
+
+	/* Register network device */
+	netdev_link_up ( netdev );
+	if ( ( rc = register_netdev ( netdev ) ) != 0 )
+		goto err_register;
+	netbench_netdev = netdev;
+
+	return 0;
+
+	unregister_netdev ( netdev );
+ err_register:
+	list_del ( &netbench_dev.siblings );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Remove loopback root bus
+ *
+ * @v rootdev		Loopback bus root device
+ */
+static void netbench_remove ( struct root_device *rootdev __unused ) {
+	struct net_device *netdev = netbench_netdev;
+
+	unregister_netdev ( netdev );
+	list_del ( &netbench_dev.siblings );
+	netdev_nullify ( netdev );
+	netdev_put ( netdev );
+	netbench_netdev = NULL;
+}
+
+/** Loopback bus root device driver */
+static struct root_driver netbench_root_driver = {
+	.probe = netbench_probe,
+	.remove = netbench_remove,
+};
+
+/** Loopback bus root device */
+struct root_device netbench_root_device __root_device = {
+	.dev = { .name = "netbench" },
+	.driver = &netbench_root_driver,
+};
+
+/****************************************************************************
+ *
+ * Benchmarks
+ *
+ */
+
+/**
+ * Report benchmark result
+ *
+ * @v name		Benchmark name
+ * @v len		Length of data transferred
+ * @v elapsed		Elapsed time, in ticks
+ */
+static void netbench_report ( const char *name, size_t len,
+			      unsigned long elapsed ) {
+	unsigned long ms;
+	unsigned long rate;
+
+	if ( ! elapsed )
+		elapsed = 1;
+	ms = ( ( ( uint64_t ) elapsed * 1000 ) / TICKS_PER_SEC );
+	rate = ( ( ( uint64_t ) len * TICKS_PER_SEC ) / ( elapsed * 1024 ) );
+	printf ( "%s: %zd kB in %ld ms (%ld kB/s)\n",
+		 name, ( len / 1024 ), ms, rate );
+}
+
+/**
+ * Register downloaded image
+ *
+ * @v image		Image
+ * @ret rc		Return status code
+ *
+ * Downloaded images are simply discarded.
+ */
+static int netbench_register ( struct image *image __unused ) {
+	return 0;
+}
+
+/**
+ * Benchmark a download protocol
+ *
+ * @v scheme		URI scheme
+ * @v size		Transfer size
+ * @ret rc		Return status code
+ */
+static int netbench_download ( const char *scheme, size_t size ) {
+	char uri_string[64];
+	struct image *image;
+	unsigned long start;
+	int rc;
+
+	snprintf ( uri_string, sizeof ( uri_string ), "%s://10.254.0.1/%zd",
+		   scheme, size );
+	image = alloc_image();
+	if ( ! image )
+		return -ENOMEM;
+	start = currticks();
+	if ( ( rc = create_downloader ( &monojob, image, netbench_register,
+					LOCATION_URI_STRING,
+					uri_string ) ) == 0 )
+		rc = monojob_wait ( uri_string );
+	if ( ( rc == 0 ) && ( image->len != size ) ) {
+		printf ( "%s: got %zd bytes, expected %zd\n",
+			 scheme, image->len, size );
+		rc = -EIO;
+	}
+	if ( rc == 0 )
+		netbench_report ( scheme, size, ( currticks() - start ) );
+	image_put ( image );
+	return rc;
+}
+
+/**
+ * Read entire block device
+ *
+ * @v name		Benchmark name
+ * @v blockdev		Block device
+ * @v start		Start time, in ticks
+ * @ret rc		Return status code
+ */
+static int netbench_read_blockdev ( const char *name,
+				    struct block_device *blockdev,
+				    unsigned long start ) {
+	userptr_t buffer;
+	uint64_t block;
+	unsigned long count;
+	int rc = 0;
+
+	buffer = umalloc ( NETBENCH_BLOCK_COUNT * blockdev->blksize );
+	if ( ! buffer )
+		return -ENOMEM;
+	for ( block = 0 ; block < blockdev->blocks ; block += count ) {
+		count = NETBENCH_BLOCK_COUNT;
+		if ( count > ( blockdev->blocks - block ) )
+			count = ( blockdev->blocks - block );
+		if ( ( rc = blockdev->op->read ( blockdev, block, count,
+						 buffer ) ) != 0 ) {
+			printf ( "%s: could not read block %lld: %s\n", name,
+				 ( ( long long ) block ), strerror ( rc ) );
+			goto err_read;
+		}
+	}
+	netbench_report ( name, ( blockdev->blocks * blockdev->blksize ),
+			  ( currticks() - start ) );
+
+ err_read:
+	ufree ( buffer );
+	return rc;
+}
+
+/**
+ * Benchmark iSCSI
+ *
+ * @v size		Transfer size
+ * @ret rc		Return status code
+ */
+static int netbench_iscsi ( size_t size ) {
+	struct scsi_device *scsi;
+	unsigned long start;
+	int rc;
+
+	netbench_iscsi_blocks = ( ( size + NETBENCH_ISCSI_BLKSIZE - 1 ) /
+				  NETBENCH_ISCSI_BLKSIZE );
+	scsi = zalloc ( sizeof ( *scsi ) );
+	if ( ! scsi ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	start = currticks();
+	if ( ( rc = iscsi_attach ( scsi, NETBENCH_ISCSI_ROOT_PATH ) ) != 0 ) {
+		printf ( "iscsi: could not attach: %s\n", strerror ( rc ) );
+		goto err_attach;
+	}
+	if ( ( rc = init_scsidev ( scsi ) ) != 0 ) {
+		printf ( "iscsi: could not initialise: %s\n",
+			 strerror ( rc ) );
+		goto err_init;
+	}
+	rc = netbench_read_blockdev ( "iscsi", &scsi->blockdev, start );
+
+ err_init:
+	iscsi_detach ( scsi );
+ err_attach:
+	free ( scsi );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Benchmark AoE
+ *
+ * @v size		Transfer size
+ * @ret rc		Return status code
+ */
+static int netbench_aoe ( size_t size ) {
+	struct ata_device *ata;
+	unsigned long start;
+	int rc;
+
+	netbench_aoe_blocks = ( ( size + ATA_SECTOR_SIZE - 1 ) /
+				ATA_SECTOR_SIZE );
+	ata = zalloc ( sizeof ( *ata ) );
+	if ( ! ata ) {
+		rc = -ENOMEM;
+		goto err_alloc;
+	}
+
+	start = currticks();
+	if ( ( rc = aoe_attach ( ata, netbench_netdev,
+				 NETBENCH_AOE_ROOT_PATH ) ) != 0 ) {
+		printf ( "aoe: could not attach: %s\n", strerror ( rc ) );
+		goto err_attach;
+	}
+	if ( ( rc = init_atadev ( ata ) ) != 0 ) {
+		printf ( "aoe: could not initialise: %s\n", strerror ( rc ) );
+		goto err_init;
+	}
+	rc = netbench_read_blockdev ( "aoe", &ata->blockdev, start );
+
+ err_init:
+	aoe_detach ( ata );
+ err_attach:
+	free ( ata );
+ err_alloc:
+	return rc;
+}
+
+/**
+ * Benchmark DHCP
+ *
+ * @ret rc		Return status code
+ *
+ * DHCP transactions are too small to measure in bytes per second, so
+ * the benchmark reports the time taken by each transaction instead.
+ */
+static int netbench_dhcp ( void ) {
+	unsigned long start;
+	unsigned long elapsed;
+	unsigned int i;
+	int rc;
+
+	start = currticks();
+	for ( i = 0 ; i < NETBENCH_DHCP_COUNT ; i++ ) {
+		if ( ( rc = start_dhcp ( &monojob, netbench_netdev ) ) == 0 )
+			rc = monojob_wait ( "dhcp" );
+		if ( rc != 0 )
+			return rc;
+	}
+	elapsed = ( currticks() - start );
+	printf ( "dhcp: %d transactions in %ld ms (%ld us each)\n",
+		 NETBENCH_DHCP_COUNT,
+		 ( ( unsigned long ) ( ( ( uint64_t ) elapsed * 1000 ) /
+				       TICKS_PER_SEC ) ),
+		 ( ( unsigned long ) ( ( ( uint64_t ) elapsed * 1000000 ) /
+				       ( NETBENCH_DHCP_COUNT *
+					 TICKS_PER_SEC ) ) ) );
+	return 0;
+}
+
+/**
+ * Configure loopback network device
+ *
+ * @ret rc		Return status code
+ */
+static int netbench_configure ( void ) {
+	struct net_device *netdev = netbench_netdev;
+	struct settings *settings;
+	struct in_addr ip = { .s_addr = htonl ( NETBENCH_CLIENT_IP ) };
+	struct in_addr netmask = { .s_addr = htonl ( NETBENCH_NETMASK ) };
+	int rc;
+
+	if ( ! netdev ) {
+		printf ( "netbench: no loopback device\n" );
+		return -ENODEV;
+	}
+	settings = netdev_settings ( netdev );
+	if ( ( ( rc = store_setting ( settings, &ip_setting, &ip,
+				      sizeof ( ip ) ) ) != 0 ) ||
+	     ( ( rc = store_setting ( settings, &netmask_setting, &netmask,
+				      sizeof ( netmask ) ) ) != 0 ) ) {
+		printf ( "netbench: could not configure %s: %s\n",
+			 netdev->name, strerror ( rc ) );
+		return rc;
+	}
+	if ( ( rc = netdev_open ( netdev ) ) != 0 ) {
+		printf ( "netbench: could not open %s: %s\n",
+			 netdev->name, strerror ( rc ) );
+		return rc;
+	}
+	return 0;
+}
+
+/** "netbench" options */
+static struct option netbench_opts[] = {
+	{ "help", 0, NULL, 'h' },
+	{ "size", required_argument, NULL, 's' },
+	{ "profile", required_argument, NULL, 'p' },
+	{ "seed", required_argument, NULL, 'S' },
+	{ NULL, 0, NULL, 0 },
+};
+
+/**
+ * "netbench" syntax message
+ *
+ * @v argv		Argument list
+ */
+static void netbench_syntax ( char **argv ) {
+	printf ( "Usage:\n"
+		 "  %s [-s|--size <size>[k|M]] [-p|--profile <profile>|all]\n"
+		 "       [-S|--seed <seed>] [tftp|http|iscsi|aoe|dhcp...]\n"
+		 "\n"
+		 "Benchmark network protocols against stand-in servers\n",
+		 argv[0] );
+}
+
+/**
+ * Run benchmarks
+ *
+ * @v protocols		List of protocols
+ * @v count		Number of protocols
+ * @v size		Transfer size
+ * @ret rc		Return status code
+ */
+static int netbench_run ( char **protocols, unsigned int count,
+			  size_t size ) {
+	unsigned int i;
+	int rc;
+
+	for ( i = 0 ; i < count ; i++ ) {
+		netbench_reset();
+		if ( strcmp ( protocols[i], "iscsi" ) == 0 ) {
+			rc = netbench_iscsi ( size );
+		} else if ( strcmp ( protocols[i], "aoe" ) == 0 ) {
+			rc = netbench_aoe ( size );
+		} else if ( strcmp ( protocols[i], "dhcp" ) == 0 ) {
+			rc = netbench_dhcp();
+		} else if ( ( strcmp ( protocols[i], "tftp" ) == 0 ) ||
+			    ( strcmp ( protocols[i], "http" ) == 0 ) ) {
+			rc = netbench_download ( protocols[i], size );
+		} else {
+			printf ( "Unknown protocol \"%s\"\n", protocols[i] );
+			rc = -ENOTSUP;
+		}
+		if ( rc != 0 ) {
+			printf ( "%s: %s\n", protocols[i], strerror ( rc ) );
+			return rc;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Run benchmarks on impaired loopback network device
+ *
+ * @v impairment	Network impairment profile
+ * @v seed		Pseudo-random seed
+ * @v protocols		List of protocols
+ * @v count		Number of protocols
+ * @v size		Transfer size
+ * @ret rc		Return status code
+ */
+static int netbench_run_impaired ( struct impairment *impairment,
+				   unsigned long seed, char **protocols,
+				   unsigned int count, size_t size ) {
+	struct impairnet *impairnet;
+	int rc;
+
+	printf ( "Profile \"%s\" (seed %ld):\n", impairment->name, seed );
+	if ( ( rc = impair_netdev ( netbench_netdev, impairment,
+				    seed ) ) != 0 ) {
+		printf ( "Could not impair %s: %s\n",
+			 netbench_netdev->name, strerror ( rc ) );
+		return rc;
+	}
+	rc = netbench_run ( protocols, count, size );
+	impairnet = find_impairnet ( netbench_netdev );
+	if ( impairnet ) {
+		printf ( "  tx: %d delivered, %d lost, %d duplicated, "
+			 "%d reordered\n", impairnet->tx.stats.delivered,
+			 impairnet->tx.stats.lost,
+			 impairnet->tx.stats.duplicated,
+			 impairnet->tx.stats.reordered );
+		printf ( "  rx: %d delivered, %d lost, %d duplicated, "
+			 "%d reordered\n", impairnet->rx.stats.delivered,
+			 impairnet->rx.stats.lost,
+			 impairnet->rx.stats.duplicated,
+			 impairnet->rx.stats.reordered );
+	}
+	unimpair_netdev ( netbench_netdev );
+	return rc;
+}
+
+/**
+ * The "netbench" command
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @ret rc		Exit code
+ */
+static int netbench_exec ( int argc, char **argv ) {
+	static char *all[] = { "tftp", "http", "iscsi", "aoe", "dhcp" };
+	char **protocols = all;
+	unsigned int count = ( sizeof ( all ) / sizeof ( all[0] ) );
+	size_t size = NETBENCH_DEFAULT_SIZE;
+	const char *profile = NULL;
+	struct impairment *impairment;
+	unsigned long seed = 1;
+	char *end;
+	int c;
+	int rc;
+
+	/* Parse options */
+	while ( ( c = getopt_long ( argc, argv, "hs:p:S:", netbench_opts,
+				    NULL ) ) >= 0 ) {
+		switch ( c ) {
+		case 's':
+			size = strtoul ( optarg, &end, 0 );
+			if ( *end == 'k' ) {
+				size *= 1024;
+				end++;
+			} else if ( *end == 'M' ) {
+				size *= ( 1024 * 1024 );
+				end++;
+			}
+			if ( *end || ( ! size ) ) {
+				printf ( "Invalid size \"%s\"\n", optarg );
+				return 1;
+			}
+			break;
+		case 'p':
+			profile = optarg;
+			if ( ( strcmp ( profile, "all" ) != 0 ) &&
+			     ( ! find_impairment ( profile ) ) ) {
+				printf ( "Unknown profile \"%s\"\n", profile );
+				return 1;
+			}
+			break;
+		case 'S':
+			seed = strtoul ( optarg, &end, 0 );
+			if ( *end ) {
+				printf ( "Invalid seed \"%s\"\n", optarg );
+				return 1;
+			}
+			break;
+		case 'h':
+			/* Display help text */
+		default:
+			/* Unrecognised/invalid option */
+			netbench_syntax ( argv );
+			return 1;
+		}
+	}
+	if ( optind < argc ) {
+		protocols = &argv[optind];
+		count = ( argc - optind );
+	}
+
+	if ( ( rc = netbench_configure() ) != 0 )
+		return 1;
+
+	/* Run unimpaired, with a single profile, or with every profile */
+	if ( ! profile ) {
+		rc = netbench_run ( protocols, count, size );
+	} else if ( strcmp ( profile, "all" ) != 0 ) {
+		rc = netbench_run_impaired ( find_impairment ( profile ), seed,
+					     protocols, count, size );
+	} else {
+		for_each_table_entry ( impairment, IMPAIRMENTS ) {
+			if ( ( rc = netbench_run_impaired ( impairment, seed,
+							    protocols, count,
+							    size ) ) != 0 )
+				break;
+		}
+	}
+
+	return ( rc ? 1 : 0 );
+}
+
+/** "netbench" command */
+struct command netbench_command __command = {
+	.name = "netbench",
+	.exec = netbench_exec,
+};
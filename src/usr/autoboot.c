@@ -130,12 +130,12 @@ int boot_root_path ( const char *root_path ) {
 }
 
 /**
- * Boot from a network device
+ * Boot from a network device that has already been configured
  *
  * @v netdev		Network device
  * @ret rc		Return status code
  */
-static int netboot ( struct net_device *netdev ) {
+static int netboot_configured ( struct net_device *netdev ) {
 	struct setting vendor_class_id_setting
 		= { .tag = DHCP_VENDOR_CLASS_ID };
 	struct setting pxe_discovery_control_setting
@@ -147,14 +147,6 @@ static int netboot ( struct net_device *netdev ) {
 	unsigned int pxe_discovery_control;
 	int rc;
 
-	/* Open device and display device status */
-	if ( ( rc = ifopen ( netdev ) ) != 0 )
-		return rc;
-	ifstat ( netdev );
-
-	/* Configure device via DHCP */
-	if ( ( rc = dhcp ( netdev ) ) != 0 )
-		return rc;
 	route();
 
 	/* Try PXE menu boot, if applicable */
@@ -200,6 +192,27 @@ static int netboot ( struct net_device *netdev ) {
 	return -ENOENT;
 }
 
+/**
+ * Boot from a network device
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ */
+static int netboot ( struct net_device *netdev ) {
+	int rc;
+
+	/* Open device and display device status */
+	if ( ( rc = ifopen ( netdev ) ) != 0 )
+		return rc;
+	ifstat ( netdev );
+
+	/* Configure device via DHCP */
+	if ( ( rc = dhcp ( netdev ) ) != 0 )
+		return rc;
+
+	return netboot_configured ( netdev );
+}
+
 /**
  * Close all open net devices
  *
@@ -223,10 +236,17 @@ void autoboot ( void ) {
 	struct net_device *boot_netdev;
 	struct net_device *netdev;
 
-	/* If we have an identifable boot device, try that first */
+	/* If we have an identifable boot device, try that first.
+	 * Otherwise, perform DHCP on all devices in parallel and try
+	 * whichever device is configured first.
+	 */
 	close_all_netdevs();
-	if ( ( boot_netdev = find_boot_netdev() ) )
+	if ( ( boot_netdev = find_boot_netdev() ) ) {
 		netboot ( boot_netdev );
+	} else if ( dhcp_any ( &boot_netdev ) == 0 ) {
+		ifstat ( boot_netdev );
+		netboot_configured ( boot_netdev );
+	}
 
 	/* If that fails, try booting from any of the other devices */
 	for_each_netdev ( netdev ) {
@@ -19,12 +19,17 @@
 FILE_LICENCE ( GPL2_OR_LATER );
 
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <console.h>
 #include <gpxe/netdevice.h>
 #include <gpxe/dhcp.h>
+#include <gpxe/job.h>
 #include <gpxe/monojob.h>
 #include <gpxe/process.h>
+#include <gpxe/keys.h>
+#include <gpxe/timer.h>
 #include <usr/ifmgmt.h>
 #include <usr/dhcpmgmt.h>
 
@@ -36,6 +41,34 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/**
+ * Apply any MTU increase supplied via DHCP
+ *
+ * @v netdev		Network device
+ * @ret rc		Return status code
+ *
+ * An MTU increase cannot take effect while the device is open, since
+ * the driver may need to reallocate its receive buffers.  DHCP has
+ * completed by the time this is called, so there is no traffic in
+ * flight and the device can safely be reopened with the new MTU.
+ */
+static int dhcp_apply_mtu ( struct net_device *netdev ) {
+	int rc;
+
+	/* Do nothing unless an MTU increase is pending */
+	if ( ! netdev->pending_mtu )
+		return 0;
+
+	/* Reopen device and wait for link to return */
+	netdev_close ( netdev );
+	if ( ( rc = ifopen ( netdev ) ) != 0 )
+		return rc;
+	if ( ( rc = iflinkwait ( netdev, LINK_WAIT_MS ) ) != 0 )
+		return rc;
+
+	return 0;
+}
+
 int dhcp ( struct net_device *netdev ) {
 	uint8_t *chaddr;
 	uint8_t hlen;
@@ -62,8 +95,14 @@ int dhcp ( struct net_device *netdev ) {
 		printf ( " using cached\n" );
 		rc = 0;
 	}
+	if ( rc != 0 )
+		return rc;
 
-	return rc;
+	/* Apply any increased MTU */
+	if ( ( rc = dhcp_apply_mtu ( netdev ) ) != 0 )
+		return rc;
+
+	return 0;
 }
 
 int pxebs ( struct net_device *netdev, unsigned int pxe_type ) {
@@ -76,3 +115,160 @@ int pxebs ( struct net_device *netdev, unsigned int pxe_type ) {
 
 	return rc;
 }
+
+/** A DHCP attempt on one of several network devices */
+struct dhcp_attempt {
+	/** Job control interface */
+	struct job_interface job;
+	/** Network device */
+	struct net_device *netdev;
+	/** DHCP has been started */
+	int started;
+	/** Status code (-EINPROGRESS while incomplete) */
+	int rc;
+};
+
+/**
+ * Handle DHCP attempt completion
+ *
+ * @v job		Job control interface
+ * @v rc		Return status code
+ */
+static void dhcp_attempt_done ( struct job_interface *job, int rc ) {
+	struct dhcp_attempt *attempt =
+		container_of ( job, struct dhcp_attempt, job );
+
+	attempt->rc = rc;
+}
+
+/** DHCP attempt job control operations */
+static struct job_interface_operations dhcp_attempt_operations = {
+	.done		= dhcp_attempt_done,
+	.kill		= ignore_job_kill,
+	.progress	= ignore_job_progress,
+};
+
+/**
+ * Configure any network device via DHCP
+ *
+ * @ret configured	Configured network device
+ * @ret rc		Return status code
+ *
+ * All network devices are opened, and DHCP is started on each as soon
+ * as its link comes up.  The first device to complete DHCP is used,
+ * and DHCP is abandoned on all others.
+ */
+int dhcp_any ( struct net_device **configured ) {
+	struct dhcp_attempt *attempts;
+	struct dhcp_attempt *attempt;
+	struct net_device *netdev;
+	unsigned int count = 0;
+	unsigned int active;
+	unsigned long start;
+	unsigned long last_progress_dot;
+	int rc;
+
+	/* Allocate and open all network devices */
+	*configured = NULL;
+	for_each_netdev ( netdev )
+		count++;
+	if ( ! count )
+		return -ENODEV;
+	attempts = zalloc ( count * sizeof ( attempts[0] ) );
+	if ( ! attempts )
+		return -ENOMEM;
+	attempt = attempts;
+	for_each_netdev ( netdev ) {
+		job_init ( &attempt->job, &dhcp_attempt_operations, NULL );
+		attempt->netdev = netdev;
+		attempt->rc = ifopen ( netdev );
+		if ( attempt->rc == 0 )
+			attempt->rc = -EINPROGRESS;
+		attempt++;
+	}
+	printf ( "DHCP (" );
+	for ( attempt = attempts ; attempt < ( attempts + count ) ; attempt++ ){
+		printf ( "%s%s", ( ( attempt == attempts ) ? "" : " " ),
+			 attempt->netdev->name );
+	}
+	printf ( ")." );
+
+	/* Wait for first successful attempt */
+	rc = -ENODEV;
+	start = last_progress_dot = currticks();
+	while ( 1 ) {
+		step();
+		active = 0;
+		for ( attempt = attempts ; attempt < ( attempts + count ) ;
+		      attempt++ ) {
+
+			/* Start DHCP once link is up */
+			netdev = attempt->netdev;
+			if ( ( attempt->rc == -EINPROGRESS ) &&
+			     ( ! attempt->started ) ) {
+				if ( netdev_link_ok ( netdev ) ) {
+					attempt->started = 1;
+					attempt->rc = start_dhcp ( &attempt->job,
+								   netdev );
+					if ( attempt->rc == 0 ) {
+						attempt->rc = -EINPROGRESS;
+					} else if ( attempt->rc > 0 ) {
+						/* Using cached settings */
+						attempt->rc = 0;
+					}
+				} else if ( ( currticks() - start ) >
+					    ( ( LINK_WAIT_MS * TICKS_PER_SEC ) /
+					      1000 ) ) {
+					attempt->rc = netdev->link_rc;
+				}
+			}
+
+			/* Record status */
+			if ( attempt->rc == 0 ) {
+				*configured = netdev;
+				break;
+			} else if ( attempt->rc == -EINPROGRESS ) {
+				active++;
+			} else {
+				rc = attempt->rc;
+			}
+		}
+		if ( *configured ) {
+			rc = 0;
+			break;
+		}
+		if ( ! active )
+			break;
+		if ( iskey() && ( getchar() == CTRL_C ) ) {
+			rc = -ECANCELED;
+			break;
+		}
+		if ( ( currticks() - last_progress_dot ) >= TICKS_PER_SEC ) {
+			printf ( "." );
+			last_progress_dot = currticks();
+		}
+	}
+
+	/* Abandon all other attempts.  Killing a completed attempt
+	 * simply detaches it from its (already terminated) DHCP
+	 * session.
+	 */
+	for ( attempt = attempts ; attempt < ( attempts + count ) ; attempt++ ){
+		if ( attempt->started )
+			job_kill ( &attempt->job );
+	}
+	free ( attempts );
+
+	if ( rc == 0 ) {
+		printf ( " ok (%s)\n", ( *configured )->name );
+	} else {
+		printf ( " %s\n", strerror ( rc ) );
+		return rc;
+	}
+
+	/* Apply any increased MTU */
+	if ( ( rc = dhcp_apply_mtu ( *configured ) ) != 0 )
+		return rc;
+
+	return 0;
+}
@@ -26,7 +26,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/netdevice.h>
 #include <gpxe/device.h>
 #include <gpxe/process.h>
+#include <gpxe/timer.h>
 #include <gpxe/keys.h>
+#include <gpxe/settings.h>
+#include <gpxe/netstats.h>
 #include <usr/ifmgmt.h>
 
 /** @file
@@ -98,10 +101,56 @@ void ifstat ( struct net_device *netdev ) {
 		printf ( "  [Link status: %s]\n",
 			 strerror ( netdev->link_rc ) );
 	}
+	if ( netdev->state & NETDEV_LINK_TIMED ) {
+		printf ( "  [Link up after %ldms]\n",
+			 ( ( netdev->link_time * 1000 ) / TICKS_PER_SEC ) );
+	}
 	ifstat_errors ( &netdev->tx_stats, "TXE" );
 	ifstat_errors ( &netdev->rx_stats, "RXE" );
 }
 
+/**
+ * Print network device queue occupancy histogram
+ *
+ * @v stats		Network device statistics
+ * @v prefix		Message prefix
+ */
+static void ifstat_occupancy ( struct net_device_stats *stats,
+			       const char *prefix ) {
+	unsigned int i;
+
+	printf ( "  [%s occupancy:", prefix );
+	for ( i = 0 ; i < NETDEV_OCCUPANCY_BUCKETS ; i++ )
+		printf ( " %d%s:%d", ( 1 << i ),
+			 ( ( i == ( NETDEV_OCCUPANCY_BUCKETS - 1 ) ) ?
+			   "+" : "" ), stats->occupancy[i] );
+	printf ( "]\n" );
+}
+
+/**
+ * Print status and statistics of network device
+ *
+ * @v netdev		Network device
+ */
+void ifstat_verbose ( struct net_device *netdev ) {
+	struct net_statistic *stat;
+	unsigned int i;
+
+	ifstat ( netdev );
+	ifstat_occupancy ( &netdev->tx_stats, "TX" );
+	ifstat_occupancy ( &netdev->rx_stats, "RX" );
+	if ( netdev->num_queues > 1 ) {
+		for ( i = 0 ; i < netdev->num_queues ; i++ ) {
+			printf ( "  [Queue %d: TX:%d RX:%d]\n", i,
+				 netdev->queues[i].tx, netdev->queues[i].rx );
+		}
+	}
+	for_each_table_entry ( stat, NET_STATISTICS ) {
+		printf ( "  %s: %ld (%s)\n", stat->setting->name,
+			 stat->value ( netdev ), stat->setting->description );
+	}
+}
+
 /**
  * Wait for link-up, with status indication
  *
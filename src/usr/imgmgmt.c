@@ -25,8 +25,10 @@ FILE_LICENCE ( GPL2_OR_LATER );
 #include <gpxe/image.h>
 #include <gpxe/downloader.h>
 #include <gpxe/monojob.h>
+#include <gpxe/bgjob.h>
 #include <gpxe/open.h>
 #include <gpxe/uri.h>
+#include <gpxe/imgcache.h>
 #include <usr/imgmgmt.h>
 
 /** @file
@@ -35,6 +37,87 @@ FILE_LICENCE ( GPL2_OR_LATER );
  *
  */
 
+/**
+ * Fetch image from image cache
+ *
+ * @v image		Image
+ * @v uri		Image URI
+ * @ret rc		Return status code
+ *
+ * This is a stub used when the image cache is not present.
+ */
+__weak int imgcache_fetch ( struct image *image __unused,
+			    struct uri *uri __unused ) {
+	return -ENOENT;
+}
+
+/**
+ * Add image to image cache
+ *
+ * @v image		Image
+ * @v uri		Image URI
+ *
+ * This is a stub used when the image cache is not present.
+ */
+__weak void imgcache_add ( struct image *image __unused,
+			   struct uri *uri __unused ) {
+	/* Nothing to do */
+}
+
+/**
+ * Prepare to fetch an image
+ *
+ * @v image		Image
+ * @v uri_string	URI as a string
+ * @v image_register	Image registration routine
+ * @v redacted		Buffer for URI string with any password redacted
+ * @v redacted_len	Length of buffer
+ * @ret uri		Parsed URI, or NULL if the image was cached
+ * @ret resolved_uri	Resolved URI (for adding to image cache), or NULL
+ * @ret rc		Return status code
+ *
+ * If the image is permitted to come from the image cache and is
+ * available there, it is registered immediately, and both @c uri and
+ * @c resolved_uri are returned as NULL.  Otherwise, the caller must
+ * drop the references to both URIs once the download is complete.
+ */
+static int imgfetch_prepare ( struct image *image, const char *uri_string,
+			      int ( * image_register ) ( struct image *image ),
+			      char *redacted, size_t redacted_len,
+			      struct uri **uri, struct uri **resolved_uri ) {
+	const char *password;
+	int rc;
+
+	*resolved_uri = NULL;
+	if ( ! ( *uri = parse_uri ( uri_string ) ) )
+		return -ENOMEM;
+
+	image_set_uri ( image, *uri );
+
+	/* Redact password portion of URI, if necessary */
+	password = (*uri)->password;
+	if ( password )
+		(*uri)->password = "***";
+	unparse_uri ( redacted, redacted_len, *uri, URI_ALL );
+	(*uri)->password = password;
+
+	/* Use cached copy of image, if permitted and available */
+	if ( image->flags & IMAGE_CACHEABLE )
+		*resolved_uri = resolve_uri ( cwuri, *uri );
+	if ( *resolved_uri &&
+	     ( imgcache_fetch ( image, *resolved_uri ) == 0 ) ) {
+		printf ( "%s... ok (cached)\n", redacted );
+		rc = image_register ( image );
+		uri_put ( *resolved_uri );
+		*resolved_uri = NULL;
+		uri_put ( *uri );
+		*uri = NULL;
+		return rc;
+	}
+
+	return 0;
+}
+
 /**
  * Fetch an image
  *
@@ -48,26 +131,112 @@ int imgfetch ( struct image *image, const char *uri_string,
 	char uri_string_redacted[ strlen ( uri_string ) + 3 /* "***" */
 				  + 1 /* NUL */ ];
 	struct uri *uri;
-	const char *password;
+	struct uri *resolved_uri;
 	int rc;
 
-	if ( ! ( uri = parse_uri ( uri_string ) ) )
-		return -ENOMEM;
-
-	image_set_uri ( image, uri );
-
-	/* Redact password portion of URI, if necessary */
-	password = uri->password;
-	if ( password )
-		uri->password = "***";
-	unparse_uri ( uri_string_redacted, sizeof ( uri_string_redacted ),
-		      uri, URI_ALL );
-	uri->password = password;
+	if ( ( ( rc = imgfetch_prepare ( image, uri_string, image_register,
+					 uri_string_redacted,
+					 sizeof ( uri_string_redacted ),
+					 &uri, &resolved_uri ) ) != 0 ) ||
+	     ( ! uri ) )
+		return rc;
 
 	if ( ( rc = create_downloader ( &monojob, image, image_register,
 					LOCATION_URI, uri ) ) == 0 )
 		rc = monojob_wait ( uri_string_redacted );
 
+	/* Add successfully downloaded image to cache */
+	if ( ( rc == 0 ) && resolved_uri )
+		imgcache_add ( image, resolved_uri );
+
+	uri_put ( resolved_uri );
+	uri_put ( uri );
+	return rc;
+}
+
+/** A background image fetch */
+struct imgfetch_background {
+	/** Image */
+	struct image *image;
+	/** Resolved URI (for adding to image cache), or NULL */
+	struct uri *resolved_uri;
+};
+
+/**
+ * Handle background image fetch completion
+ *
+ * @v bgjob		Background job
+ * @v rc		Final status code
+ */
+static void imgfetch_background_complete ( struct bgjob *bgjob, int rc ) {
+	struct imgfetch_background *fetch = bgjob->priv;
+
+	/* Add successfully downloaded image to cache */
+	if ( ( rc == 0 ) && fetch->resolved_uri )
+		imgcache_add ( fetch->image, fetch->resolved_uri );
+
+	image_put ( fetch->image );
+	fetch->image = NULL;
+	uri_put ( fetch->resolved_uri );
+	fetch->resolved_uri = NULL;
+}
+
+/**
+ * Fetch an image in the background
+ *
+ * @v image		Image
+ * @v uri_string	URI as a string (e.g. "http://www.nowhere.com/vmlinuz")
+ * @v register_image	Image registration routine
+ * @ret bgjob		Background job, or NULL if already complete
+ * @ret rc		Return status code
+ *
+ * The image will be registered when the download completes; use
+ * bgjob_wait() to wait for completion.  If the image is available
+ * from the image cache, it is registered immediately and no
+ * background job is created.
+ */
+int imgfetch_background ( struct image *image, const char *uri_string,
+			  int ( * image_register ) ( struct image *image ),
+			  struct bgjob **bgjob ) {
+	char uri_string_redacted[ strlen ( uri_string ) + 3 /* "***" */
+				  + 1 /* NUL */ ];
+	struct imgfetch_background *fetch;
+	struct uri *uri;
+	struct uri *resolved_uri;
+	int rc;
+
+	*bgjob = NULL;
+	if ( ( ( rc = imgfetch_prepare ( image, uri_string, image_register,
+					 uri_string_redacted,
+					 sizeof ( uri_string_redacted ),
+					 &uri, &resolved_uri ) ) != 0 ) ||
+	     ( ! uri ) )
+		return rc;
+
+	/* Allocate background job */
+	*bgjob = alloc_bgjob ( uri_string_redacted, sizeof ( *fetch ) );
+	if ( ! *bgjob ) {
+		rc = -ENOMEM;
+		goto done;
+	}
+	fetch = (*bgjob)->priv;
+	fetch->image = image_get ( image );
+	fetch->resolved_uri = uri_get ( resolved_uri );
+	(*bgjob)->complete = imgfetch_background_complete;
+
+	/* Start download */
+	if ( ( rc = create_downloader ( &(*bgjob)->job, image, image_register,
+					LOCATION_URI, uri ) ) != 0 ) {
+		imgfetch_background_complete ( *bgjob, rc );
+		bgjob_put ( *bgjob );
+		*bgjob = NULL;
+		goto done;
+	}
+	register_bgjob ( *bgjob );
+	bgjob_put ( *bgjob );
+
+ done:
+	uri_put ( resolved_uri );
 	uri_put ( uri );
 	return rc;
 }
@@ -0,0 +1,65 @@
+#!/usr/bin/perl -w
+# usage:
+# [somebody@somewhere ~/gpxe/src]$ ./util/compsize.pl [<target> ...]
+# by default <target> is bin/gpxe.lkrn
+#
+# Builds each target once with each available image compressor, and
+# reports the resulting image sizes, followed by the compression ratio
+# and (host reference) decompression speed of each compressor for the
+# blocks that the prefix decompresses.
+
+use strict;
+
+-d "bin" or die "Please run me in the gPXE src directory\n";
+
+my @compressors = qw(nrv2b lz4);
+my @targets = @ARGV ? @ARGV : ("bin/gpxe.lkrn");
+
+sub build($$) {
+  my($target, $compressor) = @_;
+
+  # The linked image does not depend upon COMPRESSOR, so force a relink
+  unlink($target, map { "$target.$_" } qw(tmp bin zinfo zbin));
+  system("make COMPRESSOR=$compressor $target >/dev/null") == 0
+      or die "Error making $target with $compressor\n";
+}
+
+system("make util/zbench >/dev/null") == 0 or die "Error making zbench\n";
+
+our %Sizes;
+
+foreach my $target (@targets) {
+  foreach my $compressor (@compressors) {
+    build($target, $compressor);
+    $Sizes{$target}{$compressor} = -s $target;
+  }
+}
+
+printf "%-24s", "Target";
+printf " %10s", $_ foreach @compressors;
+print "\n";
+foreach my $target (@targets) {
+  my $base = $Sizes{$target}{$compressors[0]};
+  printf "%-24s", $target;
+  foreach my $compressor (@compressors) {
+    my $size = $Sizes{$target}{$compressor};
+    if ($compressor eq $compressors[0]) {
+      printf " %10d", $size;
+    } else {
+      printf " %+10d", ($size - $base);
+    }
+  }
+  print "\n";
+}
+
+foreach my $target (@targets) {
+  print "\n$target:\n";
+  system("make $target.bin $target.zinfo >/dev/null") == 0
+      or die "Error making $target.bin\n";
+  system("./util/zbench $target.bin $target.zinfo") == 0
+      or die "Error comparing compressors for $target\n";
+  unlink("$target.bin", "$target.zinfo");
+
+  # Leave the target built with the default compressor
+  build($target, $compressors[0]);
+}
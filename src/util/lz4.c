@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/** @file
+ *
+ * LZ4 block compression
+ *
+ * This file is #included by host utilities (zbin, zbench) in the
+ * same way as nrv2b.c.  Define ENCODE to obtain lz4_compress() and
+ * DECODE to obtain lz4_decompress().
+ *
+ * The output is a standard LZ4 block (i.e. a sequence of tokens,
+ * literals and 16-bit match offsets, with no frame header).  Since
+ * a block does not record its own length, the decompressor stops
+ * when the expected quantity of output has been produced; this
+ * length is always known to the prefix (see install_block).
+ *
+ * The compressor uses hash chains and lazy matching in order to
+ * trade compression time (which is spent only once, at build time)
+ * for density.  The decompressor needs nothing more than byte
+ * copies, which keeps the real-mode decompressor (unlz4.S) small
+ * and fast.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Minimum match length */
+#define LZ4_MIN_MATCH 4
+
+/** Maximum match offset */
+#define LZ4_MAX_OFFSET 0xffff
+
+/** Number of trailing bytes which must always be literals */
+#define LZ4_LAST_LITERALS 5
+
+/** Minimum distance from start of last match to end of block */
+#define LZ4_MF_LIMIT 12
+
+/** Maximum value held within a token length field */
+#define LZ4_TOKEN_MAX 0x0f
+
+/**
+ * Calculate maximum compressed length
+ *
+ * @v len		Uncompressed length
+ * @ret max_len		Maximum compressed length
+ */
+#define LZ4_MAX_LEN( len ) ( (len) + ( (len) / 255 ) + 16 )
+
+#ifdef ENCODE
+
+/** Number of bits in hash table index */
+#define LZ4_HASH_BITS 16
+
+/** Maximum number of hash chain entries to examine per position */
+#define LZ4_CHAIN_DEPTH 1024
+
+/** Hash chain window mask */
+#define LZ4_WINDOW_MASK LZ4_MAX_OFFSET
+
+/** LZ4 match finder */
+struct lz4_matcher {
+	/** Input data */
+	const uint8_t *in;
+	/** Length of input data */
+	size_t len;
+	/** Most recent position for each hash value, or -1 */
+	long head[ 1 << LZ4_HASH_BITS ];
+	/** Previous position with the same hash value, or -1 */
+	long prev[ LZ4_WINDOW_MASK + 1 ];
+	/** Number of positions inserted into hash chains */
+	size_t inserted;
+};
+
+/**
+ * Calculate hash of four bytes
+ *
+ * @v data		Data
+ * @ret hash		Hash value
+ */
+static unsigned int lz4_hash ( const uint8_t *data ) {
+	uint32_t value = ( data[0] | ( data[1] << 8 ) | ( data[2] << 16 ) |
+			   ( ( uint32_t ) data[3] << 24 ) );
+
+	return ( ( value * 2654435761U ) >> ( 32 - LZ4_HASH_BITS ) );
+}
+
+/**
+ * Insert positions into hash chains
+ *
+ * @v matcher		Match finder
+ * @v pos		Position up to which to insert (exclusive)
+ */
+static void lz4_insert ( struct lz4_matcher *matcher, size_t pos ) {
+	unsigned int hash;
+
+	for ( ; matcher->inserted < pos ; matcher->inserted++ ) {
+		if ( ( matcher->inserted + LZ4_MIN_MATCH ) > matcher->len )
+			continue;
+		hash = lz4_hash ( matcher->in + matcher->inserted );
+		matcher->prev[ matcher->inserted & LZ4_WINDOW_MASK ] =
+			matcher->head[hash];
+		matcher->head[hash] = matcher->inserted;
+	}
+}
+
+/**
+ * Find longest match
+ *
+ * @v matcher		Match finder
+ * @v pos		Position
+ * @v limit		Position beyond which a match may not extend
+ * @ret offset		Match offset
+ * @ret len		Match length, or zero if no match was found
+ */
+static size_t lz4_find ( struct lz4_matcher *matcher, size_t pos,
+			 size_t limit, size_t *offset ) {
+	const uint8_t *in = matcher->in;
+	unsigned int depth = LZ4_CHAIN_DEPTH;
+	size_t best_len = 0;
+	size_t len;
+	long candidate;
+
+	lz4_insert ( matcher, pos );
+	if ( ( pos + LZ4_MIN_MATCH ) > limit )
+		return 0;
+
+	candidate = matcher->head[ lz4_hash ( in + pos ) ];
+	while ( ( candidate >= 0 ) && depth-- &&
+		( ( pos - candidate ) <= LZ4_MAX_OFFSET ) ) {
+		if ( in[ candidate + best_len ] == in[ pos + best_len ] ) {
+			for ( len = 0 ; ( pos + len ) < limit ; len++ ) {
+				if ( in[ candidate + len ] != in[ pos + len ] )
+					break;
+			}
+			if ( len > best_len ) {
+				best_len = len;
+				*offset = ( pos - candidate );
+				if ( ( pos + len ) == limit )
+					break;
+			}
+		}
+		candidate = matcher->prev[ candidate & LZ4_WINDOW_MASK ];
+	}
+
+	return ( ( best_len >= LZ4_MIN_MATCH ) ? best_len : 0 );
+}
+
+/**
+ * Write extended length
+ *
+ * @v out		Output pointer
+ * @v len		Length in excess of LZ4_TOKEN_MAX
+ * @ret out		Updated output pointer
+ */
+static uint8_t * lz4_put_len ( uint8_t *out, size_t len ) {
+
+	for ( ; len >= 0xff ; len -= 0xff )
+		*(out++) = 0xff;
+	*(out++) = len;
+	return out;
+}
+
+/**
+ * Write sequence
+ *
+ * @v out		Output pointer
+ * @v literals		Literal data
+ * @v literals_len	Length of literal data
+ * @v offset		Match offset
+ * @v match_len		Match length, or zero for the final sequence
+ * @ret out		Updated output pointer
+ */
+static uint8_t * lz4_put_sequence ( uint8_t *out, const uint8_t *literals,
+				    size_t literals_len, size_t offset,
+				    size_t match_len ) {
+	uint8_t *token = out++;
+	size_t match_code = ( match_len ? ( match_len - LZ4_MIN_MATCH ) : 0 );
+
+	*token = ( ( ( literals_len < LZ4_TOKEN_MAX ) ?
+		     literals_len : LZ4_TOKEN_MAX ) << 4 );
+	if ( literals_len >= LZ4_TOKEN_MAX )
+		out = lz4_put_len ( out, ( literals_len - LZ4_TOKEN_MAX ) );
+	memcpy ( out, literals, literals_len );
+	out += literals_len;
+	if ( ! match_len )
+		return out;
+
+	*(out++) = ( offset & 0xff );
+	*(out++) = ( offset >> 8 );
+	*token |= ( ( match_code < LZ4_TOKEN_MAX ) ?
+		    match_code : LZ4_TOKEN_MAX );
+	if ( match_code >= LZ4_TOKEN_MAX )
+		out = lz4_put_len ( out, ( match_code - LZ4_TOKEN_MAX ) );
+	return out;
+}
+
+/**
+ * Compress data
+ *
+ * @v in		Input data
+ * @v in_len		Length of input data
+ * @v out		Output buffer (at least LZ4_MAX_LEN(in_len) bytes)
+ * @ret out_len		Length of output data
+ * @ret rc		Return status code (zero on success)
+ */
+static int lz4_compress ( const uint8_t *in, size_t in_len,
+			  uint8_t *out, size_t *out_len ) {
+	struct lz4_matcher *matcher;
+	uint8_t *start = out;
+	size_t mf_limit;
+	size_t limit;
+	size_t anchor = 0;
+	size_t pos = 0;
+	size_t len;
+	size_t offset;
+	size_t next_len;
+	size_t next_offset;
+
+	matcher = malloc ( sizeof ( *matcher ) );
+	if ( ! matcher )
+		return -1;
+	memset ( matcher->head, 0xff, sizeof ( matcher->head ) );
+	memset ( matcher->prev, 0xff, sizeof ( matcher->prev ) );
+	matcher->in = in;
+	matcher->len = in_len;
+	matcher->inserted = 0;
+
+	mf_limit = ( ( in_len > LZ4_MF_LIMIT ) ? ( in_len - LZ4_MF_LIMIT ) : 0 );
+	limit = ( ( in_len > LZ4_LAST_LITERALS ) ?
+		  ( in_len - LZ4_LAST_LITERALS ) : 0 );
+
+	while ( pos < mf_limit ) {
+		len = lz4_find ( matcher, pos, limit, &offset );
+		if ( ! len ) {
+			pos++;
+			continue;
+		}
+		/* Defer to a longer match starting at the next byte */
+		if ( ( pos + 1 ) < mf_limit ) {
+			next_len = lz4_find ( matcher, ( pos + 1 ), limit,
+					      &next_offset );
+			if ( next_len > len ) {
+				pos++;
+				continue;
+			}
+		}
+		out = lz4_put_sequence ( out, ( in + anchor ), ( pos - anchor ),
+					 offset, len );
+		pos += len;
+		anchor = pos;
+	}
+	out = lz4_put_sequence ( out, ( in + anchor ), ( in_len - anchor ),
+				 0, 0 );
+
+	free ( matcher );
+	*out_len = ( out - start );
+	return 0;
+}
+
+#endif /* ENCODE */
+
+#ifdef DECODE
+
+/**
+ * Read extended length
+ *
+ * @v in		Input data
+ * @v in_len		Length of input data
+ * @v ilen		Input position
+ * @v len		Length to extend
+ * @ret rc		Return status code (zero on success)
+ */
+static int lz4_get_len ( const uint8_t *in, size_t in_len, size_t *ilen,
+			 size_t *len ) {
+	uint8_t byte;
+
+	if ( *len != LZ4_TOKEN_MAX )
+		return 0;
+	do {
+		if ( *ilen >= in_len )
+			return -1;
+		byte = in[ (*ilen)++ ];
+		*len += byte;
+	} while ( byte == 0xff );
+	return 0;
+}
+
+/**
+ * Decompress data
+ *
+ * @v in		Input data
+ * @v in_len		Length of input data
+ * @v out		Output buffer
+ * @v out_len		Length of decompressed data
+ * @ret used		Length of input data consumed, or negative error
+ *
+ * As with the real-mode decompressor, decompression stops as soon
+ * as @c out_len bytes have been produced.
+ */
+static long lz4_decompress ( const uint8_t *in, size_t in_len,
+			     uint8_t *out, size_t out_len ) {
+	size_t ilen = 0;
+	size_t olen = 0;
+	size_t len;
+	size_t offset;
+	uint8_t token;
+
+	while ( olen < out_len ) {
+		if ( ilen >= in_len )
+			return -1;
+		token = in[ ilen++ ];
+
+		/* Copy literals */
+		len = ( token >> 4 );
+		if ( lz4_get_len ( in, in_len, &ilen, &len ) != 0 )
+			return -1;
+		if ( ( ( ilen + len ) > in_len ) ||
+		     ( ( olen + len ) > out_len ) )
+			return -1;
+		memcpy ( ( out + olen ), ( in + ilen ), len );
+		ilen += len;
+		olen += len;
+		if ( olen == out_len )
+			break;
+
+		/* Copy match */
+		if ( ( ilen + 2 ) > in_len )
+			return -1;
+		offset = ( in[ilen] | ( in[ ilen + 1 ] << 8 ) );
+		ilen += 2;
+		len = ( token & LZ4_TOKEN_MAX );
+		if ( lz4_get_len ( in, in_len, &ilen, &len ) != 0 )
+			return -1;
+		len += LZ4_MIN_MATCH;
+		if ( ( offset == 0 ) || ( offset > olen ) ||
+		     ( ( olen + len ) > out_len ) )
+			return -1;
+		for ( ; len ; len--, olen++ )
+			out[olen] = out[ olen - offset ];
+	}
+
+	return ilen;
+}
+
+#endif /* DECODE */
@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+
+#define FILE_LICENCE( _licence )
+#include <gpxe/mfec.h>
+
+#define eprintf(...) fprintf ( stderr, __VA_ARGS__ )
+
+/** GF(2^8) generator polynomial (must match core/fec.c) */
+#define GF_POLY 0x11d
+
+/** Maximum number of source blocks per group (must match core/fec.c) */
+#define MAX_K 32
+
+/** Command-line options */
+struct options {
+	unsigned int blksize;
+	unsigned int k;
+	unsigned int r;
+	unsigned int rate;
+	unsigned int ttl;
+	unsigned int rounds;
+};
+
+/** GF(2^8) exponent table */
+static uint8_t gf_exp[510];
+
+/** GF(2^8) logarithm table */
+static uint8_t gf_log[256];
+
+/**
+ * Initialise GF(2^8) tables
+ *
+ */
+static void gf_init ( void ) {
+	unsigned int x = 1;
+	unsigned int i;
+
+	for ( i = 0 ; i < 255 ; i++ ) {
+		gf_exp[i] = gf_exp[ i + 255 ] = x;
+		gf_log[x] = i;
+		x <<= 1;
+		if ( x & 0x100 )
+			x ^= GF_POLY;
+	}
+}
+
+/**
+ * Construct repair block
+ *
+ * @v k			Number of source blocks per group
+ * @v r			Number of repair blocks per group
+ * @v repair		Repair block index
+ * @v sources		Source blocks (contiguous)
+ * @v blksize		Block size
+ * @v out		Repair block to fill in
+ */
+static void encode ( unsigned int k, unsigned int r, unsigned int repair,
+		     const uint8_t *sources, size_t blksize, uint8_t *out ) {
+	unsigned int log_c;
+	unsigned int i;
+	size_t j;
+
+	memset ( out, 0, blksize );
+	for ( i = 0 ; i < k ; i++ ) {
+		/* Coefficient is 1 / ( repair XOR ( r + i ) ) */
+		log_c = ( 255 - gf_log[ repair ^ ( r + i ) ] );
+		for ( j = 0 ; j < blksize ; j++ ) {
+			if ( sources[j] )
+				out[j] ^= gf_exp[ gf_log[sources[j]] + log_c ];
+		}
+		sources += blksize;
+	}
+}
+
+/**
+ * Transmit file
+ *
+ * @v fd		Socket
+ * @v dest		Destination address
+ * @v data		File data (padded to a whole number of groups)
+ * @v len		File length
+ * @v opts		Command-line options
+ */
+static void transmit ( int fd, struct sockaddr_in *dest, uint8_t *data,
+		       size_t len, struct options *opts ) {
+	size_t group_len = ( opts->k * opts->blksize );
+	unsigned long num_groups = ( ( len + group_len - 1 ) / group_len );
+	size_t pkt_len = ( sizeof ( struct mfec_header ) + opts->blksize );
+	struct timespec delay;
+	struct mfec_header *hdr;
+	uint8_t *repair;
+	uint8_t *pkt;
+	unsigned long group;
+	unsigned int round;
+	unsigned int index;
+
+	pkt = malloc ( pkt_len );
+	repair = malloc ( num_groups * opts->r * opts->blksize );
+	if ( ! ( pkt && repair ) ) {
+		eprintf ( "Out of memory\n" );
+		exit ( 1 );
+	}
+
+	/* Construct all repair blocks in advance */
+	for ( group = 0 ; group < num_groups ; group++ ) {
+		for ( index = 0 ; index < opts->r ; index++ ) {
+			encode ( opts->k, opts->r, index,
+				 ( data + ( group * group_len ) ),
+				 opts->blksize,
+				 ( repair + ( ( ( group * opts->r ) + index ) *
+					      opts->blksize ) ) );
+		}
+	}
+
+	/* Construct fixed header fields */
+	hdr = ( ( struct mfec_header * ) pkt );
+	memset ( hdr, 0, sizeof ( *hdr ) );
+	hdr->magic = htonl ( MFEC_MAGIC );
+	hdr->session = htonl ( ( time ( NULL ) << 8 ) ^ getpid() );
+	hdr->len = htonl ( len );
+	hdr->blksize = htons ( opts->blksize );
+	hdr->k = opts->k;
+	hdr->r = opts->r;
+	delay.tv_sec = 0;
+	delay.tv_nsec = ( opts->rate ? ( 1000000000UL / opts->rate ) : 0 );
+
+	/* Transmit carousel.  Blocks are interleaved across groups so
+	 * that a burst of packet loss is spread over many groups.
+	 */
+	for ( round = 0 ; ( ( opts->rounds == 0 ) ||
+			    ( round < opts->rounds ) ) ; round++ ) {
+		for ( index = 0 ; index < ( opts->k + opts->r ) ; index++ ) {
+			for ( group = 0 ; group < num_groups ; group++ ) {
+				hdr->group = htonl ( group );
+				hdr->index = index;
+				if ( index < opts->k ) {
+					memcpy ( ( hdr + 1 ),
+						 ( data + ( group * group_len ) +
+						   ( index * opts->blksize ) ),
+						 opts->blksize );
+				} else {
+					memcpy ( ( hdr + 1 ),
+						 ( repair +
+						   ( ( ( group * opts->r ) +
+						       ( index - opts->k ) ) *
+						     opts->blksize ) ),
+						 opts->blksize );
+				}
+				if ( sendto ( fd, pkt, pkt_len, 0,
+					      ( struct sockaddr * ) dest,
+					      sizeof ( *dest ) ) < 0 ) {
+					eprintf ( "Cannot send: %s\n",
+						  strerror ( errno ) );
+				}
+				if ( delay.tv_nsec )
+					nanosleep ( &delay, NULL );
+			}
+		}
+	}
+
+	free ( repair );
+	free ( pkt );
+}
+
+/**
+ * Serve file
+ *
+ * @v address		Multicast address and port
+ * @v infile		Filename
+ * @v opts		Command-line options
+ */
+static void mfecd ( const char *address, const char *infile,
+		    struct options *opts ) {
+	struct sockaddr_in dest;
+	unsigned char ttl = opts->ttl;
+	char addr_buf[32];
+	struct stat stat;
+	size_t group_len;
+	size_t len;
+	uint8_t *data;
+	char *sep;
+	int fd;
+
+	/* Parse address */
+	memset ( &dest, 0, sizeof ( dest ) );
+	dest.sin_family = AF_INET;
+	dest.sin_port = htons ( MFEC_DEFAULT_PORT );
+	snprintf ( addr_buf, sizeof ( addr_buf ), "%s", address );
+	sep = strchr ( addr_buf, ':' );
+	if ( sep ) {
+		*(sep++) = '\0';
+		dest.sin_port = htons ( strtoul ( sep, NULL, 0 ) );
+	}
+	if ( inet_aton ( addr_buf, &dest.sin_addr ) == 0 ) {
+		eprintf ( "Invalid address \"%s\"\n", address );
+		exit ( 1 );
+	}
+
+	/* Read file, padded to a whole number of groups */
+	if ( ( fd = open ( infile, O_RDONLY ) ) < 0 ) {
+		eprintf ( "Cannot open \"%s\": %s\n",
+			  infile, strerror ( errno ) );
+		exit ( 1 );
+	}
+	if ( fstat ( fd, &stat ) < 0 ) {
+		eprintf ( "Cannot stat \"%s\": %s\n",
+			  infile, strerror ( errno ) );
+		exit ( 1 );
+	}
+	len = stat.st_size;
+	group_len = ( opts->k * opts->blksize );
+	data = calloc ( 1, ( ( ( len + group_len - 1 ) / group_len ) *
+			     group_len ) + 1 );
+	if ( ! data ) {
+		eprintf ( "Out of memory\n" );
+		exit ( 1 );
+	}
+	if ( read ( fd, data, len ) != ( ssize_t ) len ) {
+		eprintf ( "Cannot read \"%s\": %s\n",
+			  infile, strerror ( errno ) );
+		exit ( 1 );
+	}
+	close ( fd );
+
+	/* Open socket */
+	if ( ( fd = socket ( AF_INET, SOCK_DGRAM, 0 ) ) < 0 ) {
+		eprintf ( "Cannot open socket: %s\n", strerror ( errno ) );
+		exit ( 1 );
+	}
+	if ( setsockopt ( fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl,
+			  sizeof ( ttl ) ) < 0 ) {
+		eprintf ( "Cannot set TTL: %s\n", strerror ( errno ) );
+		exit ( 1 );
+	}
+
+	printf ( "Serving \"%s\" (%zd bytes) to %s:%d as %d+%d blocks of "
+		 "%d bytes\n", infile, len, inet_ntoa ( dest.sin_addr ),
+		 ntohs ( dest.sin_port ), opts->k, opts->r, opts->blksize );
+	transmit ( fd, &dest, data, len, opts );
+
+	close ( fd );
+	free ( data );
+}
+
+/**
+ * Print help
+ *
+ * @v program_name	Program name
+ */
+static void print_help ( const char *program_name ) {
+	eprintf ( "Syntax: %s [--blksize=<bytes>] [--k=<n>] [--r=<n>]\n"
+		  "          [--rate=<packets/sec>] [--ttl=<n>] "
+		  "[--rounds=<n>]\n"
+		  "          <address>[:<port>] <file>\n", program_name );
+}
+
+/**
+ * Parse command-line options
+ *
+ * @v argc		Argument count
+ * @v argv		Argument list
+ * @v opts		Options structure to populate
+ */
+static int parse_options ( const int argc, char **argv,
+			   struct options *opts ) {
+	char *end;
+	int c;
+
+	while (1) {
+		int option_index = 0;
+		static struct option long_options[] = {
+			{ "blksize", required_argument, NULL, 'b' },
+			{ "k", required_argument, NULL, 'k' },
+			{ "r", required_argument, NULL, 'r' },
+			{ "rate", required_argument, NULL, 'p' },
+			{ "ttl", required_argument, NULL, 't' },
+			{ "rounds", required_argument, NULL, 'n' },
+			{ "help", 0, NULL, 'h' },
+			{ 0, 0, 0, 0 }
+		};
+
+		if ( ( c = getopt_long ( argc, argv, "b:k:r:p:t:n:h",
+					 long_options,
+					 &option_index ) ) == -1 ) {
+			break;
+		}
+
+		switch ( c ) {
+		case 'b':
+			opts->blksize = strtoul ( optarg, &end, 0 );
+			if ( *end || ( opts->blksize == 0 ) ||
+			     ( opts->blksize > 65535 ) ) {
+				eprintf ( "Invalid block size\n" );
+				exit ( 2 );
+			}
+			break;
+		case 'k':
+			opts->k = strtoul ( optarg, &end, 0 );
+			if ( *end || ( opts->k == 0 ) || ( opts->k > MAX_K ) ) {
+				eprintf ( "Invalid source block count\n" );
+				exit ( 2 );
+			}
+			break;
+		case 'r':
+			opts->r = strtoul ( optarg, &end, 0 );
+			if ( *end || ( opts->r > ( 256 - MAX_K ) ) ) {
+				eprintf ( "Invalid repair block count\n" );
+				exit ( 2 );
+			}
+			break;
+		case 'p':
+			opts->rate = strtoul ( optarg, &end, 0 );
+			if ( *end ) {
+				eprintf ( "Invalid rate\n" );
+				exit ( 2 );
+			}
+			break;
+		case 't':
+			opts->ttl = strtoul ( optarg, &end, 0 );
+			if ( *end || ( opts->ttl > 255 ) ) {
+				eprintf ( "Invalid TTL\n" );
+				exit ( 2 );
+			}
+			break;
+		case 'n':
+			opts->rounds = strtoul ( optarg, &end, 0 );
+			if ( *end ) {
+				eprintf ( "Invalid round count\n" );
+				exit ( 2 );
+			}
+			break;
+		case 'h':
+			print_help ( argv[0] );
+			exit ( 0 );
+		case '?':
+		default:
+			exit ( 2 );
+		}
+	}
+	return optind;
+}
+
+int main ( int argc, char **argv ) {
+	struct options opts = {
+		.blksize = 1024,
+		.k = 16,
+		.r = 4,
+		.rate = 5000,
+		.ttl = 1,
+		.rounds = 0,
+	};
+	int infile_index;
+
+	/* Parse command-line arguments */
+	infile_index = parse_options ( argc, argv, &opts );
+	if ( argc != ( infile_index + 2 ) ) {
+		print_help ( argv[0] );
+		exit ( 2 );
+	}
+
+	/* Serve file */
+	gf_init();
+	mfecd ( argv[infile_index], argv[ infile_index + 1 ], &opts );
+
+	return 0;
+}
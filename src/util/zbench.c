@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2010 Michael Brown <mbrown@fensystems.co.uk>.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/*
+ * Compare the available image compressors
+ *
+ * Compresses each block that zbin would compress (i.e. each PACK
+ * record in the .zinfo file) using every available compressor,
+ * checks that the result decompresses correctly, and reports the
+ * compressed size along with compression and decompression times.
+ *
+ * Decompression is timed using host C reference decoders, which
+ * perform the same operations as the prefix decompressors.  The
+ * absolute figures therefore say little about speed in real mode,
+ * but the relative figures are a reasonable guide.
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define ENCODE
+#define DECODE
+#include "nrv2b.c"
+#include "lz4.c"
+FILE *infile, *outfile;
+
+/* Minimum time over which to measure decompression, in microseconds */
+#define MIN_DECOMPRESS_TIME 200000
+
+/* Number of bytes by which a decompressor may overrun its input */
+#define INPUT_SLACK 8
+
+struct zinfo_pack {
+	char type[4];
+	uint32_t offset;
+	uint32_t len;
+	uint32_t align;
+};
+
+struct compressor {
+	const char *name;
+	int ( * compress ) ( const uint8_t *in, size_t in_len,
+			     uint8_t *out, size_t *out_len );
+	long ( * decompress ) ( const uint8_t *in, size_t in_len,
+				uint8_t *out, size_t out_len );
+};
+
+struct block {
+	const uint8_t *data;
+	size_t len;
+};
+
+static int compress_nrv2b ( const uint8_t *in, size_t in_len,
+			    uint8_t *out, size_t *out_len ) {
+	unsigned long packed_len;
+
+	if ( ucl_nrv2b_99_compress ( in, in_len, out, &packed_len,
+				     0 ) != UCL_E_OK )
+		return -1;
+	*out_len = packed_len;
+	return 0;
+}
+
+static long decompress_nrv2b ( const uint8_t *src, size_t src_len,
+			       uint8_t *dst, size_t dst_len ) {
+	unsigned long ilen = 0, olen = 0, last_m_off = 1;
+	uint32_t bb = 0;
+	unsigned bc = 0;
+	unsigned int m_off, m_len;
+
+	for ( ; ; ) {
+		while ( GETBIT ( bb, src, ilen ) ) {
+			if ( ( ilen >= src_len ) || ( olen >= dst_len ) )
+				return -1;
+			dst[olen++] = src[ilen++];
+		}
+		m_off = 1;
+		do {
+			m_off = m_off*2 + GETBIT ( bb, src, ilen );
+			if ( ( ilen >= src_len ) || ( m_off > 0xffffffU + 3 ) )
+				return -1;
+		} while ( ! GETBIT ( bb, src, ilen ) );
+		if ( m_off == 2 ) {
+			m_off = last_m_off;
+		} else {
+			if ( ilen >= src_len )
+				return -1;
+			m_off = ( m_off - 3 ) * 256 + src[ilen++];
+			if ( m_off == 0xffffffffU )
+				break;
+			last_m_off = ++m_off;
+		}
+		m_len = GETBIT ( bb, src, ilen );
+		m_len = m_len*2 + GETBIT ( bb, src, ilen );
+		if ( m_len == 0 ) {
+			m_len++;
+			do {
+				m_len = m_len*2 + GETBIT ( bb, src, ilen );
+				if ( ( ilen >= src_len ) ||
+				     ( m_len >= dst_len ) )
+					return -1;
+			} while ( ! GETBIT ( bb, src, ilen ) );
+			m_len += 2;
+		}
+		m_len += ( m_off > 0xd00 );
+		if ( ( ( olen + m_len + 1 ) > dst_len ) || ( m_off > olen ) )
+			return -1;
+		for ( m_len++ ; m_len ; m_len--, olen++ )
+			dst[olen] = dst[ olen - m_off ];
+	}
+
+	if ( olen != dst_len )
+		return -1;
+	return ilen;
+}
+
+static struct compressor compressors[] = {
+	{ "nrv2b", compress_nrv2b, decompress_nrv2b },
+	{ "lz4", lz4_compress, lz4_decompress },
+};
+
+static int read_file ( const char *filename, void **buf, size_t *len ) {
+	FILE *file;
+	struct stat stat;
+
+	file = fopen ( filename, "r" );
+	if ( ! file ) {
+		fprintf ( stderr, "Could not open %s: %s\n", filename,
+			  strerror ( errno ) );
+		goto err;
+	}
+
+	if ( fstat ( fileno ( file ), &stat ) < 0 ) {
+		fprintf ( stderr, "Could not stat %s: %s\n", filename,
+			  strerror ( errno ) );
+		goto err;
+	}
+
+	*len = stat.st_size;
+	*buf = malloc ( *len );
+	if ( ! *buf ) {
+		fprintf ( stderr, "Could not malloc() %zd bytes for %s: %s\n",
+			  *len, filename, strerror ( errno ) );
+		goto err;
+	}
+
+	if ( fread ( *buf, 1, *len, file ) != *len ) {
+		fprintf ( stderr, "Could not read %zd bytes from %s: %s\n",
+			  *len, filename, strerror ( errno ) );
+		goto err;
+	}
+
+	fclose ( file );
+	return 0;
+
+ err:
+	if ( file )
+		fclose ( file );
+	return -1;
+}
+
+static unsigned long elapsed ( struct timeval *start ) {
+	struct timeval now;
+
+	gettimeofday ( &now, NULL );
+	return ( ( now.tv_sec - start->tv_sec ) * 1000000UL +
+		 now.tv_usec - start->tv_usec );
+}
+
+static int bench ( struct compressor *compressor, struct block *blocks,
+		   unsigned int num_blocks ) {
+	struct block *block;
+	struct timeval start;
+	uint8_t *packed[num_blocks];
+	size_t packed_len[num_blocks];
+	uint8_t *unpacked;
+	size_t total_len = 0;
+	size_t total_packed_len = 0;
+	unsigned long pack_time;
+	unsigned long unpack_time;
+	unsigned int rounds = 0;
+	unsigned int i;
+
+	/* Compress all blocks */
+	gettimeofday ( &start, NULL );
+	for ( i = 0 ; i < num_blocks ; i++ ) {
+		block = &blocks[i];
+		packed[i] = calloc ( 1, ( LZ4_MAX_LEN ( block->len ) +
+					  ( block->len / 8 ) + INPUT_SLACK ) );
+		if ( ! packed[i] ) {
+			fprintf ( stderr, "Could not allocate buffer\n" );
+			return -1;
+		}
+		if ( compressor->compress ( block->data, block->len,
+					    packed[i], &packed_len[i] ) != 0 ) {
+			fprintf ( stderr, "%s: compression failure\n",
+				  compressor->name );
+			return -1;
+		}
+		total_len += block->len;
+		total_packed_len += packed_len[i];
+	}
+	pack_time = elapsed ( &start );
+
+	/* Decompress and verify all blocks, repeating until enough
+	 * time has elapsed to give a meaningful measurement.
+	 */
+	gettimeofday ( &start, NULL );
+	do {
+		for ( i = 0 ; i < num_blocks ; i++ ) {
+			block = &blocks[i];
+			unpacked = malloc ( block->len + 1 );
+			if ( ! unpacked ) {
+				fprintf ( stderr, "Could not allocate "
+					  "buffer\n" );
+				return -1;
+			}
+			if ( ( compressor->decompress ( packed[i],
+							packed_len[i],
+							unpacked,
+							block->len ) !=
+			       ( long ) packed_len[i] ) ||
+			     ( memcmp ( unpacked, block->data,
+					block->len ) != 0 ) ) {
+				fprintf ( stderr, "%s: block %d does not "
+					  "decompress correctly\n",
+					  compressor->name, i );
+				return -1;
+			}
+			free ( unpacked );
+		}
+		rounds++;
+	} while ( ( unpack_time = elapsed ( &start ) ) < MIN_DECOMPRESS_TIME );
+
+	printf ( "%-10s %9zd %9zd %6.1f%% %9.1f %11.1f\n", compressor->name,
+		 total_len, total_packed_len,
+		 ( 100.0 * total_packed_len / total_len ),
+		 ( pack_time / 1000.0 ),
+		 ( ( ( double ) total_len * rounds ) / unpack_time ) );
+
+	for ( i = 0 ; i < num_blocks ; i++ )
+		free ( packed[i] );
+	return 0;
+}
+
+int main ( int argc, char **argv ) {
+	void *input;
+	size_t input_len;
+	void *zinfo;
+	size_t zinfo_len;
+	struct zinfo_pack *pack;
+	struct block *blocks;
+	unsigned int num_blocks = 0;
+	unsigned int i;
+
+	if ( argc != 3 ) {
+		fprintf ( stderr, "Syntax: %s file.bin file.zinfo\n",
+			  argv[0] );
+		exit ( 1 );
+	}
+
+	if ( read_file ( argv[1], &input, &input_len ) < 0 )
+		exit ( 1 );
+	if ( read_file ( argv[2], &zinfo, &zinfo_len ) < 0 )
+		exit ( 1 );
+	if ( ( zinfo_len % sizeof ( *pack ) ) != 0 ) {
+		fprintf ( stderr, ".zinfo file %s has invalid length %zd\n",
+			  argv[2], zinfo_len );
+		exit ( 1 );
+	}
+
+	/* Collect blocks that would be compressed */
+	blocks = calloc ( ( zinfo_len / sizeof ( *pack ) ),
+			  sizeof ( blocks[0] ) );
+	if ( ! blocks ) {
+		fprintf ( stderr, "Could not allocate blocks\n" );
+		exit ( 1 );
+	}
+	for ( pack = zinfo ; ( ( void * ) pack ) < ( zinfo + zinfo_len ) ;
+	      pack++ ) {
+		if ( memcmp ( pack->type, "PACK", sizeof ( pack->type ) ) != 0 )
+			continue;
+		if ( ( pack->offset + pack->len ) > input_len ) {
+			fprintf ( stderr, "Input buffer overrun on pack\n" );
+			exit ( 1 );
+		}
+		if ( ! pack->len )
+			continue;
+		blocks[num_blocks].data = ( input + pack->offset );
+		blocks[num_blocks].len = pack->len;
+		num_blocks++;
+	}
+	if ( ! num_blocks ) {
+		fprintf ( stderr, "No compressed blocks in %s\n", argv[2] );
+		exit ( 1 );
+	}
+
+	printf ( "%-10s %9s %9s %7s %9s %11s\n", "Compressor", "Input",
+		 "Packed", "Ratio", "Pack ms", "Unpack MB/s" );
+	for ( i = 0 ; i < ( sizeof ( compressors ) /
+			    sizeof ( compressors[0] ) ) ; i++ ) {
+		if ( bench ( &compressors[i], blocks, num_blocks ) < 0 )
+			exit ( 1 );
+	}
+
+	return 0;
+}
@@ -4,6 +4,7 @@
 #define ENCODE
 #define VERBOSE
 #include "nrv2b.c"
+#include "lz4.c"
 FILE *infile, *outfile;
 
 #define DEBUG 0
@@ -53,12 +54,18 @@ struct zinfo_add {
 	uint32_t pad;
 };
 
+struct zinfo_algorithm {
+	char type[4];
+	char name[12];
+};
+
 union zinfo_record {
 	struct zinfo_common common;
 	struct zinfo_copy copy;
 	struct zinfo_pack pack;
 	struct zinfo_payload payload;
 	struct zinfo_add add;
+	struct zinfo_algorithm algorithm;
 };
 
 struct zinfo_file {
@@ -66,6 +73,31 @@ struct zinfo_file {
 	unsigned int num_entries;
 };
 
+struct compressor {
+	const char *name;
+	int ( * compress ) ( const uint8_t *in, size_t in_len,
+			     uint8_t *out, size_t *out_len );
+};
+
+static int compress_nrv2b ( const uint8_t *in, size_t in_len,
+			    uint8_t *out, size_t *out_len ) {
+	unsigned long packed_len;
+
+	if ( ucl_nrv2b_99_compress ( in, in_len, out, &packed_len,
+				     0 ) != UCL_E_OK )
+		return -1;
+	*out_len = packed_len;
+	return 0;
+}
+
+static struct compressor compressors[] = {
+	{ "nrv2b", compress_nrv2b },
+	{ "lz4", lz4_compress },
+};
+
+/* Compressor used for PACK records, selected by the ALGO record */
+static struct compressor *compressor = &compressors[0];
+
 static unsigned long align ( unsigned long value, unsigned long align ) {
 	return ( ( value + align - 1 ) & ~( align - 1 ) );
 }
@@ -183,7 +215,7 @@ static int process_zinfo_pack ( struct input_file *input,
 	struct zinfo_pack *pack = &zinfo->pack;
 	size_t offset = pack->offset;
 	size_t len = pack->len;
-	unsigned long packed_len;
+	size_t packed_len;
 
 	if ( ( offset + len ) > input->len ) {
 		fprintf ( stderr, "Input buffer overrun on pack\n" );
@@ -196,17 +228,17 @@ static int process_zinfo_pack ( struct input_file *input,
 		return -1;
 	}
 
-	if ( ucl_nrv2b_99_compress ( ( input->buf + offset ), len,
-				     ( output->buf + output->len ),
-				     &packed_len, 0 ) != UCL_E_OK ) {
+	if ( compressor->compress ( ( input->buf + offset ), len,
+				    ( output->buf + output->len ),
+				    &packed_len ) != 0 ) {
 		fprintf ( stderr, "Compression failure\n" );
 		return -1;
 	}
 
 	if ( DEBUG ) {
-		fprintf ( stderr, "PACK [%#zx,%#zx) to [%#zx,%#zx)\n",
+		fprintf ( stderr, "PACK [%#zx,%#zx) to [%#zx,%#zx) (%s)\n",
 			  offset, ( offset + len ), output->len,
-			  ( size_t )( output->len + packed_len ) );
+			  ( output->len + packed_len ), compressor->name );
 	}
 
 	output->len += packed_len;
@@ -231,6 +263,13 @@ static int process_zinfo_payl ( struct input_file *input,
 	}
 }
 
+static int process_zinfo_algo ( struct input_file *input,
+				struct output_file *output,
+				union zinfo_record *zinfo ) {
+	/* Compressor has already been selected by select_compressor() */
+	return 0;
+}
+
 static int process_zinfo_add ( struct input_file *input,
 			       struct output_file *output,
 			       size_t len,
@@ -365,6 +404,7 @@ static struct zinfo_processor zinfo_processors[] = {
 	{ "COPY", process_zinfo_copy },
 	{ "PACK", process_zinfo_pack },
 	{ "PAYL", process_zinfo_payl },
+	{ "ALGO", process_zinfo_algo },
 	{ "ADDB", process_zinfo_addb },
 	{ "ADDW", process_zinfo_addw },
 	{ "ADDL", process_zinfo_addl },
@@ -393,6 +433,38 @@ static int process_zinfo ( struct input_file *input,
 	return -1;
 }
 
+static int select_compressor ( struct zinfo_file *zinfo ) {
+	struct zinfo_algorithm *algorithm;
+	char name[ sizeof ( algorithm->name ) + 1 ];
+	unsigned int i;
+	unsigned int j;
+
+	/* The ALGO record, if present, may appear anywhere within
+	 * the .zinfo section (it is contributed by the decompressor),
+	 * so it must be found before any PACK record is processed.
+	 */
+	for ( i = 0 ; i < zinfo->num_entries ; i++ ) {
+		algorithm = &zinfo->zinfo[i].algorithm;
+		if ( memcmp ( algorithm->type, "ALGO",
+			      sizeof ( algorithm->type ) ) != 0 )
+			continue;
+		memset ( name, 0, sizeof ( name ) );
+		memcpy ( name, algorithm->name, sizeof ( algorithm->name ) );
+		for ( j = 0 ; j < ( sizeof ( compressors ) /
+				    sizeof ( compressors[0] ) ) ; j++ ) {
+			if ( strcmp ( compressors[j].name, name ) == 0 ) {
+				compressor = &compressors[j];
+				return 0;
+			}
+		}
+		fprintf ( stderr, "Unknown compression algorithm \"%s\"\n",
+			  name );
+		return -1;
+	}
+
+	return 0;
+}
+
 static int write_output_file ( struct output_file *output ) {
 	if ( fwrite ( output->buf, 1, output->len, stdout ) != output->len ) {
 		fprintf ( stderr, "Could not write %zd bytes of output: %s\n",
@@ -418,6 +490,8 @@ int main ( int argc, char **argv ) {
 		exit ( 1 );
 	if ( read_zinfo_file ( argv[2], &zinfo ) < 0 )
 		exit ( 1 );
+	if ( select_compressor ( &zinfo ) < 0 )
+		exit ( 1 );
 	if ( alloc_output_file ( ( input.len * 4 ), &output ) < 0 )
 		exit ( 1 );
 